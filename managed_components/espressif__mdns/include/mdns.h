@@ -92,6 +92,36 @@ typedef enum {
     MDNS_QUERY_MULTICAST,
 } mdns_query_transmission_type_t;
 
+/**
+ * @brief   Fixed-size block pools behind the allocations of outgoing packets (see CONFIG_MDNS_MEMORY_POOL)
+ */
+typedef enum {
+    MDNS_MEM_POOL_TX_PACKET,                /*!< outgoing packets */
+    MDNS_MEM_POOL_ANSWER,                   /*!< answers, authority and additional records of outgoing packets */
+    MDNS_MEM_POOL_QUESTION,                 /*!< questions of outgoing packets */
+    MDNS_MEM_POOL_MAX
+} mdns_mem_pool_t;
+
+/**
+ * @brief   Usage statistics of one block pool
+ */
+typedef struct {
+    size_t block_size;                      /*!< size of one block in bytes */
+    size_t capacity;                        /*!< number of pooled blocks (0 if the pools are disabled) */
+    size_t in_use;                          /*!< blocks currently allocated, pooled or not */
+    size_t high_water;                      /*!< maximum of in_use since mdns_init() */
+    uint32_t heap_allocs;                   /*!< allocations served from the heap because the pool was full */
+} mdns_mem_pool_stats_t;
+
+/**
+ * @brief   Counters of outgoing packets scheduled by the responder (probes, announcements, delayed answers)
+ */
+typedef struct {
+    uint32_t sent;                          /*!< packets written to the network */
+    uint32_t dropped;                       /*!< due packets not sent: interface down or network write failed */
+    uint32_t deferred;                      /*!< due packets held back a retry period because the action queue was full */
+} mdns_tx_stats_t;
+
 /**
  * @brief   mDNS query result structure
  */
@@ -466,6 +496,28 @@ esp_err_t mdns_service_txt_set_for_host(const char *instance, const char *servic
  */
 esp_err_t mdns_service_txt_item_set(const char *service_type, const char *proto, const char *key, const char *value);
 
+/**
+ * @brief  Set/Add TXT item for service TXT record without waiting for the mDNS task
+ *
+ * The item is copied to a pending slot and returns at once; the mDNS task applies it and
+ * announces the service. Updates made before it gets to them are merged: the last value of
+ * each key wins and the service is announced once. Unlike the other calls this one never
+ * takes the mDNS lock, so it may be used from time-critical tasks (not from an ISR).
+ * Errors found when the item is applied (no such service, out of memory) are only logged.
+ *
+ * @param  service_type service type (_http, _ftp, etc)
+ * @param  proto        service protocol (_tcp, _udp)
+ * @param  key          the key that you want to add/update, shorter than 16 characters
+ * @param  value        the new value of the key, shorter than 32 characters
+ *
+ * @return
+ *     - ESP_OK success
+ *     - ESP_ERR_INVALID_ARG Parameter error
+ *     - ESP_ERR_INVALID_STATE mDNS is not running
+ *     - ESP_ERR_NO_MEM all CONFIG_MDNS_TXT_ASYNC_ITEMS slots hold other pending keys
+ */
+esp_err_t mdns_service_txt_item_set_async(const char *service_type, const char *proto, const char *key, const char *value);
+
 /**
  * @brief  Set/Add TXT item for service TXT record
  *
@@ -930,6 +982,29 @@ mdns_browse_t *mdns_browse_new(const char *service, const char *proto, mdns_brow
  */
 esp_err_t mdns_browse_delete(const char *service, const char *proto);
 
+/**
+ * @brief   Get usage statistics of one of the outgoing packet pools
+ *
+ * @param pool   Pool to query
+ * @param stats  Filled with the current statistics
+ * @return
+ *     - ESP_OK                 success
+ *     - ESP_ERR_INVALID_ARG    unknown pool or NULL stats
+ *     - ESP_ERR_INVALID_STATE  mDNS is not running
+ */
+esp_err_t mdns_mem_pool_get_stats(mdns_mem_pool_t pool, mdns_mem_pool_stats_t *stats);
+
+/**
+ * @brief   Get the counters of the outgoing packet scheduler
+ *
+ * @param stats  Filled with the counters since mdns_init()
+ * @return
+ *     - ESP_OK                 success
+ *     - ESP_ERR_INVALID_ARG    NULL stats
+ *     - ESP_ERR_INVALID_STATE  mDNS is not running
+ */
+esp_err_t mdns_tx_get_stats(mdns_tx_stats_t *stats);
+
 #ifdef __cplusplus
 }
 #endif
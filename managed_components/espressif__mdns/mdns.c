@@ -4,6 +4,7 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <ctype.h>
 #include <string.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
@@ -57,7 +58,14 @@ static const char *MDNS_SUB_STR = "_sub";
 
 mdns_server_t *_mdns_server = NULL;
 static mdns_host_item_t *_mdns_host_list = NULL;
+static mdns_host_item_t *_mdns_host_index[MDNS_HOST_INDEX_SIZE];
+static uint32_t _mdns_label_filter[MDNS_LABEL_FILTER_BITS / 32];
+static bool _mdns_label_filter_valid;
 static mdns_host_item_t _mdns_self_host;
+static portMUX_TYPE _mdns_txt_async_lock = portMUX_INITIALIZER_UNLOCKED;
+static mdns_txt_async_t _mdns_txt_async[CONFIG_MDNS_TXT_ASYNC_ITEMS];
+static bool _mdns_txt_async_dirty;                  // a slot was written since the last _mdns_txt_async_apply()
+static bool _mdns_txt_async_posted;                 // ACTION_TXT_ASYNC is in the action queue
 
 static const char *TAG = "mdns";
 
@@ -66,6 +74,8 @@ static SemaphoreHandle_t _mdns_service_semaphore = NULL;
 static StackType_t *_mdns_stack_buffer;
 
 static void _mdns_search_finish_done(void);
+static void _mdns_answer_cache_flush(void);
+static void _mdns_timer_rearm(uint32_t min_ms);
 static mdns_search_once_t *_mdns_search_find_from(mdns_search_once_t *search, mdns_name_t *name, uint16_t type, mdns_if_t tcpip_if, mdns_ip_protocol_t ip_protocol);
 static mdns_browse_t *_mdns_browse_find_from(mdns_browse_t *b, mdns_name_t *name, uint16_t type, mdns_if_t tcpip_if, mdns_ip_protocol_t ip_protocol);
 static void _mdns_browse_result_add_srv(mdns_browse_t *browse, const char *hostname, const char *instance, const char *service, const char *proto,
@@ -269,6 +279,103 @@ static char *_mdns_mangle_name(char *in)
     return ret;
 }
 
+/**
+ * @brief  Case-insensitive FNV-1a, continued from h (mDNS names compare case-insensitively)
+ */
+static uint32_t _mdns_hash_str(uint32_t h, const char *str)
+{
+    while (*str) {
+        h ^= (uint8_t)tolower((unsigned char)*str++);
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/**
+ * @brief  Bucket of _mdns_server->service_index holding every service of this type
+ *
+ * Every service lookup names the service and proto, while instance and hostname
+ * may be wildcards, so those two are the key and the rest is compared in the bucket.
+ * Buckets keep the relative order of _mdns_server->services, so a bucket walk
+ * finds the same first match as a list walk.
+ */
+static mdns_srv_item_t **_mdns_service_bucket(const char *service, const char *proto)
+{
+    uint32_t h = _mdns_hash_str(2166136261u, service);
+    h = _mdns_hash_str(h ^ '.', proto);
+    return &_mdns_server->service_index[h & (MDNS_SERVICE_INDEX_SIZE - 1)];
+}
+
+/**
+ * @brief  Index a service just pushed to the head of _mdns_server->services
+ */
+static void _mdns_service_index_add(mdns_srv_item_t *item)
+{
+    mdns_srv_item_t **bucket = _mdns_service_bucket(item->service->service, item->service->proto);
+    item->index_next = *bucket;
+    *bucket = item;
+    _mdns_label_filter_valid = false;
+    _mdns_answer_cache_flush();
+}
+
+/**
+ * @brief  Drop a service from the index, before it is unlinked and freed
+ */
+static void _mdns_service_index_remove(mdns_srv_item_t *item)
+{
+    mdns_srv_item_t **p = _mdns_service_bucket(item->service->service, item->service->proto);
+    while (*p && *p != item) {
+        p = &(*p)->index_next;
+    }
+    if (*p) {
+        *p = item->index_next;
+    }
+    _mdns_label_filter_valid = false;
+    _mdns_answer_cache_flush();
+}
+
+static mdns_host_item_t **_mdns_host_bucket(const char *hostname)
+{
+    return &_mdns_host_index[_mdns_hash_str(2166136261u, hostname) & (MDNS_HOST_INDEX_SIZE - 1)];
+}
+
+static void _mdns_host_index_add(mdns_host_item_t *host)
+{
+    mdns_host_item_t **bucket = _mdns_host_bucket(host->hostname);
+    host->index_next = *bucket;
+    *bucket = host;
+    _mdns_label_filter_valid = false;
+    _mdns_answer_cache_flush();
+}
+
+static void _mdns_host_index_remove(mdns_host_item_t *host)
+{
+    mdns_host_item_t **p = _mdns_host_bucket(host->hostname);
+    while (*p && *p != host) {
+        p = &(*p)->index_next;
+    }
+    if (*p) {
+        *p = host->index_next;
+    }
+    _mdns_label_filter_valid = false;
+    _mdns_answer_cache_flush();
+}
+
+/**
+ * @brief  finds a delegated host by name (not our own hostname)
+ */
+static mdns_host_item_t *_mdns_get_delegated_host(const char *hostname)
+{
+    mdns_host_item_t *host = *_mdns_host_bucket(hostname);
+    while (host) {
+        if (strcasecmp(host->hostname, hostname) == 0) {
+            return host;
+        }
+        host = host->index_next;
+    }
+    return NULL;
+}
+
 static bool _mdns_service_match(const mdns_service_t *srv, const char *service, const char *proto,
                                 const char *hostname)
 {
@@ -290,19 +397,25 @@ static bool _mdns_service_match(const mdns_service_t *srv, const char *service,
  */
 static mdns_srv_item_t *_mdns_get_service_item(const char *service, const char *proto, const char *hostname)
 {
-    mdns_srv_item_t *s = _mdns_server->services;
+    if (!service || !proto) {
+        return NULL;
+    }
+    mdns_srv_item_t *s = *_mdns_service_bucket(service, proto);
     while (s) {
         if (_mdns_service_match(s->service, service, proto, hostname)) {
             return s;
         }
-        s = s->next;
+        s = s->index_next;
     }
     return NULL;
 }
 
 static mdns_srv_item_t *_mdns_get_service_item_subtype(const char *subtype, const char *service, const char *proto)
 {
-    mdns_srv_item_t *s = _mdns_server->services;
+    if (!service || !proto) {
+        return NULL;
+    }
+    mdns_srv_item_t *s = *_mdns_service_bucket(service, proto);
     while (s) {
         if (_mdns_service_match(s->service, service, proto, NULL)) {
             mdns_subtype_t *subtype_item = s->service->subtype;
@@ -313,7 +426,7 @@ static mdns_srv_item_t *_mdns_get_service_item_subtype(const char *subtype, cons
                 subtype_item = subtype_item->next;
             }
         }
-        s = s->next;
+        s = s->index_next;
     }
     return NULL;
 }
@@ -323,14 +436,7 @@ static mdns_host_item_t *mdns_get_host_item(const char *hostname)
     if (hostname == NULL || strcasecmp(hostname, _mdns_server->hostname) == 0) {
         return &_mdns_self_host;
     }
-    mdns_host_item_t *host = _mdns_host_list;
-    while (host != NULL) {
-        if (strcasecmp(host->hostname, hostname) == 0) {
-            return host;
-        }
-        host = host->next;
-    }
-    return NULL;
+    return _mdns_get_delegated_host(hostname);
 }
 
 static bool _mdns_can_add_more_services(void)
@@ -422,7 +528,10 @@ static bool _mdns_service_match_instance(const mdns_service_t *srv, const char *
 static mdns_srv_item_t *_mdns_get_service_item_instance(const char *instance, const char *service, const char *proto,
                                                         const char *hostname)
 {
-    mdns_srv_item_t *s = _mdns_server->services;
+    if (!service || !proto) {
+        return NULL;
+    }
+    mdns_srv_item_t *s = *_mdns_service_bucket(service, proto);
     while (s) {
         if (instance) {
             if (_mdns_service_match_instance(s->service, instance, service, proto, hostname)) {
@@ -433,7 +542,7 @@ static mdns_srv_item_t *_mdns_get_service_item_instance(const char *instance, co
                 return s;
             }
         }
-        s = s->next;
+        s = s->index_next;
     }
     return NULL;
 }
@@ -1482,6 +1591,124 @@ static uint8_t _mdns_append_answer(uint8_t *packet, uint16_t *index, mdns_out_an
     return 0;
 }
 
+#if CONFIG_MDNS_ANSWER_CACHE_ENTRIES
+static mdns_answer_cache_entry_t _mdns_answer_cache[CONFIG_MDNS_ANSWER_CACHE_ENTRIES];
+static uint8_t _mdns_answer_cache_victim;
+
+static bool _mdns_answer_cache_key_equal(const mdns_out_answer_t *k, const mdns_out_answer_t *a)
+{
+    return k->type == a->type && k->bye == a->bye && k->flush == a->flush
+           && k->service == a->service && k->host == a->host
+           && k->custom_instance == a->custom_instance && k->custom_service == a->custom_service
+           && k->custom_proto == a->custom_proto;
+}
+
+/**
+ * @brief  Check whether a cached response was serialized from the same records and state
+ *
+ * A and AAAA records are read from the interface at dispatch, and whether they
+ * are sent at all depends on the PCB states, so those are part of the key too.
+ */
+static bool _mdns_answer_cache_match(const mdns_answer_cache_entry_t *e, mdns_tx_packet_t *p, mdns_out_answer_t *const sections[3])
+{
+    if (!e->key || e->tcpip_if != p->tcpip_if) {
+        return false;
+    }
+    const mdns_out_answer_t *k = e->key;
+    for (int s = 0; s < 3; s++) {
+        uint8_t n = 0;
+        for (const mdns_out_answer_t *a = sections[s]; a; a = a->next, k++, n++) {
+            if (n == e->records[s] || !_mdns_answer_cache_key_equal(k, a)) {
+                return false;
+            }
+        }
+        if (n != e->records[s]) {
+            return false;
+        }
+    }
+    for (int i = 0; i < MDNS_MAX_INTERFACES; i++) {
+        for (int j = 0; j < MDNS_IP_PROTOCOL_MAX; j++) {
+            if (e->pcb_state[i][j] != _mdns_server->interfaces[i].pcbs[j].state) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief  Keep the sections of a just serialized response, replacing the oldest entry
+ */
+static void _mdns_answer_cache_store(mdns_tx_packet_t *p, mdns_out_answer_t *const sections[3], size_t records,
+                                     const uint8_t *data, uint16_t len, const uint8_t counts[3])
+{
+    mdns_answer_cache_entry_t *e = &_mdns_answer_cache[_mdns_answer_cache_victim];
+    mdns_out_answer_t *k = mdns_mem_malloc(records * sizeof(mdns_out_answer_t) + len);
+    if (!k) {
+        HOOK_MALLOC_FAILED;
+        return;
+    }
+    mdns_mem_free(e->key);
+    e->key = k;
+    e->data = (uint8_t *)(k + records);
+    memcpy(e->data, data, len);
+    e->len = len;
+    e->tcpip_if = p->tcpip_if;
+    for (int s = 0; s < 3; s++) {
+        e->records[s] = 0;
+        for (const mdns_out_answer_t *a = sections[s]; a; a = a->next) {
+            *k++ = *a;
+            e->records[s]++;
+        }
+        e->counts[s] = counts[s];
+    }
+    for (int i = 0; i < MDNS_MAX_INTERFACES; i++) {
+        for (int j = 0; j < MDNS_IP_PROTOCOL_MAX; j++) {
+            e->pcb_state[i][j] = _mdns_server->interfaces[i].pcbs[j].state;
+        }
+    }
+    _mdns_answer_cache_victim = (_mdns_answer_cache_victim + 1) % CONFIG_MDNS_ANSWER_CACHE_ENTRIES;
+}
+
+/**
+ * @brief  Number of records to key a packet by, or 0 if it is not worth caching
+ *
+ * Packets with questions are probes, queries and legacy unicast replies, each
+ * built once, so they are always serialized.
+ */
+static size_t _mdns_answer_cache_records(mdns_tx_packet_t *p, mdns_out_answer_t *const sections[3])
+{
+    if (p->questions) {
+        return 0;
+    }
+    size_t n = 0;
+    for (int s = 0; s < 3; s++) {
+        for (const mdns_out_answer_t *a = sections[s]; a; a = a->next) {
+            if (++n > MDNS_ANSWER_CACHE_RECORDS) {
+                return 0;
+            }
+        }
+    }
+    return n;
+}
+#endif /* CONFIG_MDNS_ANSWER_CACHE_ENTRIES */
+
+/**
+ * @brief  Forget every serialized response, after a change to what they were built from
+ *
+ * Called on any change to the hostname, instances, services, TXT, subtypes,
+ * delegated hosts or interfaces, so a cached response is never out of date.
+ */
+static void _mdns_answer_cache_flush(void)
+{
+#if CONFIG_MDNS_ANSWER_CACHE_ENTRIES
+    for (int i = 0; i < CONFIG_MDNS_ANSWER_CACHE_ENTRIES; i++) {
+        mdns_mem_free(_mdns_answer_cache[i].key);
+        _mdns_answer_cache[i].key = NULL;
+    }
+#endif /* CONFIG_MDNS_ANSWER_CACHE_ENTRIES */
+}
+
 /**
  * @brief  sends a packet
  *
@@ -1509,6 +1736,25 @@ static void _mdns_dispatch_tx_packet(mdns_tx_packet_t *p)
     }
     _mdns_set_u16(packet, MDNS_HEAD_QUESTIONS_OFFSET, count);
 
+#if CONFIG_MDNS_ANSWER_CACHE_ENTRIES
+    mdns_out_answer_t *const sections[3] = { p->answers, p->servers, p->additional };
+    if (!p->questions) {
+        for (int i = 0; i < CONFIG_MDNS_ANSWER_CACHE_ENTRIES; i++) {
+            mdns_answer_cache_entry_t *e = &_mdns_answer_cache[i];
+            if (_mdns_answer_cache_match(e, p, sections)) {
+                memcpy(packet + index, e->data, e->len);
+                index += e->len;
+                _mdns_set_u16(packet, MDNS_HEAD_ANSWERS_OFFSET, e->counts[0]);
+                _mdns_set_u16(packet, MDNS_HEAD_SERVERS_OFFSET, e->counts[1]);
+                _mdns_set_u16(packet, MDNS_HEAD_ADDITIONAL_OFFSET, e->counts[2]);
+                goto send;
+            }
+        }
+    }
+    uint16_t start = index;
+    uint8_t counts[3];
+#endif /* CONFIG_MDNS_ANSWER_CACHE_ENTRIES */
+
     count = 0;
     a = p->answers;
     while (a) {
@@ -1516,6 +1762,9 @@ static void _mdns_dispatch_tx_packet(mdns_tx_packet_t *p)
         a = a->next;
     }
     _mdns_set_u16(packet, MDNS_HEAD_ANSWERS_OFFSET, count);
+#if CONFIG_MDNS_ANSWER_CACHE_ENTRIES
+    counts[0] = count;
+#endif
 
     count = 0;
     a = p->servers;
@@ -1524,6 +1773,9 @@ static void _mdns_dispatch_tx_packet(mdns_tx_packet_t *p)
         a = a->next;
     }
     _mdns_set_u16(packet, MDNS_HEAD_SERVERS_OFFSET, count);
+#if CONFIG_MDNS_ANSWER_CACHE_ENTRIES
+    counts[1] = count;
+#endif
 
     count = 0;
     a = p->additional;
@@ -1533,6 +1785,15 @@ static void _mdns_dispatch_tx_packet(mdns_tx_packet_t *p)
     }
     _mdns_set_u16(packet, MDNS_HEAD_ADDITIONAL_OFFSET, count);
 
+#if CONFIG_MDNS_ANSWER_CACHE_ENTRIES
+    counts[2] = count;
+    size_t records = _mdns_answer_cache_records(p, sections);
+    if (records) {
+        _mdns_answer_cache_store(p, sections, records, packet + start, index - start, counts);
+    }
+send:
+#endif /* CONFIG_MDNS_ANSWER_CACHE_ENTRIES */
+
 #ifdef MDNS_ENABLE_DEBUG
     _mdns_dbg_printf("\nTX[%lu][%lu]: ", (unsigned long)p->tcpip_if, (unsigned long)p->ip_protocol);
 #ifdef CONFIG_LWIP_IPV4
@@ -1548,7 +1809,23 @@ static void _mdns_dispatch_tx_packet(mdns_tx_packet_t *p)
     mdns_debug_packet(packet, index);
 #endif
 
-    _mdns_udp_pcb_write(p->tcpip_if, p->ip_protocol, &p->dst, p->port, packet, index);
+    if (_mdns_udp_pcb_write(p->tcpip_if, p->ip_protocol, &p->dst, p->port, packet, index)) {
+        _mdns_server->tx_stats.sent++;
+    } else {
+        _mdns_server->tx_stats.dropped++;
+    }
+}
+
+/**
+ * @brief  frees a list of answers
+ */
+static void _mdns_free_answers(mdns_out_answer_t *a)
+{
+    while (a) {
+        mdns_out_answer_t *next = a->next;
+        mdns_mem_pool_free(MDNS_MEM_POOL_ANSWER, a);
+        a = next;
+    }
 }
 
 /**
@@ -1570,13 +1847,13 @@ static void _mdns_free_tx_packet(mdns_tx_packet_t *packet)
             mdns_mem_free((char *)q->proto);
             mdns_mem_free((char *)q->domain);
         }
-        mdns_mem_free(q);
+        mdns_mem_pool_free(MDNS_MEM_POOL_QUESTION, q);
         q = next;
     }
-    queueFree(mdns_out_answer_t, packet->answers);
-    queueFree(mdns_out_answer_t, packet->servers);
-    queueFree(mdns_out_answer_t, packet->additional);
-    mdns_mem_free(packet);
+    _mdns_free_answers(packet->answers);
+    _mdns_free_answers(packet->servers);
+    _mdns_free_answers(packet->additional);
+    mdns_mem_pool_free(MDNS_MEM_POOL_TX_PACKET, packet);
 }
 
 /**
@@ -1595,14 +1872,15 @@ static void _mdns_schedule_tx_packet(mdns_tx_packet_t *packet, uint32_t ms_after
     if (!_mdns_server->tx_queue_head || _mdns_server->tx_queue_head->send_at > packet->send_at) {
         packet->next = _mdns_server->tx_queue_head;
         _mdns_server->tx_queue_head = packet;
-        return;
-    }
-    mdns_tx_packet_t *q = _mdns_server->tx_queue_head;
-    while (q->next && q->next->send_at <= packet->send_at) {
-        q = q->next;
+    } else {
+        mdns_tx_packet_t *q = _mdns_server->tx_queue_head;
+        while (q->next && q->next->send_at <= packet->send_at) {
+            q = q->next;
+        }
+        packet->next = q->next;
+        q->next = packet;
     }
-    packet->next = q->next;
-    q->next = packet;
+    _mdns_timer_rearm(0);
 }
 
 /**
@@ -1680,13 +1958,13 @@ static void _mdns_remove_scheduled_answer(mdns_if_t tcpip_if, mdns_ip_protocol_t
             if (a) {
                 if (a->type == type && a->service == service->service) {
                     q->answers = q->answers->next;
-                    mdns_mem_free(a);
+                    mdns_mem_pool_free(MDNS_MEM_POOL_ANSWER, a);
                 } else {
                     while (a->next) {
                         if (a->next->type == type && a->next->service == service->service) {
                             mdns_out_answer_t *b = a->next;
                             a->next = b->next;
-                            mdns_mem_free(b);
+                            mdns_mem_pool_free(MDNS_MEM_POOL_ANSWER, b);
                             break;
                         }
                         a = a->next;
@@ -1713,14 +1991,14 @@ static void _mdns_dealloc_answer(mdns_out_answer_t **destination, uint16_t type,
     }
     if (d->type == type && d->service == service->service) {
         *destination = d->next;
-        mdns_mem_free(d);
+        mdns_mem_pool_free(MDNS_MEM_POOL_ANSWER, d);
         return;
     }
     while (d->next) {
         mdns_out_answer_t *a = d->next;
         if (a->type == type && a->service == service->service) {
             d->next = a->next;
-            mdns_mem_free(a);
+            mdns_mem_pool_free(MDNS_MEM_POOL_ANSWER, a);
             return;
         }
         d = d->next;
@@ -1741,7 +2019,7 @@ static bool _mdns_alloc_answer(mdns_out_answer_t **destination, uint16_t type, m
         d = d->next;
     }
 
-    mdns_out_answer_t *a = (mdns_out_answer_t *)mdns_mem_malloc(sizeof(mdns_out_answer_t));
+    mdns_out_answer_t *a = (mdns_out_answer_t *)mdns_mem_pool_alloc(MDNS_MEM_POOL_ANSWER);
     if (!a) {
         HOOK_MALLOC_FAILED;
         return false;
@@ -1762,7 +2040,7 @@ static bool _mdns_alloc_answer(mdns_out_answer_t **destination, uint16_t type, m
  */
 static mdns_tx_packet_t *_mdns_alloc_packet_default(mdns_if_t tcpip_if, mdns_ip_protocol_t ip_protocol)
 {
-    mdns_tx_packet_t *packet = (mdns_tx_packet_t *)mdns_mem_malloc(sizeof(mdns_tx_packet_t));
+    mdns_tx_packet_t *packet = (mdns_tx_packet_t *)mdns_mem_pool_alloc(MDNS_MEM_POOL_TX_PACKET);
     if (!packet) {
         HOOK_MALLOC_FAILED;
         return NULL;
@@ -1959,7 +2237,7 @@ static void _mdns_create_answer_from_parsed_packet(mdns_parsed_packet_t *parsed_
                  || q->type == MDNS_TYPE_PTR
 #endif /* CONFIG_MDNS_RESPOND_REVERSE_QUERIES */
                 )) {
-            mdns_out_question_t *out_question = mdns_mem_malloc(sizeof(mdns_out_question_t));
+            mdns_out_question_t *out_question = (mdns_out_question_t *)mdns_mem_pool_alloc(MDNS_MEM_POOL_QUESTION);
             if (out_question == NULL) {
                 HOOK_MALLOC_FAILED;
                 _mdns_free_tx_packet(packet);
@@ -2070,7 +2348,7 @@ static bool _mdns_append_host_list(mdns_out_answer_t **destination, bool flush,
 
 static bool _mdns_append_host_question(mdns_out_question_t **questions, const char *hostname, bool unicast)
 {
-    mdns_out_question_t *q = (mdns_out_question_t *)mdns_mem_malloc(sizeof(mdns_out_question_t));
+    mdns_out_question_t *q = (mdns_out_question_t *)mdns_mem_pool_alloc(MDNS_MEM_POOL_QUESTION);
     if (!q) {
         HOOK_MALLOC_FAILED;
         return false;
@@ -2084,7 +2362,7 @@ static bool _mdns_append_host_question(mdns_out_question_t **questions, const ch
     q->domain = MDNS_DEFAULT_DOMAIN;
     q->own_dynamic_memory = false;
     if (_mdns_question_exists(q, *questions)) {
-        mdns_mem_free(q);
+        mdns_mem_pool_free(MDNS_MEM_POOL_QUESTION, q);
     } else {
         queueToEnd(mdns_out_question_t, *questions, q);
     }
@@ -2118,7 +2396,7 @@ static mdns_tx_packet_t *_mdns_create_probe_packet(mdns_if_t tcpip_if, mdns_ip_p
 
     size_t i;
     for (i = 0; i < len; i++) {
-        mdns_out_question_t *q = (mdns_out_question_t *)mdns_mem_malloc(sizeof(mdns_out_question_t));
+        mdns_out_question_t *q = (mdns_out_question_t *)mdns_mem_pool_alloc(MDNS_MEM_POOL_QUESTION);
         if (!q) {
             HOOK_MALLOC_FAILED;
             _mdns_free_tx_packet(packet);
@@ -2133,7 +2411,7 @@ static mdns_tx_packet_t *_mdns_create_probe_packet(mdns_if_t tcpip_if, mdns_ip_p
         q->domain = MDNS_DEFAULT_DOMAIN;
         q->own_dynamic_memory = false;
         if (!q->host || _mdns_question_exists(q, packet->questions)) {
-            mdns_mem_free(q);
+            mdns_mem_pool_free(MDNS_MEM_POOL_QUESTION, q);
             continue;
         } else {
             queueToEnd(mdns_out_question_t, packet->questions, q);
@@ -2767,14 +3045,14 @@ static void _mdns_dealloc_scheduled_service_answers(mdns_out_answer_t **destinat
     }
     while (d && d->service == service) {
         *destination = d->next;
-        mdns_mem_free(d);
+        mdns_mem_pool_free(MDNS_MEM_POOL_ANSWER, d);
         d = *destination;
     }
     while (d && d->next) {
         mdns_out_answer_t *a = d->next;
         if (a->service == service) {
             d->next = a->next;
-            mdns_mem_free(a);
+            mdns_mem_pool_free(MDNS_MEM_POOL_ANSWER, a);
         } else {
             d = d->next;
         }
@@ -2834,14 +3112,14 @@ static void _mdns_remove_scheduled_service_packets(mdns_service_t *service)
                                 && qs->service && strcmp(qs->service, service->service) == 0
                                 && qs->proto && strcmp(qs->proto, service->proto) == 0) {
                             q->questions = q->questions->next;
-                            mdns_mem_free(qs);
+                            mdns_mem_pool_free(MDNS_MEM_POOL_QUESTION, qs);
                         } else while (qs->next) {
                                 qsn = qs->next;
                                 if (qsn->type == MDNS_TYPE_ANY
                                         && qsn->service && strcmp(qsn->service, service->service) == 0
                                         && qsn->proto && strcmp(qsn->proto, service->proto) == 0) {
                                     qs->next = qsn->next;
-                                    mdns_mem_free(qsn);
+                                    mdns_mem_pool_free(MDNS_MEM_POOL_QUESTION, qsn);
                                     break;
                                 }
                                 qs = qs->next;
@@ -3130,14 +3408,7 @@ static bool _hostname_is_ours(const char *hostname)
             strcasecmp(hostname, _mdns_server->hostname) == 0) {
         return true;
     }
-    mdns_host_item_t *host = _mdns_host_list;
-    while (host != NULL) {
-        if (strcasecmp(hostname, host->hostname) == 0) {
-            return true;
-        }
-        host = host->next;
-    }
-    return false;
+    return _mdns_get_delegated_host(hostname) != NULL;
 }
 
 /**
@@ -3162,6 +3433,7 @@ static bool _mdns_delegate_hostname_add(const char *hostname, mdns_ip_addr_t *ad
     host->hostname = hostname;
     host->next = _mdns_host_list;
     _mdns_host_list = host;
+    _mdns_host_index_add(host);
     return true;
 }
 
@@ -3181,16 +3453,13 @@ static bool _mdns_delegate_hostname_set_address(const char *hostname, mdns_ip_ad
             strcasecmp(hostname, _mdns_server->hostname) == 0) {
         return false;
     }
-    mdns_host_item_t *host = _mdns_host_list;
-    while (host != NULL) {
-        if (strcasecmp(hostname, host->hostname) == 0) {
-            // free previous address list
-            free_address_list(host->address_list);
-            // set current address list to the host
-            host->address_list = address_list;
-            return true;
-        }
-        host = host->next;
+    mdns_host_item_t *host = _mdns_get_delegated_host(hostname);
+    if (host) {
+        // free previous address list
+        free_address_list(host->address_list);
+        // set current address list to the host
+        host->address_list = address_list;
+        return true;
     }
     return false;
 }
@@ -3230,6 +3499,9 @@ static void free_delegated_hostnames(void)
         mdns_mem_free(item);
     }
     _mdns_host_list = NULL;
+    memset(_mdns_host_index, 0, sizeof(_mdns_host_index));
+    _mdns_label_filter_valid = false;
+    _mdns_answer_cache_flush();
 }
 
 static bool _mdns_delegate_hostname_remove(const char *hostname)
@@ -3241,6 +3513,7 @@ static bool _mdns_delegate_hostname_remove(const char *hostname)
             mdns_srv_item_t *to_free = srv;
             _mdns_send_bye(&srv, 1, false);
             _mdns_remove_scheduled_service_packets(srv->service);
+            _mdns_service_index_remove(srv);
             if (prev_srv == NULL) {
                 _mdns_server->services = srv->next;
                 srv = srv->next;
@@ -3259,6 +3532,7 @@ static bool _mdns_delegate_hostname_remove(const char *hostname)
     mdns_host_item_t *prev_host = NULL;
     while (host != NULL) {
         if (strcasecmp(hostname, host->hostname) == 0) {
+            _mdns_host_index_remove(host);
             if (prev_host == NULL) {
                 _mdns_host_list = host->next;
             } else {
@@ -3664,6 +3938,140 @@ static esp_err_t _mdns_strdup_check(char **out, char *in)
     return ESP_OK;
 }
 
+/**
+ * @brief  Case-insensitive FNV-1a of one raw label
+ */
+static uint32_t _mdns_hash_label(const uint8_t *label, size_t len)
+{
+    uint32_t h = 2166136261u;
+    while (len--) {
+        h ^= (uint8_t)tolower(*label++);
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static void _mdns_label_filter_set(const char *name)
+{
+    if (_str_null_or_empty(name)) {
+        return;
+    }
+    // a parsed host keeps its first label as is, the rest are appended after dots
+    uint32_t h = _mdns_hash_label((const uint8_t *)name, strcspn(name, ".")) & (MDNS_LABEL_FILTER_BITS - 1);
+    _mdns_label_filter[h / 32] |= 1u << (h % 32);
+}
+
+/**
+ * @brief  Rebuild the label filter from our host names and service types
+ *
+ * _mdns_name_is_ours() only accepts a name with a label equal to our hostname,
+ * a delegated hostname or the type of one of our services, and discovery and
+ * reverse names end in "_services" and "arpa", so a name with none of these
+ * labels can be skipped without parsing it.
+ */
+static void _mdns_label_filter_build(void)
+{
+    memset(_mdns_label_filter, 0, sizeof(_mdns_label_filter));
+    _mdns_label_filter_set(_mdns_server->hostname);
+    for (mdns_host_item_t *host = _mdns_host_list; host; host = host->next) {
+        _mdns_label_filter_set(host->hostname);
+    }
+    for (mdns_srv_item_t *srv = _mdns_server->services; srv; srv = srv->next) {
+        _mdns_label_filter_set(srv->service->service);
+    }
+    _mdns_label_filter_set("_services");
+#ifdef CONFIG_MDNS_RESPOND_REVERSE_QUERIES
+    _mdns_label_filter_set("arpa");
+#endif /* CONFIG_MDNS_RESPOND_REVERSE_QUERIES */
+    _mdns_label_filter_valid = true;
+}
+
+/**
+ * @brief  Step over a FQDN in the packet, checking its labels against the label filter
+ *
+ * @param  packet       start of packet
+ * @param  start        start of the name
+ * @param  packet_len   length of the packet
+ * @param  hit          set to true if any label may be ours
+ *
+ * @return the address after the name or NULL if it is malformed
+ */
+static const uint8_t *_mdns_skip_fqdn(const uint8_t *packet, const uint8_t *start, size_t packet_len, bool *hit)
+{
+    const uint8_t *packet_end = packet + packet_len;
+    const uint8_t *segment = start;
+    const uint8_t *p = start;
+    const uint8_t *next = NULL;
+    while (p < packet_end && *p) {
+        uint8_t len = *p++;
+        if (len >= 0xC0) {
+            if (p >= packet_end) {
+                return NULL;
+            }
+            const uint8_t *target = packet + ((((uint16_t)len & 0x3F) << 8) | *p++);
+            if (target >= segment) {
+                //same rule as _mdns_read_fqdn(), which also bounds the jumps
+                return NULL;
+            }
+            if (!next) {
+                next = p;
+            }
+            p = segment = target;
+        } else if (len > 63 || p + len > packet_end) {
+            return NULL;
+        } else {
+            uint32_t h = _mdns_hash_label(p, len) & (MDNS_LABEL_FILTER_BITS - 1);
+            if (_mdns_label_filter[h / 32] & (1u << (h % 32))) {
+                *hit = true;
+            }
+            p += len;
+        }
+    }
+    if (p >= packet_end) {
+        return NULL;
+    }
+    return next ? next : p + 1;
+}
+
+/**
+ * @brief  Check, before the full parse, whether the packet could concern us
+ *
+ * A query is answered only if one of its questions is ours, and a record that
+ * is not ours is only looked at by a running search or browse. Whenever the
+ * packet cannot be walked cleanly it is left to mdns_parse_packet().
+ *
+ * @return false if mdns_parse_packet() would do nothing with the packet
+ */
+static bool _mdns_packet_may_be_ours(const uint8_t *data, size_t len, const mdns_header_t *header)
+{
+    if ((header->flags & MDNS_FLAGS_QUERY_REPSONSE) && (_mdns_server->search_once || _mdns_server->browse)) {
+        return true;
+    }
+    if (!_mdns_label_filter_valid) {
+        _mdns_label_filter_build();
+    }
+    const uint8_t *content = data + MDNS_HEAD_LEN;
+    bool hit = false;
+    for (uint16_t qs = header->questions; qs; qs--) {
+        content = _mdns_skip_fqdn(data, content, len, &hit);
+        if (!content || hit || content + MDNS_CLASS_OFFSET + 1 >= data + len) {
+            return true;
+        }
+        content += 4;
+    }
+    if (header->questions && !header->answers) {
+        return false;
+    }
+    while (content < data + len) {
+        content = _mdns_skip_fqdn(data, content, len, &hit);
+        if (!content || hit || content + MDNS_LEN_OFFSET + 1 >= data + len) {
+            return true;
+        }
+        content += MDNS_DATA_OFFSET + _mdns_read_u16(content, MDNS_LEN_OFFSET);
+    }
+    return false;
+}
+
 /**
  * @brief  main packet parser
  *
@@ -3726,16 +4134,6 @@ void mdns_parse_packet(mdns_rx_packet_t *packet)
         return;
     }
 
-    mdns_parsed_packet_t *parsed_packet = (mdns_parsed_packet_t *)mdns_mem_malloc(sizeof(mdns_parsed_packet_t));
-    if (!parsed_packet) {
-        HOOK_MALLOC_FAILED;
-        return;
-    }
-    memset(parsed_packet, 0, sizeof(mdns_parsed_packet_t));
-
-    mdns_name_t *name = &n;
-    memset(name, 0, sizeof(mdns_name_t));
-
     header.id = _mdns_read_u16(data, MDNS_HEAD_ID_OFFSET);
     header.flags = _mdns_read_u16(data, MDNS_HEAD_FLAGS_OFFSET);
     header.questions = _mdns_read_u16(data, MDNS_HEAD_QUESTIONS_OFFSET);
@@ -3744,16 +4142,29 @@ void mdns_parse_packet(mdns_rx_packet_t *packet)
     header.additional = _mdns_read_u16(data, MDNS_HEAD_ADDITIONAL_OFFSET);
 
     if (header.flags == MDNS_FLAGS_QR_AUTHORITATIVE && packet->src_port != MDNS_SERVICE_PORT) {
-        mdns_mem_free(parsed_packet);
         return;
     }
 
     //if we have not set the hostname, we can not answer questions
     if (header.questions && !header.answers && _str_null_or_empty(_mdns_server->hostname)) {
-        mdns_mem_free(parsed_packet);
         return;
     }
 
+    //most multicast traffic on a busy network is not for us
+    if (!_mdns_packet_may_be_ours(data, len, &header)) {
+        return;
+    }
+
+    mdns_parsed_packet_t *parsed_packet = (mdns_parsed_packet_t *)mdns_mem_malloc(sizeof(mdns_parsed_packet_t));
+    if (!parsed_packet) {
+        HOOK_MALLOC_FAILED;
+        return;
+    }
+    memset(parsed_packet, 0, sizeof(mdns_parsed_packet_t));
+
+    mdns_name_t *name = &n;
+    memset(name, 0, sizeof(mdns_name_t));
+
     parsed_packet->tcpip_if = packet->tcpip_if;
     parsed_packet->ip_protocol = packet->ip_protocol;
     parsed_packet->multicast = packet->multicast;
@@ -4078,6 +4489,7 @@ void mdns_parse_packet(mdns_rx_packet_t *packet)
                                     if (new_instance) {
                                         mdns_mem_free((char *)service->service->instance);
                                         service->service->instance = new_instance;
+                                        _mdns_answer_cache_flush();
                                     }
                                     _mdns_probe_all_pcbs(&service, 1, false, false);
                                 } else if (!_str_null_or_empty(_mdns_server->instance)) {
@@ -4085,6 +4497,7 @@ void mdns_parse_packet(mdns_rx_packet_t *packet)
                                     if (new_instance) {
                                         mdns_mem_free((char *)_mdns_server->instance);
                                         _mdns_server->instance = new_instance;
+                                        _mdns_answer_cache_flush();
                                     }
                                     _mdns_restart_all_pcbs_no_instance();
                                 } else {
@@ -4094,6 +4507,8 @@ void mdns_parse_packet(mdns_rx_packet_t *packet)
                                         mdns_mem_free((char *)_mdns_server->hostname);
                                         _mdns_server->hostname = new_host;
                                         _mdns_self_host.hostname = new_host;
+                                        _mdns_label_filter_valid = false;
+                                        _mdns_answer_cache_flush();
                                     }
                                     _mdns_restart_all_pcbs();
                                 }
@@ -4219,6 +4634,8 @@ void mdns_parse_packet(mdns_rx_packet_t *packet)
                                     mdns_mem_free((char *)_mdns_server->hostname);
                                     _mdns_server->hostname = new_host;
                                     _mdns_self_host.hostname = new_host;
+                                    _mdns_label_filter_valid = false;
+                                    _mdns_answer_cache_flush();
                                 }
                                 _mdns_restart_all_pcbs();
                             }
@@ -4276,6 +4693,8 @@ void mdns_parse_packet(mdns_rx_packet_t *packet)
                                     mdns_mem_free((char *)_mdns_server->hostname);
                                     _mdns_server->hostname = new_host;
                                     _mdns_self_host.hostname = new_host;
+                                    _mdns_label_filter_valid = false;
+                                    _mdns_answer_cache_flush();
                                 }
                                 _mdns_restart_all_pcbs();
                             }
@@ -4667,6 +5086,7 @@ static void _mdns_search_add(mdns_search_once_t *search)
 {
     search->next = _mdns_server->search_once;
     _mdns_server->search_once = search;
+    _mdns_timer_rearm(0);
 }
 
 /**
@@ -5009,7 +5429,7 @@ static mdns_tx_packet_t *_mdns_create_search_packet(mdns_search_once_t *search,
         return NULL;
     }
 
-    mdns_out_question_t *q = (mdns_out_question_t *)mdns_mem_malloc(sizeof(mdns_out_question_t));
+    mdns_out_question_t *q = (mdns_out_question_t *)mdns_mem_pool_alloc(MDNS_MEM_POOL_QUESTION);
     if (!q) {
         HOOK_MALLOC_FAILED;
         _mdns_free_tx_packet(packet);
@@ -5033,7 +5453,7 @@ static mdns_tx_packet_t *_mdns_create_search_packet(mdns_search_once_t *search,
                 r = r->next;
                 continue;
             }
-            mdns_out_answer_t *a = (mdns_out_answer_t *)mdns_mem_malloc(sizeof(mdns_out_answer_t));
+            mdns_out_answer_t *a = (mdns_out_answer_t *)mdns_mem_pool_alloc(MDNS_MEM_POOL_ANSWER);
             if (!a) {
                 HOOK_MALLOC_FAILED;
                 _mdns_free_tx_packet(packet);
@@ -5108,6 +5528,7 @@ static void _mdns_tx_handle_packet(mdns_tx_packet_t *p)
     uint32_t send_after = 1000;
 
     if (pcb->state == PCB_OFF) {
+        _mdns_server->tx_stats.dropped++;
         _mdns_free_tx_packet(p);
         return;
     }
@@ -5157,6 +5578,24 @@ static void _mdns_tx_handle_packet(mdns_tx_packet_t *p)
     }
 }
 
+/**
+ * @brief  Called from service thread to transmit every due packet at tx head in one pass
+ *
+ * Packets rescheduled while handling (probes, announcements) are not due again in this pass.
+ */
+static void _mdns_tx_due_run(void)
+{
+    uint32_t now = xTaskGetTickCount() * portTICK_PERIOD_MS;
+    mdns_tx_packet_t *p;
+
+    _mdns_server->tx_due_posted = false;
+    while ((p = _mdns_server->tx_queue_head) && (int32_t)(p->send_at - now) < 0) {
+        _mdns_server->tx_queue_head = p->next;
+        _mdns_tx_handle_packet(p);
+    }
+    _mdns_timer_rearm(0);
+}
+
 static void _mdns_remap_self_service_hostname(const char *old_hostname, const char *new_hostname)
 {
     mdns_srv_item_t *service = _mdns_server->services;
@@ -5210,9 +5649,10 @@ static void _mdns_free_action(mdns_action_t *action)
     case ACTION_BROWSE_SYNC:
         _mdns_sync_browse_result_link_free(action->data.browse_sync.browse_sync);
         break;
-    case ACTION_TX_HANDLE:
-        _mdns_free_tx_packet(action->data.tx_handle.packet);
-        break;
+    case ACTION_TX_DUE:
+    //fallthrough
+    case ACTION_TXT_ASYNC:
+        return; // static
     case ACTION_RX_HANDLE:
         _mdns_packet_free(action->data.rx_handle.packet);
         break;
@@ -5238,6 +5678,7 @@ static void _mdns_execute_action(mdns_action_t *action)
     switch (action->type) {
     case ACTION_SYSTEM_EVENT:
         perform_event_action(action->data.sys_event.interface, action->data.sys_event.event_action);
+        _mdns_answer_cache_flush();
         break;
     case ACTION_HOSTNAME_SET:
         _mdns_send_bye_all_pcbs_no_instance(true);
@@ -5245,6 +5686,8 @@ static void _mdns_execute_action(mdns_action_t *action)
         mdns_mem_free((char *)_mdns_server->hostname);
         _mdns_server->hostname = action->data.hostname_set.hostname;
         _mdns_self_host.hostname = action->data.hostname_set.hostname;
+        _mdns_label_filter_valid = false;
+        _mdns_answer_cache_flush();
         _mdns_restart_all_pcbs();
         xSemaphoreGive(_mdns_server->action_sema);
         break;
@@ -5252,6 +5695,7 @@ static void _mdns_execute_action(mdns_action_t *action)
         _mdns_send_bye_all_pcbs_no_instance(false);
         mdns_mem_free((char *)_mdns_server->instance);
         _mdns_server->instance = action->data.instance;
+        _mdns_answer_cache_flush();
         _mdns_restart_all_pcbs_no_instance();
 
         break;
@@ -5276,18 +5720,11 @@ static void _mdns_execute_action(mdns_action_t *action)
         _mdns_browse_finish(action->data.browse_add.browse);
         break;
 
-    case ACTION_TX_HANDLE: {
-        mdns_tx_packet_t *p = _mdns_server->tx_queue_head;
-        // packet to be handled should be at tx head, but must be consistent with the one pushed to action queue
-        if (p && p == action->data.tx_handle.packet && p->queued) {
-            p->queued = false; // clearing, as the packet might be reused (pushed and transmitted again)
-            _mdns_server->tx_queue_head = p->next;
-            _mdns_tx_handle_packet(p);
-        } else {
-            ESP_LOGD(TAG, "Skipping transmit of an unexpected packet!");
-        }
-    }
-    break;
+    case ACTION_TX_DUE:
+        _mdns_tx_due_run();
+        return; // static, not to be freed
+    case ACTION_TXT_ASYNC:
+        return; // static wake-up, the service task applies the items after every action
     case ACTION_RX_HANDLE:
         mdns_parse_packet(action->data.rx_handle.packet);
         _mdns_packet_free(action->data.rx_handle.packet);
@@ -5305,6 +5742,7 @@ static void _mdns_execute_action(mdns_action_t *action)
                                                  action->data.delegate_hostname.address_list)) {
             free_address_list(action->data.delegate_hostname.address_list);
         }
+        _mdns_answer_cache_flush();
         mdns_mem_free((char *)action->data.delegate_hostname.hostname);
         break;
     case ACTION_DELEGATE_HOSTNAME_REMOVE:
@@ -5342,55 +5780,49 @@ static esp_err_t _mdns_send_search_action(mdns_action_type_t type, mdns_search_o
 /**
  * @brief  Called from timer task to run mDNS responder
  *
- * periodically checks first unqueued packet (from tx head).
- * if it is scheduled to be transmitted, then pushes the packet to action queue to be handled.
+ * if the packet at tx head is scheduled to be transmitted, pushes a single ACTION_TX_DUE
+ * to action queue, and the service thread sends every due packet when handling it.
  *
+ * @return true if the action could not be queued and has to be retried
  */
-static void _mdns_scheduler_run(void)
+static bool _mdns_scheduler_run(void)
 {
+    static mdns_action_t tx_due_action = { .type = ACTION_TX_DUE };
+    mdns_action_t *action = &tx_due_action;
+    bool deferred = false;
     MDNS_SERVICE_LOCK();
+    uint32_t now = xTaskGetTickCount() * portTICK_PERIOD_MS;
     mdns_tx_packet_t *p = _mdns_server->tx_queue_head;
-    mdns_action_t *action = NULL;
 
-    // find first unqueued packet
-    while (p && p->queued) {
-        p = p->next;
-    }
-    if (!p) {
-        MDNS_SERVICE_UNLOCK();
-        return;
-    }
-    while (p && (int32_t)(p->send_at - (xTaskGetTickCount() * portTICK_PERIOD_MS)) < 0) {
-        action = (mdns_action_t *)mdns_mem_malloc(sizeof(mdns_action_t));
-        if (action) {
-            action->type = ACTION_TX_HANDLE;
-            action->data.tx_handle.packet = p;
-            p->queued = true;
-            if (xQueueSend(_mdns_server->action_queue, &action, (TickType_t)0) != pdPASS) {
-                mdns_mem_free(action);
-                p->queued = false;
-            }
+    if (!_mdns_server->tx_due_posted && p && (int32_t)(p->send_at - now) < 0) {
+        if (xQueueSend(_mdns_server->action_queue, &action, (TickType_t)0) == pdPASS) {
+            _mdns_server->tx_due_posted = true;
         } else {
-            HOOK_MALLOC_FAILED;
-            break;
+            while (p && (int32_t)(p->send_at - now) < 0) {
+                _mdns_server->tx_stats.deferred++;
+                p = p->next;
+            }
+            deferred = true;
         }
-        //Find the next unqued packet
-        p = p->next;
     }
     MDNS_SERVICE_UNLOCK();
+    return deferred;
 }
 
 /**
  * @brief  Called from timer task to run active searches
+ *
+ * @return true if a search action could not be queued and has to be retried
  */
-static void _mdns_search_run(void)
+static bool _mdns_search_run(void)
 {
+    bool deferred = false;
     MDNS_SERVICE_LOCK();
     mdns_search_once_t *s = _mdns_server->search_once;
     uint32_t now = xTaskGetTickCount() * portTICK_PERIOD_MS;
     if (!s) {
         MDNS_SERVICE_UNLOCK();
-        return;
+        return false;
     }
     while (s) {
         if (s->state != SEARCH_OFF) {
@@ -5398,18 +5830,122 @@ static void _mdns_search_run(void)
                 s->state = SEARCH_OFF;
                 if (_mdns_send_search_action(ACTION_SEARCH_END, s) != ESP_OK) {
                     s->state = SEARCH_RUNNING;
+                    deferred = true;
                 }
             } else if (s->state == SEARCH_INIT || (now - s->sent_at) > 1000) {
                 s->state = SEARCH_RUNNING;
                 s->sent_at = now;
                 if (_mdns_send_search_action(ACTION_SEARCH_SEND, s) != ESP_OK) {
                     s->sent_at -= 1000;
+                    deferred = true;
                 }
             }
         }
         s = s->next;
     }
     MDNS_SERVICE_UNLOCK();
+    return deferred;
+}
+
+/**
+ * @brief  Set or add one TXT item of a service
+ *
+ * @param  changed      if not NULL, set to whether the item was added or got a different value
+ *
+ * @return ESP_OK, or ESP_ERR_NO_MEM with the TXT record unchanged
+ */
+static esp_err_t _mdns_txt_item_set(mdns_service_t *srv, const char *key, const char *value_arg, uint8_t value_len, bool *changed)
+{
+    char *value = NULL;
+    mdns_txt_linked_item_t *txt = srv->txt;
+    while (txt && strcmp(txt->key, key) != 0) {
+        txt = txt->next;
+    }
+    if (changed) {
+        *changed = !txt || txt->value_len != value_len || (value_len && memcmp(txt->value, value_arg, value_len) != 0);
+        if (!*changed) {
+            return ESP_OK;
+        }
+    }
+    if (value_len > 0) {
+        value = (char *)mdns_mem_malloc(value_len);
+        if (!value) {
+            HOOK_MALLOC_FAILED;
+            return ESP_ERR_NO_MEM;
+        }
+        memcpy(value, value_arg, value_len);
+    }
+    if (txt) {
+        mdns_mem_free((char *)txt->value);
+        txt->value = value;
+        txt->value_len = value_len;
+        return ESP_OK;
+    }
+    txt = (mdns_txt_linked_item_t *)mdns_mem_malloc(sizeof(mdns_txt_linked_item_t));
+    if (!txt || !(txt->key = mdns_mem_strdup(key))) {
+        HOOK_MALLOC_FAILED;
+        mdns_mem_free(txt);
+        mdns_mem_free(value);
+        return ESP_ERR_NO_MEM;
+    }
+    txt->value = value;
+    txt->value_len = value_len;
+    txt->next = srv->txt;
+    srv->txt = txt;
+    return ESP_OK;
+}
+
+/**
+ * @brief  Called from service thread to apply the items of mdns_service_txt_item_set_async()
+ *
+ * Runs after every action, so items whose ACTION_TXT_ASYNC did not fit the queue still
+ * get applied. Each changed service is announced once, however many of its items changed.
+ */
+static void _mdns_txt_async_apply(void)
+{
+    mdns_srv_item_t *changed[CONFIG_MDNS_TXT_ASYNC_ITEMS];
+    size_t num_changed = 0;
+    mdns_txt_async_t item;
+
+    taskENTER_CRITICAL(&_mdns_txt_async_lock);
+    bool dirty = _mdns_txt_async_dirty;
+    _mdns_txt_async_dirty = false;
+    _mdns_txt_async_posted = false;
+    taskEXIT_CRITICAL(&_mdns_txt_async_lock);
+    if (!dirty) {
+        return;
+    }
+    for (size_t i = 0; i < CONFIG_MDNS_TXT_ASYNC_ITEMS; i++) {
+        // copied out one at a time: the slot is free again as soon as it has been read
+        taskENTER_CRITICAL(&_mdns_txt_async_lock);
+        item = _mdns_txt_async[i];
+        _mdns_txt_async[i].used = false;
+        taskEXIT_CRITICAL(&_mdns_txt_async_lock);
+        if (!item.used) {
+            continue;
+        }
+        mdns_srv_item_t *s = _mdns_get_service_item(item.service, item.proto, _mdns_server->hostname);
+        if (!s) {
+            ESP_LOGW(TAG, "TXT %s: service %s.%s doesn't exist", item.key, item.service, item.proto);
+            continue;
+        }
+        bool item_changed;
+        if (_mdns_txt_item_set(s->service, item.key, item.value, strlen(item.value), &item_changed) != ESP_OK) {
+            ESP_LOGE(TAG, "TXT %s: out of memory", item.key);
+            continue;
+        }
+        size_t j = 0;
+        while (j < num_changed && changed[j] != s) {
+            j++;
+        }
+        if (item_changed && j == num_changed) {
+            changed[num_changed++] = s;
+        }
+    }
+    if (num_changed) {
+        _mdns_answer_cache_flush();
+        _mdns_announce_all_pcbs(changed, num_changed, false);
+    }
 }
 
 /**
@@ -5427,6 +5963,7 @@ static void _mdns_service_task(void *pvParameters)
                 }
                 MDNS_SERVICE_LOCK();
                 _mdns_execute_action(a);
+                _mdns_txt_async_apply();
                 MDNS_SERVICE_UNLOCK();
             }
         } else {
@@ -5437,10 +5974,79 @@ static void _mdns_service_task(void *pvParameters)
     vTaskDelay(portMAX_DELAY);
 }
 
+/**
+ * @brief  Arm the one-shot timer for the earliest packet or search deadline, or stop it if there is none
+ *
+ * Called with the service lock held whenever a packet is scheduled or a search
+ * is added, and after every timer run, so an idle responder does not wake up.
+ * A timer already due no later than the new deadline is left alone.
+ *
+ * @param  min_ms       wait at least this long (back-off after a deferred packet or search)
+ */
+static void _mdns_timer_rearm(uint32_t min_ms)
+{
+    if (!_mdns_server || !_mdns_server->timer_handle) {
+        return;
+    }
+    uint32_t now = xTaskGetTickCount() * portTICK_PERIOD_MS;
+    bool pending = false;
+    int32_t wait = INT32_MAX;
+
+    mdns_tx_packet_t *p = _mdns_server->tx_queue_head;
+    if (p && !_mdns_server->tx_due_posted) {
+        // _mdns_scheduler_run() sends once send_at is in the past; _mdns_tx_due_run() re-arms when done
+        wait = (int32_t)(p->send_at - now) + 1;
+        pending = true;
+    }
+    for (mdns_search_once_t *s = _mdns_server->search_once; s; s = s->next) {
+        if (s->state == SEARCH_OFF) {
+            continue;
+        }
+        // the same conditions as _mdns_search_run()
+        int32_t end = (int32_t)(s->started_at + s->timeout - now) + 1;
+        int32_t send = s->state == SEARCH_INIT ? 0 : (int32_t)(s->sent_at + 1000 - now) + 1;
+        if (end < wait) {
+            wait = end;
+        }
+        if (send < wait) {
+            wait = send;
+        }
+        pending = true;
+    }
+
+    if (!pending) {
+        if (_mdns_server->timer_armed) {
+            esp_timer_stop(_mdns_server->timer_handle);
+            _mdns_server->timer_armed = false;
+        }
+        return;
+    }
+    if (wait < (int32_t)min_ms) {
+        wait = min_ms;
+    }
+    uint32_t due = now + wait;
+    if (_mdns_server->timer_armed && (int32_t)(_mdns_server->timer_due - due) <= 0) {
+        return;
+    }
+    esp_timer_stop(_mdns_server->timer_handle);
+    if (esp_timer_start_once(_mdns_server->timer_handle, (uint64_t)wait * 1000) == ESP_OK) {
+        _mdns_server->timer_due = due;
+        _mdns_server->timer_armed = true;
+    } else {
+        _mdns_server->timer_armed = false;
+    }
+}
+
 static void _mdns_timer_cb(void *arg)
 {
-    _mdns_scheduler_run();
-    _mdns_search_run();
+    MDNS_SERVICE_LOCK();
+    _mdns_server->timer_armed = false;
+    MDNS_SERVICE_UNLOCK();
+    bool deferred = _mdns_scheduler_run();
+    deferred |= _mdns_search_run();
+    MDNS_SERVICE_LOCK();
+    _mdns_timer_rearm(deferred ? MDNS_TIMER_RETRY_MS : 0);
+    MDNS_SERVICE_UNLOCK();
 }
 
 static esp_err_t _mdns_start_timer(void)
@@ -5451,22 +6057,24 @@ static esp_err_t _mdns_start_timer(void)
         .dispatch_method = ESP_TIMER_TASK,
         .name = "mdns_timer"
     };
+    _mdns_server->timer_armed = false;
     esp_err_t err = esp_timer_create(&timer_conf, &(_mdns_server->timer_handle));
     if (err) {
         return err;
     }
-    return esp_timer_start_periodic(_mdns_server->timer_handle, MDNS_TIMER_PERIOD_US);
+    _mdns_timer_rearm(0);
+    return ESP_OK;
 }
 
 static esp_err_t _mdns_stop_timer(void)
 {
     esp_err_t err = ESP_OK;
     if (_mdns_server->timer_handle) {
-        err = esp_timer_stop(_mdns_server->timer_handle);
-        if (err) {
-            return err;
-        }
+        // a one-shot timer is usually not running, which esp_timer_stop() reports as an error
+        esp_timer_stop(_mdns_server->timer_handle);
         err = esp_timer_delete(_mdns_server->timer_handle);
+        _mdns_server->timer_handle = NULL;
+        _mdns_server->timer_armed = false;
     }
     return err;
 }
@@ -5635,6 +6243,7 @@ esp_err_t mdns_register_netif(esp_netif_t *esp_netif)
     for (mdns_if_t i = 0; i < MDNS_MAX_INTERFACES; ++i) {
         if (!s_esp_netifs[i].predefined && s_esp_netifs[i].netif == NULL) {
             s_esp_netifs[i].netif = esp_netif;
+            _mdns_answer_cache_flush();
             err = ESP_OK;
             break;
         }
@@ -5654,6 +6263,7 @@ esp_err_t mdns_unregister_netif(esp_netif_t *esp_netif)
     for (mdns_if_t i = 0; i < MDNS_MAX_INTERFACES; ++i) {
         if (!s_esp_netifs[i].predefined && s_esp_netifs[i].netif == esp_netif) {
             s_esp_netifs[i].netif = NULL;
+            _mdns_answer_cache_flush();
             err = ESP_OK;
             break;
         }
@@ -5682,10 +6292,15 @@ esp_err_t mdns_init(void)
         s_esp_netifs[i].netif = NULL;
     }
 
+    err = mdns_mem_pool_init();
+    if (err) {
+        goto free_server;
+    }
+
     _mdns_server->action_queue = xQueueCreate(MDNS_ACTION_QUEUE_LEN, sizeof(mdns_action_t *));
     if (!_mdns_server->action_queue) {
         err = ESP_ERR_NO_MEM;
-        goto free_server;
+        goto free_pools;
     }
 
     _mdns_server->action_sema = xSemaphoreCreateBinary();
@@ -5755,6 +6370,8 @@ free_event_handlers:
     vSemaphoreDelete(_mdns_server->action_sema);
 free_queue:
     vQueueDelete(_mdns_server->action_queue);
+free_pools:
+    mdns_mem_pool_deinit();
 free_server:
     mdns_mem_free(_mdns_server);
     _mdns_server = NULL;
@@ -5810,10 +6427,45 @@ void mdns_free(void)
 
     }
     vSemaphoreDelete(_mdns_server->action_sema);
+    _mdns_answer_cache_flush();
+    taskENTER_CRITICAL(&_mdns_txt_async_lock);
+    memset(_mdns_txt_async, 0, sizeof(_mdns_txt_async));
+    _mdns_txt_async_dirty = false;
+    _mdns_txt_async_posted = false;
+    taskEXIT_CRITICAL(&_mdns_txt_async_lock);
+    mdns_mem_pool_deinit();
     mdns_mem_free(_mdns_server);
     _mdns_server = NULL;
 }
 
+esp_err_t mdns_mem_pool_get_stats(mdns_mem_pool_t pool, mdns_mem_pool_stats_t *stats)
+{
+    if ((unsigned)pool >= MDNS_MEM_POOL_MAX || !stats) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!_mdns_server) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    MDNS_SERVICE_LOCK();
+    mdns_mem_pool_stats(pool, stats);
+    MDNS_SERVICE_UNLOCK();
+    return ESP_OK;
+}
+
+esp_err_t mdns_tx_get_stats(mdns_tx_stats_t *stats)
+{
+    if (!stats) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!_mdns_server) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    MDNS_SERVICE_LOCK();
+    *stats = _mdns_server->tx_stats;
+    MDNS_SERVICE_UNLOCK();
+    return ESP_OK;
+}
+
 esp_err_t mdns_hostname_set(const char *hostname)
 {
     if (!_mdns_server) {
@@ -6023,6 +6675,7 @@ esp_err_t mdns_service_add_for_host(const char *instance, const char *service, c
 
     item->next = _mdns_server->services;
     _mdns_server->services = item;
+    _mdns_service_index_add(item);
     _mdns_probe_all_pcbs(&item, 1, false, false);
     MDNS_SERVICE_UNLOCK();
     return ESP_OK;
@@ -6119,14 +6772,8 @@ handle_error:
 
 static mdns_ip_addr_t *_copy_delegated_host_address_list(char *hostname)
 {
-    mdns_host_item_t *host = _mdns_host_list;
-    while (host) {
-        if (strcasecmp(host->hostname, hostname) == 0) {
-            return copy_address_list(host->address_list);
-        }
-        host = host->next;
-    }
-    return NULL;
+    mdns_host_item_t *host = _mdns_get_delegated_host(hostname);
+    return host ? copy_address_list(host->address_list) : NULL;
 }
 
 static mdns_result_t *_mdns_lookup_service(const char *instance, const char *service, const char *proto, size_t max_results, bool selfhost)
@@ -6220,6 +6867,7 @@ esp_err_t mdns_service_port_set_for_host(const char *instance, const char *servi
     ESP_GOTO_ON_FALSE(s, ESP_ERR_NOT_FOUND, err, TAG, "Service doesn't exist");
 
     s->service->port = port;
+    _mdns_answer_cache_flush();
     _mdns_announce_all_pcbs(&s, 1, true);
 
 err:
@@ -6258,6 +6906,7 @@ esp_err_t mdns_service_txt_set_for_host(const char *instance, const char *servic
     srv->txt = NULL;
     _mdns_free_linked_txt(txt);
     srv->txt = new_txt;
+    _mdns_answer_cache_flush();
     _mdns_announce_all_pcbs(&s, 1, false);
 
 err:
@@ -6278,8 +6927,6 @@ esp_err_t mdns_service_txt_item_set_for_host_with_explicit_value_len(const char
 {
     MDNS_SERVICE_LOCK();
     esp_err_t ret = ESP_OK;
-    char *value = NULL;
-    mdns_txt_linked_item_t *new_txt = NULL;
     const char *hostname = host ? host : _mdns_server->hostname;
     ESP_GOTO_ON_FALSE(_mdns_server && _mdns_server->services && !_str_null_or_empty(service) && !_str_null_or_empty(proto) && !_str_null_or_empty(key) &&
                       !((!value_arg && value_len)), ESP_ERR_INVALID_ARG, err, TAG, "Invalid state or arguments");
@@ -6287,46 +6934,15 @@ esp_err_t mdns_service_txt_item_set_for_host_with_explicit_value_len(const char
     mdns_srv_item_t *s = _mdns_get_service_item_instance(instance, service, proto, hostname);
     ESP_GOTO_ON_FALSE(s, ESP_ERR_NOT_FOUND, err, TAG, "Service doesn't exist");
 
-    mdns_service_t *srv = s->service;
-    if (value_len > 0) {
-        value = (char *) mdns_mem_malloc(value_len);
-        ESP_GOTO_ON_FALSE(value, ESP_ERR_NO_MEM, out_of_mem, TAG, "Out of memory");
-        memcpy(value, value_arg, value_len);
-    } else {
-        value_len = 0;
-    }
-    mdns_txt_linked_item_t *txt = srv->txt;
-    while (txt) {
-        if (strcmp(txt->key, key) == 0) {
-            mdns_mem_free((char *)txt->value);
-            txt->value = value;
-            txt->value_len = value_len;
-            break;
-        }
-        txt = txt->next;
-    }
-    if (!txt) {
-        new_txt = (mdns_txt_linked_item_t *)mdns_mem_malloc(sizeof(mdns_txt_linked_item_t));
-        ESP_GOTO_ON_FALSE(new_txt, ESP_ERR_NO_MEM, out_of_mem, TAG, "Out of memory");
-        new_txt->key = mdns_mem_strdup(key);
-        ESP_GOTO_ON_FALSE(new_txt->key, ESP_ERR_NO_MEM, out_of_mem, TAG, "Out of memory");
-        new_txt->value = value;
-        new_txt->value_len = value_len;
-        new_txt->next = srv->txt;
-        srv->txt = new_txt;
-    }
+    ret = _mdns_txt_item_set(s->service, key, value_arg, value_len, NULL);
+    ESP_GOTO_ON_ERROR(ret, err, TAG, "Out of memory");
+    _mdns_answer_cache_flush();
 
     _mdns_announce_all_pcbs(&s, 1, false);
 
 err:
     MDNS_SERVICE_UNLOCK();
     return ret;
-out_of_mem:
-    MDNS_SERVICE_UNLOCK();
-    HOOK_MALLOC_FAILED;
-    mdns_mem_free(value);
-    mdns_mem_free(new_txt);
-    return ret;
 }
 
 esp_err_t mdns_service_txt_item_set_for_host(const char *instance, const char *service, const char *proto, const char *hostname,
@@ -6346,6 +6962,58 @@ esp_err_t mdns_service_txt_item_set(const char *service, const char *proto, cons
                                                                       value, strlen(value));
 }
 
+esp_err_t mdns_service_txt_item_set_async(const char *service, const char *proto, const char *key, const char *value)
+{
+    static mdns_action_t txt_async_action = { .type = ACTION_TXT_ASYNC };
+    mdns_action_t *action = &txt_async_action;
+    mdns_txt_async_t *slot = NULL;
+    bool post = false;
+
+    if (!_mdns_server) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (_str_null_or_empty(service) || _str_null_or_empty(proto) || _str_null_or_empty(key) || !value ||
+            strlen(service) >= sizeof(slot->service) || strlen(proto) >= sizeof(slot->proto) ||
+            strlen(key) >= sizeof(slot->key) || strlen(value) >= sizeof(slot->value)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    taskENTER_CRITICAL(&_mdns_txt_async_lock);
+    for (size_t i = 0; i < CONFIG_MDNS_TXT_ASYNC_ITEMS; i++) {
+        mdns_txt_async_t *t = &_mdns_txt_async[i];
+        if (!t->used) {
+            if (!slot) {
+                slot = t;
+            }
+        } else if (!strcasecmp(t->service, service) && !strcasecmp(t->proto, proto) && !strcmp(t->key, key)) {
+            slot = t;
+            break;
+        }
+    }
+    if (slot) {
+        strcpy(slot->service, service);
+        strcpy(slot->proto, proto);
+        strcpy(slot->key, key);
+        strcpy(slot->value, value);
+        slot->used = true;
+        _mdns_txt_async_dirty = true;
+        post = !_mdns_txt_async_posted;
+        _mdns_txt_async_posted = true;
+    }
+    taskEXIT_CRITICAL(&_mdns_txt_async_lock);
+    if (!slot) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    // a full queue is fine: the service task is busy and applies the items after its next action
+    if (post && xQueueSend(_mdns_server->action_queue, &action, (TickType_t)0) != pdPASS) {
+        taskENTER_CRITICAL(&_mdns_txt_async_lock);
+        _mdns_txt_async_posted = false;
+        taskEXIT_CRITICAL(&_mdns_txt_async_lock);
+    }
+    return ESP_OK;
+}
+
 esp_err_t mdns_service_txt_item_set_with_explicit_value_len(const char *service, const char *proto, const char *key,
                                                             const char *value, uint8_t value_len)
 {
@@ -6391,6 +7059,7 @@ esp_err_t mdns_service_txt_item_remove_for_host(const char *instance, const char
             }
         }
     }
+    _mdns_answer_cache_flush();
 
     _mdns_announce_all_pcbs(&s, 1, false);
 
@@ -6426,6 +7095,7 @@ static esp_err_t _mdns_service_subtype_remove_for_host(mdns_srv_item_t *service,
             }
             mdns_mem_free((char *)srv_subtype->subtype);
             mdns_mem_free(srv_subtype);
+            _mdns_answer_cache_flush();
             ret = ESP_OK;
             break;
         }
@@ -6487,6 +7157,7 @@ static esp_err_t _mdns_service_subtype_add_for_host(mdns_srv_item_t *service, co
     ESP_GOTO_ON_FALSE(subtype_item->subtype, ESP_ERR_NO_MEM, out_of_mem, TAG, "Out of memory");
     subtype_item->next = service->service->subtype;
     service->service->subtype = subtype_item;
+    _mdns_answer_cache_flush();
 
 err:
     return ret;
@@ -6611,6 +7282,7 @@ esp_err_t mdns_service_subtype_update_multiple_items_for_host(const char *instan
 
     _mdns_free_subtype(goodbye_subtype);
     _mdns_free_service_subtype(s->service);
+    _mdns_answer_cache_flush();
 
     for (; cur_index < num_items; cur_index++) {
         ret = _mdns_service_subtype_add_for_host(s, subtype[cur_index].subtype);
@@ -6656,6 +7328,7 @@ esp_err_t mdns_service_instance_name_set_for_host(const char *instance_old, cons
         mdns_mem_free((char *)s->service->instance);
     }
     s->service->instance = mdns_mem_strndup(instance, MDNS_NAME_BUF_LEN - 1);
+    _mdns_answer_cache_flush();
     ESP_GOTO_ON_FALSE(s->service->instance, ESP_ERR_NO_MEM, err, TAG, "Out of memory");
     _mdns_probe_all_pcbs(&s, 1, false, false);
 
@@ -6687,6 +7360,7 @@ esp_err_t mdns_service_remove_for_host(const char *instance, const char *service
     if (instance) {
         while (a) {
             if (_mdns_service_match_instance(a->service, instance, service, proto, hostname)) {
+                _mdns_service_index_remove(a);
                 if (_mdns_server->services != a) {
                     b->next = a->next;
                 } else {
@@ -6704,6 +7378,7 @@ esp_err_t mdns_service_remove_for_host(const char *instance, const char *service
     } else {
         while (a) {
             if (_mdns_service_match(a->service, service, proto, hostname)) {
+                _mdns_service_index_remove(a);
                 if (_mdns_server->services != a) {
                     b->next = a->next;
                 } else {
@@ -6745,6 +7420,9 @@ esp_err_t mdns_service_remove_all(void)
     _mdns_send_final_bye(false);
     mdns_srv_item_t *services = _mdns_server->services;
     _mdns_server->services = NULL;
+    memset(_mdns_server->service_index, 0, sizeof(_mdns_server->service_index));
+    _mdns_label_filter_valid = false;
+    _mdns_answer_cache_flush();
     while (services) {
         mdns_srv_item_t *s = services;
         services = services->next;
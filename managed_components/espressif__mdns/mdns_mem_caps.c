@@ -94,3 +94,116 @@ void ALLOW_WEAK mdns_mem_task_free(void *ptr)
 {
     heap_caps_free(ptr);
 }
+
+/*
+ * Block pools for outgoing packets and their records. Each pool is one slab
+ * from mdns_mem_malloc(), so the allocation type and custom implementations
+ * above still apply, carved into equal blocks kept on an intrusive free list.
+ * A block outside the slab came from the heap fallback and goes back there.
+ */
+typedef struct mdns_mem_block_s {
+    struct mdns_mem_block_s *next;
+} mdns_mem_block_t;
+
+typedef struct {
+    uint8_t *slab;
+    mdns_mem_block_t *free_list;
+    size_t capacity;
+    size_t in_use;
+    size_t high_water;
+    uint32_t heap_allocs;
+} mdns_mem_pool_state_t;
+
+#define MDNS_MEM_POOL_BLOCK(type) ((sizeof(type) + sizeof(void *) - 1) & ~(sizeof(void *) - 1))
+
+static const size_t s_pool_block_size[MDNS_MEM_POOL_MAX] = {
+    [MDNS_MEM_POOL_TX_PACKET] = MDNS_MEM_POOL_BLOCK(mdns_tx_packet_t),
+    [MDNS_MEM_POOL_ANSWER] = MDNS_MEM_POOL_BLOCK(mdns_out_answer_t),
+    [MDNS_MEM_POOL_QUESTION] = MDNS_MEM_POOL_BLOCK(mdns_out_question_t),
+};
+
+#if CONFIG_MDNS_MEMORY_POOL
+static const size_t s_pool_capacity[MDNS_MEM_POOL_MAX] = {
+    [MDNS_MEM_POOL_TX_PACKET] = CONFIG_MDNS_MEMORY_POOL_TX_PACKETS,
+    [MDNS_MEM_POOL_ANSWER] = CONFIG_MDNS_MEMORY_POOL_ANSWERS,
+    [MDNS_MEM_POOL_QUESTION] = CONFIG_MDNS_MEMORY_POOL_QUESTIONS,
+};
+#endif
+
+static mdns_mem_pool_state_t s_pools[MDNS_MEM_POOL_MAX];
+
+esp_err_t mdns_mem_pool_init(void)
+{
+    memset(s_pools, 0, sizeof(s_pools));
+#if CONFIG_MDNS_MEMORY_POOL
+    for (int i = 0; i < MDNS_MEM_POOL_MAX; i++) {
+        mdns_mem_pool_state_t *pool = &s_pools[i];
+        pool->slab = (uint8_t *)mdns_mem_malloc(s_pool_capacity[i] * s_pool_block_size[i]);
+        if (!pool->slab) {
+            mdns_mem_pool_deinit();
+            return ESP_ERR_NO_MEM;
+        }
+        pool->capacity = s_pool_capacity[i];
+        for (size_t b = pool->capacity; b > 0; b--) {
+            mdns_mem_block_t *block = (mdns_mem_block_t *)(pool->slab + (b - 1) * s_pool_block_size[i]);
+            block->next = pool->free_list;
+            pool->free_list = block;
+        }
+    }
+#endif
+    return ESP_OK;
+}
+
+void mdns_mem_pool_deinit(void)
+{
+    for (int i = 0; i < MDNS_MEM_POOL_MAX; i++) {
+        mdns_mem_free(s_pools[i].slab);
+    }
+    memset(s_pools, 0, sizeof(s_pools));
+}
+
+void *mdns_mem_pool_alloc(mdns_mem_pool_t pool_id)
+{
+    mdns_mem_pool_state_t *pool = &s_pools[pool_id];
+    void *ptr = pool->free_list;
+    if (ptr) {
+        pool->free_list = pool->free_list->next;
+    } else {
+        ptr = mdns_mem_malloc(s_pool_block_size[pool_id]);
+        if (!ptr) {
+            return NULL;
+        }
+        pool->heap_allocs++;
+    }
+    if (++pool->in_use > pool->high_water) {
+        pool->high_water = pool->in_use;
+    }
+    return ptr;
+}
+
+void mdns_mem_pool_free(mdns_mem_pool_t pool_id, void *ptr)
+{
+    if (!ptr) {
+        return;
+    }
+    mdns_mem_pool_state_t *pool = &s_pools[pool_id];
+    uint8_t *p = (uint8_t *)ptr;
+    pool->in_use--;
+    if (pool->slab && p >= pool->slab && p < pool->slab + pool->capacity * s_pool_block_size[pool_id]) {
+        mdns_mem_block_t *block = (mdns_mem_block_t *)ptr;
+        block->next = pool->free_list;
+        pool->free_list = block;
+    } else {
+        mdns_mem_free(ptr);
+    }
+}
+
+void mdns_mem_pool_stats(mdns_mem_pool_t pool_id, mdns_mem_pool_stats_t *stats)
+{
+    const mdns_mem_pool_state_t *pool = &s_pools[pool_id];
+    stats->block_size = s_pool_block_size[pool_id];
+    stats->capacity = pool->capacity;
+    stats->in_use = pool->in_use;
+    stats->high_water = pool->high_water;
+    stats->heap_allocs = pool->heap_allocs;
+}
@@ -38,6 +38,15 @@ typedef struct interfaces {
     int proto;
 } interfaces_t;
 
+/**
+ * @brief  A received packet in one allocation, recvfrom() writing straight into the payload
+ */
+typedef struct sock_rx_packet {
+    mdns_rx_packet_t packet;    // first, so the mdns_rx_packet_t pointer frees the whole block
+    struct pbuf pb;
+    uint8_t payload[MDNS_MAX_PACKET_SIZE];
+} sock_rx_packet_t;
+
 static interfaces_t s_interfaces[MDNS_MAX_INTERFACES];
 
 static const char *TAG = "mdns_networking";
@@ -88,8 +97,6 @@ size_t _mdns_get_packet_len(mdns_rx_packet_t *packet)
 
 void _mdns_packet_free(mdns_rx_packet_t *packet)
 {
-    mdns_mem_free(packet->pb->payload);
-    mdns_mem_free(packet->pb);
     mdns_mem_free(packet);
 }
 
@@ -281,41 +288,40 @@ void sock_recv_task(void *arg)
                     continue;
                 }
                 if (FD_ISSET(sock, &rfds)) {
-                    static char recvbuf[MDNS_MAX_PACKET_SIZE];
                     uint16_t port = 0;
 
                     struct sockaddr_storage raddr; // Large enough for both IPv4 or IPv6
                     socklen_t socklen = sizeof(struct sockaddr_storage);
                     esp_ip_addr_t addr = {0};
-                    int len = recvfrom(sock, recvbuf, sizeof(recvbuf), 0,
+                    sock_rx_packet_t *rx = (sock_rx_packet_t *) mdns_mem_malloc(sizeof(sock_rx_packet_t));
+                    if (rx == NULL) {
+                        // still take the datagram off the socket
+                        uint8_t discard;
+                        recvfrom(sock, &discard, sizeof(discard), 0, NULL, NULL);
+                        HOOK_MALLOC_FAILED;
+                        ESP_LOGE(TAG, "Failed to allocate the mdns packet");
+                        continue;
+                    }
+                    int len = recvfrom(sock, rx->payload, sizeof(rx->payload), 0,
                                        (struct sockaddr *) &raddr, &socklen);
                     if (len < 0) {
                         ESP_LOGE(TAG, "multicast recvfrom failed. errno=%d: %s", errno, strerror(errno));
+                        mdns_mem_free(rx);
                         break;
                     }
                     ESP_LOGD(TAG, "[sock=%d]: Received from IP:%s", sock, get_string_address(&raddr));
-                    ESP_LOG_BUFFER_HEXDUMP(TAG, recvbuf, len, ESP_LOG_VERBOSE);
+                    ESP_LOG_BUFFER_HEXDUMP(TAG, rx->payload, len, ESP_LOG_VERBOSE);
                     inet_to_espaddr(&raddr, &addr, &port);
 
-                    // Allocate the packet structure and pass it to the mdns main engine
-                    mdns_rx_packet_t *packet = (mdns_rx_packet_t *) mdns_mem_calloc(1, sizeof(mdns_rx_packet_t));
-                    struct pbuf *packet_pbuf = mdns_mem_calloc(1, sizeof(struct pbuf));
-                    uint8_t *buf = mdns_mem_malloc(len);
-                    if (packet == NULL || packet_pbuf == NULL || buf == NULL) {
-                        mdns_mem_free(buf);
-                        mdns_mem_free(packet_pbuf);
-                        mdns_mem_free(packet);
-                        HOOK_MALLOC_FAILED;
-                        ESP_LOGE(TAG, "Failed to allocate the mdns packet");
-                        continue;
-                    }
-                    memcpy(buf, recvbuf, len);
-                    packet_pbuf->next = NULL;
-                    packet_pbuf->payload = buf;
-                    packet_pbuf->tot_len = len;
-                    packet_pbuf->len = len;
+                    // Pass the packet to the mdns main engine, which parses it in place
+                    mdns_rx_packet_t *packet = &rx->packet;
+                    memset(packet, 0, sizeof(mdns_rx_packet_t));
+                    memset(&rx->pb, 0, sizeof(struct pbuf));
+                    rx->pb.payload = rx->payload;
+                    rx->pb.tot_len = len;
+                    rx->pb.len = len;
                     packet->tcpip_if = tcpip_if;
-                    packet->pb = packet_pbuf;
+                    packet->pb = &rx->pb;
                     packet->src_port = ntohs(port);
                     memcpy(&packet->src, &addr, sizeof(esp_ip_addr_t));
                     // TODO(IDF-3651): Add the correct dest addr -- for mdns to decide multicast/unicast
@@ -327,9 +333,7 @@ void sock_recv_task(void *arg)
                         packet->src.type == ESP_IPADDR_TYPE_V4 ? MDNS_IP_PROTOCOL_V4 : MDNS_IP_PROTOCOL_V6;
                     if (_mdns_send_rx_action(packet) != ESP_OK) {
                         ESP_LOGE(TAG, "_mdns_send_rx_action failed!");
-                        mdns_mem_free(packet->pb->payload);
-                        mdns_mem_free(packet->pb);
-                        mdns_mem_free(packet);
+                        mdns_mem_free(rx);
                     }
                 }
             }
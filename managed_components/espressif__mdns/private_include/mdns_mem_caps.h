@@ -6,6 +6,7 @@
 #pragma once
 
 #include <stddef.h>
+#include "mdns.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -60,6 +61,40 @@ void *mdns_mem_task_malloc(size_t size);
  */
 void mdns_mem_task_free(void *ptr);
 
+/**
+ * @brief Allocate the block pools (no-op unless CONFIG_MDNS_MEMORY_POOL).
+ * @return ESP_OK, or ESP_ERR_NO_MEM if a pool could not be allocated.
+ */
+esp_err_t mdns_mem_pool_init(void);
+
+/**
+ * @brief Free the block pools. All their blocks must have been returned.
+ */
+void mdns_mem_pool_deinit(void);
+
+/**
+ * @brief Allocate one block of the given pool, from the heap if the pool is full.
+ *
+ * Pool functions are not thread safe: call them with the mDNS service lock
+ * held, or before the service task starts.
+ *
+ * @param pool Pool to allocate from.
+ * @return Pointer to uninitialized memory, or NULL on failure.
+ */
+void *mdns_mem_pool_alloc(mdns_mem_pool_t pool);
+
+/**
+ * @brief Return a block obtained from mdns_mem_pool_alloc() of the same pool.
+ * @param pool Pool the block was allocated from.
+ * @param ptr Block to free, may be NULL.
+ */
+void mdns_mem_pool_free(mdns_mem_pool_t pool, void *ptr);
+
+/**
+ * @brief Read the statistics of one pool; see mdns_mem_pool_get_stats().
+ */
+void mdns_mem_pool_stats(mdns_mem_pool_t pool, mdns_mem_pool_stats_t *stats);
+
 #ifdef __cplusplus
 }
 #endif
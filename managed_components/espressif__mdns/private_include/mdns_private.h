@@ -104,6 +104,12 @@
 #define MDNS_ACTION_QUEUE_LEN       CONFIG_MDNS_ACTION_QUEUE_LEN  // Maximum actions pending to the server
 #define MDNS_TXT_MAX_LEN            1024                    // Maximum string length of text data in TXT record
 #define MDNS_MAX_PACKET_SIZE        1460                    // Maximum size of mDNS  outgoing packet
+#define MDNS_SERVICE_INDEX_SIZE     16                      // Hash buckets for services by (service, proto), power of two
+#define MDNS_HOST_INDEX_SIZE        8                       // Hash buckets for delegated hostnames, power of two
+#define MDNS_LABEL_FILTER_BITS      256                     // Bits of the RX label filter, power of two
+#define MDNS_TXT_ASYNC_KEY_LEN      16                      // Longest key of mdns_service_txt_item_set_async(), with the NUL
+#define MDNS_TXT_ASYNC_VALUE_LEN    32                      // Longest value of mdns_service_txt_item_set_async(), with the NUL
+#define MDNS_ANSWER_CACHE_RECORDS   32                      // Most records of a response kept in the answer cache
 
 #define MDNS_HEAD_LEN               12
 #define MDNS_HEAD_ID_OFFSET         0
@@ -124,7 +130,7 @@
 #define MDNS_SRV_PORT_OFFSET        4
 #define MDNS_SRV_FQDN_OFFSET        6
 
-#define MDNS_TIMER_PERIOD_US        (CONFIG_MDNS_TIMER_PERIOD_MS*1000)
+#define MDNS_TIMER_RETRY_MS         CONFIG_MDNS_TIMER_PERIOD_MS     // Back-off when a due packet or search cannot be queued
 
 #define MDNS_SERVICE_LOCK()     xSemaphoreTake(_mdns_service_semaphore, portMAX_DELAY)
 #define MDNS_SERVICE_UNLOCK()   xSemaphoreGive(_mdns_service_semaphore)
@@ -187,7 +193,8 @@ typedef enum {
     ACTION_BROWSE_ADD,
     ACTION_BROWSE_SYNC,
     ACTION_BROWSE_END,
-    ACTION_TX_HANDLE,
+    ACTION_TX_DUE,
+    ACTION_TXT_ASYNC,
     ACTION_RX_HANDLE,
     ACTION_TASK_STOP,
     ACTION_DELEGATE_HOSTNAME_ADD,
@@ -293,6 +300,7 @@ typedef struct {
 
 typedef struct mdns_srv_item_s {
     struct mdns_srv_item_s *next;
+    struct mdns_srv_item_s *index_next;     // next in the same service_index bucket, in list order
     mdns_service_t *service;
 } mdns_srv_item_t;
 
@@ -311,6 +319,7 @@ typedef struct mdns_host_item_t {
     const char *hostname;
     mdns_ip_addr_t *address_list;
     struct mdns_host_item_t *next;
+    struct mdns_host_item_t *index_next;    // next in the same delegated host index bucket
 } mdns_host_item_t;
 
 typedef struct mdns_out_answer_s {
@@ -325,6 +334,30 @@ typedef struct mdns_out_answer_s {
     const char *custom_proto;
 } mdns_out_answer_t;
 
+/**
+ * @brief  A serialized response, kept for the next packet with the same records
+ */
+typedef struct {
+    mdns_out_answer_t *key;                         // the packet's records in order, next unused; NULL if the entry is unused
+    uint8_t *data;                                  // sections after the header, in the same allocation as key
+    uint16_t len;
+    mdns_if_t tcpip_if;
+    uint8_t records[3];                             // key records in answers, servers and additional
+    uint8_t counts[3];                              // records serialized into each of them
+    uint8_t pcb_state[MDNS_MAX_INTERFACES][MDNS_IP_PROTOCOL_MAX];
+} mdns_answer_cache_entry_t;
+
+/**
+ * @brief  A TXT item set by mdns_service_txt_item_set_async(), waiting for the service task
+ */
+typedef struct {
+    char service[MDNS_NAME_BUF_LEN];
+    char proto[8];
+    char key[MDNS_TXT_ASYNC_KEY_LEN];
+    char value[MDNS_TXT_ASYNC_VALUE_LEN];
+    bool used;
+} mdns_txt_async_t;
+
 typedef struct mdns_tx_packet_s {
     struct mdns_tx_packet_s *next;
     uint32_t send_at;
@@ -338,7 +371,6 @@ typedef struct mdns_tx_packet_s {
     mdns_out_answer_t *answers;
     mdns_out_answer_t *servers;
     mdns_out_answer_t *additional;
-    bool queued;
     uint16_t id;
 } mdns_tx_packet_t;
 
@@ -412,11 +444,16 @@ typedef struct mdns_server_s {
     const char *hostname;
     const char *instance;
     mdns_srv_item_t *services;
+    mdns_srv_item_t *service_index[MDNS_SERVICE_INDEX_SIZE];    // services hashed by (service, proto)
     QueueHandle_t action_queue;
     SemaphoreHandle_t action_sema;
     mdns_tx_packet_t *tx_queue_head;
     mdns_search_once_t *search_once;
     esp_timer_handle_t timer_handle;
+    uint32_t timer_due;                     // ms tick the one-shot timer fires at, valid while timer_armed
+    bool timer_armed;
+    bool tx_due_posted;                     // ACTION_TX_DUE is in the action queue
+    mdns_tx_stats_t tx_stats;
     mdns_browse_t *browse;
 } mdns_server_t;
 
@@ -434,9 +471,6 @@ typedef struct {
         struct {
             mdns_search_once_t *search;
         } search_add;
-        struct {
-            mdns_tx_packet_t *packet;
-        } tx_handle;
         struct {
             mdns_rx_packet_t *packet;
         } rx_handle;
@@ -0,0 +1,682 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//
+// mdns_parse_packet() throughput benchmark on the fuzz test's mocked environment
+//
+// Runs the receive path (parse, answer, transmit) over a set of workloads and
+// reports packets per second, mdns_mem_* allocations and bytes per packet,
+// transmitted packets per received packet and the peak mDNS heap:
+//   corpus        the packets decoded in input_packets.txt, re-encoded
+//   foreign       announcements from many devices whose services are not ours
+//   known-answer  queries for our services carrying long known-answer lists
+//   large-txt     announcements with TXT records near the packet size
+// then corpus and foreign again with the test's searches running, so that
+// responses are parsed into results rather than dropped early.
+//
+
+#include <time.h>
+
+#define MDNS_TEST_NO_MAIN
+#include "test.c"
+
+#define BENCH_PKT_MAX        1460
+#define BENCH_SYNTH_PKTS     64          // distinct synthetic packets per workload
+#define BENCH_CORPUS_MAX     64
+#define BENCH_NAMES_MAX      48          // compression targets per packet
+#define BENCH_NAME_LEN       256         // a whole name, dotted
+#define BENCH_LABEL_LEN      63
+
+void mdns_test_tx_handle_packet(void *p);
+
+typedef struct {
+    uint8_t data[BENCH_PKT_MAX];
+    size_t len;
+} bench_pkt_t;
+
+//
+// DNS packet writer, with name compression
+//
+typedef struct {
+    bench_pkt_t *pkt;
+    size_t len;
+    bool overflow;
+    uint16_t qd, an, ar;
+    uint16_t rdlength_at;
+    int names;
+    uint16_t name_off[BENCH_NAMES_MAX];
+    char name_sfx[BENCH_NAMES_MAX][BENCH_NAME_LEN];
+} bench_writer_t;
+
+typedef struct {
+    size_t len;
+    uint16_t qd, an, ar;
+    int names;
+} bench_mark_t;
+
+static void w_begin(bench_writer_t *w, bench_pkt_t *pkt)
+{
+    memset(w, 0, sizeof(*w));
+    w->pkt = pkt;
+    w->len = 12;
+}
+
+static void w_bytes(bench_writer_t *w, const void *data, size_t len)
+{
+    if (w->overflow || w->len + len > BENCH_PKT_MAX) {
+        w->overflow = true;
+        return;
+    }
+    memcpy(w->pkt->data + w->len, data, len);
+    w->len += len;
+}
+
+static void w_u8(bench_writer_t *w, uint8_t v)
+{
+    w_bytes(w, &v, 1);
+}
+
+static void w_u16(bench_writer_t *w, uint16_t v)
+{
+    uint8_t b[2] = { v >> 8, v & 0xff };
+    w_bytes(w, b, 2);
+}
+
+static void w_u32(bench_writer_t *w, uint32_t v)
+{
+    w_u16(w, v >> 16);
+    w_u16(w, v & 0xffff);
+}
+
+// Labels are split at '.', except that an instance name ("Hristo's Time Capsule.1._smb._tcp.local") is one label
+static int w_split(const char *name, char labels[][BENCH_LABEL_LEN + 1], int max)
+{
+    int n = 0;
+    const char *p = name;
+    const char *svc = strstr(name, "._");
+    if (svc && name[0] != '_') {
+        size_t len = svc - name;
+        if (len > BENCH_LABEL_LEN) {
+            return -1;
+        }
+        memcpy(labels[n], name, len);
+        labels[n++][len] = '\0';
+        p = svc + 1;
+    }
+    while (*p && n < max) {
+        const char *dot = strchr(p, '.');
+        size_t len = dot ? (size_t)(dot - p) : strlen(p);
+        if (len > BENCH_LABEL_LEN) {
+            return -1;
+        }
+        if (len) {                  // the dump prints "host...local." for some NSEC names
+            memcpy(labels[n], p, len);
+            labels[n++][len] = '\0';
+        }
+        p += len + (dot ? 1 : 0);
+    }
+    return n;
+}
+
+static void w_name(bench_writer_t *w, const char *name)
+{
+    char labels[16][BENCH_LABEL_LEN + 1];
+    int n = w_split(name, labels, 16);
+    if (n < 0) {
+        w->overflow = true;
+        return;
+    }
+    for (int i = 0; i < n; i++) {
+        char sfx[BENCH_NAME_LEN];
+        size_t len = 0;
+        for (int j = i; j < n && len < sizeof(sfx); j++) {
+            len += snprintf(sfx + len, sizeof(sfx) - len, "%s.", labels[j]);
+        }
+        for (int k = 0; k < w->names; k++) {
+            if (!strcmp(w->name_sfx[k], sfx)) {
+                w_u16(w, 0xC000 | w->name_off[k]);
+                return;
+            }
+        }
+        if (w->names < BENCH_NAMES_MAX && w->len < 0x3fff) {
+            w->name_off[w->names] = w->len;
+            snprintf(w->name_sfx[w->names++], BENCH_NAME_LEN, "%s", sfx);
+        }
+        w_u8(w, strlen(labels[i]));
+        w_bytes(w, labels[i], strlen(labels[i]));
+    }
+    w_u8(w, 0);
+}
+
+static void w_question(bench_writer_t *w, const char *name, uint16_t type, bool unicast)
+{
+    w_name(w, name);
+    w_u16(w, type);
+    w_u16(w, unicast ? 0x8001 : 0x0001);
+    w->qd++;
+}
+
+// Record header; the rdata follows, then w_record_end(). Answers must all come before additional records.
+static void w_record(bench_writer_t *w, bool additional, const char *name, uint16_t type, bool flush, uint32_t ttl)
+{
+    w_name(w, name);
+    w_u16(w, type);
+    w_u16(w, flush ? 0x8001 : 0x0001);
+    w_u32(w, ttl);
+    w->rdlength_at = w->len;
+    w_u16(w, 0);
+    if (additional) {
+        w->ar++;
+    } else {
+        w->an++;
+    }
+}
+
+static void w_record_end(bench_writer_t *w)
+{
+    if (!w->overflow) {
+        size_t rdlength = w->len - w->rdlength_at - 2;
+        w->pkt->data[w->rdlength_at] = rdlength >> 8;
+        w->pkt->data[w->rdlength_at + 1] = rdlength & 0xff;
+    }
+}
+
+static void w_txt_item(bench_writer_t *w, const char *item, size_t len)
+{
+    w_u8(w, len);
+    w_bytes(w, item, len);
+}
+
+static bench_mark_t w_mark(const bench_writer_t *w)
+{
+    bench_mark_t m = { w->len, w->qd, w->an, w->ar, w->names };
+    return m;
+}
+
+static void w_rollback(bench_writer_t *w, bench_mark_t m)
+{
+    w->len = m.len;
+    w->qd = m.qd;
+    w->an = m.an;
+    w->ar = m.ar;
+    w->names = m.names;
+    w->overflow = false;
+}
+
+// Queries have flags 0, responses are authoritative answers
+static bool w_end(bench_writer_t *w, uint16_t flags)
+{
+    if (w->overflow) {
+        return false;
+    }
+    uint8_t *h = w->pkt->data;
+    memset(h, 0, 12);
+    h[2] = flags >> 8;
+    h[3] = flags & 0xff;
+    h[5] = w->qd;
+    h[7] = w->an;
+    h[11] = w->ar;
+    w->pkt->len = w->len;
+    return true;
+}
+
+//
+// input_packets.txt: the parser's dump of the fuzz corpus, re-encoded
+//
+static int bench_type(const char *s)
+{
+    static const struct {
+        const char *name;
+        uint16_t type;
+    } types[] = {
+        { "A", MDNS_TYPE_A }, { "PTR", MDNS_TYPE_PTR }, { "TXT", MDNS_TYPE_TXT }, { "AAAA", MDNS_TYPE_AAAA },
+        { "SRV", MDNS_TYPE_SRV }, { "NSEC", MDNS_TYPE_NSEC }, { "ANY", MDNS_TYPE_ANY },
+    };
+    for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); i++) {
+        if (!strcmp(s, types[i].name)) {
+            return types[i].type;
+        }
+    }
+    return -1;
+}
+
+// "<name>. TYPE IN [FLUSH]" up to the end of the class; returns what follows it, or NULL
+static char *bench_parse_head(char *line, char *name, int *type, bool *flush)
+{
+    char *end = strstr(line, ". ");
+    if (!end || end - line + 2 > BENCH_NAME_LEN) {
+        return NULL;
+    }
+    memcpy(name, line, end - line + 1);
+    name[end - line + 1] = '\0';
+    char tname[8];
+    int used = 0;
+    if (sscanf(end + 2, "%7s IN%n", tname, &used) != 1 || !used || (*type = bench_type(tname)) < 0) {
+        return NULL;
+    }
+    char *rest = end + 2 + used;
+    *flush = !strncmp(rest, " FLUSH", 6);
+    return *flush ? rest + 6 : rest;
+}
+
+static bool bench_parse_rdata(bench_writer_t *w, int type, char *data)
+{
+    unsigned v[8];
+    switch (type) {
+    case MDNS_TYPE_A:
+        if (sscanf(data, "%u.%u.%u.%u", &v[0], &v[1], &v[2], &v[3]) != 4) {
+            return false;
+        }
+        for (int i = 0; i < 4; i++) {
+            w_u8(w, v[i]);
+        }
+        return true;
+    case MDNS_TYPE_AAAA:
+        if (sscanf(data, "%x:%x:%x:%x:%x:%x:%x:%x", &v[0], &v[1], &v[2], &v[3], &v[4], &v[5], &v[6], &v[7]) != 8) {
+            return false;
+        }
+        for (int i = 0; i < 8; i++) {
+            w_u16(w, v[i]);
+        }
+        return true;
+    case MDNS_TYPE_PTR:
+        w_name(w, data);
+        return true;
+    case MDNS_TYPE_SRV: {
+        char *target = strchr(data, ' ');
+        if (!target) {
+            return false;
+        }
+        w_u16(w, 0);
+        w_u16(w, 0);
+        w_u16(w, atoi(data));
+        w_name(w, target + 1);
+        return true;
+    }
+    case MDNS_TYPE_TXT:
+        // items are printed joined by "; ", an empty TXT as nothing
+        if (!*data) {
+            w_u8(w, 0);
+        }
+        while (*data) {
+            char *sep = strstr(data, "; ");
+            size_t len = sep ? (size_t)(sep - data) : strlen(data);
+            w_txt_item(w, data, len);
+            data += len + (sep ? 2 : 0);
+        }
+        return true;
+    case MDNS_TYPE_NSEC: {
+        // "<next name>  00 05 00 00 80 00 40": the type bitmap in hex
+        char *bitmap = strstr(data, "  ");
+        if (!bitmap) {
+            return false;
+        }
+        *bitmap = '\0';
+        w_name(w, data);
+        for (char *p = bitmap + 2; *p;) {
+            char *next;
+            unsigned long b = strtoul(p, &next, 16);
+            if (next == p) {
+                break;
+            }
+            w_u8(w, b);
+            p = next;
+        }
+        return true;
+    }
+    }
+    return false;
+}
+
+static size_t bench_load_corpus(const char *path, bench_pkt_t *out, size_t max)
+{
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        return 0;
+    }
+    static bench_writer_t w;
+    char line[1024];
+    char name[BENCH_NAME_LEN];
+    size_t n = 0;
+    bool open = false;
+    unsigned answers = 0, skipped = 0;
+    while (n < max) {
+        bool eof = !fgets(line, sizeof(line), f);
+        line[strcspn(line, "\r\n")] = '\0';
+        if (eof || !strncmp(line, "Input:", 6)) {
+            if (open && w.qd + w.an + w.ar) {
+                if (w_end(&w, w.qd ? 0 : MDNS_FLAGS_QR_AUTHORITATIVE)) {
+                    n++;
+                } else {
+                    skipped++;
+                }
+            }
+            if (eof) {
+                break;
+            }
+            w_begin(&w, &out[n]);
+            open = true;
+            answers = UINT16_MAX;
+            continue;
+        }
+        int type;
+        bool flush;
+        char *rest;
+        if (sscanf(line, "Answers: %u", &answers) == 1) {
+            continue;
+        }
+        if (!strncmp(line, "  Q: ", 5)) {
+            if (bench_parse_head(line + 5, name, &type, &flush)) {
+                w_question(&w, name, type, flush);
+            }
+        } else if (!strncmp(line, "  A: ", 5) && (rest = bench_parse_head(line + 5, name, &type, &flush))) {
+            unsigned ttl, len;
+            int used = 0;
+            if (sscanf(rest, " %u [%u]%n", &ttl, &len, &used) != 2 || !used) {
+                continue;
+            }
+            rest += used;
+            rest += *rest == ' ';
+            bench_mark_t m = w_mark(&w);
+            w_record(&w, w.an + w.ar >= answers, name, type, flush, ttl);
+            if (bench_parse_rdata(&w, type, rest)) {
+                w_record_end(&w);
+            } else {
+                w_rollback(&w, m);
+            }
+        }
+    }
+    fclose(f);
+    if (skipped) {
+        printf("corpus: %u packets did not fit in %d bytes, skipped\n", skipped, BENCH_PKT_MAX);
+    }
+    return n;
+}
+
+//
+// Synthetic multicast traffic
+//
+static uint32_t s_rand = 1;
+
+static uint32_t bench_rand(void)
+{
+    s_rand ^= s_rand << 13;
+    s_rand ^= s_rand >> 17;
+    s_rand ^= s_rand << 5;
+    return s_rand;
+}
+
+// Our service types: a foreign instance of one of these gets past the early drop
+static const char *s_our_services[] = { "_http", "_arduino", "_workstation", "_smb", "_printer", "_ipp" };
+#define OUR_SERVICES (sizeof(s_our_services) / sizeof(s_our_services[0]))
+
+static const char *s_hostname;
+
+// PTR, SRV, TXT (unless txt_items < 0) and A of one instance, all in the answer section as in an announcement
+static void bench_instance(bench_writer_t *w, const char *instance, const char *service, const char *host,
+                           uint16_t port, int txt_items)
+{
+    char ptr[64], inst[BENCH_NAME_LEN], target[64];
+    snprintf(ptr, sizeof(ptr), "%s._tcp.local.", service);
+    snprintf(inst, sizeof(inst), "%s.%s", instance, ptr);
+    snprintf(target, sizeof(target), "%s.local.", host);
+
+    w_record(w, false, ptr, MDNS_TYPE_PTR, false, 4500);
+    w_name(w, inst);
+    w_record_end(w);
+    w_record(w, false, inst, MDNS_TYPE_SRV, true, 120);
+    w_u16(w, 0);
+    w_u16(w, 0);
+    w_u16(w, port);
+    w_name(w, target);
+    w_record_end(w);
+    if (txt_items >= 0) {
+        w_record(w, false, inst, MDNS_TYPE_TXT, true, 4500);
+        for (int i = 0; i < txt_items; i++) {
+            char item[64];
+            int len = snprintf(item, sizeof(item), "k%d=%08x%08x", i, (unsigned)bench_rand(), (unsigned)bench_rand());
+            w_txt_item(w, item, len);
+        }
+        if (!txt_items) {
+            w_u8(w, 0);
+        }
+        w_record_end(w);
+    }
+    w_record(w, false, target, MDNS_TYPE_A, true, 120);
+    w_u32(w, 0x0a000000 | (bench_rand() & 0xffff));
+    w_record_end(w);
+}
+
+// Announcements of up to eight instances; one in four uses a service type of ours
+static bool bench_foreign(bench_writer_t *w, bench_pkt_t *pkt)
+{
+    w_begin(w, pkt);
+    int device = bench_rand() % 1000;
+    for (int i = 0; i < 8; i++) {
+        char service[16], instance[48], host[32];
+        if (bench_rand() % 4 == 0) {
+            snprintf(service, sizeof(service), "%s", s_our_services[bench_rand() % OUR_SERVICES]);
+        } else {
+            snprintf(service, sizeof(service), "_svc%u", (unsigned)(bench_rand() % 40));
+        }
+        snprintf(instance, sizeof(instance), "Device %d unit %d", device, i);
+        snprintf(host, sizeof(host), "device-%d", device);
+        bench_mark_t m = w_mark(w);
+        bench_instance(w, instance, service, host, 8000 + i, 3);
+        if (w->overflow) {
+            w_rollback(w, m);
+            break;
+        }
+    }
+    return w_end(w, MDNS_FLAGS_QR_AUTHORITATIVE);
+}
+
+// One to four questions for our names with 10 to 40 known answers, half of them ours so the answer is suppressed
+static bool bench_known_answer(bench_writer_t *w, bench_pkt_t *pkt)
+{
+    w_begin(w, pkt);
+    int questions = 1 + bench_rand() % 4;
+    char name[BENCH_NAME_LEN];
+    for (int i = 0; i < questions; i++) {
+        switch (bench_rand() % 4) {
+        case 0:
+            snprintf(name, sizeof(name), "%s.local.", s_hostname);
+            w_question(w, name, bench_rand() & 1 ? MDNS_TYPE_A : MDNS_TYPE_AAAA, false);
+            break;
+        case 1:
+            w_question(w, "ESP WebServer._http._tcp.local.", bench_rand() & 1 ? MDNS_TYPE_SRV : MDNS_TYPE_TXT, false);
+            break;
+        default:
+            snprintf(name, sizeof(name), "%s._tcp.local.", s_our_services[bench_rand() % OUR_SERVICES]);
+            w_question(w, name, MDNS_TYPE_PTR, false);
+            break;
+        }
+    }
+    int answers = 10 + bench_rand() % 31;
+    for (int i = 0; i < answers; i++) {
+        const char *service = s_our_services[bench_rand() % OUR_SERVICES];
+        char ptr[64], inst[BENCH_NAME_LEN];
+        snprintf(ptr, sizeof(ptr), "%s._tcp.local.", service);
+        if (bench_rand() & 1) {
+            snprintf(inst, sizeof(inst), "%s.%s", !strcmp(service, "_http") ? "ESP WebServer" : s_hostname, ptr);
+        } else {
+            snprintf(inst, sizeof(inst), "Peer %u.%s", (unsigned)(bench_rand() % 500), ptr);
+        }
+        bench_mark_t m = w_mark(w);
+        w_record(w, false, ptr, MDNS_TYPE_PTR, false, 4500);
+        w_name(w, inst);
+        w_record_end(w);
+        if (w->overflow) {
+            w_rollback(w, m);
+            break;
+        }
+    }
+    return w_end(w, 0);
+}
+
+// One foreign _http instance whose TXT record fills the rest of the packet
+static bool bench_large_txt(bench_writer_t *w, bench_pkt_t *pkt)
+{
+    w_begin(w, pkt);
+    char instance[48], host[32], inst[BENCH_NAME_LEN];
+    int device = bench_rand() % 1000;
+    snprintf(instance, sizeof(instance), "Camera %d", device);
+    snprintf(host, sizeof(host), "camera-%d", device);
+    snprintf(inst, sizeof(inst), "%s._http._tcp.local.", instance);
+    bench_instance(w, instance, "_http", host, 80, -1);
+    w_record(w, false, inst, MDNS_TYPE_TXT, true, 4500);
+    for (int i = 0; ; i++) {
+        char item[64];
+        int len = snprintf(item, sizeof(item), "key%02d=%08x%08x%08x%08x", i, (unsigned)bench_rand(),
+                           (unsigned)bench_rand(), (unsigned)bench_rand(), (unsigned)bench_rand());
+        bench_mark_t m = w_mark(w);
+        w_txt_item(w, item, len);
+        if (w->overflow) {
+            w_rollback(w, m);
+            break;
+        }
+    }
+    w_record_end(w);
+    return w_end(w, MDNS_FLAGS_QR_AUTHORITATIVE);
+}
+
+static size_t bench_synth(bool (*gen)(bench_writer_t *, bench_pkt_t *), bench_pkt_t *out, size_t max)
+{
+    static bench_writer_t w;
+    size_t n = 0;
+    for (size_t i = 0; i < max; i++) {
+        if (gen(&w, &out[n])) {
+            n++;
+        }
+    }
+    return n;
+}
+
+//
+// Receive path
+//
+static unsigned s_tx;
+
+// Send what the last packet queued; probes and announcements requeue themselves, so stop after a few
+static void bench_flush_tx(int max)
+{
+    for (int i = 0; i < max && _mdns_server->tx_queue_head; i++) {
+        mdns_tx_packet_t *p = _mdns_server->tx_queue_head;
+        _mdns_server->tx_queue_head = p->next;
+        mdns_test_tx_handle_packet(p);
+        s_tx++;
+    }
+}
+
+static void bench_rx(const bench_pkt_t *pkt)
+{
+    static struct pbuf pb;
+    static mdns_rx_packet_t rx;
+    pb.payload = (void *)pkt->data;
+    pb.len = pkt->len;
+    pb.tot_len = pkt->len;
+    rx.pb = &pb;
+    rx.tcpip_if = 0;
+    rx.ip_protocol = MDNS_IP_PROTOCOL_V4;
+    rx.src.type = ESP_IPADDR_TYPE_V4;
+    rx.src.u_addr.ip4.addr = 0x0a0000fe;
+    rx.src_port = MDNS_SERVICE_PORT;
+    rx.multicast = 1;
+    mdns_parse_packet(&rx);
+    bench_flush_tx(16);
+}
+
+static double bench_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void bench_run(const char *name, const bench_pkt_t *pkts, size_t count, size_t packets)
+{
+    if (!count) {
+        printf("%-20s no packets\n", name);
+        return;
+    }
+    size_t bytes = 0;
+    for (size_t i = 0; i < count; i++) {
+        bench_rx(&pkts[i]);         // warm up: first-seen conflicts and renames happen here
+        bytes += pkts[i].len;
+    }
+    mdns_mem_mock_stats_t before, after;
+    mdns_mem_mock_reset_peak();
+    mdns_mem_mock_stats(&before);
+    unsigned tx = s_tx;
+    double t0 = bench_now();
+    for (size_t i = 0; i < packets; i++) {
+        bench_rx(&pkts[i % count]);
+    }
+    double dt = bench_now() - t0;
+    mdns_mem_mock_stats(&after);
+    printf("%-20s %5zu %6zu %10.0f %8.2f %9.2f %10.0f %7.2f %9zu %+8ld\n", name, count, bytes / count, packets / dt,
+           dt * 1e6 / packets, (double)(after.allocs - before.allocs) / packets,
+           (double)(after.bytes - before.bytes) / packets, (double)(s_tx - tx) / packets, after.peak,
+           (long)after.live - (long)before.live);
+}
+
+int main(int argc, char **argv)
+{
+    size_t packets = 20000;
+    const char *corpus_path = "input_packets.txt";
+    int opt;
+    while ((opt = getopt(argc, argv, "n:s:")) != -1) {
+        switch (opt) {
+        case 'n':
+            packets = strtoul(optarg, NULL, 0);
+            break;
+        case 's':
+            s_rand = strtoul(optarg, NULL, 0) | 1;
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-n packets per workload] [-s seed] [input_packets.txt]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (optind < argc) {
+        corpus_path = argv[optind];
+    }
+
+    mdns_test_setup();
+    bench_flush_tx(200);
+
+    static bench_pkt_t corpus[BENCH_CORPUS_MAX];
+    static bench_pkt_t synth[BENCH_SYNTH_PKTS];
+    size_t corpus_count = bench_load_corpus(corpus_path, corpus, BENCH_CORPUS_MAX);
+    if (!corpus_count) {
+        fprintf(stderr, "%s: no packets\n", corpus_path);
+        return 1;
+    }
+    mdns_mem_mock_stats_t st;
+    mdns_mem_mock_stats(&st);
+    printf("setup: %zu bytes in %zu blocks; %zu packets per workload\n\n", st.live, st.allocs - st.frees, packets);
+    printf("%-20s %5s %6s %10s %8s %9s %10s %7s %9s %8s\n", "workload", "pkts", "bytes", "pkt/s", "us/pkt",
+           "allocs/pkt", "bytes/pkt", "tx/pkt", "peak heap", "held");
+
+    static char hostname[BENCH_NAME_LEN];
+    s_hostname = hostname;
+    bench_run("corpus", corpus, corpus_count, packets);
+    mdns_hostname_get(hostname);    // the corpus claims "minifritz", so the host may have been renamed
+    bench_run("foreign", synth, bench_synth(bench_foreign, synth, BENCH_SYNTH_PKTS), packets);
+    bench_run("known-answer", synth, bench_synth(bench_known_answer, synth, BENCH_SYNTH_PKTS), packets);
+    bench_run("large-txt", synth, bench_synth(bench_large_txt, synth, BENCH_SYNTH_PKTS), packets);
+
+    mdns_test_query("minifritz", "_fritz", "_tcp", MDNS_TYPE_ANY);
+    mdns_test_query(NULL, "_fritz", "_tcp", MDNS_TYPE_PTR);
+    mdns_test_query(NULL, "_afpovertcp", "_tcp", MDNS_TYPE_PTR);
+    mdns_test_query(NULL, "_http", "_tcp", MDNS_TYPE_PTR);
+    bench_flush_tx(200);
+    bench_run("corpus, searching", corpus, corpus_count, packets);
+    bench_run("foreign, searching", synth, bench_synth(bench_foreign, synth, BENCH_SYNTH_PKTS), packets);
+
+    mdns_test_teardown();
+    return 0;
+}
@@ -3,6 +3,7 @@
  *
  * SPDX-License-Identifier: Unlicense OR CC0-1.0
  */
+#include <stddef.h>
 #include <stdio.h>
 #include <string.h>
 #include <pthread.h>
@@ -10,6 +11,9 @@
 #include <unistd.h>
 #include "esp32_mock.h"
 #include "esp_log.h"
+#include "mdns.h"
+#include "mdns_private.h"
+#include "mdns_mem_caps.h"
 
 void     *g_queue;
 int       g_queue_send_shall_fail = 0;
@@ -46,6 +50,11 @@ esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period)
     return ESP_OK;
 }
 
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    return ESP_OK;
+}
+
 esp_err_t esp_timer_create(const esp_timer_create_args_t *create_args,
                            esp_timer_handle_t *out_handle)
 {
@@ -88,9 +97,12 @@ uint32_t xQueueReceive(QueueHandle_t xQueue, void *pvBuffer, TickType_t xTicksTo
     return pdFALSE;
 }
 
+// Takes the item, so that a call which queued nothing (the service instance-name and TXT setters
+// apply their change directly) reads NULL instead of the stale action a previous call left here
 void GetLastItem(void *pvBuffer)
 {
     memcpy(pvBuffer, g_queue, g_size);
+    memset(g_queue, 0, g_size);
 }
 
 void ForceTaskDelete(void)
@@ -126,37 +138,123 @@ uint32_t esp_log_timestamp(void)
     return 0;
 }
 
+/// mdns_mem_* mock: heap with accounting, read by bench.c
+typedef union {
+    size_t size;
+    max_align_t align;
+} mem_header_t;
+
+static mdns_mem_mock_stats_t s_mem;
+
+static void *mem_alloc(size_t size, bool zero)
+{
+    mem_header_t *h = zero ? calloc(1, sizeof(*h) + size) : malloc(sizeof(*h) + size);
+    if (!h) {
+        return NULL;
+    }
+    h->size = size;
+    s_mem.allocs++;
+    s_mem.bytes += size;
+    s_mem.live += size;
+    if (s_mem.live > s_mem.peak) {
+        s_mem.peak = s_mem.live;
+    }
+    return h + 1;
+}
+
+static void mem_free(void *ptr)
+{
+    if (!ptr) {
+        return;
+    }
+    mem_header_t *h = (mem_header_t *)ptr - 1;
+    s_mem.frees++;
+    s_mem.live -= h->size;
+    free(h);
+}
+
+void mdns_mem_mock_stats(mdns_mem_mock_stats_t *stats)
+{
+    *stats = s_mem;
+}
+
+void mdns_mem_mock_reset_peak(void)
+{
+    s_mem.peak = s_mem.live;
+}
+
 void *mdns_mem_malloc(size_t size)
 {
-    return malloc(size);
+    return mem_alloc(size, false);
 }
 
 void *mdns_mem_calloc(size_t num, size_t size)
 {
-    return calloc(num, size);
+    return mem_alloc(num * size, true);
 }
 
 void mdns_mem_free(void *ptr)
 {
-    free(ptr);
+    mem_free(ptr);
 }
 
 char *mdns_mem_strdup(const char *s)
 {
-    return strdup(s);
+    return mdns_mem_strndup(s, SIZE_MAX);
 }
 
 char *mdns_mem_strndup(const char *s, size_t n)
 {
-    return strndup(s, n);
+    if (!s) {
+        return NULL;
+    }
+    size_t len = strnlen(s, n);
+    char *copy = mem_alloc(len + 1, false);
+    if (copy) {
+        memcpy(copy, s, len);
+        copy[len] = '\0';
+    }
+    return copy;
 }
 
 void *mdns_mem_task_malloc(size_t size)
 {
-    return malloc(size);
+    return mem_alloc(size, false);
 }
 
 void mdns_mem_task_free(void *ptr)
 {
-    free(ptr);
+    mem_free(ptr);
+}
+
+esp_err_t mdns_mem_pool_init(void)
+{
+    return ESP_OK;
+}
+
+void mdns_mem_pool_deinit(void)
+{
+}
+
+static const size_t s_pool_block_size[MDNS_MEM_POOL_MAX] = {
+    [MDNS_MEM_POOL_TX_PACKET] = sizeof(mdns_tx_packet_t),
+    [MDNS_MEM_POOL_ANSWER] = sizeof(mdns_out_answer_t),
+    [MDNS_MEM_POOL_QUESTION] = sizeof(mdns_out_question_t),
+};
+
+void *mdns_mem_pool_alloc(mdns_mem_pool_t pool)
+{
+    s_mem.pool_allocs++;
+    return mem_alloc(s_pool_block_size[pool], false);
+}
+
+void mdns_mem_pool_free(mdns_mem_pool_t pool, void *ptr)
+{
+    mem_free(ptr);
+}
+
+void mdns_mem_pool_stats(mdns_mem_pool_t pool, mdns_mem_pool_stats_t *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    stats->block_size = s_pool_block_size[pool];
 }
@@ -63,6 +63,9 @@
 #define xSemaphoreCreateMutex()     malloc(1)
 #define xSemaphoreCreateBinary()    malloc(1)
 #define vSemaphoreDelete(s)         free(s)
+#define taskENTER_CRITICAL(m)
+#define taskEXIT_CRITICAL(m)
+#define portMUX_INITIALIZER_UNLOCKED 0
 #define queueQUEUE_TYPE_MUTEX       ( ( uint8_t ) 1U
 #define xTaskCreatePinnedToCore(a,b,c,d,e,f,g)     *(f) = malloc(1)
 #define xTaskCreateStaticPinnedToCore(a,b,c,d,e,f,g,h)     ((void*)1)
@@ -85,6 +88,7 @@ typedef int    BaseType_t;
 typedef uint32_t TickType_t;
 typedef void *StackType_t;
 typedef void *StaticTask_t;
+typedef int portMUX_TYPE;
 
 struct udp_pcb {
     uint8_t dummy;
@@ -134,6 +138,20 @@ esp_err_t esp_event_handler_register(const char *event_base, int32_t event_id, v
 esp_err_t esp_event_handler_unregister(const char *event_base, int32_t event_id, void *event_handler);
 
 
+// mdns_mem_* mock accounting; pool blocks are heap blocks here, counted in both
+typedef struct {
+    size_t allocs;          // allocations since start
+    size_t pool_allocs;     // of which mdns_mem_pool_alloc() blocks
+    size_t frees;
+    size_t bytes;           // bytes allocated since start
+    size_t live;            // bytes allocated now
+    size_t peak;            // high water of live
+} mdns_mem_mock_stats_t;
+
+void mdns_mem_mock_stats(mdns_mem_mock_stats_t *stats);
+
+void mdns_mem_mock_reset_peak(void);
+
 TaskHandle_t xTaskGetCurrentTaskHandle(void);
 void xTaskNotifyGive(TaskHandle_t task);
 BaseType_t xTaskNotifyWait(uint32_t bits_entry_clear, uint32_t bits_exit_clear, uint32_t *value, TickType_t wait_time);
@@ -128,11 +128,10 @@ static void mdns_test_query_free(void)
 void mdns_parse_packet(mdns_rx_packet_t *packet);
 
 //
-// Test starts here
+// Hostname, delegated hosts and services the input packets refer to
 //
-int main(int argc, char **argv)
+static void mdns_test_setup(void)
 {
-    int i;
     const char *mdns_hostname = "minifritz";
     const char *mdns_instance = "Hristo's Time Capsule";
     mdns_txt_item_t arduTxtData[4] = {
@@ -144,7 +143,6 @@ int main(int argc, char **argv)
 
     const uint8_t mac[6] = {0xDE, 0xAD, 0xBE, 0xEF, 0x00, 0x32};
 
-    uint8_t buf[1460];
     char winstance[21 + strlen(mdns_hostname)];
 
     sprintf(winstance, "%s [%02x:%02x:%02x:%02x:%02x:%02x]", mdns_hostname, mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
@@ -218,10 +216,31 @@ int main(int argc, char **argv)
         abort();
     }
 #endif
+}
+
+static void mdns_test_teardown(void)
+{
+#ifndef MDNS_NO_SERVICES
+    mdns_service_remove_all();
+#endif
+    ForceTaskDelete();
+    mdns_free();
+}
+
+//
+// Test starts here (bench.c defines MDNS_TEST_NO_MAIN and brings its own)
+//
+#ifndef MDNS_TEST_NO_MAIN
+int main(int argc, char **argv)
+{
+    int i;
+    uint8_t buf[1460];
     mdns_result_t *results = NULL;
     FILE *file;
     size_t nread;
 
+    mdns_test_setup();
+
 #ifdef INSTR_IS_OFF
     size_t len = 1460;
     memset(buf, 0, 1460);
@@ -254,10 +273,7 @@ int main(int argc, char **argv)
         mdns_parse_packet(&g_packet);
         free(mypbuf.payload);
     }
-#ifndef MDNS_NO_SERVICES
-    mdns_service_remove_all();
-#endif
-    ForceTaskDelete();
-    mdns_free();
+    mdns_test_teardown();
     return 0;
 }
+#endif
@@ -0,0 +1,466 @@
+#!/usr/bin/env python3
+"""
+Doormon benchmark: HTTP load and trigger-to-client latency, with
+machine-readable results for comparing firmware builds.
+
+Modes:
+  load     Drive /status and /reset with N concurrent clients, optionally at a
+           fixed request rate, with or without keep-alive. Reports throughput
+           and p50/p95/p99/max latency per endpoint.
+  trigger  Pull the trigger input low from the host (USB-serial RTS/DTR or a
+           Linux GPIO line wired to the trigger GPIO) and time how long until
+           the change reaches a client over /events or a long-poll.
+  compare  Print the difference between two result files.
+
+Usage:
+  pip install -r scripts/requirements.txt   # once; pyserial / gpiod only for trigger mode
+  python scripts/doormon_bench.py load --host 192.168.1.100 --concurrency 16 --duration 30 --json a.json
+  python scripts/doormon_bench.py load --mix status=9,reset=1 --rate 200 --no-keepalive
+  python scripts/doormon_bench.py trigger --serial /dev/ttyUSB1 --count 50 --json t.json
+  python scripts/doormon_bench.py trigger --gpiochip /dev/gpiochip0 --line 17 --via longpoll
+  python scripts/doormon_bench.py compare before.json after.json
+
+Without --host the device is found over mDNS, as in doormon_monitor.py.
+"""
+
+import argparse
+import datetime
+import http.client
+import json
+import math
+import queue
+import random
+import sys
+import threading
+import time
+
+from doormon_monitor import DoormonClient, discover_device, parse_host, watch_events
+
+RESULT_VERSION = 1
+PATHS = {"status": ("GET", "/status"), "reset": ("POST", "/reset")}
+
+
+# --- statistics ---------------------------------------------------------------
+
+def percentile(sorted_values, p):
+    """Nearest-rank percentile of an already sorted list."""
+    if not sorted_values:
+        return None
+    k = max(0, min(len(sorted_values) - 1, math.ceil(p / 100.0 * len(sorted_values)) - 1))
+    return sorted_values[k]
+
+
+def summarize(latencies_s, errors, duration_s, codes=None):
+    values = sorted(v * 1000.0 for v in latencies_s)
+    out = {
+        "requests": len(values) + errors,
+        "errors": errors,
+        "duration_s": round(duration_s, 3),
+        "throughput_rps": round(len(values) / duration_s, 2) if duration_s > 0 else None,
+        "latency_ms": None,
+    }
+    if values:
+        out["latency_ms"] = {
+            "min": round(values[0], 3),
+            "p50": round(percentile(values, 50), 3),
+            "p95": round(percentile(values, 95), 3),
+            "p99": round(percentile(values, 99), 3),
+            "max": round(values[-1], 3),
+            "mean": round(sum(values) / len(values), 3),
+        }
+    if codes is not None:
+        out["status_codes"] = {str(k): v for k, v in sorted(codes.items())}
+    return out
+
+
+def print_table(results):
+    print(f"{'':<10}{'reqs':>8}{'err':>6}{'rps':>9}{'p50':>9}{'p95':>9}{'p99':>9}{'max':>9}  (ms)")
+    for name, r in results.items():
+        lat = r.get("latency_ms") or {}
+        cols = [lat.get(k) for k in ("p50", "p95", "p99", "max")]
+        cells = "".join(f"{c:>9.2f}" if c is not None else f"{'-':>9}" for c in cols)
+        rps = r.get("throughput_rps")
+        rps = f"{rps:>9.1f}" if rps is not None else f"{'-':>9}"
+        print(f"{name:<10}{r['requests']:>8}{r['errors']:>6}{rps}{cells}")
+
+
+def fetch_metrics(host, port):
+    """Device /metrics as {series: value}, or None if the firmware has none."""
+    try:
+        conn = http.client.HTTPConnection(host, port, timeout=5.0)
+        conn.request("GET", "/metrics")
+        resp = conn.getresponse()
+        body = resp.read().decode("utf-8", "replace")
+        conn.close()
+    except (OSError, http.client.HTTPException):
+        return None
+    if resp.status != 200:
+        return None
+    series = {}
+    for line in body.splitlines():
+        if not line or line.startswith("#"):
+            continue
+        key, _, value = line.rpartition(" ")
+        try:
+            series[key] = float(value)
+        except ValueError:
+            pass
+    return series
+
+
+# --- load mode ----------------------------------------------------------------
+
+def parse_mix(text):
+    mix = []
+    for part in text.split(","):
+        name, _, weight = part.partition("=")
+        name = name.strip()
+        if name not in PATHS:
+            raise argparse.ArgumentTypeError(f"unknown endpoint {name!r} (use status, reset)")
+        mix.append((name, int(weight) if weight else 1))
+    return mix
+
+
+def run_load(host, port, args):
+    mix = args.mix
+    names = [n for n, _ in mix]
+    weights = [w for _, w in mix]
+    lock = threading.Lock()
+    samples = {n: [] for n in names}
+    errors = {n: 0 for n in names}
+    codes = {n: {} for n in names}
+    state = {"next": 0}
+
+    start = time.perf_counter() + 0.2
+    stop_at = start + args.duration if args.duration else None
+    limit = args.requests
+
+    def next_slot():
+        """Index and intended start time of the next request, or None when done."""
+        with lock:
+            i = state["next"]
+            if limit and i >= limit:
+                return None
+            state["next"] += 1
+        due = start + i / args.rate if args.rate else None
+        if stop_at and (due or time.perf_counter()) >= stop_at:
+            return None
+        return i, due
+
+    def worker(seed):
+        rng = random.Random(seed)
+        conn = None
+        while True:
+            slot = next_slot()
+            if slot is None:
+                break
+            _, due = slot
+            if due is not None:
+                delay = due - time.perf_counter()
+                if delay > 0:
+                    time.sleep(delay)
+            name = rng.choices(names, weights)[0]
+            method, path = PATHS[name]
+            # Fixed-rate runs time from the intended start, so a stalled device
+            # shows up as latency instead of silently lowering the offered load.
+            t0 = due if due is not None else time.perf_counter()
+            try:
+                if conn is None:
+                    conn = http.client.HTTPConnection(host, port, timeout=args.timeout)
+                headers = {} if args.keepalive else {"Connection": "close"}
+                conn.request(method, path, body=b"" if method == "POST" else None, headers=headers)
+                resp = conn.getresponse()
+                resp.read()
+                elapsed = time.perf_counter() - t0
+                if not args.keepalive or resp.will_close:
+                    conn.close()
+                    conn = None
+                with lock:
+                    codes[name][resp.status] = codes[name].get(resp.status, 0) + 1
+                    if 200 <= resp.status < 400:
+                        samples[name].append(elapsed)
+                    else:
+                        errors[name] += 1
+            except (OSError, http.client.HTTPException):
+                if conn is not None:
+                    conn.close()
+                    conn = None
+                with lock:
+                    errors[name] += 1
+        if conn is not None:
+            conn.close()
+
+    threads = [threading.Thread(target=worker, args=(i,), daemon=True) for i in range(args.concurrency)]
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+    duration = time.perf_counter() - start
+
+    results = {n: summarize(samples[n], errors[n], duration, codes[n]) for n in names}
+    all_codes = {}
+    for c in codes.values():
+        for k, v in c.items():
+            all_codes[k] = all_codes.get(k, 0) + v
+    results["all"] = summarize([s for n in names for s in samples[n]], sum(errors.values()), duration, all_codes)
+    return results
+
+
+# --- trigger mode -------------------------------------------------------------
+
+class SerialLine:
+    """USB-serial RTS or DTR as the trigger: asserted drives the pin low."""
+
+    def __init__(self, port, pin):
+        try:
+            import serial
+        except ImportError:
+            sys.exit("trigger --serial needs pyserial: pip install pyserial")
+        self.ser = serial.Serial()
+        self.ser.port = port
+        self.ser.rts = False
+        self.ser.dtr = False
+        self.ser.open()
+        self.pin = pin
+
+    def set(self, active):
+        setattr(self.ser, self.pin, active)
+
+    def close(self):
+        self.set(False)
+        self.ser.close()
+
+
+class GpiodLine:
+    """Linux GPIO line (libgpiod v2 bindings), open-drain: active pulls low, inactive floats."""
+
+    def __init__(self, chip, line):
+        try:
+            import gpiod
+            from gpiod.line import Direction, Drive, Value
+        except ImportError:
+            sys.exit("trigger --gpiochip needs the gpiod (v2) Python bindings: pip install gpiod")
+        self.Value = Value
+        self.req = gpiod.request_lines(
+            chip, consumer="doormon_bench",
+            config={line: gpiod.LineSettings(direction=Direction.OUTPUT, drive=Drive.OPEN_DRAIN,
+                                              active_low=True, output_value=Value.INACTIVE)})
+        self.line = line
+
+    def set(self, active):
+        self.req.set_value(self.line, self.Value.ACTIVE if active else self.Value.INACTIVE)
+
+    def close(self):
+        self.set(False)
+        self.req.release()
+
+
+def start_event_reader(host, port):
+    """Background /events subscriber; returns a queue of (perf_counter, triggered)."""
+    q = queue.Queue()
+
+    def run():
+        while True:
+            try:
+                for triggered in watch_events(host, port):
+                    q.put((time.perf_counter(), triggered))
+            except Exception as e:  # keep the benchmark alive across stream drops
+                q.put((time.perf_counter(), e))
+                time.sleep(1.0)
+
+    threading.Thread(target=run, daemon=True).start()
+    return q
+
+
+def wait_state(q, want, timeout):
+    """Time at which the stream reported triggered == want, or None on timeout."""
+    deadline = time.perf_counter() + timeout
+    while True:
+        remaining = deadline - time.perf_counter()
+        if remaining <= 0:
+            return None
+        try:
+            t, value = q.get(timeout=remaining)
+        except queue.Empty:
+            return None
+        if value is want:
+            return t
+
+
+def run_trigger(host, port, args):
+    if args.serial:
+        line = SerialLine(args.serial, args.serial_pin)
+    else:
+        line = GpiodLine(args.gpiochip, args.line)
+    client = DoormonClient(host, port)
+    events = start_event_reader(host, port) if args.via == "events" else None
+    if events is not None:
+        try:
+            events.get(timeout=5.0)     # state sent on connect
+        except queue.Empty:
+            sys.exit("/events sent nothing; is this Doormon firmware with /events?")
+    latencies, missed = [], 0
+    start = time.perf_counter()
+    try:
+        for i in range(args.count):
+            line.set(False)
+            client.post_reset()
+            if events is not None:
+                wait_state(events, False, 2.0)
+            time.sleep(args.settle + random.uniform(0, args.settle))
+
+            if events is not None:
+                t0 = time.perf_counter()
+                line.set(True)
+                t1 = wait_state(events, True, args.timeout)
+            else:
+                t1 = longpoll_trigger(host, port, line, args.timeout)
+                t0 = t1[0] if t1 else None
+                t1 = t1[1] if t1 else None
+            time.sleep(args.pulse_ms / 1000.0)
+            line.set(False)
+
+            if t1 is None:
+                missed += 1
+                print(f"  #{i + 1}: no state change within {args.timeout}s")
+            else:
+                latencies.append(t1 - t0)
+                if args.verbose:
+                    print(f"  #{i + 1}: {(t1 - t0) * 1000:.2f} ms")
+    finally:
+        line.close()
+        client.post_reset()
+        client.close()
+    # throughput_rps is samples per second of wall time here, not a load figure.
+    return {f"trigger_{args.via}": summarize(latencies, missed, time.perf_counter() - start)}
+
+
+def longpoll_trigger(host, port, line, timeout):
+    """Park a long-poll, pull the line, return (t_assert, t_response) or None."""
+    conn = http.client.HTTPConnection(host, port, timeout=timeout + 5)
+    try:
+        conn.request("GET", "/status")
+        gen = json.loads(conn.getresponse().read().decode()).get("gen", 0)
+        conn.request("GET", f"/status?since={gen}&wait={int(timeout)}")
+        time.sleep(0.05)    # let the device park the request
+        t0 = time.perf_counter()
+        line.set(True)
+        resp = conn.getresponse()
+        body = json.loads(resp.read().decode())
+        t1 = time.perf_counter()
+        return (t0, t1) if body.get("gen") != gen and body.get("triggered") else None
+    except (OSError, http.client.HTTPException, ValueError):
+        return None
+    finally:
+        conn.close()
+
+
+# --- compare mode -------------------------------------------------------------
+
+def run_compare(a_path, b_path):
+    with open(a_path) as f:
+        a = json.load(f)
+    with open(b_path) as f:
+        b = json.load(f)
+    print(f"{'':<18}{'metric':<8}{a_path[-14:]:>14}{b_path[-14:]:>14}{'change':>10}")
+    for name in a.get("results", {}):
+        if name not in b.get("results", {}):
+            continue
+        ra, rb = a["results"][name], b["results"][name]
+        rows = [("rps", ra.get("throughput_rps"), rb.get("throughput_rps"))]
+        la, lb = ra.get("latency_ms") or {}, rb.get("latency_ms") or {}
+        rows += [(k, la.get(k), lb.get(k)) for k in ("p50", "p95", "p99", "max")]
+        rows.append(("errors", ra.get("errors"), rb.get("errors")))
+        for metric, va, vb in rows:
+            change = f"{(vb - va) / va * 100:+.1f}%" if va and vb is not None else "-"
+            fa = f"{va:.2f}" if isinstance(va, float) else str(va)
+            fb = f"{vb:.2f}" if isinstance(vb, float) else str(vb)
+            print(f"{name:<18}{metric:<8}{fa:>14}{fb:>14}{change:>10}")
+
+
+# --- main ---------------------------------------------------------------------
+
+def main():
+    parser = argparse.ArgumentParser(description="Benchmark a Doormon device.")
+    sub = parser.add_subparsers(dest="mode", required=True)
+
+    def common(p):
+        p.add_argument("--host", metavar="HOST[:PORT]", help="device address (default: mDNS discovery)")
+        p.add_argument("--json", metavar="FILE", help="write results as JSON")
+        p.add_argument("--label", help="free-form tag stored in the JSON (e.g. firmware build)")
+
+    p = sub.add_parser("load", help="HTTP load on /status and /reset")
+    common(p)
+    p.add_argument("--mix", type=parse_mix, default=parse_mix("status"),
+                   help="endpoints and weights, e.g. status=9,reset=1 (default: status)")
+    p.add_argument("--concurrency", type=int, default=4, help="parallel clients (default 4)")
+    p.add_argument("--rate", type=float, default=0, help="total requests/s; 0 = as fast as possible")
+    p.add_argument("--duration", type=float, default=10.0, help="seconds to run (default 10)")
+    p.add_argument("--requests", type=int, default=0, help="stop after this many requests")
+    p.add_argument("--keepalive", action=argparse.BooleanOptionalAction, default=True,
+                   help="reuse connections (default) or open one per request")
+    p.add_argument("--timeout", type=float, default=5.0, help="per-request timeout (s)")
+
+    p = sub.add_parser("trigger", help="trigger-to-client latency via a host-driven input")
+    common(p)
+    src = p.add_mutually_exclusive_group(required=True)
+    src.add_argument("--serial", metavar="PORT", help="USB-serial adapter whose RTS/DTR is wired to the trigger GPIO")
+    src.add_argument("--gpiochip", metavar="CHIP", help="Linux GPIO chip (e.g. /dev/gpiochip0), with --line")
+    p.add_argument("--serial-pin", choices=("rts", "dtr"), default="rts")
+    p.add_argument("--line", type=int, help="GPIO line offset on --gpiochip")
+    p.add_argument("--via", choices=("events", "longpoll"), default="events",
+                   help="how the client learns of the trigger (default events)")
+    p.add_argument("--count", type=int, default=20, help="number of triggers (default 20)")
+    p.add_argument("--pulse-ms", type=float, default=50.0,
+                   help="how long the input is held low; must exceed TRIGGER_MIN_PULSE_MS (default 50)")
+    p.add_argument("--settle", type=float, default=0.3, help="idle time between samples (s), plus jitter")
+    p.add_argument("--timeout", type=float, default=5.0, help="give up on a sample after this long (s)")
+    p.add_argument("-v", "--verbose", action="store_true", help="print every sample")
+
+    p = sub.add_parser("compare", help="compare two JSON result files")
+    p.add_argument("before")
+    p.add_argument("after")
+
+    args = parser.parse_args()
+    if args.mode == "compare":
+        run_compare(args.before, args.after)
+        return
+    if args.mode == "trigger" and args.gpiochip and args.line is None:
+        parser.error("--gpiochip needs --line")
+
+    if args.host:
+        host, port = parse_host(args.host)
+    else:
+        print("Discovering Doormon via mDNS (_http._tcp)...")
+        addr = discover_device()
+        if not addr:
+            sys.exit("No Doormon device found on the LAN.")
+        host, port = addr
+    print(f"Device http://{host}:{port}")
+
+    started = datetime.datetime.now(datetime.timezone.utc).isoformat(timespec="seconds")
+    results = run_load(host, port, args) if args.mode == "load" else run_trigger(host, port, args)
+    print_table(results)
+
+    if args.json:
+        settings = {k: v for k, v in vars(args).items() if k not in ("json", "host", "label")}
+        if "mix" in settings:
+            settings["mix"] = dict(settings["mix"])
+        doc = {
+            "tool": "doormon_bench",
+            "version": RESULT_VERSION,
+            "mode": args.mode,
+            "label": args.label,
+            "started": started,
+            "device": f"{host}:{port}",
+            "settings": settings,
+            "results": results,
+            "device_metrics": fetch_metrics(host, port),
+        }
+        with open(args.json, "w") as f:
+            json.dump(doc, f, indent=2)
+        print(f"Results written to {args.json}")
+
+
+if __name__ == "__main__":
+    main()
@@ -1,26 +1,42 @@
 #!/usr/bin/env python3
 """
-Doormon monitor – discover device via mDNS, poll /status every second,
+Doormon monitor – discover device via mDNS, subscribe to the /events stream,
 report trigger events and slow responses (>3s), allow reset via 'r'.
 
 Uses mDNS directly so discovery is fast (no 5s system DNS timeout).
-All HTTP requests use the resolved IP, so polling stays fast.
+All HTTP requests use the resolved IP over one persistent (keep-alive)
+connection. State changes are pushed by the device over Server-Sent Events;
+firmware without /events falls back to polling /status.
+
+--fleet watches every device on the LAN at once: a continuous mDNS browse,
+one asyncio task per device over persistent connections, one merged event
+stream and per-device latency stats.
 
 Usage:
   pip install -r scripts/requirements.txt   # once
   python scripts/doormon_monitor.py
+  python scripts/doormon_monitor.py --host 192.168.1.100      # skip mDNS
+  python scripts/doormon_monitor.py --latency 200             # new-connection vs keep-alive timing
+  python scripts/doormon_monitor.py --listen                   # multicast datagrams (MCAST_ENABLE)
+  python scripts/doormon_monitor.py --fleet                    # every device on the LAN, one event stream
 """
 
+import argparse
+import asyncio
+import collections
+import http.client
 import json
+import random
 import socket
+import statistics
+import struct
 import sys
 import threading
 import time
-import urllib.error
-import urllib.request
 
 try:
-    from zeroconf import ServiceBrowser, ServiceInfo, Zeroconf
+    from zeroconf import ServiceBrowser, ServiceInfo, ServiceStateChange, Zeroconf
+    from zeroconf.asyncio import AsyncServiceBrowser, AsyncServiceInfo, AsyncZeroconf
 except ImportError:
     print("Install zeroconf: pip install -r scripts/requirements.txt", file=sys.stderr)
     sys.exit(1)
@@ -31,6 +47,21 @@ INSTANCE_NAME = "Doormon"
 POLL_INTERVAL = 1.0
 SLOW_RESPONSE_THRESHOLD = 3.0
 DISCOVERY_TIMEOUT = 15.0
+# Firmware sends a keepalive comment every 30 s; treat 45 s of silence as a dead stream.
+EVENTS_READ_TIMEOUT = 45.0
+EVENTS_RETRY_DELAY = 2.0
+# Must match MCAST_GROUP / MCAST_PORT in src/doormon_config.h
+MCAST_GROUP = "239.255.68.77"
+MCAST_PORT = 5077
+# Datagram layout from src/mcast.h
+MCAST_PKT = struct.Struct(">4sBBBB6s2xIIIIQ")
+MCAST_TYPES = {0: "state", 1: "heartbeat"}
+# Fleet mode: one keep-alive GET /status per device this often feeds the latency stats.
+FLEET_PROBE_INTERVAL = 10.0
+FLEET_STATS_INTERVAL = 60.0
+FLEET_LATENCY_SAMPLES = 1000
+# Below LONGPOLL_MAX_WAIT_S in src/doormon_config.h, so the device answers before we time out.
+LONGPOLL_WAIT = 50
 
 
 def discover_device():
@@ -71,48 +102,619 @@ def discover_device():
     return result["info"]
 
 
-def get_status(host, port, timeout=4.0):
-    """GET /status; return (triggered, response_time_sec) or (None, time) on error."""
-    url = f"http://{host}:{port}/status"
-    req = urllib.request.Request(url)
-    t0 = time.monotonic()
-    try:
-        with urllib.request.urlopen(req, timeout=timeout) as resp:
-            data = resp.read().decode()
+class DoormonClient:
+    """
+    HTTP/1.1 client holding one keep-alive connection to the device, so repeated
+    requests skip the TCP handshake. Thread-safe; reconnects once if the device
+    closed the idle socket.
+    """
+
+    def __init__(self, host, port, timeout=4.0):
+        self.host, self.port, self.timeout = host, port, timeout
+        self._conn = None
+        self._lock = threading.Lock()
+        self._etag = None
+        self._triggered = None
+
+    def close(self):
+        with self._lock:
+            if self._conn is not None:
+                self._conn.close()
+                self._conn = None
+
+    def request(self, method, path, headers=None):
+        """Return (status, headers, body bytes). Raises OSError/HTTPException."""
+        with self._lock:
+            for attempt in (0, 1):
+                if self._conn is None:
+                    self._conn = http.client.HTTPConnection(self.host, self.port, timeout=self.timeout)
+                try:
+                    self._conn.request(method, path, body=b"" if method == "POST" else None,
+                                       headers=headers or {})
+                    resp = self._conn.getresponse()
+                    body = resp.read()
+                    if resp.will_close:
+                        self._conn.close()
+                        self._conn = None
+                    return resp.status, resp.headers, body
+                except (OSError, http.client.HTTPException):
+                    self._conn.close()
+                    self._conn = None
+                    if attempt:
+                        raise
+
+    def get_status(self):
+        """GET /status; return (triggered, response_time_sec) or (None, time) on error."""
+        t0 = time.monotonic()
+        try:
+            headers = {"If-None-Match": self._etag} if self._etag else {}
+            status, resp_headers, body = self.request("GET", "/status", headers)
             elapsed = time.monotonic() - t0
-            obj = json.loads(data)
-            return (obj.get("triggered", False), elapsed)
-    except Exception:
-        elapsed = time.monotonic() - t0
-        return (None, elapsed)
+            if status == 304 and self._triggered is not None:
+                return (self._triggered, elapsed)
+            if status != 200:
+                return (None, elapsed)
+            self._triggered = json.loads(body.decode()).get("triggered", False)
+            self._etag = resp_headers.get("ETag")
+            return (self._triggered, elapsed)
+        except (OSError, http.client.HTTPException, ValueError):
+            return (None, time.monotonic() - t0)
 
+    def post_reset(self):
+        """POST /reset; return True on success."""
+        try:
+            status, _, _ = self.request("POST", "/reset")
+            return status == 200
+        except (OSError, http.client.HTTPException):
+            return False
 
-def post_reset(host, port, timeout=4.0):
-    """POST /reset; return True on success."""
-    url = f"http://{host}:{port}/reset"
-    req = urllib.request.Request(url, method="POST", data=b"")
+
+class EventsUnsupported(Exception):
+    """Device has no /events endpoint (older firmware)."""
+
+
+def watch_events(host, port, on_connect=None):
+    """
+    GET /events and yield the triggered state from each pushed 'state' event.
+    Raises EventsUnsupported on 404, OSError/HTTPException when the stream drops.
+    """
+    conn = http.client.HTTPConnection(host, port, timeout=EVENTS_READ_TIMEOUT)
     try:
-        with urllib.request.urlopen(req, timeout=timeout) as resp:
-            return resp.getcode() == 200
-    except Exception:
-        return False
+        t0 = time.monotonic()
+        conn.request("GET", "/events", headers={"Accept": "text/event-stream"})
+        resp = conn.getresponse()
+        if resp.status == 404:
+            raise EventsUnsupported()
+        if resp.status != 200:
+            raise http.client.HTTPException(f"/events returned {resp.status}")
+        if on_connect is not None:
+            on_connect(time.monotonic() - t0)
+        event, data = None, []
+        while True:
+            line = resp.fp.readline()
+            if not line:
+                raise ConnectionError("event stream closed")
+            line = line.decode("utf-8", "replace").rstrip("\r\n")
+            if line == "":
+                if event == "state" and data:
+                    obj = json.loads("\n".join(data))
+                    yield obj.get("triggered", False)
+                event, data = None, []
+            elif line.startswith(":"):
+                continue  # keepalive comment
+            elif line.startswith("event:"):
+                event = line[6:].strip()
+            elif line.startswith("data:"):
+                data.append(line[5:].lstrip())
+    finally:
+        conn.close()
+
+
+def poll_status(client, on_state):
+    """Legacy mode: poll /status every POLL_INTERVAL seconds."""
+    while True:
+        triggered, elapsed = client.get_status()
+        if triggered is None:
+            print(f"[Error] No response (took {elapsed:.2f}s)")
+        else:
+            if elapsed > SLOW_RESPONSE_THRESHOLD:
+                print(f"[Slow] Response took {elapsed:.2f}s (>{SLOW_RESPONSE_THRESHOLD}s)")
+            on_state(triggered)
+        time.sleep(POLL_INTERVAL)
+
+
+def measure_latency(host, port, count):
+    """Time `count` GET /status with a new TCP connection each, then over one keep-alive connection."""
+
+    def fresh():
+        conn = http.client.HTTPConnection(host, port, timeout=4.0)
+        try:
+            conn.request("GET", "/status", headers={"Connection": "close"})
+            conn.getresponse().read()
+        finally:
+            conn.close()
+
+    client = DoormonClient(host, port)
+
+    def keepalive():
+        client.request("GET", "/status")
+
+    print(f"GET /status x{count}, sequential (ms):")
+    print(f"  {'mode':<12}{'min':>8}{'p50':>8}{'p95':>8}{'max':>8}{'errors':>8}")
+    for name, fn in (("new-conn", fresh), ("keep-alive", keepalive)):
+        samples, errors = [], 0
+        for _ in range(count):
+            t0 = time.perf_counter()
+            try:
+                fn()
+                samples.append((time.perf_counter() - t0) * 1000.0)
+            except (OSError, http.client.HTTPException):
+                errors += 1
+        if not samples:
+            print(f"  {name:<12}{'-':>8}{'-':>8}{'-':>8}{'-':>8}{errors:>8}")
+            continue
+        samples.sort()
+        p95 = samples[min(len(samples) - 1, int(len(samples) * 0.95))]
+        print(f"  {name:<12}{samples[0]:>8.1f}{statistics.median(samples):>8.1f}"
+              f"{p95:>8.1f}{samples[-1]:>8.1f}{errors:>8}")
+    client.close()
+
+
+def listen_multicast(group=MCAST_GROUP, port=MCAST_PORT):
+    """Print state datagrams from every device on the group; repeats are dropped by (device, seq)."""
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM, socket.IPPROTO_UDP)
+    sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    sock.bind(("", port))
+    mreq = struct.pack("4s4s", socket.inet_aton(group), socket.inet_aton("0.0.0.0"))
+    sock.setsockopt(socket.IPPROTO_IP, socket.IP_ADD_MEMBERSHIP, mreq)
+    print(f"Listening on {group}:{port}. Ctrl+C to quit.")
+    print()
+
+    last_seq = {}
+    latched = {}
+    while True:
+        data, (src, _) = sock.recvfrom(512)
+        if len(data) < MCAST_PKT.size:
+            continue
+        magic, version, ptype, repeat, ninputs, dev, seq, gen, mask, levels, uptime_ms = \
+            MCAST_PKT.unpack_from(data)
+        if magic != b"DMON" or version != 1:
+            continue
+        device = dev.hex(":")
+        if last_seq.get(device) == seq:
+            continue    # repeat of a message we already have
+        if device in last_seq and seq != last_seq[device] + 1:
+            print(f"[{device}] {seq - last_seq[device] - 1} message(s) lost")
+        last_seq[device] = seq
+        kind = MCAST_TYPES.get(ptype, f"type {ptype}")
+        if ptype == 0 or latched.get(device) != mask:
+            print(f"[{device} {src}] {kind} gen={gen} latched={mask:#x} levels={levels:#x} "
+                  f"uptime={uptime_ms / 1000:.1f}s")
+        if not latched.get(device) and mask:
+            print(f"[{device}] Triggered!")
+        latched[device] = mask
+
+
+# --- fleet mode -----------------------------------------------------------------
+
+class AsyncHTTPConnection:
+    """
+    One keep-alive HTTP/1.1 connection over asyncio streams, enough for the
+    firmware's responses (Content-Length or chunked bodies). Not shared between
+    concurrent requests; reconnects once if the device closed the idle socket.
+    """
+
+    def __init__(self, host, port, timeout=4.0):
+        self.host, self.port, self.timeout = host, port, timeout
+        self._reader = self._writer = None
+
+    def close(self):
+        if self._writer is not None:
+            self._writer.close()
+            self._reader = self._writer = None
+
+    async def _send(self, method, path, headers):
+        if self._writer is None:
+            self._reader, self._writer = await asyncio.wait_for(
+                asyncio.open_connection(self.host, self.port), self.timeout)
+        lines = [f"{method} {path} HTTP/1.1", f"Host: {self.host}"]
+        lines += [f"{k}: {v}" for k, v in (headers or {}).items()]
+        if method == "POST":
+            lines.append("Content-Length: 0")
+        self._writer.write(("\r\n".join(lines) + "\r\n\r\n").encode())
+        await self._writer.drain()
+        status_line = await self._reader.readline()
+        if not status_line:
+            raise ConnectionError("connection closed")
+        status = int(status_line.split()[1])
+        resp_headers = {}
+        while True:
+            line = (await self._reader.readline()).decode("latin-1").rstrip("\r\n")
+            if not line:
+                break
+            key, _, value = line.partition(":")
+            resp_headers[key.strip().lower()] = value.strip()
+        return status, resp_headers
+
+    async def _read_body(self, headers):
+        if headers.get("transfer-encoding", "").lower() == "chunked":
+            body = bytearray()
+            while True:
+                size = int((await self._reader.readline()).split(b";")[0], 16)
+                chunk = await self._reader.readexactly(size + 2)
+                if size == 0:
+                    return bytes(body)
+                body += chunk[:-2]
+        return await self._reader.readexactly(int(headers.get("content-length", 0)))
+
+    async def request(self, method, path, headers=None, timeout=None):
+        """Return (status, lower-cased headers, body bytes). Raises OSError/asyncio.TimeoutError."""
+        for attempt in (0, 1):
+            reused = self._writer is not None
+            try:
+                async def exchange():
+                    status, resp_headers = await self._send(method, path, headers)
+                    return status, resp_headers, await self._read_body(resp_headers)
+                status, resp_headers, body = await asyncio.wait_for(exchange(), timeout or self.timeout)
+                if resp_headers.get("connection", "").lower() == "close":
+                    self.close()
+                return status, resp_headers, body
+            except asyncio.TimeoutError:
+                self.close()
+                raise
+            except (OSError, asyncio.IncompleteReadError, ValueError, IndexError):
+                self.close()
+                if attempt or not reused:
+                    raise ConnectionError(f"{method} {path} failed")
+
+    async def stream(self, path, headers=None):
+        """Send GET path and return (status, headers); the caller reads the body from .reader."""
+        return await asyncio.wait_for(self._send("GET", path, headers), self.timeout)
+
+    @property
+    def reader(self):
+        return self._reader
+
+
+class FleetDevice:
+    """One device: state from /events (or long-poll, or polling), latency from periodic probes."""
+
+    def __init__(self, fleet, name, host, port):
+        self.fleet, self.name, self.host, self.port = fleet, name, host, port
+        self.gen = None
+        self.triggered = None
+        self.mode = "-"
+        self.online = None
+        self.latency = collections.deque(maxlen=FLEET_LATENCY_SAMPLES)
+        self.requests = self.errors = self.events = 0
+        self._etag = None
+        self._tasks = []
+
+    def start(self):
+        self._tasks = [asyncio.create_task(self._watch()), asyncio.create_task(self._probe())]
+
+    def stop(self):
+        for t in self._tasks:
+            t.cancel()
+        self._tasks = []
+
+    def apply(self, obj, source):
+        """Take a /status body (or the TXT items); emit triggered/cleared on a new generation."""
+        gen = obj.get("gen")
+        if gen is None or gen == self.gen:
+            return
+        if source == "mdns" and self.gen is not None and gen < self.gen:
+            return  # a late announcement: HTTP already told us more
+        triggered = bool(obj.get("triggered"))
+        first = self.gen is None
+        self.gen = gen
+        if first:
+            self.fleet.emit(self, "state", triggered=triggered, gen=gen, via=source)
+        elif triggered != self.triggered:
+            self.events += 1
+            self.fleet.emit(self, "triggered" if triggered else "cleared", gen=gen, via=source)
+        self.triggered = triggered
+
+    def apply_txt(self, properties):
+        try:
+            self.apply({"triggered": properties.get(b"triggered") == b"1",
+                        "gen": int(properties[b"seq"])}, "mdns")
+        except (KeyError, TypeError, ValueError):
+            pass  # firmware without the state in TXT
+
+    def _set_online(self, online, reason=None):
+        if online != self.online:
+            self.online = online
+            if online:
+                self.fleet.emit(self, "online", mode=self.mode)
+            else:
+                self.fleet.emit(self, "offline", reason=reason)
+
+    def _sample(self, elapsed):
+        self.requests += 1
+        self.latency.append(elapsed)
+        if elapsed > SLOW_RESPONSE_THRESHOLD:
+            self.fleet.emit(self, "slow", ms=round(elapsed * 1000))
+
+    async def _watch(self):
+        """Prefer the /events push stream, then long-poll, then polling; reconnect forever."""
+        conn = AsyncHTTPConnection(self.host, self.port, timeout=EVENTS_READ_TIMEOUT)
+        modes = ["events", "longpoll", "poll"]
+        while True:
+            self.mode = modes[0]
+            try:
+                if self.mode == "events":
+                    if not await self._events(conn):
+                        modes.pop(0)
+                        conn.close()
+                        continue
+                elif self.mode == "longpoll":
+                    if not await self._longpoll(conn):
+                        modes.pop(0)
+                        conn.close()
+                        continue
+                else:
+                    await self._poll(conn)
+            except asyncio.CancelledError:
+                conn.close()
+                raise
+            except (OSError, asyncio.TimeoutError, asyncio.IncompleteReadError, ValueError) as e:
+                self._set_online(False, str(e) or type(e).__name__)
+            conn.close()
+            # spread the reconnects of a fleet that lost the AP together
+            await asyncio.sleep(EVENTS_RETRY_DELAY * (0.5 + random.random()))
+
+    async def _events(self, conn):
+        """Return False if the device has no /events; otherwise run until the stream drops."""
+        status, _ = await conn.stream("/events", {"Accept": "text/event-stream"})
+        if status == 404:
+            return False
+        if status != 200:
+            raise ConnectionError(f"/events returned {status}")
+        self._set_online(True)
+        event, data = None, []
+        while True:
+            line = await asyncio.wait_for(conn.reader.readline(), EVENTS_READ_TIMEOUT)
+            if not line:
+                raise ConnectionError("event stream closed")
+            line = line.decode("utf-8", "replace").rstrip("\r\n")
+            if line == "":
+                if event == "state" and data:
+                    self.apply(json.loads("\n".join(data)), "events")
+                event, data = None, []
+            elif line.startswith("event:"):
+                event = line[6:].strip()
+            elif line.startswith("data:"):
+                data.append(line[5:].lstrip())
+
+    async def _longpoll(self, conn):
+        """Return False if the device answers a long-poll at once (no ?since support)."""
+        while True:
+            path = "/status" if self.gen is None else f"/status?since={self.gen}&wait={LONGPOLL_WAIT}"
+            t0 = time.monotonic()
+            status, _, body = await conn.request("GET", path, timeout=LONGPOLL_WAIT + 10)
+            if status != 200:
+                raise ConnectionError(f"/status returned {status}")
+            self._set_online(True)
+            before = self.gen
+            self.apply(json.loads(body), "longpoll")
+            if path != "/status" and self.gen == before and time.monotonic() - t0 < 1.0:
+                return False
+
+    async def _poll(self, conn):
+        while True:
+            headers = {"If-None-Match": self._etag} if self._etag else {}
+            status, resp_headers, body = await conn.request("GET", "/status", headers)
+            self._set_online(True)
+            if status == 200:
+                self._etag = resp_headers.get("etag")
+                self.apply(json.loads(body), "poll")
+            elif status != 304:
+                raise ConnectionError(f"/status returned {status}")
+            await asyncio.sleep(POLL_INTERVAL)
+
+    async def _probe(self):
+        """GET /status with If-None-Match on its own keep-alive connection: usually a bodyless 304."""
+        conn = AsyncHTTPConnection(self.host, self.port)
+        etag = None
+        await asyncio.sleep(FLEET_PROBE_INTERVAL * random.random())
+        try:
+            while True:
+                t0 = time.monotonic()
+                try:
+                    status, resp_headers, _ = await conn.request(
+                        "GET", "/status", {"If-None-Match": etag} if etag else {})
+                    self._sample(time.monotonic() - t0)
+                    if status == 200:
+                        etag = resp_headers.get("etag")
+                except (OSError, asyncio.TimeoutError):
+                    self.requests += 1
+                    self.errors += 1
+                await asyncio.sleep(FLEET_PROBE_INTERVAL)
+        finally:
+            conn.close()
+
+    def stats(self):
+        values = sorted(v * 1000.0 for v in self.latency)
+
+        def pct(p):
+            return round(values[min(len(values) - 1, int(len(values) * p))], 1) if values else None
+
+        return {"device": self.name, "host": f"{self.host}:{self.port}", "mode": self.mode,
+                "online": bool(self.online), "triggered": self.triggered, "gen": self.gen,
+                "events": self.events, "requests": self.requests, "errors": self.errors,
+                "p50_ms": pct(0.5), "p95_ms": pct(0.95), "max_ms": round(values[-1], 1) if values else None}
+
+
+class Fleet:
+    """Every Doormon on the LAN: a running mDNS browse adds and removes devices."""
+
+    def __init__(self, as_json=False, stats_interval=FLEET_STATS_INTERVAL):
+        self.as_json = as_json
+        self.stats_interval = stats_interval
+        self.devices = {}
+        self._pending = set()
+
+    def emit(self, device, kind, **fields):
+        """One line of the consolidated event stream."""
+        now = time.time()
+        if self.as_json:
+            print(json.dumps({"time": round(now, 3), "device": device.name, "event": kind, **fields}), flush=True)
+            return
+        stamp = time.strftime("%H:%M:%S", time.localtime(now)) + f".{int(now * 1000) % 1000:03d}"
+        extra = " ".join(f"{k}={v}" for k, v in fields.items() if v is not None)
+        print(f"{stamp} {device.name:<24} {kind:<9} {extra}", flush=True)
+
+    def add(self, name, host, port, properties=None):
+        dev = self.devices.get(name)
+        if dev is not None and (dev.host, dev.port) != (host, port):
+            dev.stop()
+            dev = None
+        if dev is None:
+            dev = FleetDevice(self, name, host, port)
+            self.devices[name] = dev
+            self.emit(dev, "found", host=f"{host}:{port}")
+            dev.start()
+        if properties:
+            dev.apply_txt(properties)
+
+    def remove(self, name):
+        dev = self.devices.pop(name, None)
+        if dev is not None:
+            dev.stop()
+            self.emit(dev, "gone")
+
+    def print_stats(self):
+        rows = [d.stats() for d in sorted(self.devices.values(), key=lambda d: d.name)]
+        if self.as_json:
+            for r in rows:
+                print(json.dumps({"time": round(time.time(), 3), "event": "stats", **r}), flush=True)
+            return
+        print(f"{'device':<24}{'mode':>9}{'state':>10}{'gen':>7}{'events':>7}{'reqs':>7}{'err':>5}"
+              f"{'p50':>8}{'p95':>8}{'max':>8}  (ms)")
+        for r in rows:
+            state = "offline" if not r["online"] else ("TRIGGERED" if r["triggered"] else "ok")
+            cols = ["-" if r[k] is None else f"{r[k]:.1f}" for k in ("p50_ms", "p95_ms", "max_ms")]
+            print(f"{r['device']:<24}{r['mode']:>9}{state:>10}{r['gen'] if r['gen'] is not None else '-':>7}"
+                  f"{r['events']:>7}{r['requests']:>7}{r['errors']:>5}{cols[0]:>8}{cols[1]:>8}{cols[2]:>8}",
+                  flush=True)
+
+    async def _resolve(self, zc, name):
+        info = AsyncServiceInfo(SERVICE_TYPE, name)
+        if not await info.async_request(zc, 3000):
+            return
+        for addr in info.addresses:
+            if len(addr) == 4:
+                self.add(name.split(".")[0], socket.inet_ntoa(addr), info.port or 80, info.properties)
+                return
+
+    def _on_change(self, zeroconf, service_type, name, state_change):
+        if INSTANCE_NAME.lower() not in name.lower():
+            return
+        if state_change is ServiceStateChange.Removed:
+            self.remove(name.split(".")[0])
+            return
+        # Added, or Updated: new TXT items (state) or address
+        task = asyncio.ensure_future(self._resolve(zeroconf, name))
+        self._pending.add(task)
+        task.add_done_callback(self._pending.discard)
+
+    async def run(self, static_hosts=()):
+        for host, port in static_hosts:
+            self.add(host if port == 80 else f"{host}:{port}", host, port)
+        azc = None
+        if not static_hosts:
+            azc = AsyncZeroconf()
+            browser = AsyncServiceBrowser(azc.zeroconf, [SERVICE_TYPE], handlers=[self._on_change])
+        try:
+            while True:
+                await asyncio.sleep(self.stats_interval)
+                self.print_stats()
+        finally:
+            for dev in self.devices.values():
+                dev.stop()
+            if azc is not None:
+                await browser.async_cancel()
+                await azc.async_close()
+
+
+def run_fleet(static_hosts, as_json, stats_interval):
+    fleet = Fleet(as_json, stats_interval)
+    if not as_json:
+        what = "the given devices" if static_hosts else "Doormon devices via mDNS (_http._tcp)"
+        print(f"Watching {what}. Ctrl+C to quit.")
+        print()
+    try:
+        asyncio.run(fleet.run(static_hosts))
+    except KeyboardInterrupt:
+        pass
+    if not as_json:
+        print()
+    fleet.print_stats()
+
+
+def parse_host(value):
+    host, _, port = value.partition(":")
+    return host, int(port) if port else 80
 
 
 def main():
-    print("Discovering Doormon via mDNS (_http._tcp)...")
-    addr = discover_device()
-    if not addr:
-        print("No Doormon device found on the LAN.", file=sys.stderr)
-        sys.exit(1)
-    host, port = addr
-    print(f"Found Doormon at http://{host}:{port}")
-    print("Polling /status every second. Press 'r' + Enter to reset. Ctrl+C to quit.")
+    parser = argparse.ArgumentParser(description="Watch a Doormon device.")
+    parser.add_argument("--host", metavar="HOST[:PORT]", action="append",
+                        help="device address (skips mDNS discovery); repeat with --fleet for several")
+    parser.add_argument("--latency", type=int, metavar="N",
+                        help="measure /status latency over N requests (new connection vs keep-alive) and exit")
+    parser.add_argument("--listen", action="store_true",
+                        help="print multicast state datagrams from all devices instead of connecting to one")
+    parser.add_argument("--fleet", action="store_true",
+                        help="watch every device found over mDNS (or each --host) at once")
+    parser.add_argument("--json", action="store_true", help="fleet mode: print events and stats as JSON lines")
+    parser.add_argument("--stats-interval", type=float, default=FLEET_STATS_INTERVAL, metavar="S",
+                        help=f"fleet mode: print per-device stats every S seconds (default {FLEET_STATS_INTERVAL:.0f})")
+    args = parser.parse_args()
+
+    if args.fleet:
+        run_fleet([parse_host(h) for h in args.host or []], args.json, args.stats_interval)
+        return
+
+    if args.listen:
+        try:
+            listen_multicast()
+        except KeyboardInterrupt:
+            print("\nBye.")
+        return
+
+    if args.host:
+        host, port = parse_host(args.host[-1])
+    else:
+        print("Discovering Doormon via mDNS (_http._tcp)...")
+        addr = discover_device()
+        if not addr:
+            print("No Doormon device found on the LAN.", file=sys.stderr)
+            sys.exit(1)
+        host, port = addr
+        print(f"Found Doormon at http://{host}:{port}")
+
+    if args.latency:
+        measure_latency(host, port, args.latency)
+        return
+
+    client = DoormonClient(host, port)
+    print("Watching /events. Press 'r' + Enter to reset. Ctrl+C to quit.")
     print()
 
-    prev_triggered = None
-    reset_requested = threading.Event()
-    input_buffer = []
+    state = {"prev": None}
+
+    def on_state(triggered):
+        if state["prev"] is False and triggered is True:
+            print("Triggered!")
+        state["prev"] = triggered
+
+    def on_connect(elapsed):
+        if elapsed > SLOW_RESPONSE_THRESHOLD:
+            print(f"[Slow] Response took {elapsed:.2f}s (>{SLOW_RESPONSE_THRESHOLD}s)")
 
+    # The event stream blocks the main thread, so resets are sent from the input thread.
     def input_thread():
         while True:
             try:
@@ -120,7 +722,10 @@ def main():
                 if not line:
                     break
                 if line.strip().lower() in ("r", "reset"):
-                    reset_requested.set()
+                    if client.post_reset():
+                        print("[Reset] Triggered state cleared.")
+                    else:
+                        print("[Reset] Request failed.")
             except (KeyboardInterrupt, EOFError):
                 break
 
@@ -129,25 +734,15 @@ def main():
 
     try:
         while True:
-            if reset_requested.is_set():
-                reset_requested.clear()
-                if post_reset(host, port):
-                    print("[Reset] Triggered state cleared.")
-                    prev_triggered = False
-                else:
-                    print("[Reset] Request failed.")
-
-            triggered, elapsed = get_status(host, port)
-            if triggered is None:
-                print(f"[Error] No response (took {elapsed:.2f}s)")
-            else:
-                if elapsed > SLOW_RESPONSE_THRESHOLD:
-                    print(f"[Slow] Response took {elapsed:.2f}s (>{SLOW_RESPONSE_THRESHOLD}s)")
-                if prev_triggered is False and triggered is True:
-                    print("Triggered!")
-                prev_triggered = triggered
-
-            time.sleep(POLL_INTERVAL)
+            try:
+                for triggered in watch_events(host, port, on_connect):
+                    on_state(triggered)
+            except EventsUnsupported:
+                print("Device has no /events endpoint; polling /status every second.")
+                poll_status(client, on_state)
+            except (OSError, http.client.HTTPException, ValueError) as e:
+                print(f"[Error] Event stream lost ({e}); reconnecting...")
+                time.sleep(EVENTS_RETRY_DELAY)
     except KeyboardInterrupt:
         print("\nBye.")
 
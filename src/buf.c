@@ -0,0 +1,23 @@
+/**
+ * Buffer helpers – see buf.h.
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include "buf.h"
+
+int buf_appendf(char *buf, size_t size, int n, const char *fmt, ...)
+{
+    if (n < 0 || (size_t)n >= size) {
+        return n;
+    }
+    va_list ap;
+    va_start(ap, fmt);
+    int w = vsnprintf(buf + n, size - n, fmt, ap);
+    va_end(ap);
+    if (w < 0) {
+        return n;
+    }
+    n += w;
+    return (size_t)n < size ? n : (int)size - 1;
+}
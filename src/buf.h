@@ -0,0 +1,14 @@
+/**
+ * Bounded appends into a fixed text buffer, for /metrics and the JSON bodies.
+ */
+#pragma once
+
+#include <stddef.h>
+
+/*
+ * snprintf at buf + n, clamped so a truncated write never runs past size:
+ * returns the new length, at most size - 1. Chained calls stop appending once
+ * the buffer is full.
+ */
+int buf_appendf(char *buf, size_t size, int n, const char *fmt, ...)
+    __attribute__((format(printf, 4, 5)));
@@ -0,0 +1,646 @@
+/**
+ * CoAP server – see coap.h.
+ *
+ * The "coap" task owns the socket's receive side and answers requests.
+ * coap_notify() (event_task) sends notifications on the same socket; the
+ * observer table and the message-ID / Observe counters are shared under
+ * s_lock, and every sendto() runs outside it on a private copy.
+ *
+ * Retransmitted requests are recognised by (peer, message ID) for
+ * EXCHANGE_LIFETIME and answered with the stored ACK, so a repeated POST
+ * /reset is not applied twice (RFC 7252 section 4.5). Only /status replies
+ * can outgrow COAP_DEDUP_PKT; those are rebuilt, which a GET is safe to do.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_random.h"
+#include "esp_timer.h"
+#include "lwip/sockets.h"
+
+#include "doormon_config.h"
+#include "coap.h"
+
+#if COAP_ENABLE
+
+static const char *TAG = "coap";
+
+/* Message types and codes (RFC 7252 sections 3 and 12.1) */
+enum { T_CON = 0, T_NON = 1, T_ACK = 2, T_RST = 3 };
+#define CODE(c, dd)      (((c) << 5) | (dd))
+#define C_EMPTY          CODE(0, 0)
+#define C_GET            CODE(0, 1)
+#define C_POST           CODE(0, 2)
+#define C_VALID          CODE(2, 3)
+#define C_CHANGED        CODE(2, 4)
+#define C_CONTENT        CODE(2, 5)
+#define C_BAD_REQUEST    CODE(4, 0)
+#define C_BAD_OPTION     CODE(4, 2)
+#define C_NOT_FOUND      CODE(4, 4)
+#define C_NOT_ALLOWED    CODE(4, 5)
+#define C_NOT_ACCEPTABLE CODE(4, 6)
+#define C_INTERNAL       CODE(5, 0)
+
+/* Option numbers and content formats */
+enum {
+    O_URI_HOST = 3, O_ETAG = 4, O_OBSERVE = 6, O_URI_PORT = 7, O_URI_PATH = 11, O_CONTENT_FORMAT = 12,
+    O_MAX_AGE = 14, O_URI_QUERY = 15, O_ACCEPT = 17,
+};
+#define CF_LINK_FORMAT   40
+#define CF_JSON          50
+#define PAYLOAD_MARKER   0xff
+
+/* Duplicate detection window for CON and NON (RFC 7252 section 4.8.2). */
+#define EXCHANGE_LIFETIME_US  (247LL * 1000000)
+
+#define WELL_KNOWN_CORE  "</status>;rt=\"doormon.state\";ct=50;obs,</reset>;rt=\"doormon.reset\""
+
+typedef struct {
+    bool               used;
+    struct sockaddr_in addr;
+    uint8_t            token[8];
+    uint8_t            tkl;
+    uint16_t           last_mid;     /* message ID of the last notification, to match an RST */
+    int64_t            expires_us;
+} observer_t;
+
+/* A request already answered, for duplicate detection. */
+typedef struct {
+    bool               used;
+    struct sockaddr_in addr;
+    uint16_t           mid;
+    uint16_t           len;          /* stored ACK; 0 for NON (drop duplicates) or an ACK too long to keep */
+    int64_t            at_us;
+    uint8_t            pkt[COAP_DEDUP_PKT];
+} exchange_t;
+
+/* One parsed request; pointers into the receive buffer. */
+typedef struct {
+    uint8_t        type;
+    uint8_t        code;
+    uint16_t       mid;
+    uint8_t        tkl;
+    const uint8_t *token;
+    char           path[32];         /* Uri-Path segments, each prefixed by '/' */
+    char           query[48];        /* Uri-Query items joined by '&' */
+    bool           too_long;         /* path or query did not fit */
+    bool           bad_option;       /* an unrecognised critical option */
+    int32_t        accept;           /* Accept content format; -1 = any */
+    bool           has_observe;
+    uint32_t       observe;
+    uint8_t        etag[8];
+    uint8_t        etag_len;         /* 0 = none; only the first ETag is compared */
+} coap_req_t;
+
+/* Response under construction. */
+typedef struct {
+    uint8_t *buf;
+    size_t   size;
+    size_t   n;
+    unsigned last_opt;
+    bool     overflow;
+} pkt_t;
+
+static int s_sock = -1;
+static coap_state_fn_t s_state;
+static coap_reset_fn_t s_reset;
+
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static observer_t s_obs[COAP_MAX_OBSERVERS];   /* under s_lock */
+static uint32_t   s_obs_seq;                   /* Observe sequence number (24 bits on the wire), under s_lock */
+static uint16_t   s_mid;                       /* message ID for our own NON messages, under s_lock */
+static exchange_t s_exch[COAP_DEDUP_ENTRIES];  /* coap task only */
+
+static uint16_t next_mid(void)
+{
+    taskENTER_CRITICAL(&s_lock);
+    uint16_t mid = s_mid++;
+    taskEXIT_CRITICAL(&s_lock);
+    return mid;
+}
+
+/* ---- wire format ---- */
+
+/* Extended option delta/length (13: one more byte, 14: two, 15: reserved). */
+static bool opt_ext(const uint8_t *p, size_t len, size_t *i, unsigned *v)
+{
+    if (*v == 13) {
+        if (*i + 1 > len) {
+            return false;
+        }
+        *v = 13 + p[(*i)++];
+    } else if (*v == 14) {
+        if (*i + 2 > len) {
+            return false;
+        }
+        *v = 269 + ((unsigned)p[*i] << 8 | p[*i + 1]);
+        *i += 2;
+    } else if (*v == 15) {
+        return false;
+    }
+    return true;
+}
+
+static uint32_t opt_uint(const uint8_t *v, unsigned len)
+{
+    uint32_t x = 0;
+    for (unsigned i = 0; i < len && i < 4; i++) {
+        x = x << 8 | v[i];
+    }
+    return x;
+}
+
+/* Append sep and len bytes of v to a NUL-terminated dst; false if it does not fit. */
+static bool str_add(char *dst, size_t size, char sep, const uint8_t *v, unsigned len)
+{
+    size_t n = strlen(dst);
+    if (n + (sep ? 1 : 0) + len >= size) {
+        return false;
+    }
+    if (sep) {
+        dst[n++] = sep;
+    }
+    memcpy(dst + n, v, len);
+    dst[n + len] = '\0';
+    return true;
+}
+
+static bool parse(const uint8_t *p, size_t len, coap_req_t *r)
+{
+    memset(r, 0, sizeof(*r));
+    if (len < 4 || (p[0] >> 6) != 1) {
+        return false;
+    }
+    r->type = (p[0] >> 4) & 3;
+    r->tkl = p[0] & 0x0f;
+    r->code = p[1];
+    r->mid = (uint16_t)(p[2] << 8 | p[3]);
+    if (r->tkl > 8 || 4u + r->tkl > len) {
+        return false;
+    }
+    r->token = p + 4;
+    r->accept = -1;
+
+    size_t i = 4 + r->tkl;
+    unsigned num = 0;
+    while (i < len && p[i] != PAYLOAD_MARKER) {
+        unsigned delta = p[i] >> 4;
+        unsigned olen = p[i] & 0x0f;
+        i++;
+        if (!opt_ext(p, len, &i, &delta) || !opt_ext(p, len, &i, &olen) || i + olen > len) {
+            return false;
+        }
+        num += delta;
+        const uint8_t *v = p + i;
+        i += olen;
+        switch (num) {
+        case O_URI_PATH:
+            r->too_long |= !str_add(r->path, sizeof(r->path), '/', v, olen);
+            break;
+        case O_URI_QUERY:
+            r->too_long |= !str_add(r->query, sizeof(r->query), r->query[0] ? '&' : 0, v, olen);
+            break;
+        case O_OBSERVE:
+            r->has_observe = true;
+            r->observe = opt_uint(v, olen);
+            break;
+        case O_URI_HOST:
+        case O_URI_PORT:
+            break;   /* whichever name or port reached us, the resources are the same */
+        case O_ACCEPT:
+            r->accept = (int32_t)opt_uint(v, olen);
+            break;
+        case O_ETAG:
+            if (!r->etag_len && olen >= 1 && olen <= sizeof(r->etag)) {
+                memcpy(r->etag, v, olen);
+                r->etag_len = (uint8_t)olen;
+            }
+            break;
+        default:
+            r->bad_option |= (num & 1) != 0;   /* odd numbers are critical, e.g. Block2: no block-wise */
+            break;
+        }
+    }
+    return true;
+}
+
+static void pkt_put(pkt_t *k, const void *data, size_t len)
+{
+    if (len == 0) {
+        return;
+    }
+    if (k->n + len > k->size) {
+        k->overflow = true;
+        return;
+    }
+    memcpy(k->buf + k->n, data, len);
+    k->n += len;
+}
+
+static void pkt_header(pkt_t *k, uint8_t type, uint8_t code, uint16_t mid, const uint8_t *token, uint8_t tkl)
+{
+    uint8_t h[4] = { (uint8_t)(0x40 | type << 4 | tkl), code, (uint8_t)(mid >> 8), (uint8_t)mid };
+    k->n = 0;
+    k->last_opt = 0;
+    k->overflow = false;
+    pkt_put(k, h, sizeof(h));
+    pkt_put(k, token, tkl);
+}
+
+/* Options must be added in ascending number. */
+static void pkt_option(pkt_t *k, unsigned num, const void *val, size_t len)
+{
+    uint8_t h[5];
+    size_t hn = 1;
+    unsigned fields[2] = { num - k->last_opt, (unsigned)len };
+    uint8_t nibbles[2];
+    for (int f = 0; f < 2; f++) {
+        unsigned v = fields[f];
+        if (v < 13) {
+            nibbles[f] = (uint8_t)v;
+        } else if (v < 269) {
+            nibbles[f] = 13;
+            h[hn++] = (uint8_t)(v - 13);
+        } else {
+            nibbles[f] = 14;
+            h[hn++] = (uint8_t)((v - 269) >> 8);
+            h[hn++] = (uint8_t)(v - 269);
+        }
+    }
+    h[0] = (uint8_t)(nibbles[0] << 4 | nibbles[1]);
+    pkt_put(k, h, hn);
+    pkt_put(k, val, len);
+    k->last_opt = num;
+}
+
+/* Unsigned option value in the fewest bytes (0 = empty). */
+static void pkt_option_uint(pkt_t *k, unsigned num, uint32_t v)
+{
+    uint8_t b[4];
+    size_t n = 0;
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        if (n || (v >> shift) & 0xff) {
+            b[n++] = (uint8_t)(v >> shift);
+        }
+    }
+    pkt_option(k, num, b, n);
+}
+
+static void pkt_payload(pkt_t *k, const void *data, size_t len)
+{
+    if (len) {
+        uint8_t m = PAYLOAD_MARKER;
+        pkt_put(k, &m, 1);
+        pkt_put(k, data, len);
+    }
+}
+
+/* ---- observers ---- */
+
+static bool same_peer(const struct sockaddr_in *a, const struct sockaddr_in *b)
+{
+    return a->sin_addr.s_addr == b->sin_addr.s_addr && a->sin_port == b->sin_port;
+}
+
+/* Register (or refresh) an observer; returns the Observe value for the response, or -1 if the table is full. */
+static int32_t observe_add(const struct sockaddr_in *from, const coap_req_t *r)
+{
+    int64_t now = esp_timer_get_time();
+    int32_t seq = -1;
+    taskENTER_CRITICAL(&s_lock);
+    observer_t *slot = NULL;
+    for (int i = 0; i < COAP_MAX_OBSERVERS; i++) {
+        observer_t *o = &s_obs[i];
+        if (o->used && now >= o->expires_us) {
+            o->used = false;
+        }
+        if (o->used && same_peer(&o->addr, from) && o->tkl == r->tkl && memcmp(o->token, r->token, r->tkl) == 0) {
+            slot = o;
+            break;
+        }
+        if (!o->used && !slot) {
+            slot = o;
+        }
+    }
+    if (slot) {
+        slot->used = true;
+        slot->addr = *from;
+        slot->tkl = r->tkl;
+        memcpy(slot->token, r->token, r->tkl);
+        slot->expires_us = now + (int64_t)COAP_OBSERVE_LEASE_S * 1000000;
+        seq = (int32_t)(s_obs_seq & 0xffffff);
+    }
+    taskEXIT_CRITICAL(&s_lock);
+    return seq;
+}
+
+/* Drop observers from this peer: by token (Observe 1), or by the message ID an RST answered. */
+static void observe_remove(const struct sockaddr_in *from, const coap_req_t *r, bool by_mid)
+{
+    taskENTER_CRITICAL(&s_lock);
+    for (int i = 0; i < COAP_MAX_OBSERVERS; i++) {
+        observer_t *o = &s_obs[i];
+        if (!o->used || !same_peer(&o->addr, from)) {
+            continue;
+        }
+        if (by_mid ? o->last_mid == r->mid
+                   : o->tkl == r->tkl && memcmp(o->token, r->token, r->tkl) == 0) {
+            o->used = false;
+        }
+    }
+    taskEXIT_CRITICAL(&s_lock);
+}
+
+/* ---- duplicates ---- */
+
+static exchange_t *exchange_find(const struct sockaddr_in *from, uint16_t mid)
+{
+    int64_t now = esp_timer_get_time();
+    for (int i = 0; i < COAP_DEDUP_ENTRIES; i++) {
+        exchange_t *x = &s_exch[i];
+        if (x->used && now - x->at_us >= EXCHANGE_LIFETIME_US) {
+            x->used = false;
+        }
+        if (x->used && x->mid == mid && same_peer(&x->addr, from)) {
+            return x;
+        }
+    }
+    return NULL;
+}
+
+/* Remember a handled request and, for CON, its ACK; evicts the oldest entry when full. */
+static void exchange_add(const struct sockaddr_in *from, const coap_req_t *r, const pkt_t *k)
+{
+    exchange_t *x = &s_exch[0];
+    for (int i = 0; i < COAP_DEDUP_ENTRIES && x->used; i++) {
+        if (!s_exch[i].used || s_exch[i].at_us < x->at_us) {
+            x = &s_exch[i];
+        }
+    }
+    x->used = true;
+    x->addr = *from;
+    x->mid = r->mid;
+    x->at_us = esp_timer_get_time();
+    x->len = 0;
+    if (r->type == T_CON && !k->overflow && k->n <= sizeof(x->pkt)) {
+        memcpy(x->pkt, k->buf, k->n);
+        x->len = (uint16_t)k->n;
+    }
+}
+
+/* ---- requests ---- */
+
+/* 2.05 (or 2.03 on a matching ETag) with the state. observe < 0: not observing. */
+static void respond_state(pkt_t *k, const coap_req_t *r, uint8_t type, uint16_t mid, int32_t observe)
+{
+    static char body[COAP_MAX_PKT];   /* coap task only */
+    uint8_t etag[8];
+    int len = s_state(body, sizeof(body), etag);
+    if (len < 0 || (size_t)len >= sizeof(body) - 1) {
+        pkt_header(k, type, C_INTERNAL, mid, r->token, r->tkl);
+        pkt_payload(k, "state too large", 15);
+        return;
+    }
+    bool valid = r->etag_len == sizeof(etag) && memcmp(r->etag, etag, sizeof(etag)) == 0;
+    pkt_header(k, type, valid ? C_VALID : C_CONTENT, mid, r->token, r->tkl);
+    pkt_option(k, O_ETAG, etag, sizeof(etag));
+    if (observe >= 0) {
+        pkt_option_uint(k, O_OBSERVE, (uint32_t)observe);
+    }
+    if (!valid) {
+        pkt_option_uint(k, O_CONTENT_FORMAT, CF_JSON);
+    }
+    pkt_option_uint(k, O_MAX_AGE, observe >= 0 ? COAP_OBSERVE_LEASE_S : 0);
+    if (!valid) {
+        pkt_payload(k, body, (size_t)len);
+    }
+}
+
+static void respond_reset(pkt_t *k, const coap_req_t *r, uint8_t type, uint16_t mid)
+{
+    const char *input = NULL;
+    if (strncmp(r->query, "input=", 6) == 0) {
+        input = r->query + 6;
+    } else if (strstr(r->query, "&input=")) {
+        input = strstr(r->query, "&input=") + 7;
+    }
+    char name[32] = "";
+    if (input) {
+        size_t n = strcspn(input, "&");
+        if (n >= sizeof(name)) {
+            n = sizeof(name) - 1;
+        }
+        memcpy(name, input, n);
+        name[n] = '\0';
+    }
+    if (!s_reset(input ? name : NULL)) {
+        pkt_header(k, type, C_BAD_REQUEST, mid, r->token, r->tkl);
+        pkt_payload(k, "unknown input", 13);
+        return;
+    }
+    static const char ok[] = "{\"reset\":true}";
+    pkt_header(k, type, C_CHANGED, mid, r->token, r->tkl);
+    pkt_option_uint(k, O_CONTENT_FORMAT, CF_JSON);
+    pkt_payload(k, ok, sizeof(ok) - 1);
+}
+
+/* Whether the request's Accept option (if any) allows content format cf. */
+static bool accepts(const coap_req_t *r, unsigned cf)
+{
+    return r->accept < 0 || (uint32_t)r->accept == cf;
+}
+
+/* Dispatch a new (non-duplicate) request to its resource. */
+static void handle_request(const coap_req_t *r, const struct sockaddr_in *from, pkt_t *k)
+{
+    /* Piggybacked ACK for CON, our own NON for NON. */
+    uint8_t type = r->type == T_CON ? T_ACK : T_NON;
+    uint16_t mid = r->type == T_CON ? r->mid : next_mid();
+    uint8_t code = 0;
+    if (r->bad_option) {
+        code = C_BAD_OPTION;
+    } else if (r->too_long) {
+        code = C_NOT_FOUND;
+    } else if (strcmp(r->path, "/status") == 0) {
+        if (r->code != C_GET) {
+            code = C_NOT_ALLOWED;
+        } else if (!accepts(r, CF_JSON)) {
+            code = C_NOT_ACCEPTABLE;
+        } else {
+            int32_t observe = -1;
+            if (r->has_observe && r->observe == 0) {
+                observe = observe_add(from, r);   /* table full: answer as a plain GET */
+            } else if (r->has_observe && r->observe == 1) {
+                observe_remove(from, r, false);
+            }
+            respond_state(k, r, type, mid, observe);
+            return;
+        }
+    } else if (strcmp(r->path, "/reset") == 0) {
+        if (r->code != C_POST) {
+            code = C_NOT_ALLOWED;
+        } else if (!accepts(r, CF_JSON)) {
+            code = C_NOT_ACCEPTABLE;   /* checked first: nothing is reset */
+        } else {
+            respond_reset(k, r, type, mid);
+            return;
+        }
+    } else if (strcmp(r->path, "/.well-known/core") == 0 && r->code == C_GET) {
+        if (accepts(r, CF_LINK_FORMAT)) {
+            pkt_header(k, type, C_CONTENT, mid, r->token, r->tkl);
+            pkt_option_uint(k, O_CONTENT_FORMAT, CF_LINK_FORMAT);
+            pkt_payload(k, WELL_KNOWN_CORE, sizeof(WELL_KNOWN_CORE) - 1);
+            return;
+        }
+        code = C_NOT_ACCEPTABLE;
+    } else {
+        code = C_NOT_FOUND;
+    }
+    pkt_header(k, type, code, mid, r->token, r->tkl);
+}
+
+/* Build the reply to one message into k; k->n == 0 means send nothing. */
+static void handle(const coap_req_t *r, const struct sockaddr_in *from, pkt_t *k)
+{
+    k->n = 0;
+    if (r->type == T_RST) {
+        observe_remove(from, r, true);
+        return;
+    }
+    if (r->type == T_ACK || (r->code >> 5) != 0) {
+        return;   /* ACKs to our messages, or a response sent to us */
+    }
+    if (r->code == C_EMPTY) {
+        if (r->type == T_CON) {
+            pkt_header(k, T_RST, C_EMPTY, r->mid, NULL, 0);   /* CoAP ping */
+        }
+        return;
+    }
+
+    exchange_t *x = exchange_find(from, r->mid);
+    if (x && (x->len || r->type == T_NON)) {
+        memcpy(k->buf, x->pkt, x->len);   /* retransmission: the same ACK again, nothing for NON */
+        k->n = x->len;
+        return;
+    }
+    handle_request(r, from, k);
+    if (!x) {
+        exchange_add(from, r, k);
+    }
+}
+
+static void coap_task(void *arg)
+{
+    (void)arg;
+    static uint8_t in[COAP_MAX_PKT];
+    static uint8_t out[COAP_MAX_PKT];
+    for (;;) {
+        struct sockaddr_in from;
+        socklen_t from_len = sizeof(from);
+        int len = recvfrom(s_sock, in, sizeof(in), 0, (struct sockaddr *)&from, &from_len);
+        if (len < 0) {
+            ESP_LOGW(TAG, "recvfrom failed: errno %d", errno);
+            vTaskDelay(pdMS_TO_TICKS(100));
+            continue;
+        }
+        coap_req_t r;
+        pkt_t k = { .buf = out, .size = sizeof(out) };
+        if (parse(in, (size_t)len, &r)) {
+            handle(&r, &from, &k);
+        } else if (len >= 4 && (in[0] >> 6) == 1 && ((in[0] >> 4) & 3) == T_CON) {
+            /* Malformed confirmable message: reject it (RFC 7252 section 4.2). */
+            pkt_header(&k, T_RST, C_EMPTY, (uint16_t)(in[2] << 8 | in[3]), NULL, 0);
+        }
+        if (k.n && !k.overflow) {
+            sendto(s_sock, out, k.n, 0, (struct sockaddr *)&from, from_len);
+        }
+    }
+}
+
+void coap_init(coap_state_fn_t state, coap_reset_fn_t reset)
+{
+    s_state = state;
+    s_reset = reset;
+    s_mid = (uint16_t)esp_random();
+
+    int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (sock < 0) {
+        ESP_LOGE(TAG, "socket failed: errno %d", errno);
+        return;
+    }
+    struct sockaddr_in addr = {
+        .sin_family      = AF_INET,
+        .sin_port        = htons(COAP_PORT),
+        .sin_addr.s_addr = htonl(INADDR_ANY),
+    };
+    if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        ESP_LOGE(TAG, "bind to port %d failed: errno %d", COAP_PORT, errno);
+        close(sock);
+        return;
+    }
+    s_sock = sock;
+    xTaskCreate(coap_task, "coap", 4096, NULL, 5, NULL);
+    ESP_LOGI(TAG, "listening on udp/%d", COAP_PORT);
+}
+
+void coap_notify(void)
+{
+    /* event_task only */
+    static char body[COAP_MAX_PKT];
+    static uint8_t out[COAP_MAX_PKT];
+    static observer_t obs[COAP_MAX_OBSERVERS];
+    if (s_sock < 0) {
+        return;
+    }
+    uint8_t etag[8];
+    int len = s_state(body, sizeof(body), etag);
+    if (len < 0 || (size_t)len >= sizeof(body) - 1) {
+        return;
+    }
+
+    int64_t now = esp_timer_get_time();
+    int n = 0;
+    taskENTER_CRITICAL(&s_lock);
+    uint32_t seq = ++s_obs_seq & 0xffffff;
+    for (int i = 0; i < COAP_MAX_OBSERVERS; i++) {
+        observer_t *o = &s_obs[i];
+        if (o->used && now >= o->expires_us) {
+            o->used = false;
+        }
+        if (o->used) {
+            o->last_mid = s_mid++;
+            obs[n++] = *o;
+        }
+    }
+    taskEXIT_CRITICAL(&s_lock);
+
+    for (int i = 0; i < n; i++) {
+        pkt_t k = { .buf = out, .size = sizeof(out) };
+        pkt_header(&k, T_NON, C_CONTENT, obs[i].last_mid, obs[i].token, obs[i].tkl);
+        pkt_option(&k, O_ETAG, etag, sizeof(etag));
+        pkt_option_uint(&k, O_OBSERVE, seq);
+        pkt_option_uint(&k, O_CONTENT_FORMAT, CF_JSON);
+        pkt_option_uint(&k, O_MAX_AGE, (uint32_t)((obs[i].expires_us - now) / 1000000));
+        pkt_payload(&k, body, (size_t)len);
+        if (!k.overflow && sendto(s_sock, out, k.n, 0, (struct sockaddr *)&obs[i].addr, sizeof(obs[i].addr)) < 0) {
+            ESP_LOGD(TAG, "notify sendto failed: errno %d", errno);
+        }
+    }
+}
+
+#else
+
+void coap_init(coap_state_fn_t state, coap_reset_fn_t reset)
+{
+    (void)state;
+    (void)reset;
+}
+
+void coap_notify(void)
+{
+}
+
+#endif
@@ -0,0 +1,38 @@
+/**
+ * CoAP server (COAP_ENABLE, RFC 7252) for /status and /reset over UDP, with
+ * Observe (RFC 7641) on /status.
+ *
+ * One request and one response datagram, no handshake and no httpd socket,
+ * so a poller costs the device a recvfrom() and a sendto(). Resources:
+ *   GET  /status               2.05, the /status JSON (Content-Format 50) with an ETag
+ *   GET  /status, Observe 0    also register; a notification follows every state change
+ *   GET  /status, Observe 1    deregister
+ *   POST /reset[?input=<name>] 2.04 {"reset":true}; 4.00 on an unknown input
+ *   GET  /.well-known/core     link-format list of the above
+ *
+ * Confirmable requests get a piggybacked ACK, and a request naming the
+ * current ETag gets 2.03 Valid with no payload. Uri-Host and Uri-Port are
+ * ignored; an Accept other than the format listed above gets 4.06, and any
+ * other critical option (Block2 included) 4.02. A retransmitted request (same
+ * peer and message ID) gets the first ACK again instead of being re-run. Notifications are
+ * non-confirmable: an observer is dropped when it answers one with RST, or
+ * when it has not re-registered within COAP_OBSERVE_LEASE_S (sent as
+ * Max-Age). There is no block-wise transfer; a body must fit COAP_MAX_PKT.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Render the /status body into buf and fill its 8-byte validator; returns the body length. Any task. */
+typedef int (*coap_state_fn_t)(char *buf, size_t size, uint8_t etag[8]);
+
+/* /reset: input is NULL for all inputs; return false if the name is unknown. */
+typedef bool (*coap_reset_fn_t)(const char *input);
+
+/* Bind COAP_PORT and start the server task. Call once the station has an IP. */
+void coap_init(coap_state_fn_t state, coap_reset_fn_t reset);
+
+/* Send the current state to every observer. event_task, after a state change. */
+void coap_notify(void);
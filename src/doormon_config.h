@@ -0,0 +1,219 @@
+/**
+ * Doormon build-time configuration.
+ *
+ * Change WiFi credentials and the trigger input table here before building.
+ * The optional-module switches are wrapped in #ifndef so a build (the host
+ * tests) can turn one on with -D without editing this file.
+ */
+#pragma once
+
+#include "sdkconfig.h"
+#include "driver/gpio.h"
+
+/* WiFi – change these for your network */
+#define WIFI_SSID      "Planet Express"
+//#define WIFI_SSID      "FuturePointFactory"
+#define WIFI_PASSWORD  "Kelvinator"
+#define WIFI_CONNECT_TIMEOUT_MS  (60 * 1000)  /* Retry for ~60s at startup, then reboot */
+/* After a disconnect, retry after MIN, doubling per failed attempt up to MAX. Never reboots. */
+#define WIFI_BACKOFF_MIN_MS      250
+#define WIFI_BACKOFF_MAX_MS      (30 * 1000)
+/* Attempts on the cached BSSID/channel before falling back to a full scan for the SSID. */
+#define WIFI_PIN_MAX_FAILS       2
+
+/*
+ * How the station gets its address after associating:
+ *   DHCP        – a full DISCOVER/OFFER/REQUEST/ACK every time. Needs
+ *                 CONFIG_LWIP_DHCP_RESTORE_LAST_IP off.
+ *   DHCP_REBOOT – DHCP INIT-REBOOT: one REQUEST/ACK for the last leased
+ *                 address, kept in NVS by lwIP. The address is only used once
+ *                 the server ACKs it. Needs CONFIG_LWIP_DHCP_RESTORE_LAST_IP=y.
+ *   STATIC      – the fixed address below; no DHCP at all.
+ */
+#define WIFI_IP_DHCP         0
+#define WIFI_IP_DHCP_REBOOT  1
+#define WIFI_IP_STATIC       2
+#define WIFI_IP_MODE         WIFI_IP_DHCP_REBOOT
+#define WIFI_STATIC_IP       "192.168.1.50"
+#define WIFI_STATIC_NETMASK  "255.255.255.0"
+#define WIFI_STATIC_GW       "192.168.1.1"
+#define WIFI_STATIC_DNS      "192.168.1.1"
+
+/*
+ * Trigger inputs: { GPIO, name }, one per door. A falling edge latches that
+ * input; /reset clears it. Up to 32 inputs; names appear in /status.
+ */
+#define TRIGGER_INPUTS \
+    { GPIO_NUM_5, "door" },
+
+/* GPIO2 drives the onboard blue LED: on while any input is triggered. */
+#define LED_GPIO       GPIO_NUM_2
+
+/* Trigger input filtering */
+#define TRIGGER_FILTER_NONE  0   /* raw GPIO interrupt; every edge is reported */
+#define TRIGGER_FILTER_SOFT  1   /* GPIO interrupt, masked for TRIGGER_MIN_PULSE_MS after an edge */
+#define TRIGGER_FILTER_PCNT  2   /* PCNT counts edges behind its glitch filter; no CPU per bounce */
+#define TRIGGER_FILTER_MODE  TRIGGER_FILTER_SOFT
+/* SOFT/PCNT: an edge is reported only if the input is still low this long after it. */
+#define TRIGGER_MIN_PULSE_MS 10
+/* PCNT: pulses shorter than this never reach the counter (ESP32 hardware max ~12700 ns). */
+#define TRIGGER_GLITCH_NS    10000
+
+/*
+ * Real-time trigger path (trigger.h). The trigger task applies each edge and
+ * lights the LED, then leaves the network fan-out to event_task. It takes the
+ * input interrupt on its own core, away from WiFi, lwIP and mDNS, which
+ * sdkconfig.defaults pins to core 0; use core 0 on a single-core chip.
+ * Level 3 preempts the level-1 WiFi interrupts, and an IRAM ISR keeps running
+ * while NVS or the event log writes flash. PCNT mode takes its own interrupt
+ * flags (CONFIG_PCNT_ISR_IRAM_SAFE).
+ */
+#define TRIGGER_TASK_CORE    1
+#define TRIGGER_TASK_PRIO    20      /* above httpd, lwIP (18) and event_task (10) */
+#define TRIGGER_ISR_FLAGS    (ESP_INTR_FLAG_IRAM | ESP_INTR_FLAG_LEVEL3)
+
+/*
+ * Low-power mode (power.h) for battery installs. Off by default. The CPU
+ * scales between the two clocks and light-sleeps whenever it is idle. The
+ * radio keeps to WiFi modem sleep: it wakes for every DTIM beacon, or every
+ * POWER_LISTEN_INTERVAL beacons (102.4 ms each) if that is set. The trigger
+ * inputs switch to level interrupts so they can wake the chip. SOFT or NONE
+ * filtering only, because PCNT stops in light sleep.
+ * POWER_REPORT_TARGET_MS is the intended time from an edge to its report.
+ * It is not enforced: reports slower than that are only counted in /metrics.
+ * The listen interval must fit inside it. /metrics also shows an average
+ * current. It is modelled, not measured, from the sleep time and the two
+ * board figures below.
+ */
+#ifndef POWER_SAVE_ENABLE
+#define POWER_SAVE_ENABLE        0
+#endif
+#define POWER_MAX_CPU_MHZ        160
+#define POWER_MIN_CPU_MHZ        40      /* XTAL; WiFi needs at least this */
+#define POWER_LISTEN_INTERVAL    0       /* 0 = every DTIM (WIFI_PS_MIN_MODEM) */
+#define POWER_REPORT_TARGET_MS   500
+#define POWER_SLEEP_UA           800     /* light sleep */
+#define POWER_AWAKE_UA           30000   /* CPU running, radio in modem sleep */
+
+#define NVS_NAMESPACE  "doormon"
+#define NVS_KEY_LATCH       "latched"     /* u32 bitmask of triggered inputs */
+#define NVS_KEY_TRIG        "triggered"   /* legacy single-input u8, read once for migration */
+#define NVS_KEY_WIFI_AP     "wifi_ap"     /* blob: SSID, BSSID and channel of the last AP */
+/* Transitions within this window after the first one are folded into a single write. */
+#define NVS_COALESCE_MS  500
+#define NVS_RETRY_MS     5000
+
+#define MDNS_HOSTNAME  "doormon"
+#define MDNS_INSTANCE  "Doormon"
+
+/* Server-Sent Events (/events): max concurrent subscribers, idle keepalive period. */
+#define SSE_MAX_CLIENTS    4
+#define SSE_KEEPALIVE_MS   (30 * 1000)
+
+/* Long-poll (/status?since=<gen>&wait=<s>): parked requests, longest wait honoured. */
+#define LONGPOLL_MAX_CLIENTS  8
+#define LONGPOLL_MAX_WAIT_S   60
+
+/*
+ * UDP multicast notifications (mcast.h): one datagram per transition to any
+ * number of listeners. Off by default. TTL 1 keeps them on the local subnet.
+ */
+#define MCAST_ENABLE        0
+#define MCAST_GROUP         "239.255.68.77"
+#define MCAST_PORT          5077
+#define MCAST_TTL           1
+#define MCAST_REPEAT        3          /* copies of each transition */
+#define MCAST_REPEAT_MS     50         /* spacing between copies */
+#define MCAST_HEARTBEAT_MS  (10 * 1000)
+
+/*
+ * MQTT (mqtt_pub.h): retained state, per-transition events and a /reset
+ * command topic over one broker connection. Off by default.
+ */
+#define MQTT_ENABLE       0
+#define MQTT_BROKER_URI   "mqtt://192.168.1.10"
+#define MQTT_USERNAME     ""
+#define MQTT_PASSWORD     ""
+#define MQTT_TOPIC_BASE   "doormon/" MDNS_HOSTNAME
+#define MQTT_QOS          1
+#define MQTT_QUEUE_LEN    16     /* events kept while the broker is unreachable; oldest dropped */
+#define MQTT_EVENT_MAX    160    /* bytes per queued event message */
+
+/*
+ * CoAP (coap.h): /status and /reset over UDP, one datagram each way, and
+ * Observe notifications on /status. Off by default.
+ */
+#ifndef COAP_ENABLE
+#define COAP_ENABLE           0
+#endif
+#define COAP_PORT             5683
+#define COAP_MAX_OBSERVERS    16
+#define COAP_OBSERVE_LEASE_S  300     /* an observer not re-registered this long is dropped */
+#define COAP_MAX_PKT          1152    /* largest datagram received or sent */
+#define COAP_DEDUP_ENTRIES    8       /* recent (peer, message ID) pairs remembered to drop retransmissions */
+#define COAP_DEDUP_PKT        256     /* ACKs up to this size are kept for replay; larger ones are rebuilt */
+
+/*
+ * Event log (evlog.h): every edge, reset and boot as a 16-byte record in the
+ * EVLOG_PARTITION flash partition (partitions.csv), paged out by
+ * /events/history. Records wait in RAM for a full flash page, or for
+ * EVLOG_FLUSH_MS after the first of them or the last page write; more than
+ * EVLOG_PENDING waiting are dropped.
+ */
+#define EVLOG_ENABLE          1
+#define EVLOG_PARTITION       "evlog"
+#define EVLOG_FLUSH_MS        (5 * 1000)
+#define EVLOG_PENDING         48
+#define EVLOG_PAGE_DEFAULT    100     /* /events/history records per response, default and max */
+#define EVLOG_PAGE_MAX        500
+
+/*
+ * Firmware update (ota.h): POST /ota with "Authorization: Bearer <OTA_TOKEN>"
+ * streams an image into the idle OTA slot (partitions.csv) and reboots into
+ * it. A new image that does not bring its network services up within
+ * OTA_CONFIRM_TIMEOUT_S is rolled back. The endpoint is off by default;
+ * set a long random token before turning it on.
+ */
+#ifndef OTA_ENABLE
+#define OTA_ENABLE             0
+#endif
+#ifndef OTA_TOKEN
+#define OTA_TOKEN              ""
+#endif
+#define OTA_CHUNK              1024    /* bytes per receive and flash write */
+#define OTA_CONFIRM_TIMEOUT_S  300
+#define OTA_RESTART_DELAY_MS   500     /* lets the response leave before the restart */
+
+/*
+ * HTTP server sizing for many keep-alive pollers. Every open socket (SSE and
+ * parked long-polls included) counts against HTTPD_MAX_SOCKETS. httpd keeps
+ * three lwIP sockets of its own on top of those (listener and control), and
+ * NET_RESERVED_SOCKETS holds one each for the multicast, MQTT and CoAP
+ * sockets when enabled. By default HTTPD_MAX_SOCKETS takes whatever is left;
+ * a smaller value may be set, a larger one fails the build. sdkconfig.defaults
+ * raises the lwIP limits.
+ */
+#define HTTPD_INTERNAL_SOCKETS 3
+#define NET_RESERVED_SOCKETS  (MCAST_ENABLE + MQTT_ENABLE + COAP_ENABLE)
+#ifndef HTTPD_MAX_SOCKETS
+#define HTTPD_MAX_SOCKETS     (CONFIG_LWIP_MAX_SOCKETS - HTTPD_INTERNAL_SOCKETS - NET_RESERVED_SOCKETS)
+#endif
+_Static_assert(HTTPD_MAX_SOCKETS > 0,
+               "CONFIG_LWIP_MAX_SOCKETS leaves no socket for HTTP clients");
+_Static_assert(HTTPD_MAX_SOCKETS + HTTPD_INTERNAL_SOCKETS + NET_RESERVED_SOCKETS <= CONFIG_LWIP_MAX_SOCKETS,
+               "HTTPD_MAX_SOCKETS plus httpd's own and the reserved sockets exceed CONFIG_LWIP_MAX_SOCKETS");
+_Static_assert(HTTPD_MAX_SOCKETS > SSE_MAX_CLIENTS + LONGPOLL_MAX_CLIENTS,
+               "no httpd socket left for plain requests once SSE and long-poll slots are full");
+#define HTTPD_BACKLOG         8       /* pending accepts while all workers are busy */
+#define HTTPD_RECV_TIMEOUT_S  5       /* per-recv stall before a slow client is dropped */
+#define HTTPD_SEND_TIMEOUT_S  5
+#define HTTPD_STACK_SIZE      6144
+#define HTTPD_TASK_CORE       0       /* with the network stack; tskNO_AFFINITY to float */
+#define HTTPD_TASK_PRIO       5
+/* TCP keepalive reaps idle peers that vanished without a FIN: probe after idle_s, every interval_s, count times. */
+#define HTTPD_TCP_KEEPALIVE_IDLE_S      60
+#define HTTPD_TCP_KEEPALIVE_INTERVAL_S  10
+#define HTTPD_TCP_KEEPALIVE_COUNT       3
+
+/* /metrics (Prometheus text): latency histograms, heap, task stacks, WiFi. */
+#define METRICS_ENABLE  1
@@ -0,0 +1,398 @@
+/**
+ * Persistent event log – see evlog.h.
+ *
+ * Two locks: s_mux (spinlock) guards the RAM buffer and the counters, so an
+ * append from any task costs a memcpy; s_io (mutex) serialises flash access
+ * and the head/sector table between evlog_service() and readers. A flush
+ * copies a page's worth out of the buffer, writes it outside s_mux, and only
+ * then drops it from the buffer, so a reader holding s_io sees every record
+ * exactly once, in flash or in RAM.
+ */
+
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_timer.h"
+
+#include "doormon_config.h"
+#include "evlog.h"
+
+#if EVLOG_ENABLE
+
+static const char *TAG = "evlog";
+
+#define SECTOR_SIZE      4096    /* SPI flash erase unit */
+#define PAGE_SIZE        256     /* SPI flash program page */
+#define RECS_PER_SECTOR  (SECTOR_SIZE / EVLOG_REC_LEN)
+#define RECS_PER_PAGE    (PAGE_SIZE / EVLOG_REC_LEN)
+#define MAX_SECTORS      64
+
+static const esp_partition_t *s_part;
+static uint32_t s_sectors;
+
+static SemaphoreHandle_t s_io;
+static uint32_t s_head;                        /* partition offset of the next free slot, under s_io */
+static uint32_t s_sector_seq[MAX_SECTORS];     /* seq of each sector's first record, 0 = none; under s_io */
+
+static portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+static evlog_rec_t s_pend[EVLOG_PENDING];      /* appended, not yet in flash; under s_mux */
+static unsigned    s_pend_n;
+static int64_t     s_pend_since_us;            /* when s_pend[0] was appended, or the last page went out */
+static uint32_t    s_next_seq;                 /* under s_mux */
+static uint8_t     s_boot;
+static uint32_t    s_writes, s_erases, s_lost; /* under s_mux */
+
+/* CRC-8 (poly 0x07) over everything but the crc byte. */
+static uint8_t rec_crc(const evlog_rec_t *r)
+{
+    const uint8_t *p = (const uint8_t *)r;
+    uint8_t crc = 0;
+    for (int i = 0; i < EVLOG_REC_LEN - 1; i++) {
+        crc ^= p[i];
+        for (int b = 0; b < 8; b++) {
+            crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+static bool rec_valid(const evlog_rec_t *r)
+{
+    return r->seq != UINT32_MAX && r->seq != 0 && r->crc == rec_crc(r);
+}
+
+static bool rec_erased(const evlog_rec_t *r)
+{
+    static const uint8_t ff[EVLOG_REC_LEN] = { [0 ... EVLOG_REC_LEN - 1] = 0xff };
+    return memcmp(r, ff, EVLOG_REC_LEN) == 0;
+}
+
+/* a is older than b, wrap-safe. */
+static bool seq_before(uint32_t a, uint32_t b)
+{
+    return (int32_t)(a - b) < 0;
+}
+
+static bool read_slot(uint32_t sector, uint32_t slot, evlog_rec_t *r)
+{
+    return esp_partition_read(s_part, sector * SECTOR_SIZE + slot * EVLOG_REC_LEN, r, EVLOG_REC_LEN) == ESP_OK;
+}
+
+/* Oldest sector still holding records: the one the head will erase next, or the one after the head's. */
+static uint32_t oldest_sector(void)
+{
+    return ((s_head + SECTOR_SIZE - 1) / SECTOR_SIZE) % s_sectors;
+}
+
+/* Rebuild s_head, s_sector_seq, s_next_seq and s_boot from flash. */
+static void scan(void)
+{
+    uint32_t newest = 0;
+    bool any = false;
+    for (uint32_t s = 0; s < s_sectors; s++) {
+        evlog_rec_t r;
+        s_sector_seq[s] = 0;
+        if (read_slot(s, 0, &r) && rec_valid(&r)) {
+            s_sector_seq[s] = r.seq;
+            if (!any || seq_before(s_sector_seq[newest], r.seq)) {
+                newest = s;
+            }
+            any = true;
+        }
+    }
+    if (!any) {
+        s_head = 0;
+        s_next_seq = 1;
+        s_boot = 0;
+        return;
+    }
+
+    /* Slots are written in order: bisect for the first erased one. Slot 0 is in use. */
+    uint32_t lo = 1, hi = RECS_PER_SECTOR;
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        evlog_rec_t r;
+        if (read_slot(newest, mid, &r) && rec_erased(&r)) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    s_head = (newest * SECTOR_SIZE + lo * EVLOG_REC_LEN) % (s_sectors * SECTOR_SIZE);
+
+    /* The last written slot may be torn; walk back to the last good record. */
+    evlog_rec_t last = { .seq = s_sector_seq[newest] };
+    for (uint32_t slot = lo; slot-- > 0;) {
+        evlog_rec_t r;
+        if (read_slot(newest, slot, &r) && rec_valid(&r)) {
+            last = r;
+            break;
+        }
+    }
+    s_next_seq = last.seq + 1;
+    s_boot = (uint8_t)(last.boot + 1);
+}
+
+void evlog_init(void)
+{
+    s_part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, EVLOG_PARTITION);
+    if (!s_part) {
+        ESP_LOGW(TAG, "no \"%s\" partition, event log disabled", EVLOG_PARTITION);
+        return;
+    }
+    s_sectors = s_part->size / SECTOR_SIZE;
+    if (s_sectors > MAX_SECTORS) {
+        s_sectors = MAX_SECTORS;
+    }
+    if (s_sectors < 2) {
+        ESP_LOGW(TAG, "\"%s\" partition needs at least 2 sectors", EVLOG_PARTITION);
+        s_part = NULL;
+        return;
+    }
+    if (!s_io) {
+        s_io = xSemaphoreCreateMutex();
+    }
+    s_pend_n = 0;
+    s_writes = s_erases = s_lost = 0;
+    scan();
+    ESP_LOGI(TAG, "%u sectors, head at 0x%x, next seq %u, boot %u",
+             (unsigned)s_sectors, (unsigned)s_head, (unsigned)s_next_seq, (unsigned)s_boot);
+}
+
+void evlog_append(evlog_kind_t kind, uint8_t input, uint32_t arg, int64_t time_us)
+{
+    if (!s_part) {
+        return;
+    }
+    evlog_rec_t r = {
+        .time_ms = (uint32_t)(time_us / 1000),
+        .arg     = arg,
+        .boot    = s_boot,
+        .kind    = kind,
+        .input   = input,
+    };
+    taskENTER_CRITICAL(&s_mux);
+    if (s_pend_n < EVLOG_PENDING) {
+        r.seq = s_next_seq++;
+        r.crc = rec_crc(&r);
+        if (s_pend_n == 0) {
+            s_pend_since_us = esp_timer_get_time();
+        }
+        s_pend[s_pend_n++] = r;
+    } else {
+        s_lost++;
+    }
+    taskEXIT_CRITICAL(&s_mux);
+}
+
+/*
+ * Write buffered records up to the end of the head's page, repeatedly. With
+ * all false only complete pages go out. Erases the head's sector on entry.
+ * Caller holds s_io.
+ */
+static void flush_locked(bool all)
+{
+    for (;;) {
+        unsigned room = (PAGE_SIZE - s_head % PAGE_SIZE) / EVLOG_REC_LEN;
+        evlog_rec_t batch[RECS_PER_PAGE];
+        taskENTER_CRITICAL(&s_mux);
+        unsigned n = s_pend_n < room ? s_pend_n : room;
+        if (n < room && !all) {
+            n = 0;
+        }
+        memcpy(batch, s_pend, n * EVLOG_REC_LEN);
+        taskEXIT_CRITICAL(&s_mux);
+        if (n == 0) {
+            return;
+        }
+
+        uint32_t sector = s_head / SECTOR_SIZE;
+        esp_err_t err = ESP_OK;
+        bool erased = false;
+        if (s_head % SECTOR_SIZE == 0) {
+            s_sector_seq[sector] = 0;
+            err = esp_partition_erase_range(s_part, s_head, SECTOR_SIZE);
+            erased = err == ESP_OK;
+        }
+        if (err == ESP_OK) {
+            err = esp_partition_write(s_part, s_head, batch, n * EVLOG_REC_LEN);
+            if (err == ESP_OK && s_head % SECTOR_SIZE == 0) {
+                s_sector_seq[sector] = batch[0].seq;
+            }
+            /* Even a failed write may have programmed some bits: never reuse those slots. */
+            s_head = (s_head + n * EVLOG_REC_LEN) % (s_sectors * SECTOR_SIZE);
+        }
+        if (err != ESP_OK) {
+            ESP_LOGW(TAG, "flash write at 0x%x failed: %s", (unsigned)s_head, esp_err_to_name(err));
+        }
+
+        taskENTER_CRITICAL(&s_mux);
+        memmove(s_pend, s_pend + n, (s_pend_n - n) * EVLOG_REC_LEN);
+        s_pend_n -= n;
+        if (s_pend_n) {
+            /* Restart the clock, or the leftovers follow the page out at once as a partial write. */
+            s_pend_since_us = esp_timer_get_time();
+        }
+        s_writes += err == ESP_OK;
+        s_erases += erased;
+        if (err != ESP_OK) {
+            s_lost += n;
+        }
+        taskEXIT_CRITICAL(&s_mux);
+    }
+}
+
+TickType_t evlog_service(void)
+{
+    if (!s_part) {
+        return portMAX_DELAY;
+    }
+    taskENTER_CRITICAL(&s_mux);
+    unsigned pending = s_pend_n;
+    int64_t due = s_pend_since_us + (int64_t)EVLOG_FLUSH_MS * 1000;
+    taskEXIT_CRITICAL(&s_mux);
+    if (!pending) {
+        return portMAX_DELAY;
+    }
+    int64_t now = esp_timer_get_time();
+    xSemaphoreTake(s_io, portMAX_DELAY);
+    flush_locked(now >= due);
+    xSemaphoreGive(s_io);
+
+    taskENTER_CRITICAL(&s_mux);
+    pending = s_pend_n;
+    due = s_pend_since_us + (int64_t)EVLOG_FLUSH_MS * 1000;
+    taskEXIT_CRITICAL(&s_mux);
+    if (!pending) {
+        return portMAX_DELAY;
+    }
+    return due > now ? pdMS_TO_TICKS((due - now + 999) / 1000) : 0;
+}
+
+void evlog_flush(void)
+{
+    if (!s_part) {
+        return;
+    }
+    xSemaphoreTake(s_io, portMAX_DELAY);
+    flush_locked(true);
+    xSemaphoreGive(s_io);
+}
+
+/* First seq held in flash, or 0 if none. Caller holds s_io. */
+static uint32_t flash_first_locked(void)
+{
+    uint32_t s = oldest_sector();
+    for (uint32_t k = 0; k < s_sectors; k++) {
+        uint32_t seq = s_sector_seq[(s + k) % s_sectors];
+        if (seq) {
+            return seq;
+        }
+    }
+    return 0;
+}
+
+size_t evlog_read(uint32_t from, evlog_rec_t *out, size_t max)
+{
+    if (!s_part || max == 0) {
+        return 0;
+    }
+    size_t n = 0;
+    xSemaphoreTake(s_io, portMAX_DELAY);
+    uint32_t oldest = oldest_sector();
+    uint32_t head_sector = s_head / SECTOR_SIZE;
+    for (uint32_t k = 0; k < s_sectors && n < max; k++) {
+        uint32_t s = (oldest + k) % s_sectors;
+        if (!s_sector_seq[s]) {
+            continue;
+        }
+        /* Skip the whole sector if the next one already starts at or before from. */
+        uint32_t next = k + 1 < s_sectors ? s_sector_seq[(s + 1) % s_sectors] : 0;
+        if (next && !seq_before(from, next)) {
+            continue;
+        }
+        uint32_t end = (s == head_sector && s_head % SECTOR_SIZE) ? s_head % SECTOR_SIZE : SECTOR_SIZE;
+        for (uint32_t off = 0; off < end && n < max; off += PAGE_SIZE) {
+            evlog_rec_t page[RECS_PER_PAGE];
+            uint32_t len = end - off < PAGE_SIZE ? end - off : PAGE_SIZE;
+            if (esp_partition_read(s_part, s * SECTOR_SIZE + off, page, len) != ESP_OK) {
+                break;
+            }
+            for (uint32_t i = 0; i < len / EVLOG_REC_LEN && n < max; i++) {
+                if (rec_valid(&page[i]) && !seq_before(page[i].seq, from)) {
+                    out[n++] = page[i];
+                }
+            }
+        }
+    }
+    taskENTER_CRITICAL(&s_mux);
+    for (unsigned i = 0; i < s_pend_n && n < max; i++) {
+        if (!seq_before(s_pend[i].seq, from)) {
+            out[n++] = s_pend[i];
+        }
+    }
+    taskEXIT_CRITICAL(&s_mux);
+    xSemaphoreGive(s_io);
+    return n;
+}
+
+void evlog_get_info(evlog_info_t *info)
+{
+    memset(info, 0, sizeof(*info));
+    if (!s_part) {
+        return;
+    }
+    xSemaphoreTake(s_io, portMAX_DELAY);
+    uint32_t first = flash_first_locked();
+    taskENTER_CRITICAL(&s_mux);
+    info->head = s_next_seq;
+    info->first = first ? first : (s_pend_n ? s_pend[0].seq : s_next_seq);
+    info->writes = s_writes;
+    info->erases = s_erases;
+    info->lost = s_lost;
+    taskEXIT_CRITICAL(&s_mux);
+    xSemaphoreGive(s_io);
+    info->ready = true;
+    info->boot = s_boot;
+}
+
+#else
+
+void evlog_init(void)
+{
+}
+
+void evlog_append(evlog_kind_t kind, uint8_t input, uint32_t arg, int64_t time_us)
+{
+    (void)kind;
+    (void)input;
+    (void)arg;
+    (void)time_us;
+}
+
+TickType_t evlog_service(void)
+{
+    return portMAX_DELAY;
+}
+
+void evlog_flush(void)
+{
+}
+
+size_t evlog_read(uint32_t from, evlog_rec_t *out, size_t max)
+{
+    (void)from;
+    (void)out;
+    (void)max;
+    return 0;
+}
+
+void evlog_get_info(evlog_info_t *info)
+{
+    memset(info, 0, sizeof(*info));
+}
+
+#endif
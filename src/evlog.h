@@ -0,0 +1,78 @@
+/**
+ * Persistent event log (EVLOG_ENABLE): an append-only circular log of edges,
+ * resets and boots in the EVLOG_PARTITION data partition (partitions.csv).
+ *
+ * Records are EVLOG_REC_LEN bytes, 16 to a 256-byte flash program page and
+ * 256 to a 4 KB erase sector. Appends only fill a RAM buffer; evlog_service()
+ * writes a page as soon as it is complete, and whatever is left once it has
+ * waited EVLOG_FLUSH_MS, counted from the first record buffered or from the
+ * last page written, whichever is later. A write never crosses a page.
+ * A sector is erased only when the head wraps into it, so each one sees one
+ * erase per trip round the log and its 256 oldest records go with it.
+ *
+ * Record (little-endian, EVLOG_REC_LEN bytes):
+ *   0  seq (u32, +1 per record, continued across boots; erased = 0xffffffff)
+ *   4  uptime ms (u32) in that boot
+ *   8  arg (u32): trigger/edge = edge seq, reset = inputs cleared, boot = latched mask
+ *   12 boot (u8, boots since the log was created, wrapping)
+ *   13 kind (evlog_kind_t)   14 input index (EVLOG_INPUT_NONE)   15 CRC-8 of 0..14
+ *
+ * evlog_init() recovers the head by reading the first record of each sector,
+ * then bisecting the newest sector for its first erased slot; a record torn
+ * by a power cut fails its CRC and is skipped. Anything still buffered in RAM
+ * at a reset is lost.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+
+#define EVLOG_REC_LEN     16
+#define EVLOG_INPUT_NONE  0xff
+
+typedef enum {
+    EVLOG_BOOT    = 0,
+    EVLOG_TRIGGER = 1,   /* edge that latched its input */
+    EVLOG_EDGE    = 2,   /* edge on an input that was already latched */
+    EVLOG_RESET   = 3,
+} evlog_kind_t;
+
+typedef struct {
+    uint32_t seq;
+    uint32_t time_ms;
+    uint32_t arg;
+    uint8_t  boot;
+    uint8_t  kind;
+    uint8_t  input;
+    uint8_t  crc;
+} evlog_rec_t;
+_Static_assert(sizeof(evlog_rec_t) == EVLOG_REC_LEN, "evlog record layout");
+
+typedef struct {
+    bool     ready;      /* partition found and scanned */
+    uint8_t  boot;       /* this boot's number */
+    uint32_t first;      /* oldest seq still held; first == head: empty */
+    uint32_t head;       /* seq the next record will get */
+    uint32_t writes;     /* flash page writes since boot */
+    uint32_t erases;     /* sector erases since boot */
+    uint32_t lost;       /* records dropped: RAM buffer full or a flash error */
+} evlog_info_t;
+
+/* Find the partition and recover the head. Call once at boot, before any append. */
+void evlog_init(void);
+
+/* Buffer one record stamped time_us; any task. The boot number is filled in here. */
+void evlog_append(evlog_kind_t kind, uint8_t input, uint32_t arg, int64_t time_us);
+
+/* event_task: write out what is due. Returns ticks until the next flush is due, portMAX_DELAY if none. */
+TickType_t evlog_service(void);
+
+/* Write out everything buffered, however recent. Before a planned restart. */
+void evlog_flush(void);
+
+/* Copy up to max records with seq >= from (or the oldest kept, if later), oldest first. */
+size_t evlog_read(uint32_t from, evlog_rec_t *out, size_t max);
+
+void evlog_get_info(evlog_info_t *info);
@@ -1,24 +1,47 @@
 /**
  * Doormon – ESP32 FireBeetle V4.0
  *
- * Connects to WiFi, runs an HTTP server with /status and /reset.
- * Trigger input (falling edge) latches a "triggered" state; /reset clears it.
- * GPIO2 drives the onboard blue LED: on when triggered, off when reset.
- * Triggered state is stored in NVS and restored across (hot) reboots.
+ * Connects to WiFi (wifi.c: in-place reconnect, cached AP), runs an HTTP server
+ * with /status, /reset and /events.
+ * Each trigger input (falling edge) latches a "triggered" state; /reset clears it.
+ * Edges are filtered, captured and latched by trigger.c's pinned trigger task,
+ * which also lights the LED; event_task takes them from there and fans state
+ * changes out to NVS, /events subscribers, multicast and the rest.
+ * GPIO2 drives the onboard blue LED: on while any input is triggered.
+ * Triggered state is stored in NVS and restored across (hot) reboots; writes
+ * happen only on transitions, coalesced over NVS_COALESCE_MS.
+ * /events is a Server-Sent Events stream pushing every state change;
+ * /status?since=<gen>&wait=<s> long-polls until the state generation changes.
+ * The state body is rendered once per change and served with an ETag, so
+ * pollers sending If-None-Match get 304 Not Modified.
  *
- * Configure WiFi below before building.
+ * With MCAST_ENABLE, each transition is also multicast as a UDP datagram;
+ * with MQTT_ENABLE it is published to a broker (mqtt_pub.c); with COAP_ENABLE
+ * /status (with Observe) and /reset are also served over CoAP/UDP (coap.c).
+ * Every edge, reset and boot is appended to a flash event log (evlog.c),
+ * paged out by /events/history?cursor=<seq>&limit=<n>.
+ * POWER_SAVE_ENABLE light-sleeps the chip between events (power.c).
+ * With OTA_ENABLE, POST /ota streams a new image into the idle OTA slot and
+ * reboots into it; an image that never comes up is rolled back (ota.c).
+ * Startup arms the inputs first; mDNS and httpd start on the first IP, with
+ * "boot +N ms" logs marking each phase.
+ *
+ * Configure WiFi and the inputs in doormon_config.h before building.
  */
 
+#include <stdatomic.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include "freertos/event_groups.h"
 #include "esp_system.h"
-#include "esp_wifi.h"
 #include "esp_event.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "esp_netif.h"
 #include "esp_http_server.h"
 #include "nvs.h"
@@ -27,169 +50,174 @@
 #include "mdns.h"
 
 #include "lwip/err.h"
+#include "lwip/sockets.h"
 #include "lwip/sys.h"
 
-/* WiFi – change these for your network */
-#define WIFI_SSID      "Planet Express"
-//#define WIFI_SSID      "FuturePointFactory"
-#define WIFI_PASSWORD  "Kelvinator"
-#define WIFI_CONNECT_TIMEOUT_MS  (60 * 1000)  /* Retry for ~60s at startup, then reboot */
-
-/* Trigger input: GPIO12 (no onboard peripheral on FireBeetle). */
-#define TRIGGER_GPIO   GPIO_NUM_5
-/* GPIO2 drives the onboard blue LED: on when triggered, off when reset. */
-#define LED_GPIO       GPIO_NUM_2
+#include "doormon_config.h"
+#include "buf.h"
+#include "coap.h"
+#include "evlog.h"
+#include "mcast.h"
+#include "metrics.h"
+#include "mqtt_pub.h"
+#include "ota.h"
+#include "power.h"
+#include "trigger.h"
+#include "wifi.h"
 
-#define NVS_NAMESPACE  "doormon"
-#define NVS_KEY_TRIG   "triggered"
+/* event_task notification bits */
+#define EVT_BIT_EDGE       BIT0
+#define EVT_BIT_RESET      BIT1
+#define EVT_BIT_NET_UP     BIT2    /* got an IP: start network services if not yet running */
+#define EVT_BIT_RESTART    BIT3    /* ota.c: save state, flush the event log and restart */
 
-#define MDNS_HOSTNAME  "doormon"
-#define MDNS_INSTANCE  "Doormon"
+/* Largest state object (see state_format_json); per-input part dominates. */
+#define STATE_JSON_MAX     (64 + TRIGGER_NUM_INPUTS * 160)
 
 static const char *TAG = "doormon";
 
-static EventGroupHandle_t s_wifi_event_group;
-#define WIFI_CONNECTED_BIT BIT0
+/* Latched mask last read from / committed to NVS (-1 = unknown). event_task / app_main only. */
+static int64_t s_nvs_shadow = -1;
 
-/* True after first GOT_IP; used to reboot on disconnect (AP lost) instead of retrying. */
-static bool s_wifi_ever_connected;
+/* Consumer of applied edges; woken by trigger.c (EVT_BIT_EDGE) and /reset (EVT_BIT_RESET). */
+static TaskHandle_t s_event_task;
 
-/* Latched trigger state. Written by ISR (true) and /reset (false); read by /status. */
-static volatile bool s_triggered;
+static httpd_handle_t s_httpd;
 
-static void wifi_event_handler(void *arg, esp_event_base_t event_base,
-                               int32_t event_id, void *event_data)
-{
-    if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_START) {
-        esp_wifi_connect();
-    } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED) {
-        if (s_wifi_ever_connected) {
-            ESP_LOGW(TAG, "AP lost, rebooting to reconnect");
-            esp_restart();
-        }
-        esp_wifi_connect();
-        ESP_LOGW(TAG, "connect to AP failed, retrying...");
-    } else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
-        ip_event_got_ip_t *event = (ip_event_got_ip_t *)event_data;
-        ESP_LOGI(TAG, "got ip: " IPSTR, IP2STR(&event->ip_info.ip));
-        s_wifi_ever_connected = true;
-        xEventGroupSetBits(s_wifi_event_group, WIFI_CONNECTED_BIT);
-    }
-}
-
-static bool wifi_init_sta(void)
-{
-    s_wifi_event_group = xEventGroupCreate();
-    s_wifi_ever_connected = false;
-
-    ESP_ERROR_CHECK(esp_netif_init());
-    ESP_ERROR_CHECK(esp_event_loop_create_default());
-    esp_netif_create_default_wifi_sta();
-
-    wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
-    ESP_ERROR_CHECK(esp_wifi_init(&cfg));
-
-    esp_event_handler_instance_t instance_any_id;
-    esp_event_handler_instance_t instance_got_ip;
-    ESP_ERROR_CHECK(esp_event_handler_instance_register(WIFI_EVENT,
-                                                        ESP_EVENT_ANY_ID,
-                                                        &wifi_event_handler,
-                                                        NULL,
-                                                        &instance_any_id));
-    ESP_ERROR_CHECK(esp_event_handler_instance_register(IP_EVENT,
-                                                        IP_EVENT_STA_GOT_IP,
-                                                        &wifi_event_handler,
-                                                        NULL,
-                                                        &instance_got_ip));
-
-    wifi_config_t wifi_config = {
-        .sta = {
-            .threshold.authmode = WIFI_AUTH_WPA2_PSK,
-        },
-    };
-    strncpy((char *)wifi_config.sta.ssid, WIFI_SSID, sizeof(wifi_config.sta.ssid) - 1);
-    strncpy((char *)wifi_config.sta.password, WIFI_PASSWORD, sizeof(wifi_config.sta.password) - 1);
+/* Low 32 bits of the last latching edge's timestamp, for metrics_trigger_push. */
+static atomic_uint s_push_edge_us;
+static atomic_bool s_push_pending;
+
+/* Open /events sockets (-1 = free slot). Only touched from the httpd task. */
+static int s_sse_fds[SSE_MAX_CLIENTS] = { [0 ... SSE_MAX_CLIENTS - 1] = -1 };
 
-    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
-    ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &wifi_config));
-    ESP_ERROR_CHECK(esp_wifi_start());
+/* Parked long-poll requests (req == NULL = free). Only touched from the httpd task. */
+typedef struct {
+    httpd_req_t *req;        /* async copy from httpd_req_async_handler_begin() */
+    uint32_t     since;      /* generation the client already has */
+    int64_t      deadline_us;
+} longpoll_t;
 
-    ESP_LOGI(TAG, "wifi_init_sta done, waiting for AP (up to %d s)...",
-             (int)(WIFI_CONNECT_TIMEOUT_MS / 1000));
+static longpoll_t s_longpoll[LONGPOLL_MAX_CLIENTS];
+static esp_timer_handle_t s_longpoll_timer;
+
+/*
+ * Pre-rendered state, laid out as a complete SSE message so one render serves
+ * both /events (whole buffer) and /status (the JSON body inside it). Re-rendered
+ * only when the state revision or the input levels change. httpd task only.
+ */
+#define SSE_STATE_PREFIX   "event: state\ndata: "
+#define SSE_PREFIX_LEN     (sizeof(SSE_STATE_PREFIX) - 1)
 
-    EventBits_t bits = xEventGroupWaitBits(s_wifi_event_group,
-                                           WIFI_CONNECTED_BIT,
-                                           pdFALSE, pdFALSE,
-                                           pdMS_TO_TICKS(WIFI_CONNECT_TIMEOUT_MS));
+static struct {
+    bool     valid;
+    uint32_t rev;
+    uint32_t levels;
+    int      body_len;           /* JSON body at buf + SSE_PREFIX_LEN */
+    int      msg_len;            /* whole SSE message */
+    char     etag[24];
+    char     buf[SSE_PREFIX_LEN + STATE_JSON_MAX + 3];
+} s_render;
 
-    if (!(bits & WIFI_CONNECTED_BIT)) {
-        ESP_LOGE(TAG, "no connection after %d s, rebooting", (int)(WIFI_CONNECT_TIMEOUT_MS / 1000));
-        esp_restart();
+/* Log a startup milestone as time since the application started. */
+static void boot_phase(const char *phase)
+{
+    ESP_LOGI(TAG, "boot +%lld ms: %s", (long long)(esp_timer_get_time() / 1000), phase);
+}
+
+/* JSON body shared by /status and /events. Depends only on st and levels, so it can be cached. */
+static int state_format_json(char *buf, size_t size, const trigger_state_t *st, uint32_t levels)
+{
+    int n = buf_appendf(buf, size, 0,
+                    "{\"triggered\":%s,\"latched\":%u,\"gen\":%u,\"inputs\":[",
+                    st->latched ? "true" : "false", (unsigned)st->latched, (unsigned)st->gen);
+    for (int i = 0; i < TRIGGER_NUM_INPUTS; i++) {
+        const trigger_input_state_t *in = &st->in[i];
+        n = buf_appendf(buf, size, n,
+                    "%s{\"name\":\"%s\",\"gpio\":%d,\"triggered\":%s,\"level\":%d,"
+                    "\"seq\":%u,\"trigger_ms\":%lld,\"edges\":%u,\"filtered\":%u}",
+                    i ? "," : "", trigger_inputs[i].name, trigger_inputs[i].gpio,
+                    (st->latched & (1u << i)) ? "true" : "false", (levels >> i) & 1,
+                    (unsigned)in->seq, (long long)(in->time_us / 1000),
+                    (unsigned)in->edges, (unsigned)in->filtered);
     }
-    ESP_LOGI(TAG, "connected to SSID:%s", WIFI_SSID);
-    return true;
+    return buf_appendf(buf, size, n, "]}");
 }
 
-static void IRAM_ATTR trigger_isr_handler(void *arg)
+/* Bring s_render up to date with the current state (httpd task only). */
+static void state_render(void)
 {
-    (void)arg;
-    s_triggered = true;
-    gpio_set_level(LED_GPIO, 1);
+    trigger_state_t snap = trigger_snapshot();
+    uint32_t levels = trigger_levels();
+    if (s_render.valid && s_render.rev == snap.rev && s_render.levels == levels) {
+        return;
+    }
+    memcpy(s_render.buf, SSE_STATE_PREFIX, SSE_PREFIX_LEN);
+    size_t size = sizeof(s_render.buf) - SSE_PREFIX_LEN - 2;
+    s_render.body_len = state_format_json(s_render.buf + SSE_PREFIX_LEN, size, &snap, levels);
+    s_render.msg_len = (int)SSE_PREFIX_LEN + s_render.body_len;
+    memcpy(s_render.buf + s_render.msg_len, "\n\n", 2);
+    s_render.msg_len += 2;
+    snprintf(s_render.etag, sizeof(s_render.etag), "\"%x.%x\"", (unsigned)snap.rev, (unsigned)levels);
+    s_render.rev = snap.rev;
+    s_render.levels = levels;
+    s_render.valid = true;
 }
 
-/* Load / save triggered state to NVS so it survives (hot) reboots. */
+/* Load / save the latched mask to NVS so it survives (hot) reboots. */
 static void triggered_nvs_load(void)
 {
     nvs_handle_t h;
     if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &h) != ESP_OK) {
+        s_nvs_shadow = 0;   /* namespace not created yet: nothing stored */
         return;
     }
-    uint8_t v = 0;
-    if (nvs_get_u8(h, NVS_KEY_TRIG, &v) == ESP_OK && v) {
-        s_triggered = true;
-        ESP_LOGI(TAG, "restored triggered state from NVS");
+    uint32_t latched = 0;
+    esp_err_t err = nvs_get_u32(h, NVS_KEY_LATCH, &latched);
+    if (err == ESP_ERR_NVS_NOT_FOUND) {
+        /* Single-input firmware stored a u8 flag for input 0. */
+        uint8_t v = 0;
+        if (nvs_get_u8(h, NVS_KEY_TRIG, &v) == ESP_OK && v) {
+            latched = 1;
+        } else {
+            s_nvs_shadow = 0;
+        }
+    } else if (err == ESP_OK) {
+        s_nvs_shadow = latched;
+    }
+    if (latched) {
+        trigger_restore(latched);
+        ESP_LOGI(TAG, "restored triggered inputs 0x%x from NVS", (unsigned)latched);
     }
     nvs_close(h);
 }
 
-static esp_err_t triggered_nvs_save(bool triggered)
+/* Write only if the value differs from what is known to be in flash. */
+static esp_err_t triggered_nvs_save(uint32_t latched)
 {
+    if (s_nvs_shadow == (int64_t)latched) {
+        return ESP_OK;
+    }
+    int64_t t0 = esp_timer_get_time();
     nvs_handle_t h;
     esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &h);
-    if (err != ESP_OK) {
-        return err;
-    }
-    err = nvs_set_u8(h, NVS_KEY_TRIG, triggered ? 1 : 0);
     if (err == ESP_OK) {
-        err = nvs_commit(h);
-    }
-    nvs_close(h);
-    return err;
-}
-
-static void nvs_sync_task(void *arg)
-{
-    (void)arg;
-    for (;;) {
-        vTaskDelay(pdMS_TO_TICKS(1000));
-        if (s_triggered) {
-            (void)triggered_nvs_save(true);
+        err = nvs_set_u32(h, NVS_KEY_LATCH, latched);
+        if (err == ESP_OK) {
+            err = nvs_commit(h);
         }
+        nvs_close(h);
+    }
+    metrics_observe(&metrics_nvs_commit, (uint32_t)(esp_timer_get_time() - t0));
+    if (err != ESP_OK) {
+        atomic_fetch_add_explicit(&metrics_nvs_errors, 1, memory_order_relaxed);
     }
+    s_nvs_shadow = (err == ESP_OK) ? (int64_t)latched : -1;
+    return err;
 }
 
-static void trigger_gpio_init(void)
+static void led_gpio_init(void)
 {
-    /* Trigger input: falling edge latches triggered state. */
-    gpio_config_t trigger_io = {
-        .pin_bit_mask = (1ULL << TRIGGER_GPIO),
-        .mode         = GPIO_MODE_INPUT,
-        .pull_up_en   = GPIO_PULLUP_DISABLE,
-        .pull_down_en = GPIO_PULLDOWN_DISABLE,
-        .intr_type    = GPIO_INTR_NEGEDGE,
-    };
-    ESP_ERROR_CHECK(gpio_config(&trigger_io));
-
     /* LED output (GPIO2 = onboard blue LED): on when triggered, off when reset. */
     gpio_config_t led_io = {
         .pin_bit_mask = (1ULL << LED_GPIO),
@@ -199,33 +227,489 @@ static void trigger_gpio_init(void)
         .intr_type    = GPIO_INTR_DISABLE,
     };
     ESP_ERROR_CHECK(gpio_config(&led_io));
-    gpio_set_level(LED_GPIO, s_triggered ? 1 : 0);
+    gpio_set_level(LED_GPIO, trigger_snapshot().latched ? 1 : 0);
+}
 
-    ESP_ERROR_CHECK(gpio_install_isr_service(0));
-    ESP_ERROR_CHECK(gpio_isr_handler_add(TRIGGER_GPIO, trigger_isr_handler, NULL));
-    ESP_LOGI(TAG, "trigger GPIO %d, LED GPIO %d (falling-edge latch, LED = triggered)",
-             TRIGGER_GPIO, LED_GPIO);
+/* Send to one /events subscriber; drop it if the socket is gone. */
+static void sse_send(httpd_handle_t hd, int slot, const char *msg, size_t len)
+{
+    int fd = s_sse_fds[slot];
+    if (httpd_socket_send(hd, fd, msg, len, 0) < 0) {
+        s_sse_fds[slot] = -1;
+        httpd_sess_trigger_close(hd, fd);
+    }
 }
 
-static esp_err_t status_get_handler(httpd_req_t *req)
+/* Send the pre-rendered state; 304 if the client's If-None-Match already names it. */
+static esp_err_t status_send(httpd_req_t *req)
 {
-    bool t = s_triggered;
-    char body[32];
-    snprintf(body, sizeof(body), "{\"triggered\":%s}", t ? "true" : "false");
+    static bool served;
+    if (!served) {
+        served = true;
+        boot_phase("first /status served");
+    }
+    state_render();
 
+    char uptime[21];
+    snprintf(uptime, sizeof(uptime), "%lld", (long long)(esp_timer_get_time() / 1000));
+    httpd_resp_set_hdr(req, "ETag", s_render.etag);
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+    httpd_resp_set_hdr(req, "X-Uptime-Ms", uptime);
+
+    char inm[64];
+    if (httpd_req_get_hdr_value_str(req, "If-None-Match", inm, sizeof(inm)) == ESP_OK &&
+        strstr(inm, s_render.etag) != NULL) {
+        httpd_resp_set_status(req, "304 Not Modified");
+        return httpd_resp_send(req, NULL, 0);
+    }
     httpd_resp_set_type(req, "application/json");
-    httpd_resp_send(req, body, strlen(body));
+    return httpd_resp_send(req, s_render.buf + SSE_PREFIX_LEN, s_render.body_len);
+}
+
+/*
+ * httpd task: answer parked long-polls whose generation is stale or whose wait
+ * has expired, then arm s_longpoll_timer for the earliest remaining deadline.
+ */
+static void longpoll_service(void)
+{
+    uint32_t gen = trigger_snapshot().gen;
+    int64_t now = esp_timer_get_time();
+    int64_t next = INT64_MAX;
+    for (int i = 0; i < LONGPOLL_MAX_CLIENTS; i++) {
+        longpoll_t *lp = &s_longpoll[i];
+        if (!lp->req) {
+            continue;
+        }
+        if (lp->since != gen || now >= lp->deadline_us) {
+            (void)status_send(lp->req);
+            httpd_req_async_handler_complete(lp->req);
+            lp->req = NULL;
+        } else if (lp->deadline_us < next) {
+            next = lp->deadline_us;
+        }
+    }
+    esp_timer_stop(s_longpoll_timer);
+    if (next != INT64_MAX) {
+        esp_timer_start_once(s_longpoll_timer, (uint64_t)(next - now));
+    }
+}
+
+static void longpoll_work(void *arg)
+{
+    (void)arg;
+    longpoll_service();
+}
+
+static void longpoll_timer_cb(void *arg)
+{
+    (void)arg;
+    if (s_httpd) {
+        httpd_queue_work(s_httpd, longpoll_work, NULL);
+    }
+}
+
+/* httpd work item (runs in the httpd task): push state, or a keepalive comment if arg is NULL. */
+static void sse_broadcast_work(void *arg)
+{
+    static const char keepalive[] = ": keepalive\n\n";
+    const char *msg = keepalive;
+    size_t len = sizeof(keepalive) - 1;
+    if (arg) {
+        state_render();
+        msg = s_render.buf;
+        len = (size_t)s_render.msg_len;
+    }
+    for (int i = 0; i < SSE_MAX_CLIENTS; i++) {
+        if (s_sse_fds[i] >= 0) {
+            sse_send(s_httpd, i, msg, len);
+        }
+    }
+    if (arg) {
+        longpoll_service();
+        if (atomic_exchange(&s_push_pending, false)) {
+            uint32_t edge_us = atomic_load_explicit(&s_push_edge_us, memory_order_relaxed);
+            metrics_observe(&metrics_trigger_push, (uint32_t)esp_timer_get_time() - edge_us);
+        }
+    }
+}
+
+#if MQTT_ENABLE
+/* MQTT_TOPIC_BASE/event payloads. event_task only. */
+static void mqtt_event_trigger(const trigger_edge_t *e)
+{
+    char msg[MQTT_EVENT_MAX];
+    snprintf(msg, sizeof(msg),
+             "{\"event\":\"trigger\",\"input\":\"%s\",\"seq\":%u,\"trigger_ms\":%lld,\"gen\":%u}",
+             trigger_inputs[e->input].name, (unsigned)e->seq, (long long)(e->time_us / 1000),
+             (unsigned)trigger_snapshot().gen);
+    mqtt_pub_event(msg);
+}
+
+static void mqtt_event_reset(void)
+{
+    char msg[MQTT_EVENT_MAX];
+    trigger_state_t snap = trigger_snapshot();
+    snprintf(msg, sizeof(msg), "{\"event\":\"reset\",\"latched\":%u,\"gen\":%u,\"uptime_ms\":%lld}",
+             (unsigned)snap.latched, (unsigned)snap.gen, (long long)(esp_timer_get_time() / 1000));
+    mqtt_pub_event(msg);
+}
+
+/* Retained MQTT_TOPIC_BASE/state, same body as /status. event_task only. */
+static void mqtt_state_publish(const trigger_state_t *st)
+{
+    static char json[STATE_JSON_MAX];
+    state_format_json(json, sizeof(json), st, trigger_levels());
+    mqtt_pub_state(json);
+}
+#else
+static void mqtt_event_trigger(const trigger_edge_t *e) { (void)e; }
+static void mqtt_event_reset(void) { }
+static void mqtt_state_publish(const trigger_state_t *st) { (void)st; }
+#endif
+
+/* Ticks from now until deadline, clamped at 0 (wrap-safe). */
+static TickType_t ticks_until(TickType_t deadline, TickType_t now)
+{
+    int32_t d = (int32_t)(deadline - now);
+    return d > 0 ? (TickType_t)d : 0;
+}
+
+static httpd_handle_t start_httpd(void);
+static bool reset_inputs(const char *input);
+
+/*
+ * triggered=0|1 (any input latched) and seq=<gen> in the _http._tcp TXT record, so an mDNS
+ * browser sees transitions without polling HTTP. Non-blocking: the mDNS task applies and
+ * announces them, merging a burst into one announcement. No-op until mDNS is up.
+ */
+static void mdns_state_publish(const trigger_state_t *st)
+{
+    char seq[11];
+    snprintf(seq, sizeof(seq), "%u", (unsigned)st->gen);
+    mdns_service_txt_item_set_async("_http", "_tcp", "triggered", st->latched ? "1" : "0");
+    mdns_service_txt_item_set_async("_http", "_tcp", "seq", seq);
+}
+
+/* coap.c: the /status body, validated by state revision and input levels. coap or event task. */
+static int coap_state(char *buf, size_t size, uint8_t etag[8])
+{
+    trigger_state_t snap = trigger_snapshot();
+    uint32_t levels = trigger_levels();
+    memcpy(etag, &snap.rev, 4);
+    memcpy(etag + 4, &levels, 4);
+    return state_format_json(buf, size, &snap, levels);
+}
+
+/* First IP: bring up mDNS and httpd. Runs once, in event_task; both survive later reconnects. */
+static void net_services_start(void)
+{
+    boot_phase("got ip");
+    if (start_httpd()) {
+        ota_confirm();   /* this image serves HTTP: keep it */
+    }
+    boot_phase("httpd ready");
+
+    /* mDNS: advertise as doormon.local and _http._tcp on port 80, with the state in TXT */
+    esp_err_t err = mdns_init();
+    if (err == ESP_OK) {
+        trigger_state_t snap = trigger_snapshot();
+        char seq[11];
+        snprintf(seq, sizeof(seq), "%u", (unsigned)snap.gen);
+        mdns_txt_item_t txt[] = {
+            { "triggered", snap.latched ? "1" : "0" },
+            { "seq", seq },
+        };
+        mdns_hostname_set(MDNS_HOSTNAME);
+        mdns_instance_name_set(MDNS_INSTANCE);
+        mdns_service_add(NULL, "_http", "_tcp", 80, txt, sizeof(txt) / sizeof(txt[0]));
+        ESP_LOGI(TAG, "mDNS: %s.local (_http._tcp port 80)", MDNS_HOSTNAME);
+    } else {
+        ESP_LOGW(TAG, "mDNS init failed: %s", esp_err_to_name(err));
+    }
+    boot_phase("mdns ready");
+
+    mcast_init();
+    mqtt_pub_init(reset_inputs);
+    coap_init(coap_state, reset_inputs);
+}
+
+/*
+ * Single consumer of the edge ring. Latches state and fans each transition out
+ * to the LED, multicast, NVS and /events; sends /events keepalives when idle.
+ * NVS writes are deferred until NVS_COALESCE_MS after the first unsaved
+ * transition, so a burst costs at most one commit (none if it ends where it began).
+ */
+static void event_task(void *arg)
+{
+    (void)arg;
+    uint32_t dropped_seen = 0;
+    bool nvs_pending = false;
+    TickType_t nvs_due = 0;
+    TickType_t keepalive_due = xTaskGetTickCount() + pdMS_TO_TICKS(SSE_KEEPALIVE_MS);
+    for (;;) {
+        TickType_t now = xTaskGetTickCount();
+        TickType_t wait = ticks_until(keepalive_due, now);
+        if (nvs_pending && ticks_until(nvs_due, now) < wait) {
+            wait = ticks_until(nvs_due, now);
+        }
+        TickType_t evlog_wait = evlog_service();   /* full pages now, the rest once EVLOG_FLUSH_MS old */
+        if (evlog_wait < wait) {
+            wait = evlog_wait;
+        }
+        uint32_t bits = 0;
+        xTaskNotifyWait(0, UINT32_MAX, &bits, wait);
+
+        if (bits & EVT_BIT_RESTART) {
+            triggered_nvs_save(trigger_snapshot().latched);   /* also covers edges not yet popped */
+            evlog_flush();
+            ESP_LOGW(TAG, "restarting");
+            esp_restart();
+        }
+        if ((bits & EVT_BIT_NET_UP) && !s_httpd) {
+            net_services_start();
+        }
+
+        bool changed = (bits & EVT_BIT_RESET) != 0;
+        if (changed) {
+            mqtt_event_reset();
+        }
+        int64_t report_edge_us = INT64_MAX;   /* oldest edge latched in this batch */
+        trigger_event_t ev;
+        while (trigger_event_pop(&ev)) {
+            const trigger_edge_t e = ev.edge;
+            evlog_append(ev.latched ? EVLOG_TRIGGER : EVLOG_EDGE, e.input, e.seq, e.time_us);
+            if (ev.latched) {
+                ESP_LOGI(TAG, "%s triggered (edge #%u at %lld ms)", trigger_inputs[e.input].name,
+                         (unsigned)e.seq, (long long)(e.time_us / 1000));
+                mqtt_event_trigger(&e);
+                atomic_store_explicit(&s_push_edge_us, (uint32_t)e.time_us, memory_order_relaxed);
+                if (e.time_us < report_edge_us) {
+                    report_edge_us = e.time_us;
+                }
+                atomic_store(&s_push_pending, true);
+                changed = true;
+            } else {
+                ESP_LOGD(TAG, "%s edge #%u at %lld ms (already latched)", trigger_inputs[e.input].name,
+                         (unsigned)e.seq, (long long)(e.time_us / 1000));
+            }
+        }
+
+        uint32_t dropped = trigger_dropped();
+        if (dropped != dropped_seen) {
+            ESP_LOGW(TAG, "edge ring overflow, %u edges dropped", (unsigned)(dropped - dropped_seen));
+            dropped_seen = dropped;
+        }
+
+        now = xTaskGetTickCount();
+        if (changed) {
+            trigger_state_t snap = trigger_snapshot();
+            mcast_publish(&snap, trigger_levels());
+            mqtt_state_publish(&snap);
+            mdns_state_publish(&snap);
+            coap_notify();
+            if (report_edge_us != INT64_MAX) {
+                uint32_t us = (uint32_t)(esp_timer_get_time() - report_edge_us);
+                metrics_observe(&metrics_trigger_report, us);
+                if (us > POWER_REPORT_TARGET_MS * 1000u) {
+                    atomic_fetch_add_explicit(&metrics_reports_over_target, 1, memory_order_relaxed);
+                }
+            }
+            gpio_set_level(LED_GPIO, snap.latched ? 1 : 0);
+            if (!nvs_pending) {
+                nvs_pending = true;
+                nvs_due = now + pdMS_TO_TICKS(NVS_COALESCE_MS);
+            }
+        }
+        if (nvs_pending && ticks_until(nvs_due, now) == 0) {
+            esp_err_t err = triggered_nvs_save(trigger_snapshot().latched);
+            if (err == ESP_OK) {
+                nvs_pending = false;
+            } else {
+                ESP_LOGW(TAG, "NVS save failed: %s, retrying", esp_err_to_name(err));
+                nvs_due = now + pdMS_TO_TICKS(NVS_RETRY_MS);
+            }
+        }
+
+        bool keepalive = ticks_until(keepalive_due, now) == 0;
+        if (changed || keepalive) {
+            keepalive_due = now + pdMS_TO_TICKS(SSE_KEEPALIVE_MS);
+            if (s_httpd) {
+                httpd_queue_work(s_httpd, sse_broadcast_work, changed ? (void *)1 : NULL);
+            }
+        }
+    }
+}
+
+/* trigger.c latch callback, trigger task: the LED goes on without waiting for event_task. */
+static void trigger_latched(const trigger_edge_t *e)
+{
+    gpio_set_level(LED_GPIO, 1);
+    metrics_observe(&metrics_trigger_latch, (uint32_t)(esp_timer_get_time() - e->time_us));
+}
+
+/* ota.c callback: restart from event_task, so the latched state and the event log are saved first. */
+static void request_restart(void)
+{
+    xTaskNotify(s_event_task, EVT_BIT_RESTART, eSetBits);
+}
+
+/* wifi.c callback, event loop task: hand the start-up work to event_task. */
+static void wifi_got_ip(void)
+{
+    xTaskNotify(s_event_task, EVT_BIT_NET_UP, eSetBits);
+}
+
+/*
+ * Called by httpd for each accepted socket. httpd writes headers and body
+ * separately; with Nagle on, the body waits for the client's delayed ACK of
+ * the headers (~40 ms) on every request after the first on a keep-alive
+ * connection.
+ */
+static esp_err_t httpd_open_fn(httpd_handle_t hd, int sockfd)
+{
+    (void)hd;
+    int one = 1;
+    setsockopt(sockfd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return ESP_OK;
+}
+
+/* Called by httpd when a session closes; releases the /events slot if it was one. */
+static void httpd_close_fn(httpd_handle_t hd, int sockfd)
+{
+    (void)hd;
+    for (int i = 0; i < SSE_MAX_CLIENTS; i++) {
+        if (s_sse_fds[i] == sockfd) {
+            s_sse_fds[i] = -1;
+        }
+    }
+    close(sockfd);
+}
+
+/* GET /events: hold the socket open as a text/event-stream and push each state change. */
+static esp_err_t events_get_handler(httpd_req_t *req)
+{
+    int slot = -1;
+    for (int i = 0; i < SSE_MAX_CLIENTS; i++) {
+        if (s_sse_fds[i] < 0) {
+            slot = i;
+            break;
+        }
+    }
+    if (slot < 0) {
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        httpd_resp_set_type(req, "application/json");
+        httpd_resp_sendstr(req, "{\"error\":\"too many event clients\"}");
+        return ESP_OK;
+    }
+
+    /* Raw headers: httpd_resp_* would terminate the response. */
+    static const char hdr[] = "HTTP/1.1 200 OK\r\n"
+                              "Content-Type: text/event-stream\r\n"
+                              "Cache-Control: no-cache\r\n"
+                              "Connection: keep-alive\r\n"
+                              "\r\n"
+                              "retry: 2000\n\n";
+    if (httpd_send(req, hdr, sizeof(hdr) - 1) < 0) {
+        return ESP_FAIL;
+    }
+    s_sse_fds[slot] = httpd_req_to_sockfd(req);
+
+    state_render();
+    sse_send(req->handle, slot, s_render.buf, (size_t)s_render.msg_len);
+    return ESP_OK;
+}
+
+/* status_send() for an immediate answer, recorded in metrics_http_status. */
+static esp_err_t status_send_timed(httpd_req_t *req, int64_t t0)
+{
+    esp_err_t err = status_send(req);
+    metrics_observe(&metrics_http_status, (uint32_t)(esp_timer_get_time() - t0));
+    return err;
+}
+
+/*
+ * GET /status answers immediately. With ?since=<gen>&wait=<s> and gen still
+ * current, the request is detached from the worker (async handler) and parked
+ * until the generation changes or the wait expires; then the same body is sent.
+ */
+static esp_err_t status_get_handler(httpd_req_t *req)
+{
+    int64_t t0 = esp_timer_get_time();
+    char query[48];
+    char val[12];
+    bool has_since = false;
+    uint32_t since = 0;
+    uint32_t wait_s = 0;
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK) {
+        if (httpd_query_key_value(query, "since", val, sizeof(val)) == ESP_OK) {
+            since = strtoul(val, NULL, 10);
+            has_since = true;
+        }
+        if (httpd_query_key_value(query, "wait", val, sizeof(val)) == ESP_OK) {
+            wait_s = strtoul(val, NULL, 10);
+        }
+    }
+    if (wait_s > LONGPOLL_MAX_WAIT_S) {
+        wait_s = LONGPOLL_MAX_WAIT_S;
+    }
+
+    if (!has_since || wait_s == 0 || since != trigger_snapshot().gen) {
+        return status_send_timed(req, t0);
+    }
+
+    longpoll_t *lp = NULL;
+    for (int i = 0; i < LONGPOLL_MAX_CLIENTS; i++) {
+        if (!s_longpoll[i].req) {
+            lp = &s_longpoll[i];
+            break;
+        }
+    }
+    if (!lp || httpd_req_async_handler_begin(req, &lp->req) != ESP_OK) {
+        return status_send_timed(req, t0);   /* no slot: degrade to a plain poll */
+    }
+    lp->since = since;
+    lp->deadline_us = esp_timer_get_time() + (int64_t)wait_s * 1000000;
+    /* The generation may have moved while we parked; service re-checks and arms the timer. */
+    longpoll_service();
     return ESP_OK;
 }
 
+/* Clear one input by name, or all when input is NULL. Shared by /reset and the MQTT command topic. */
+static bool reset_inputs(const char *input)
+{
+    uint32_t mask = TRIGGER_ALL_INPUTS;
+    uint8_t index = EVLOG_INPUT_NONE;
+    if (input) {
+        int i = trigger_find_input(input);
+        if (i < 0) {
+            return false;
+        }
+        mask = 1u << i;
+        index = (uint8_t)i;
+    }
+    evlog_append(EVLOG_RESET, index, trigger_snapshot().latched & mask, esp_timer_get_time());
+    trigger_reset(mask);
+    if (s_event_task) {
+        xTaskNotify(s_event_task, EVT_BIT_RESET, eSetBits);
+    }
+    return true;
+}
+
+/* /reset clears every input; /reset?input=<name> clears one. */
 static esp_err_t reset_post_handler(httpd_req_t *req)
 {
-    (void)req;
-    s_triggered = false;
-    gpio_set_level(LED_GPIO, 0);
-    (void)triggered_nvs_save(false);
-    httpd_resp_set_type(req, "application/json");
-    httpd_resp_sendstr(req, "{\"reset\":true}");
+    int64_t t0 = esp_timer_get_time();
+    char query[64];
+    char name[32];
+    bool named = httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+                 httpd_query_key_value(query, "input", name, sizeof(name)) == ESP_OK;
+    if (!reset_inputs(named ? name : NULL)) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "unknown input");
+    } else {
+        httpd_resp_set_type(req, "application/json");
+        httpd_resp_sendstr(req, "{\"reset\":true}");
+    }
+    metrics_observe(&metrics_http_reset, (uint32_t)(esp_timer_get_time() - t0));
     return ESP_OK;
 }
 
@@ -234,11 +718,337 @@ static esp_err_t reset_get_handler(httpd_req_t *req)
     return reset_post_handler(req);
 }
 
+/* Records read from the log per /events/history chunk. */
+#define HISTORY_BATCH  8
+
+/* One /events/history record. */
+static int history_format_rec(char *buf, size_t size, int n, const evlog_rec_t *r)
+{
+    static const char *const kinds[] = { "boot", "trigger", "edge", "reset" };
+    const char *input = r->input < TRIGGER_NUM_INPUTS ? trigger_inputs[r->input].name : NULL;
+    n = buf_appendf(buf, size, n, "{\"seq\":%u,\"boot\":%u,\"uptime_ms\":%u,\"event\":\"%s\"",
+                (unsigned)r->seq, (unsigned)r->boot, (unsigned)r->time_ms,
+                r->kind < sizeof(kinds) / sizeof(kinds[0]) ? kinds[r->kind] : "unknown");
+    switch (r->kind) {
+    case EVLOG_TRIGGER:
+    case EVLOG_EDGE:
+        return buf_appendf(buf, size, n, ",\"input\":\"%s\",\"edge\":%u}", input ? input : "?", (unsigned)r->arg);
+    case EVLOG_RESET:
+        if (input) {
+            n = buf_appendf(buf, size, n, ",\"input\":\"%s\"", input);
+        }
+        return buf_appendf(buf, size, n, ",\"cleared\":%u}", (unsigned)r->arg);
+    case EVLOG_BOOT:
+        return buf_appendf(buf, size, n, ",\"latched\":%u}", (unsigned)r->arg);
+    default:
+        return buf_appendf(buf, size, n, "}");
+    }
+}
+
+/*
+ * GET /events/history?cursor=<seq>&limit=<n>: up to limit logged events from
+ * seq cursor on (default and minimum: the oldest kept), oldest first. Read
+ * from flash HISTORY_BATCH records at a time and sent as chunks; "next" is
+ * the cursor for the following page and "more" says whether it has records.
+ */
+static esp_err_t history_get_handler(httpd_req_t *req)
+{
+    static char buf[HISTORY_BATCH * 160];   /* httpd task only */
+    evlog_info_t info;
+    evlog_get_info(&info);
+    if (!info.ready) {
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        httpd_resp_set_type(req, "application/json");
+        return httpd_resp_sendstr(req, "{\"error\":\"event log unavailable\"}");
+    }
+
+    char query[48];
+    char val[12];
+    uint32_t cursor = info.first;
+    uint32_t limit = EVLOG_PAGE_DEFAULT;
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK) {
+        if (httpd_query_key_value(query, "cursor", val, sizeof(val)) == ESP_OK) {
+            cursor = strtoul(val, NULL, 10);
+        }
+        if (httpd_query_key_value(query, "limit", val, sizeof(val)) == ESP_OK) {
+            limit = strtoul(val, NULL, 10);
+        }
+    }
+    if ((int32_t)(cursor - info.first) < 0) {
+        cursor = info.first;   /* already overwritten */
+    }
+    if (limit < 1) {
+        limit = 1;
+    } else if (limit > EVLOG_PAGE_MAX) {
+        limit = EVLOG_PAGE_MAX;
+    }
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+    int n = buf_appendf(buf, sizeof(buf), 0, "{\"boot\":%u,\"first\":%u,\"head\":%u,\"records\":[",
+                    (unsigned)info.boot, (unsigned)info.first, (unsigned)info.head);
+    bool more = true;
+    for (uint32_t sent = 0; sent < limit;) {
+        evlog_rec_t recs[HISTORY_BATCH];
+        size_t want = limit - sent < HISTORY_BATCH ? limit - sent : HISTORY_BATCH;
+        size_t got = evlog_read(cursor, recs, want);
+        for (size_t i = 0; i < got; i++) {
+            n = buf_appendf(buf, sizeof(buf), n, "%s", sent + i ? "," : "");
+            n = history_format_rec(buf, sizeof(buf), n, &recs[i]);
+        }
+        if (got) {
+            cursor = recs[got - 1].seq + 1;
+            sent += got;
+        }
+        if (httpd_resp_send_chunk(req, buf, n) != ESP_OK) {
+            return ESP_FAIL;
+        }
+        n = 0;
+        if (got < want) {
+            more = false;
+            break;
+        }
+    }
+    if (more) {
+        evlog_rec_t peek;
+        more = evlog_read(cursor, &peek, 1) == 1;
+    }
+    n = buf_appendf(buf, sizeof(buf), 0, "],\"next\":%u,\"more\":%s}", (unsigned)cursor, more ? "true" : "false");
+    httpd_resp_send_chunk(req, buf, n);
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+#if METRICS_ENABLE
+/* Tasks whose stack high-water mark is exported; missing ones are skipped. */
+static const char *const s_metrics_tasks[] = {
+    "trigger", "event", "httpd", "esp_timer", "sys_evt", "tiT", "wifi", "mdns", "mqtt_task", "coap",
+};
+
+/* Send what is in buf as one chunk and start over. An empty chunk would end the response. */
+static void metrics_flush(httpd_req_t *req, char *buf, int *n)
+{
+    if (*n > 0) {
+        httpd_resp_send_chunk(req, buf, *n);
+    }
+    *n = 0;
+}
+
+/* mDNS TX block pool usage; size the pools (CONFIG_MDNS_MEMORY_POOL_*) by the high water. */
+static int metrics_format_mdns_pools(char *buf, size_t size, int n)
+{
+    static const char *const names[MDNS_MEM_POOL_MAX] = { "packet", "answer", "question" };
+    mdns_mem_pool_stats_t ps[MDNS_MEM_POOL_MAX];
+    for (int i = 0; i < MDNS_MEM_POOL_MAX; i++) {
+        if (mdns_mem_pool_get_stats(i, &ps[i]) != ESP_OK) {
+            return n;   /* mDNS not running */
+        }
+    }
+    n = buf_appendf(buf, size, n, "# HELP doormon_mdns_pool_high_water Most mDNS TX blocks in use at once.\n"
+                          "# TYPE doormon_mdns_pool_high_water gauge\n");
+    for (int i = 0; i < MDNS_MEM_POOL_MAX; i++) {
+        n = buf_appendf(buf, size, n, "doormon_mdns_pool_high_water{pool=\"%s\"} %u\n",
+                    names[i], (unsigned)ps[i].high_water);
+    }
+    n = buf_appendf(buf, size, n, "# HELP doormon_mdns_pool_heap_allocs_total mDNS TX blocks taken from the heap, pool full.\n"
+                          "# TYPE doormon_mdns_pool_heap_allocs_total counter\n");
+    for (int i = 0; i < MDNS_MEM_POOL_MAX; i++) {
+        n = buf_appendf(buf, size, n, "doormon_mdns_pool_heap_allocs_total{pool=\"%s\"} %u\n",
+                    names[i], (unsigned)ps[i].heap_allocs);
+    }
+    return n;
+}
+
+/* mDNS scheduled sends: drops mean a down interface or failed write, deferrals a full action queue. */
+static int metrics_format_mdns_tx(char *buf, size_t size, int n)
+{
+    mdns_tx_stats_t ts;
+    if (mdns_tx_get_stats(&ts) != ESP_OK) {
+        return n;
+    }
+    return buf_appendf(buf, size, n,
+                   "# TYPE doormon_mdns_tx_sent_total counter\n"
+                   "doormon_mdns_tx_sent_total %u\n"
+                   "# TYPE doormon_mdns_tx_dropped_total counter\n"
+                   "doormon_mdns_tx_dropped_total %u\n"
+                   "# TYPE doormon_mdns_tx_deferred_total counter\n"
+                   "doormon_mdns_tx_deferred_total %u\n",
+                   (unsigned)ts.sent, (unsigned)ts.dropped, (unsigned)ts.deferred);
+}
+
+/* Trigger task pick-up latency (edge queued to handled), min/avg/max since boot. */
+static int metrics_format_trigger_latency(char *buf, size_t size, int n)
+{
+    trigger_latency_t lat;
+    trigger_get_latency(&lat);
+    if (lat.count == 0) {
+        return n;
+    }
+    uint32_t stat_us[] = { lat.min_us, (uint32_t)(lat.sum_us / lat.count), lat.max_us };
+    static const char *const stat_name[] = { "min", "avg", "max" };
+    n = buf_appendf(buf, size, n,
+                "# HELP doormon_trigger_handler_latency_seconds Edge queued by the ISR or filter to handled by the trigger task.\n"
+                "# TYPE doormon_trigger_handler_latency_seconds gauge\n");
+    for (int i = 0; i < 3; i++) {
+        n = buf_appendf(buf, size, n, "doormon_trigger_handler_latency_seconds{stat=\"%s\"} %u.%06u\n",
+                    stat_name[i], (unsigned)(stat_us[i] / 1000000), (unsigned)(stat_us[i] % 1000000));
+    }
+    return buf_appendf(buf, size, n,
+                   "# TYPE doormon_trigger_handled_edges_total counter\n"
+                   "doormon_trigger_handled_edges_total %u\n", (unsigned)lat.count);
+}
+
+/* Low-power mode: light sleeps, time asleep and the modelled average current. */
+static int metrics_format_power(char *buf, size_t size, int n)
+{
+    power_stats_t ps;
+    power_get_stats(&ps);
+    if (!ps.enabled) {
+        return n;
+    }
+    return buf_appendf(buf, size, n,
+                   "# TYPE doormon_power_light_sleeps_total counter\n"
+                   "doormon_power_light_sleeps_total %u\n"
+                   "# TYPE doormon_power_light_sleep_seconds_total counter\n"
+                   "doormon_power_light_sleep_seconds_total %llu.%06u\n"
+                   "# HELP doormon_power_modelled_current_amperes Modelled, not measured: average since boot from sleep time and POWER_*_UA.\n"
+                   "# TYPE doormon_power_modelled_current_amperes gauge\n"
+                   "doormon_power_modelled_current_amperes %u.%06u\n",
+                   (unsigned)ps.sleeps, (unsigned long long)(ps.sleep_us / 1000000),
+                   (unsigned)(ps.sleep_us % 1000000), (unsigned)(ps.avg_ua / 1000000),
+                   (unsigned)(ps.avg_ua % 1000000));
+}
+
+/* Event log: records held, flash traffic, and records lost to a full buffer or flash errors. */
+static int metrics_format_evlog(char *buf, size_t size, int n)
+{
+    evlog_info_t info;
+    evlog_get_info(&info);
+    if (!info.ready) {
+        return n;
+    }
+    return buf_appendf(buf, size, n,
+                   "# TYPE doormon_evlog_records gauge\n"
+                   "doormon_evlog_records %u\n"
+                   "# TYPE doormon_evlog_flash_writes_total counter\n"
+                   "doormon_evlog_flash_writes_total %u\n"
+                   "# TYPE doormon_evlog_sector_erases_total counter\n"
+                   "doormon_evlog_sector_erases_total %u\n"
+                   "# TYPE doormon_evlog_records_lost_total counter\n"
+                   "doormon_evlog_records_lost_total %u\n",
+                   (unsigned)(info.head - info.first), (unsigned)info.writes,
+                   (unsigned)info.erases, (unsigned)info.lost);
+}
+
+/* Prometheus text exposition; each section goes out as its own chunk. */
+static esp_err_t metrics_get_handler(httpd_req_t *req)
+{
+    static char buf[1536];   /* httpd task only */
+    int n = 0;
+    httpd_resp_set_type(req, "text/plain; version=0.0.4");
+
+    n = metrics_format_hist(buf, sizeof(buf), n, "doormon_http_request_duration_seconds",
+                            "Service time of /status (without long-poll waits) and /reset.",
+                            "path=\"/status\"", &metrics_http_status);
+    metrics_flush(req, buf, &n);
+    n = metrics_format_hist(buf, sizeof(buf), n, "doormon_http_request_duration_seconds", NULL,
+                            "path=\"/reset\"", &metrics_http_reset);
+    metrics_flush(req, buf, &n);
+    n = metrics_format_hist(buf, sizeof(buf), n, "doormon_trigger_latch_seconds",
+                            "Edge timestamp to latched in the state table (visible to /status).",
+                            "", &metrics_trigger_latch);
+    metrics_flush(req, buf, &n);
+    n = metrics_format_hist(buf, sizeof(buf), n, "doormon_trigger_push_seconds",
+                            "Edge timestamp to sent to /events and long-poll clients.",
+                            "", &metrics_trigger_push);
+    metrics_flush(req, buf, &n);
+    n = metrics_format_hist(buf, sizeof(buf), n, "doormon_trigger_report_seconds",
+                            "Edge timestamp to handed to multicast, MQTT, mDNS and CoAP.",
+                            "", &metrics_trigger_report);
+    metrics_flush(req, buf, &n);
+    n = metrics_format_hist(buf, sizeof(buf), n, "doormon_nvs_commit_seconds",
+                            "Latched-state NVS write (open, set, commit).", "", &metrics_nvs_commit);
+    n = buf_appendf(buf, sizeof(buf), n,
+                "# TYPE doormon_nvs_commit_errors_total counter\n"
+                "doormon_nvs_commit_errors_total %u\n"
+                "# TYPE doormon_trigger_edges_dropped_total counter\n"
+                "doormon_trigger_edges_dropped_total %u\n"
+                "# HELP doormon_trigger_reports_over_target_total Reports slower than POWER_REPORT_TARGET_MS (counted, not prevented).\n"
+                "# TYPE doormon_trigger_reports_over_target_total counter\n"
+                "doormon_trigger_reports_over_target_total %u\n",
+                (unsigned)atomic_load_explicit(&metrics_nvs_errors, memory_order_relaxed),
+                (unsigned)trigger_dropped(),
+                (unsigned)atomic_load_explicit(&metrics_reports_over_target, memory_order_relaxed));
+    metrics_flush(req, buf, &n);
+    n = metrics_format_trigger_latency(buf, sizeof(buf), n);
+    n = metrics_format_power(buf, sizeof(buf), n);
+    metrics_flush(req, buf, &n);
+
+    wifi_stats_t ws;
+    wifi_get_stats(&ws);
+    n = buf_appendf(buf, sizeof(buf), n,
+                "# TYPE doormon_uptime_seconds gauge\n"
+                "doormon_uptime_seconds %lld\n"
+                "# TYPE doormon_heap_free_bytes gauge\n"
+                "doormon_heap_free_bytes %u\n"
+                "# TYPE doormon_heap_min_free_bytes gauge\n"
+                "doormon_heap_min_free_bytes %u\n"
+                "# TYPE doormon_wifi_connected gauge\n"
+                "doormon_wifi_connected %d\n"
+                "# TYPE doormon_wifi_disconnects_total counter\n"
+                "doormon_wifi_disconnects_total %u\n"
+                "# TYPE doormon_wifi_reconnects_total counter\n"
+                "doormon_wifi_reconnects_total %u\n",
+                (long long)(esp_timer_get_time() / 1000000),
+                (unsigned)esp_get_free_heap_size(), (unsigned)esp_get_minimum_free_heap_size(),
+                ws.connected ? 1 : 0, (unsigned)ws.disconnects, (unsigned)ws.reconnects);
+    if (ws.connected) {
+        n = buf_appendf(buf, sizeof(buf), n, "# TYPE doormon_wifi_rssi_dbm gauge\ndoormon_wifi_rssi_dbm %d\n", ws.rssi);
+    }
+    metrics_flush(req, buf, &n);
+
+    n = metrics_format_mdns_pools(buf, sizeof(buf), n);
+    n = metrics_format_mdns_tx(buf, sizeof(buf), n);
+    metrics_flush(req, buf, &n);
+    n = metrics_format_evlog(buf, sizeof(buf), n);
+    metrics_flush(req, buf, &n);
+    n = buf_appendf(buf, sizeof(buf), n, "# HELP doormon_task_stack_free_min_bytes Stack high-water mark.\n"
+                                 "# TYPE doormon_task_stack_free_min_bytes gauge\n");
+    for (size_t i = 0; i < sizeof(s_metrics_tasks) / sizeof(s_metrics_tasks[0]); i++) {
+        TaskHandle_t t = xTaskGetHandle(s_metrics_tasks[i]);
+        if (t) {
+            n = buf_appendf(buf, sizeof(buf), n, "doormon_task_stack_free_min_bytes{task=\"%s\"} %u\n",
+                        s_metrics_tasks[i], (unsigned)uxTaskGetStackHighWaterMark(t));
+        }
+    }
+    metrics_flush(req, buf, &n);
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+#endif
+
 static httpd_handle_t start_httpd(void)
 {
     httpd_handle_t server = NULL;
     httpd_config_t config = HTTPD_DEFAULT_CONFIG();
-    config.lru_purge_enable = true;
+    config.max_open_sockets    = HTTPD_MAX_SOCKETS;
+    config.backlog_conn        = HTTPD_BACKLOG;
+    config.recv_wait_timeout   = HTTPD_RECV_TIMEOUT_S;
+    config.send_wait_timeout   = HTTPD_SEND_TIMEOUT_S;
+    config.stack_size          = HTTPD_STACK_SIZE;
+    config.core_id             = HTTPD_TASK_CORE;
+    config.task_priority       = HTTPD_TASK_PRIO;
+    config.keep_alive_enable   = true;
+    config.keep_alive_idle     = HTTPD_TCP_KEEPALIVE_IDLE_S;
+    config.keep_alive_interval = HTTPD_TCP_KEEPALIVE_INTERVAL_S;
+    config.keep_alive_count    = HTTPD_TCP_KEEPALIVE_COUNT;
+    config.lru_purge_enable    = true;   /* a new client evicts the least recently used socket when full */
+    config.open_fn             = httpd_open_fn;
+    config.close_fn            = httpd_close_fn;
+
+    esp_timer_create_args_t longpoll_args = {
+        .callback = longpoll_timer_cb,
+        .name     = "longpoll",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&longpoll_args, &s_longpoll_timer));
 
     if (httpd_start(&server, &config) != ESP_OK) {
         ESP_LOGE(TAG, "failed to start HTTP server");
@@ -266,14 +1076,37 @@ static httpd_handle_t start_httpd(void)
     };
     httpd_register_uri_handler(server, &reset_post);
 
-    ESP_LOGI(TAG, "HTTP server started, /status and /reset");
+    httpd_uri_t events = {
+        .uri     = "/events",
+        .method  = HTTP_GET,
+        .handler = events_get_handler,
+    };
+    httpd_register_uri_handler(server, &events);
+
+    httpd_uri_t history = {
+        .uri     = "/events/history",
+        .method  = HTTP_GET,
+        .handler = history_get_handler,
+    };
+    httpd_register_uri_handler(server, &history);
+    ota_register(server);
+
+#if METRICS_ENABLE
+    httpd_uri_t metrics = {
+        .uri     = "/metrics",
+        .method  = HTTP_GET,
+        .handler = metrics_get_handler,
+    };
+    httpd_register_uri_handler(server, &metrics);
+#endif
+
+    ESP_LOGI(TAG, "HTTP server started, /status, /reset, /events and /events/history");
+    s_httpd = server;
     return server;
 }
 
 void app_main(void)
 {
-    s_triggered = false;
-
     esp_err_t ret = nvs_flash_init();
     if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
         ESP_ERROR_CHECK(nvs_flash_erase());
@@ -282,22 +1115,20 @@ void app_main(void)
     ESP_ERROR_CHECK(ret);
 
     triggered_nvs_load();   /* restore triggered state across reboots */
+    boot_phase("nvs");
+    evlog_init();
+    evlog_append(EVLOG_BOOT, EVLOG_INPUT_NONE, trigger_snapshot().latched, esp_timer_get_time());
+    boot_phase("evlog");
 
-    (void)wifi_init_sta();  /* returns only when connected; else reboots after timeout */
-
-    /* mDNS: advertise as doormon.local and _http._tcp on port 80 */
-    esp_err_t err = mdns_init();
-    if (err == ESP_OK) {
-        mdns_hostname_set(MDNS_HOSTNAME);
-        mdns_instance_name_set(MDNS_INSTANCE);
-        mdns_service_add(NULL, "_http", "_tcp", 80, NULL, 0);
-        ESP_LOGI(TAG, "mDNS: %s.local (_http._tcp port 80)", MDNS_HOSTNAME);
-    } else {
-        ESP_LOGW(TAG, "mDNS init failed: %s", esp_err_to_name(err));
-    }
+    ota_init(request_restart);   /* a fresh OTA image starts its confirm timeout */
+    power_init();            /* before the inputs: they double as wake sources */
 
-    trigger_gpio_init();     /* configures GPIOs and sets LED from s_triggered */
-    start_httpd();
+    /* Arm the inputs before WiFi so no edge during association is missed. */
+    xTaskCreate(event_task, "event", 4096, NULL, 10, &s_event_task);
+    led_gpio_init();         /* LED from restored state */
+    trigger_init(trigger_latched, s_event_task, EVT_BIT_EDGE);
+    boot_phase("trigger armed");
 
-    xTaskCreate(nvs_sync_task, "nvs_sync", 2048, NULL, 1, NULL);
+    wifi_init_sta(wifi_got_ip);   /* returns at once; mDNS/httpd start on the first IP */
+    boot_phase("wifi started");
 }
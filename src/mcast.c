@@ -0,0 +1,170 @@
+/**
+ * UDP multicast state notifications – see mcast.h.
+ *
+ * mcast_publish() (event_task) and the repeat/heartbeat timer callbacks
+ * (esp_timer task) share the current datagram under s_lock; sendto() itself
+ * runs outside the lock on a private copy. The repeat timer is one-shot and
+ * re-armed by its callback, so a publish racing the last repeat cannot be
+ * left without its own repeats.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_mac.h"
+#include "esp_timer.h"
+#include "lwip/sockets.h"
+
+#include "doormon_config.h"
+#include "mcast.h"
+
+#if MCAST_ENABLE
+
+static const char *TAG = "mcast";
+
+enum { PKT_STATE = 0, PKT_HEARTBEAT = 1 };
+
+static int s_sock = -1;
+static struct sockaddr_in s_dest;
+static uint8_t s_device_id[6];
+
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static uint8_t  s_pkt[MCAST_PKT_LEN];       /* last state message, under s_lock */
+static uint32_t s_msg_seq;                  /* under s_lock */
+static int      s_repeats_left;             /* under s_lock */
+
+static esp_timer_handle_t s_repeat_timer;
+static esp_timer_handle_t s_heartbeat_timer;
+
+static void put_u32(uint8_t *p, uint32_t v)
+{
+    p[0] = v >> 24; p[1] = v >> 16; p[2] = v >> 8; p[3] = v;
+}
+
+static void put_u64(uint8_t *p, uint64_t v)
+{
+    put_u32(p, (uint32_t)(v >> 32));
+    put_u32(p + 4, (uint32_t)v);
+}
+
+/* Fill a datagram body; the caller holds s_lock or owns buf. */
+static void pkt_build(uint8_t *buf, uint8_t type, uint32_t seq, const trigger_state_t *st, uint32_t levels)
+{
+    memset(buf, 0, MCAST_PKT_LEN);
+    memcpy(buf, "DMON", 4);
+    buf[4] = MCAST_PKT_VERSION;
+    buf[5] = type;
+    buf[7] = TRIGGER_NUM_INPUTS;
+    memcpy(buf + 8, s_device_id, 6);
+    put_u32(buf + 16, seq);
+    put_u32(buf + 20, st->gen);
+    put_u32(buf + 24, st->latched);
+    put_u32(buf + 28, levels);
+    put_u64(buf + 32, (uint64_t)(esp_timer_get_time() / 1000));
+}
+
+static void pkt_send(const uint8_t *buf)
+{
+    if (sendto(s_sock, buf, MCAST_PKT_LEN, 0, (const struct sockaddr *)&s_dest, sizeof(s_dest)) < 0) {
+        ESP_LOGD(TAG, "sendto failed: errno %d", errno);
+    }
+}
+
+static void mcast_repeat_cb(void *arg)
+{
+    uint8_t buf[MCAST_PKT_LEN];
+    bool last;
+    taskENTER_CRITICAL(&s_lock);
+    memcpy(buf, s_pkt, sizeof(buf));
+    buf[6] = (uint8_t)(MCAST_REPEAT - s_repeats_left);
+    last = --s_repeats_left <= 0;
+    taskEXIT_CRITICAL(&s_lock);
+    pkt_send(buf);
+    if (!last) {
+        esp_timer_start_once(s_repeat_timer, (uint64_t)MCAST_REPEAT_MS * 1000);
+    }
+}
+
+/* Idle heartbeat: a fresh snapshot, so a listener that joined late learns the state. */
+static void mcast_heartbeat_cb(void *arg)
+{
+    trigger_state_t st = trigger_snapshot();
+    uint8_t buf[MCAST_PKT_LEN];
+    taskENTER_CRITICAL(&s_lock);
+    uint32_t seq = ++s_msg_seq;
+    taskEXIT_CRITICAL(&s_lock);
+    pkt_build(buf, PKT_HEARTBEAT, seq, &st, trigger_levels());
+    pkt_send(buf);
+}
+
+void mcast_init(void)
+{
+    esp_read_mac(s_device_id, ESP_MAC_WIFI_STA);
+
+    s_sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (s_sock < 0) {
+        ESP_LOGE(TAG, "socket failed: errno %d", errno);
+        return;
+    }
+    uint8_t ttl = MCAST_TTL;
+    setsockopt(s_sock, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+    uint8_t loop = 0;
+    setsockopt(s_sock, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+
+    memset(&s_dest, 0, sizeof(s_dest));
+    s_dest.sin_family = AF_INET;
+    s_dest.sin_port = htons(MCAST_PORT);
+    s_dest.sin_addr.s_addr = inet_addr(MCAST_GROUP);
+
+    esp_timer_create_args_t repeat_args = {
+        .callback = mcast_repeat_cb,
+        .name     = "mcast_rep",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&repeat_args, &s_repeat_timer));
+    esp_timer_create_args_t heartbeat_args = {
+        .callback = mcast_heartbeat_cb,
+        .name     = "mcast_hb",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&heartbeat_args, &s_heartbeat_timer));
+    ESP_ERROR_CHECK(esp_timer_start_periodic(s_heartbeat_timer, (uint64_t)MCAST_HEARTBEAT_MS * 1000));
+
+    ESP_LOGI(TAG, "notifications to %s:%d", MCAST_GROUP, MCAST_PORT);
+}
+
+void mcast_publish(const trigger_state_t *st, uint32_t levels)
+{
+    if (s_sock < 0) {
+        return;
+    }
+    uint8_t buf[MCAST_PKT_LEN];
+    taskENTER_CRITICAL(&s_lock);
+    pkt_build(s_pkt, PKT_STATE, ++s_msg_seq, st, levels);
+    memcpy(buf, s_pkt, sizeof(buf));
+    s_repeats_left = MCAST_REPEAT - 1;
+    taskEXIT_CRITICAL(&s_lock);
+    pkt_send(buf);
+
+    /* Restart both timers: repeats follow this message, the heartbeat waits a full idle period. */
+    esp_timer_stop(s_repeat_timer);
+    if (MCAST_REPEAT > 1) {
+        esp_timer_start_once(s_repeat_timer, (uint64_t)MCAST_REPEAT_MS * 1000);
+    }
+    esp_timer_stop(s_heartbeat_timer);
+    esp_timer_start_periodic(s_heartbeat_timer, (uint64_t)MCAST_HEARTBEAT_MS * 1000);
+}
+
+#else
+
+void mcast_init(void)
+{
+}
+
+void mcast_publish(const trigger_state_t *st, uint32_t levels)
+{
+    (void)st;
+    (void)levels;
+}
+
+#endif
@@ -0,0 +1,28 @@
+/**
+ * UDP multicast state notifications (MCAST_ENABLE).
+ *
+ * Every state transition is sent as one small datagram to MCAST_GROUP:
+ * MCAST_PORT, repeated MCAST_REPEAT times MCAST_REPEAT_MS apart to ride out
+ * loss, and re-sent as a heartbeat every MCAST_HEARTBEAT_MS while idle. Any
+ * number of listeners cost the device one sendto() per datagram.
+ *
+ * Datagram (big-endian, MCAST_PKT_LEN bytes):
+ *   0  magic "DMON"       4  version (1)        5  type (0 state, 1 heartbeat)
+ *   6  repeat index       7  input count        8  device id (STA MAC, 6 bytes)
+ *   14 reserved (2)       16 msg seq (u32, shared by repeats of one message)
+ *   20 gen (u32)          24 latched mask (u32) 28 level mask (u32)
+ *   32 uptime ms (u64)
+ */
+#pragma once
+
+#include <stdint.h>
+#include "trigger.h"
+
+#define MCAST_PKT_VERSION  1
+#define MCAST_PKT_LEN      40
+
+/* Open the socket and start the heartbeat. Call once the station has an IP. */
+void mcast_init(void);
+
+/* Announce a state transition. Returns immediately; repeats are sent from a timer. */
+void mcast_publish(const trigger_state_t *st, uint32_t levels);
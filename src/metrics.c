@@ -0,0 +1,66 @@
+/**
+ * Metrics – see metrics.h.
+ */
+
+#include <stdio.h>
+#include "buf.h"
+#include "metrics.h"
+
+static const uint32_t s_bounds_us[METRICS_NUM_BUCKETS - 1] = { METRICS_BUCKETS_US };
+
+metrics_hist_t metrics_http_status;
+metrics_hist_t metrics_http_reset;
+metrics_hist_t metrics_trigger_latch;
+metrics_hist_t metrics_trigger_push;
+metrics_hist_t metrics_trigger_report;
+metrics_hist_t metrics_nvs_commit;
+atomic_uint    metrics_nvs_errors;
+atomic_uint    metrics_reports_over_target;
+
+#if METRICS_ENABLE
+void metrics_observe(metrics_hist_t *h, uint32_t us)
+{
+    int i = 0;
+    while (i < METRICS_NUM_BUCKETS - 1 && us > s_bounds_us[i]) {
+        i++;
+    }
+    atomic_fetch_add_explicit(&h->bucket[i], 1, memory_order_relaxed);
+    uint32_t old = atomic_fetch_add_explicit(&h->sum_lo, us, memory_order_relaxed);
+    if ((uint32_t)(old + us) < old) {
+        atomic_fetch_add_explicit(&h->sum_hi, 1, memory_order_relaxed);
+    }
+}
+#endif
+
+int metrics_format_hist(char *buf, size_t size, int n, const char *name, const char *help,
+                        const char *labels, metrics_hist_t *h)
+{
+    if (help) {
+        n = buf_appendf(buf, size, n, "# HELP %s %s\n# TYPE %s histogram\n", name, help, name);
+    }
+    const char *sep = labels[0] ? "," : "";
+    uint32_t cum = 0;
+    for (int i = 0; i < METRICS_NUM_BUCKETS; i++) {
+        cum += atomic_load_explicit(&h->bucket[i], memory_order_relaxed);
+        if (i < METRICS_NUM_BUCKETS - 1) {
+            n = buf_appendf(buf, size, n, "%s_bucket{%s%sle=\"%g\"} %u\n",
+                        name, labels, sep, s_bounds_us[i] / 1e6, (unsigned)cum);
+        } else {
+            n = buf_appendf(buf, size, n, "%s_bucket{%s%sle=\"+Inf\"} %u\n", name, labels, sep, (unsigned)cum);
+        }
+    }
+
+    /* Re-read if a carry landed between the two words. */
+    uint32_t hi, lo;
+    do {
+        hi = atomic_load_explicit(&h->sum_hi, memory_order_relaxed);
+        lo = atomic_load_explicit(&h->sum_lo, memory_order_relaxed);
+    } while (hi != atomic_load_explicit(&h->sum_hi, memory_order_relaxed));
+    uint64_t sum_us = ((uint64_t)hi << 32) | lo;
+
+    const char *lbrace = labels[0] ? "{" : "";
+    const char *rbrace = labels[0] ? "}" : "";
+    n = buf_appendf(buf, size, n, "%s_sum%s%s%s %llu.%06u\n", name, lbrace, labels, rbrace,
+                (unsigned long long)(sum_us / 1000000), (unsigned)(sum_us % 1000000));
+    return buf_appendf(buf, size, n, "%s_count%s%s%s %u\n", name, lbrace, labels, rbrace, (unsigned)cum);
+}
@@ -0,0 +1,48 @@
+/**
+ * Lock-free counters and fixed-bucket latency histograms for /metrics.
+ *
+ * Hot paths call metrics_observe(); it is a handful of relaxed 32-bit atomic
+ * adds (lock-free on ESP32; 64-bit atomics are not), so it is safe from any
+ * task and cheap enough not to disturb what it measures. Sums are kept as a
+ * split 32-bit low word plus carry word. With METRICS_ENABLE 0 everything
+ * compiles away and /metrics is not registered.
+ */
+#pragma once
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "doormon_config.h"
+
+/* Upper bounds (µs) of the histogram buckets; a final +Inf bucket follows. */
+#define METRICS_BUCKETS_US  100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 1000000
+enum { METRICS_NUM_BUCKETS = sizeof((uint32_t[]){ METRICS_BUCKETS_US }) / sizeof(uint32_t) + 1 };
+
+typedef struct {
+    atomic_uint bucket[METRICS_NUM_BUCKETS];   /* per-bucket, not cumulative */
+    atomic_uint sum_lo;                        /* total µs, low word */
+    atomic_uint sum_hi;                        /* carries out of sum_lo */
+} metrics_hist_t;
+
+extern metrics_hist_t metrics_http_status;    /* /status service time (long-poll waits excluded) */
+extern metrics_hist_t metrics_http_reset;     /* /reset service time */
+extern metrics_hist_t metrics_trigger_latch;  /* edge timestamp -> latched in the state table */
+extern metrics_hist_t metrics_trigger_push;   /* edge timestamp -> sent to /events and long-poll clients */
+extern metrics_hist_t metrics_trigger_report; /* edge timestamp -> handed to multicast, MQTT, mDNS and CoAP */
+extern metrics_hist_t metrics_nvs_commit;     /* triggered_nvs_save() open/set/commit */
+extern atomic_uint    metrics_nvs_errors;
+extern atomic_uint    metrics_reports_over_target; /* metrics_trigger_report over POWER_REPORT_TARGET_MS */
+
+#if METRICS_ENABLE
+void metrics_observe(metrics_hist_t *h, uint32_t us);
+#else
+static inline void metrics_observe(metrics_hist_t *h, uint32_t us) { (void)h; (void)us; }
+#endif
+
+/*
+ * Prometheus text for one histogram, in seconds, at buf + n (clamped like
+ * snprintf). labels is e.g. "path=\"/status\"" or "". Emits # HELP/# TYPE
+ * only when help is non-NULL, so several label sets can share one family.
+ */
+int metrics_format_hist(char *buf, size_t size, int n, const char *name, const char *help,
+                        const char *labels, metrics_hist_t *h);
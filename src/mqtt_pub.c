@@ -0,0 +1,185 @@
+/**
+ * MQTT publishing – see mqtt_pub.h.
+ *
+ * Publishes go through esp_mqtt_client_enqueue(), which only copies into the
+ * client's outbox, so the caller (event_task) never blocks on the network.
+ * s_lock guards the event queue, the state copy and s_connected against the
+ * MQTT task's CONNECTED handler.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "mqtt_client.h"
+
+#include "doormon_config.h"
+#include "mqtt_pub.h"
+
+#if MQTT_ENABLE
+
+static const char *TAG = "mqtt";
+
+#define TOPIC_STATE   MQTT_TOPIC_BASE "/state"
+#define TOPIC_EVENT   MQTT_TOPIC_BASE "/event"
+#define TOPIC_ONLINE  MQTT_TOPIC_BASE "/online"
+#define TOPIC_RESET   MQTT_TOPIC_BASE "/reset"
+
+static esp_mqtt_client_handle_t s_client;
+static mqtt_reset_cb_t s_on_reset;
+
+static SemaphoreHandle_t s_lock;
+static bool     s_connected;                           /* under s_lock */
+static char    *s_state_json;                          /* latest state, heap copy, under s_lock */
+static char     s_queue[MQTT_QUEUE_LEN][MQTT_EVENT_MAX]; /* events awaiting the broker, under s_lock */
+static unsigned s_queue_head;                          /* next to send; head..head+count-1 used */
+static unsigned s_queue_count;
+static unsigned s_queue_dropped;
+
+static int publish(const char *topic, const char *data, bool retain)
+{
+    return esp_mqtt_client_enqueue(s_client, topic, data, 0, MQTT_QOS, retain, true);
+}
+
+/* Broker is back: events in order, then the latest state. MQTT task. */
+static void flush_queue(void)
+{
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    unsigned sent = s_queue_count;
+    while (s_queue_count) {
+        publish(TOPIC_EVENT, s_queue[s_queue_head], false);
+        s_queue_head = (s_queue_head + 1) % MQTT_QUEUE_LEN;
+        s_queue_count--;
+    }
+    if (s_state_json) {
+        publish(TOPIC_STATE, s_state_json, true);
+    }
+    unsigned dropped = s_queue_dropped;
+    s_queue_dropped = 0;
+    s_connected = true;
+    xSemaphoreGive(s_lock);
+
+    if (sent || dropped) {
+        ESP_LOGI(TAG, "flushed %u queued events (%u dropped while offline)", sent, dropped);
+    }
+}
+
+static void handle_reset(const esp_mqtt_event_handle_t ev)
+{
+    char name[32];
+    int len = ev->data_len < (int)sizeof(name) - 1 ? ev->data_len : (int)sizeof(name) - 1;
+    memcpy(name, ev->data, len);
+    name[len] = '\0';
+    const char *input = (len == 0 || strcmp(name, "all") == 0) ? NULL : name;
+    if (!s_on_reset(input)) {
+        ESP_LOGW(TAG, "reset: unknown input \"%s\"", name);
+    }
+}
+
+static void mqtt_event_handler(void *arg, esp_event_base_t base, int32_t event_id, void *event_data)
+{
+    esp_mqtt_event_handle_t ev = event_data;
+    switch ((esp_mqtt_event_id_t)event_id) {
+    case MQTT_EVENT_CONNECTED:
+        ESP_LOGI(TAG, "connected to %s", MQTT_BROKER_URI);
+        esp_mqtt_client_subscribe(s_client, TOPIC_RESET, MQTT_QOS);
+        publish(TOPIC_ONLINE, "1", true);
+        flush_queue();
+        break;
+    case MQTT_EVENT_DISCONNECTED:
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        s_connected = false;
+        xSemaphoreGive(s_lock);
+        ESP_LOGW(TAG, "disconnected, queueing events");
+        break;
+    case MQTT_EVENT_DATA:
+        if (ev->topic_len == (int)strlen(TOPIC_RESET) && memcmp(ev->topic, TOPIC_RESET, ev->topic_len) == 0) {
+            handle_reset(ev);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+void mqtt_pub_init(mqtt_reset_cb_t on_reset)
+{
+    s_on_reset = on_reset;
+    s_lock = xSemaphoreCreateMutex();
+
+    esp_mqtt_client_config_t cfg = {
+        .broker.address.uri = MQTT_BROKER_URI,
+        .credentials.username = MQTT_USERNAME[0] ? MQTT_USERNAME : NULL,
+        .credentials.authentication.password = MQTT_PASSWORD[0] ? MQTT_PASSWORD : NULL,
+        .session.last_will = {
+            .topic  = TOPIC_ONLINE,
+            .msg    = "0",
+            .qos    = MQTT_QOS,
+            .retain = true,
+        },
+    };
+    s_client = esp_mqtt_client_init(&cfg);
+    if (!s_client) {
+        ESP_LOGE(TAG, "client init failed");
+        return;
+    }
+    esp_mqtt_client_register_event(s_client, ESP_EVENT_ANY_ID, mqtt_event_handler, NULL);
+    esp_mqtt_client_start(s_client);
+}
+
+void mqtt_pub_state(const char *json)
+{
+    if (!s_client) {
+        return;
+    }
+    char *copy = strdup(json);
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    free(s_state_json);
+    s_state_json = copy;
+    if (s_connected && copy) {
+        publish(TOPIC_STATE, copy, true);
+    }
+    xSemaphoreGive(s_lock);
+}
+
+void mqtt_pub_event(const char *json)
+{
+    if (!s_client) {
+        return;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    if (s_connected && publish(TOPIC_EVENT, json, false) >= 0) {
+        xSemaphoreGive(s_lock);
+        return;
+    }
+    if (s_queue_count == MQTT_QUEUE_LEN) {
+        s_queue_head = (s_queue_head + 1) % MQTT_QUEUE_LEN;   /* drop the oldest */
+        s_queue_count--;
+        s_queue_dropped++;
+    }
+    unsigned tail = (s_queue_head + s_queue_count) % MQTT_QUEUE_LEN;
+    strncpy(s_queue[tail], json, MQTT_EVENT_MAX - 1);
+    s_queue[tail][MQTT_EVENT_MAX - 1] = '\0';
+    s_queue_count++;
+    xSemaphoreGive(s_lock);
+}
+
+#else
+
+void mqtt_pub_init(mqtt_reset_cb_t on_reset)
+{
+    (void)on_reset;
+}
+
+void mqtt_pub_state(const char *json)
+{
+    (void)json;
+}
+
+void mqtt_pub_event(const char *json)
+{
+    (void)json;
+}
+
+#endif
@@ -0,0 +1,28 @@
+/**
+ * MQTT publishing (MQTT_ENABLE) over one persistent esp-mqtt connection.
+ *
+ * Topics under MQTT_TOPIC_BASE:
+ *   /state   retained state object (same JSON as /status)
+ *   /event   one message per transition
+ *   /online  "1" while connected, "0" as the last will
+ *   /reset   subscribed: empty payload clears all inputs, else an input name
+ *
+ * While the broker is unreachable, events wait in a bounded RAM queue
+ * (MQTT_QUEUE_LEN, oldest dropped first) and are flushed in one batch,
+ * followed by the latest state, as soon as the connection is back.
+ */
+#pragma once
+
+#include <stdbool.h>
+
+/* /reset command: input is NULL for all inputs; return false if the name is unknown. */
+typedef bool (*mqtt_reset_cb_t)(const char *input);
+
+/* Start the client. Call once the station has an IP. */
+void mqtt_pub_init(mqtt_reset_cb_t on_reset);
+
+/* Replace the retained state; sent now if connected, otherwise on reconnect. */
+void mqtt_pub_state(const char *json);
+
+/* Publish one event, or queue it until the broker is back. */
+void mqtt_pub_event(const char *json);
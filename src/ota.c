@@ -0,0 +1,263 @@
+/**
+ * Firmware update over HTTP – see ota.h.
+ *
+ * The handler (httpd task) checks the token and the size, takes s_busy and
+ * hands an async copy of the request to a short-lived "ota" task, which owns
+ * the OTA handle and the chunk buffer until it exits. s_busy stays taken
+ * after a successful update, so nothing else is written before the restart.
+ */
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_app_desc.h"
+#include "esp_log.h"
+#include "esp_ota_ops.h"
+#include "esp_timer.h"
+
+#include "doormon_config.h"
+#include "ota.h"
+
+static const char *TAG = "ota";
+
+static ota_restart_fn_t s_restart;
+static bool s_pending_verify;              /* app_main, then event_task */
+static esp_timer_handle_t s_confirm_timer;
+
+/* esp_timer task: the new image never got its network services up. Restarting rolls it back. */
+static void ota_confirm_timeout_cb(void *arg)
+{
+    (void)arg;
+    ESP_LOGE(TAG, "image not confirmed within %d s, rolling back", OTA_CONFIRM_TIMEOUT_S);
+    s_restart();
+}
+
+#if OTA_ENABLE
+
+_Static_assert(sizeof(OTA_TOKEN) > 1, "OTA_ENABLE needs an OTA_TOKEN");
+
+#define OTA_AUTH_MAX      (sizeof("Bearer " OTA_TOKEN) - 1)
+#define OTA_TASK_STACK    4096
+#define OTA_TASK_PRIO     4      /* below httpd, so /status is answered during a transfer */
+#define OTA_RECV_RETRIES  3      /* consecutive HTTPD_RECV_TIMEOUT_S stalls before giving up */
+
+typedef struct {
+    httpd_req_t             *req;    /* async copy, completed by the task */
+    const esp_partition_t   *part;
+} ota_job_t;
+
+static atomic_bool s_busy;
+static ota_job_t s_job;              /* written by the handler before the task starts */
+static char s_buf[OTA_CHUNK];        /* ota task only */
+static esp_timer_handle_t s_restart_timer;
+
+static void ota_restart_cb(void *arg)
+{
+    (void)arg;
+    s_restart();
+}
+
+/* Length-independent compare, so the reply time gives nothing away about the token. */
+static bool ota_token_ok(const char *auth)
+{
+    static const char want[] = "Bearer " OTA_TOKEN;
+    size_t len = strlen(auth);
+    unsigned diff = len != sizeof(want) - 1;
+    for (size_t i = 0; i < sizeof(want) - 1; i++) {
+        diff |= (unsigned char)want[i] ^ (unsigned char)(i < len ? auth[i] : 0);
+    }
+    return diff == 0;
+}
+
+static esp_err_t ota_reply(httpd_req_t *req, const char *status, const char *body)
+{
+    httpd_resp_set_status(req, status);
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_sendstr(req, body);
+}
+
+static esp_err_t ota_fail(httpd_req_t *req, const char *status, const char *reason)
+{
+    char body[96];
+    snprintf(body, sizeof(body), "{\"ota\":\"error\",\"reason\":\"%s\"}", reason);
+    return ota_reply(req, status, body);
+}
+
+/* Receive, write and verify the image, answer the client, then schedule the restart. */
+static void ota_task(void *arg)
+{
+    (void)arg;
+    httpd_req_t *req = s_job.req;
+    const esp_partition_t *part = s_job.part;
+    size_t total = req->content_len;
+    size_t done = 0;
+    int64_t t0 = esp_timer_get_time();
+    const char *status = "500 Internal Server Error";
+    const char *reason = NULL;
+    esp_app_desc_t desc;
+
+    ESP_LOGI(TAG, "receiving %u bytes into %s", (unsigned)total, part->label);
+    esp_ota_handle_t handle = 0;
+    esp_err_t err = esp_ota_begin(part, OTA_WITH_SEQUENTIAL_WRITES, &handle);
+    if (err != ESP_OK) {
+        reason = "begin failed";
+    }
+    int timeouts = 0;
+    while (!reason && done < total) {
+        size_t want = total - done < sizeof(s_buf) ? total - done : sizeof(s_buf);
+        int n = httpd_req_recv(req, s_buf, want);
+        if (n == HTTPD_SOCK_ERR_TIMEOUT && ++timeouts <= OTA_RECV_RETRIES) {
+            continue;
+        }
+        if (n <= 0) {
+            status = "408 Request Timeout";
+            reason = "receive failed";
+            break;
+        }
+        timeouts = 0;
+        err = esp_ota_write(handle, s_buf, (size_t)n);
+        if (err != ESP_OK) {
+            if (err == ESP_ERR_OTA_VALIDATE_FAILED) {
+                status = "400 Bad Request";
+                reason = "not an app image";
+            } else {
+                reason = "flash write failed";
+            }
+            break;
+        }
+        done += (size_t)n;
+    }
+
+    if (reason) {
+        if (handle) {
+            esp_ota_abort(handle);
+        }
+    } else if ((err = esp_ota_end(handle)) != ESP_OK) {
+        if (err == ESP_ERR_OTA_VALIDATE_FAILED) {
+            status = "400 Bad Request";
+            reason = "image verification failed";
+        } else {
+            reason = "end failed";
+        }
+    } else if (esp_ota_get_partition_description(part, &desc) != ESP_OK ||
+               strncmp(desc.project_name, esp_app_get_description()->project_name,
+                       sizeof(desc.project_name)) != 0) {
+        status = "400 Bad Request";
+        reason = "image from another project";
+    } else if (esp_ota_set_boot_partition(part) != ESP_OK) {
+        reason = "set boot partition failed";
+    }
+
+    if (reason) {
+        ESP_LOGW(TAG, "update failed after %u of %u bytes: %s (%s)", (unsigned)done, (unsigned)total,
+                 reason, esp_err_to_name(err));
+        ota_fail(req, status, reason);
+        httpd_req_async_handler_complete(req);
+        atomic_store(&s_busy, false);
+    } else {
+        ESP_LOGI(TAG, "%s %.32s written to %s in %lld ms, restarting", desc.project_name, desc.version,
+                 part->label, (long long)((esp_timer_get_time() - t0) / 1000));
+        char body[128];
+        snprintf(body, sizeof(body), "{\"ota\":\"ok\",\"version\":\"%.32s\",\"partition\":\"%s\",\"bytes\":%u}",
+                 desc.version, part->label, (unsigned)done);
+        ota_reply(req, "200 OK", body);
+        httpd_req_async_handler_complete(req);
+        esp_timer_start_once(s_restart_timer, (uint64_t)OTA_RESTART_DELAY_MS * 1000);
+    }
+    vTaskDelete(NULL);
+}
+
+static esp_err_t ota_post_handler(httpd_req_t *req)
+{
+    char auth[OTA_AUTH_MAX + 1];
+    if (httpd_req_get_hdr_value_str(req, "Authorization", auth, sizeof(auth)) != ESP_OK ||
+        !ota_token_ok(auth)) {
+        httpd_resp_set_hdr(req, "WWW-Authenticate", "Bearer");
+        return ota_fail(req, "401 Unauthorized", "unauthorized");
+    }
+    if (req->content_len == 0) {
+        return ota_fail(req, "411 Length Required", "no content length");
+    }
+    const esp_partition_t *part = esp_ota_get_next_update_partition(NULL);
+    if (!part) {
+        return ota_fail(req, "500 Internal Server Error", "no OTA partition");
+    }
+    if (req->content_len > part->size) {
+        return ota_fail(req, "413 Payload Too Large", "image larger than the OTA slot");
+    }
+    if (atomic_exchange(&s_busy, true)) {
+        return ota_fail(req, "409 Conflict", "update already running");
+    }
+    s_job.part = part;
+    if (httpd_req_async_handler_begin(req, &s_job.req) != ESP_OK) {
+        atomic_store(&s_busy, false);
+        return ota_fail(req, "500 Internal Server Error", "out of memory");
+    }
+    if (xTaskCreate(ota_task, "ota", OTA_TASK_STACK, NULL, OTA_TASK_PRIO, NULL) != pdPASS) {
+        ota_fail(s_job.req, "500 Internal Server Error", "out of memory");
+        httpd_req_async_handler_complete(s_job.req);
+        atomic_store(&s_busy, false);
+    }
+    return ESP_OK;
+}
+
+void ota_register(httpd_handle_t server)
+{
+    esp_timer_create_args_t restart_args = {
+        .callback = ota_restart_cb,
+        .name     = "ota_restart",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&restart_args, &s_restart_timer));
+
+    httpd_uri_t ota = {
+        .uri     = "/ota",
+        .method  = HTTP_POST,
+        .handler = ota_post_handler,
+    };
+    httpd_register_uri_handler(server, &ota);
+}
+
+#else
+
+void ota_register(httpd_handle_t server)
+{
+    (void)server;
+}
+
+#endif
+
+void ota_init(ota_restart_fn_t restart)
+{
+    s_restart = restart;
+    const esp_partition_t *running = esp_ota_get_running_partition();
+    esp_ota_img_states_t state;
+    if (!running || esp_ota_get_state_partition(running, &state) != ESP_OK ||
+        state != ESP_OTA_IMG_PENDING_VERIFY) {
+        return;
+    }
+    s_pending_verify = true;
+    esp_timer_create_args_t confirm_args = {
+        .callback = ota_confirm_timeout_cb,
+        .name     = "ota_confirm",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&confirm_args, &s_confirm_timer));
+    ESP_ERROR_CHECK(esp_timer_start_once(s_confirm_timer, (uint64_t)OTA_CONFIRM_TIMEOUT_S * 1000000));
+    ESP_LOGW(TAG, "new image in %s, pending verification (%d s)", running->label, OTA_CONFIRM_TIMEOUT_S);
+}
+
+void ota_confirm(void)
+{
+    if (!s_pending_verify) {
+        return;
+    }
+    s_pending_verify = false;
+    esp_timer_stop(s_confirm_timer);
+    esp_err_t err = esp_ota_mark_app_valid_cancel_rollback();
+    if (err == ESP_OK) {
+        ESP_LOGI(TAG, "image confirmed, rollback cancelled");
+    } else {
+        ESP_LOGW(TAG, "could not confirm image: %s", esp_err_to_name(err));
+    }
+}
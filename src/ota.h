@@ -0,0 +1,40 @@
+/**
+ * Firmware update over HTTP (OTA_ENABLE), with rollback.
+ *
+ *   POST /ota   Authorization: Bearer <OTA_TOKEN>, body = the app image (firmware.bin)
+ *
+ * The body is streamed OTA_CHUNK bytes at a time into the idle OTA slot
+ * (partitions.csv), which is erased sector by sector just ahead of the
+ * writes, so no image is ever held in RAM. The transfer runs in its own
+ * task on an async request; httpd, the trigger path and event_task keep
+ * running throughout. esp_ota_end() then checks the image checksum and
+ * SHA-256, and an image built from another project is refused. Only then
+ * does the slot become the boot partition; the device replies and restarts
+ * OTA_RESTART_DELAY_MS later.
+ *
+ *   200 {"ota":"ok","version":"…","partition":"ota_1","bytes":N}
+ *   400 not an app image / failed verification    401 wrong or missing token
+ *   409 an update is already running              411 no Content-Length
+ *   413 larger than the slot                      500 flash error
+ *
+ * Rollback (CONFIG_BOOTLOADER_APP_ROLLBACK_ENABLE): a new image boots
+ * pending verification. ota_confirm() marks it valid once httpd is up. If it
+ * resets before then, or is not up within OTA_CONFIRM_TIMEOUT_S, the
+ * bootloader goes back to the previous image on the next boot. That part is
+ * compiled in even without OTA_ENABLE, so any image can confirm itself.
+ */
+#pragma once
+
+#include "esp_http_server.h"
+
+/* Restart the device; called after a successful update and on a confirm timeout. */
+typedef void (*ota_restart_fn_t)(void);
+
+/* Check whether this image still has to prove itself. Call once in app_main. */
+void ota_init(ota_restart_fn_t restart);
+
+/* Register POST /ota on the HTTP server. */
+void ota_register(httpd_handle_t server);
+
+/* The image works: cancel the rollback. event_task, once network services are up. */
+void ota_confirm(void);
@@ -0,0 +1,125 @@
+/**
+ * Low-power mode – see power.h.
+ *
+ * The light-sleep hooks run on the core that goes to sleep, with its
+ * interrupts off; they only stamp the time and add to the totals under
+ * s_lock, which power_get_stats() (httpd task) takes to copy them.
+ */
+
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_pm.h"
+#include "esp_sleep.h"
+#include "esp_timer.h"
+
+#include "doormon_config.h"
+#include "power.h"
+
+#if POWER_SAVE_ENABLE
+
+#if TRIGGER_FILTER_MODE == TRIGGER_FILTER_PCNT
+#error "POWER_SAVE_ENABLE needs TRIGGER_FILTER_SOFT or _NONE: PCNT does not count in light sleep"
+#endif
+_Static_assert(POWER_LISTEN_INTERVAL * 1024 / 10 <= POWER_REPORT_TARGET_MS,
+               "POWER_LISTEN_INTERVAL beacons do not fit in POWER_REPORT_TARGET_MS");
+
+static const char *TAG = "power";
+
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static bool     s_enabled;
+static uint32_t s_sleeps;     /* under s_lock */
+static uint64_t s_sleep_us;   /* under s_lock */
+
+#if CONFIG_PM_LIGHT_SLEEP_CALLBACKS
+static bool     s_asleep;     /* under s_lock */
+static int64_t  s_enter_us;   /* under s_lock */
+
+static esp_err_t IRAM_ATTR power_sleep_enter(int64_t sleep_time_us, void *arg)
+{
+    (void)sleep_time_us;
+    (void)arg;
+    taskENTER_CRITICAL_ISR(&s_lock);
+    s_asleep = true;
+    s_enter_us = esp_timer_get_time();
+    taskEXIT_CRITICAL_ISR(&s_lock);
+    return ESP_OK;
+}
+
+/* esp_timer time is compensated across light sleep, so the difference is the time slept. */
+static esp_err_t IRAM_ATTR power_sleep_exit(int64_t sleep_time_us, void *arg)
+{
+    (void)sleep_time_us;
+    (void)arg;
+    int64_t now = esp_timer_get_time();
+    taskENTER_CRITICAL_ISR(&s_lock);
+    if (s_asleep) {
+        s_sleeps++;
+        s_sleep_us += (uint64_t)(now - s_enter_us);
+        s_asleep = false;
+    }
+    taskEXIT_CRITICAL_ISR(&s_lock);
+    return ESP_OK;
+}
+#endif
+
+void power_init(void)
+{
+    esp_pm_config_t pm = {
+        .max_freq_mhz       = POWER_MAX_CPU_MHZ,
+        .min_freq_mhz       = POWER_MIN_CPU_MHZ,
+        .light_sleep_enable = true,
+    };
+    esp_err_t err = esp_pm_configure(&pm);
+    if (err != ESP_OK) {
+        /* CONFIG_PM_ENABLE / CONFIG_FREERTOS_USE_TICKLESS_IDLE missing from sdkconfig */
+        ESP_LOGW(TAG, "esp_pm_configure failed: %s, staying at full power", esp_err_to_name(err));
+        return;
+    }
+#if CONFIG_PM_LIGHT_SLEEP_CALLBACKS
+    esp_pm_sleep_cbs_register_config_t cbs = {
+        .enter_cb = power_sleep_enter,
+        .exit_cb  = power_sleep_exit,
+    };
+    err = esp_pm_light_sleep_register_cbs(&cbs);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "sleep hooks not registered: %s", esp_err_to_name(err));
+    }
+#else
+    ESP_LOGW(TAG, "CONFIG_PM_LIGHT_SLEEP_CALLBACKS off: sleep time is not measured");
+#endif
+    ESP_ERROR_CHECK(esp_sleep_enable_gpio_wakeup());
+    s_enabled = true;
+    ESP_LOGI(TAG, "light sleep on, CPU %d-%d MHz, report target %d ms",
+             POWER_MIN_CPU_MHZ, POWER_MAX_CPU_MHZ, POWER_REPORT_TARGET_MS);
+}
+
+void power_get_stats(power_stats_t *out)
+{
+    memset(out, 0, sizeof(*out));
+    out->enabled = s_enabled;
+    taskENTER_CRITICAL(&s_lock);
+    out->sleeps = s_sleeps;
+    out->sleep_us = s_sleep_us;
+    taskEXIT_CRITICAL(&s_lock);
+
+    uint64_t up_us = (uint64_t)esp_timer_get_time();
+    if (up_us > out->sleep_us) {
+        uint64_t awake_us = up_us - out->sleep_us;
+        out->avg_ua = (uint32_t)((out->sleep_us * POWER_SLEEP_UA + awake_us * POWER_AWAKE_UA) / up_us);
+    }
+}
+
+#else
+
+void power_init(void)
+{
+}
+
+void power_get_stats(power_stats_t *out)
+{
+    memset(out, 0, sizeof(*out));
+}
+
+#endif
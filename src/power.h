@@ -0,0 +1,27 @@
+/**
+ * Low-power mode (POWER_SAVE_ENABLE): automatic light sleep and dynamic CPU
+ * frequency through esp_pm, with the trigger inputs as GPIO wake sources.
+ *
+ * The chip light-sleeps whenever every task is blocked, and wakes for the
+ * next esp_timer deadline, a DTIM beacon (WiFi modem sleep, wifi.c) or a
+ * trigger input changing level (trigger.c). Sleep entry and exit are timed
+ * here, so /metrics can show how long the chip slept and an average current
+ * modelled from POWER_SLEEP_UA and POWER_AWAKE_UA. That figure is not a
+ * measurement; check it once per board with a meter.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct {
+    bool     enabled;       /* esp_pm accepted the configuration */
+    uint32_t sleeps;        /* light sleeps since boot */
+    uint64_t sleep_us;      /* time spent in them */
+    uint32_t avg_ua;        /* modelled average current since boot */
+} power_stats_t;
+
+/* Configure esp_pm and the sleep hooks. Call once in app_main, before trigger_init. */
+void power_init(void);
+
+void power_get_stats(power_stats_t *out);
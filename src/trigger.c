@@ -0,0 +1,522 @@
+/**
+ * Trigger inputs – see trigger.h.
+ *
+ * TRIGGER_FILTER_NONE / SOFT use one raw GPIO interrupt for every input: the
+ * ISR reads the interrupt status registers once and handles each pending pin.
+ * PCNT uses one pulse counter unit per input and no GPIO interrupt.
+ * With POWER_SAVE_ENABLE the GPIO interrupts are level-triggered, because only
+ * a level can wake the chip from light sleep: each input waits for the
+ * opposite of its last known level and flips on every interrupt, which turns
+ * the levels back into edges.
+ *
+ * The ISR and the debounce timer only queue edges and notify the trigger
+ * task; the state table, the latch callback and the latency probe all run
+ * there. An edge that finds the applied-edge ring full is still applied, so
+ * the state stays right; only the consumer's copy of it is lost.
+ */
+
+#include <stdatomic.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "driver/gpio.h"
+#include "driver/pulse_cnt.h"
+#include "hal/gpio_ll.h"
+#include "soc/gpio_struct.h"
+#include "trigger.h"
+
+/* Edge ring between producer (ISR or debounce timer) and the trigger task, and
+ * applied-edge ring from the trigger task to the consumer (powers of two). */
+#define EDGE_RING_SIZE     32
+#define EVENT_RING_SIZE    32
+
+/* Notification bit from the ISR / debounce timer to the trigger task. */
+#define TRIGGER_BIT_EDGE   BIT0
+
+#if TRIGGER_FILTER_MODE == TRIGGER_FILTER_PCNT
+_Static_assert(TRIGGER_NUM_INPUTS <= 8, "ESP32 has 8 PCNT units");
+#endif
+
+static const char *TAG = "trigger";
+
+const trigger_input_t trigger_inputs[TRIGGER_NUM_INPUTS] = { TRIGGER_INPUTS };
+
+/*
+ * Single-producer / single-consumer ring. Indices run freely and are masked on
+ * access; head - tail is the fill level.
+ */
+static trigger_edge_t s_edge_ring[EDGE_RING_SIZE];
+static atomic_uint s_edge_head;
+static atomic_uint s_edge_tail;
+static uint32_t s_edge_seq;        /* producer only */
+static atomic_uint s_edge_dropped; /* edges lost because a ring was full */
+
+/* Same scheme, trigger task -> consumer. */
+static trigger_event_t s_event_ring[EVENT_RING_SIZE];
+static atomic_uint s_event_head;
+static atomic_uint s_event_tail;
+
+static TaskHandle_t s_trigger_task;
+static trigger_latch_fn_t s_on_latch;
+static TaskHandle_t s_consumer;
+static uint32_t s_notify_bits;
+
+static trigger_latency_t s_latency = { .min_us = UINT32_MAX };
+static portMUX_TYPE s_latency_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/* GPIO number -> input index, for the shared ISR. ESP32 has GPIO0..39. */
+static uint8_t s_pin_to_input[40];
+
+#if POWER_SAVE_ENABLE
+/* Pin is held low and waits to be released; otherwise it waits for the next press. */
+static bool s_wait_high[40];
+#endif
+
+#if TRIGGER_FILTER_MODE != TRIGGER_FILTER_NONE
+static esp_timer_handle_t s_debounce_timer[TRIGGER_NUM_INPUTS];
+static int64_t s_pending_edge_us[TRIGGER_NUM_INPUTS];  /* first edge of the pulse being verified */
+#endif
+#if TRIGGER_FILTER_MODE == TRIGGER_FILTER_PCNT
+static pcnt_unit_handle_t s_pcnt_unit[TRIGGER_NUM_INPUTS];
+#endif
+
+static trigger_state_t s_state;
+static portMUX_TYPE s_state_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/* Producer side of the edge ring. Exactly one context calls this (ISR or debounce timer). */
+static inline void IRAM_ATTR edge_ring_push(int input, int64_t time_us, int64_t now)
+{
+    uint32_t head = atomic_load_explicit(&s_edge_head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&s_edge_tail, memory_order_acquire);
+
+    s_edge_seq++;
+    if (head - tail < EDGE_RING_SIZE) {
+        trigger_edge_t *e = &s_edge_ring[head & (EDGE_RING_SIZE - 1)];
+        e->seq = s_edge_seq;
+        e->input = (uint8_t)input;
+        e->queued_us = (uint32_t)now;
+        e->time_us = time_us;
+        atomic_store_explicit(&s_edge_head, head + 1, memory_order_release);
+    } else {
+        atomic_fetch_add_explicit(&s_edge_dropped, 1, memory_order_relaxed);
+    }
+}
+
+static bool edge_ring_pop(trigger_edge_t *out)
+{
+    uint32_t tail = atomic_load_explicit(&s_edge_tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&s_edge_head, memory_order_acquire);
+    if (tail == head) {
+        return false;
+    }
+    *out = s_edge_ring[tail & (EDGE_RING_SIZE - 1)];
+    atomic_store_explicit(&s_edge_tail, tail + 1, memory_order_release);
+    return true;
+}
+
+/* Producer side of the applied-edge ring; trigger task only. */
+static bool event_ring_push(const trigger_edge_t *e, bool latched)
+{
+    uint32_t head = atomic_load_explicit(&s_event_head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&s_event_tail, memory_order_acquire);
+    if (head - tail >= EVENT_RING_SIZE) {
+        atomic_fetch_add_explicit(&s_edge_dropped, 1, memory_order_relaxed);
+        return false;
+    }
+    trigger_event_t *ev = &s_event_ring[head & (EVENT_RING_SIZE - 1)];
+    ev->edge = *e;
+    ev->latched = latched;
+    atomic_store_explicit(&s_event_head, head + 1, memory_order_release);
+    return true;
+}
+
+bool trigger_event_pop(trigger_event_t *out)
+{
+    uint32_t tail = atomic_load_explicit(&s_event_tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&s_event_head, memory_order_acquire);
+    if (tail == head) {
+        return false;
+    }
+    *out = s_event_ring[tail & (EVENT_RING_SIZE - 1)];
+    atomic_store_explicit(&s_event_tail, tail + 1, memory_order_release);
+    return true;
+}
+
+#if TRIGGER_FILTER_MODE != TRIGGER_FILTER_NONE
+/* Start verifying a pulse: remember when it began, check the level after TRIGGER_MIN_PULSE_MS. */
+static inline void IRAM_ATTR trigger_pulse_begin(int input, int64_t now)
+{
+    s_pending_edge_us[input] = now;
+    esp_timer_start_once(s_debounce_timer[input], TRIGGER_MIN_PULSE_MS * 1000);
+}
+#endif
+
+#if POWER_SAVE_ENABLE
+/* Interrupt (and wake) on the level opposite to the one just seen. ISR-safe: one register write. */
+static inline void IRAM_ATTR trigger_wait_level(int pin, bool high)
+{
+    s_wait_high[pin] = high;
+    gpio_ll_set_intr_type(&GPIO, pin, high ? GPIO_INTR_HIGH_LEVEL : GPIO_INTR_LOW_LEVEL);
+}
+#endif
+
+#if TRIGGER_FILTER_MODE != TRIGGER_FILTER_PCNT
+/*
+ * Shared ISR for all inputs. ESP32 keeps GPIO0-31 in status/in and GPIO32-39
+ * in status1/in1; both are read and acknowledged once per interrupt.
+ * NONE: every pending pin becomes an edge. SOFT: the pin is masked and its
+ * pulse is verified by the debounce timer, so bounce never re-enters here.
+ * Level mode (POWER_SAVE_ENABLE) reports a pin only when it is found low while
+ * waiting for low; a release just re-arms it for the next press.
+ */
+static void IRAM_ATTR trigger_isr(void *arg)
+{
+    (void)arg;
+    uint32_t st_lo = GPIO.status;
+    uint32_t st_hi = GPIO.status1.val;
+    GPIO.status_w1tc = st_lo;
+    GPIO.status1_w1tc.val = st_hi;
+    uint64_t pending = ((uint64_t)st_hi << 32) | st_lo;
+    int64_t now = esp_timer_get_time();
+#if POWER_SAVE_ENABLE
+    uint64_t levels = ((uint64_t)GPIO.in1.val << 32) | GPIO.in;
+#endif
+
+    while (pending) {
+        int pin = __builtin_ctzll(pending);
+        pending &= pending - 1;
+        int input = s_pin_to_input[pin];
+        if (input >= TRIGGER_NUM_INPUTS) {
+            continue;
+        }
+#if POWER_SAVE_ENABLE
+        bool high = (levels >> pin) & 1;
+        if (high || s_wait_high[pin]) {
+            if (high && s_wait_high[pin]) {
+                trigger_wait_level(pin, false);   /* released */
+            }
+            continue;                             /* else stale: the level already moved on */
+        }
+#endif
+#if TRIGGER_FILTER_MODE == TRIGGER_FILTER_NONE
+        edge_ring_push(input, now, now);
+#if POWER_SAVE_ENABLE
+        trigger_wait_level(pin, true);
+#endif
+#else
+        gpio_intr_disable(pin);
+        trigger_pulse_begin(input, now);
+#endif
+    }
+
+#if TRIGGER_FILTER_MODE == TRIGGER_FILTER_NONE
+    BaseType_t woken = pdFALSE;
+    if (s_trigger_task) {
+        xTaskNotifyFromISR(s_trigger_task, TRIGGER_BIT_EDGE, eSetBits, &woken);
+    }
+    portYIELD_FROM_ISR(woken);
+#endif
+}
+#else
+/* PCNT watch point at count 1: the first filtered edge. Later bounces only bump the counter. */
+static bool IRAM_ATTR trigger_pcnt_on_reach(pcnt_unit_handle_t unit,
+                                            const pcnt_watch_event_data_t *edata, void *ctx)
+{
+    (void)unit;
+    (void)edata;
+    trigger_pulse_begin((int)(intptr_t)ctx, esp_timer_get_time());
+    return false;
+}
+#endif
+
+#if TRIGGER_FILTER_MODE != TRIGGER_FILTER_NONE
+/*
+ * Count edges rejected by the input filter: pulses shorter than
+ * TRIGGER_MIN_PULSE_MS, and (PCNT) extra edges absorbed while a pulse was verified.
+ */
+static void trigger_count_filtered(int input, uint32_t n)
+{
+    taskENTER_CRITICAL(&s_state_lock);
+    s_state.in[input].filtered += n;
+    s_state.rev++;
+    taskEXIT_CRITICAL(&s_state_lock);
+}
+
+/* esp_timer task: report the pulse if the input is still asserted, then re-arm the input. */
+static void trigger_debounce_cb(void *arg)
+{
+    int input = (int)(intptr_t)arg;
+    gpio_num_t gpio = trigger_inputs[input].gpio;
+#if TRIGGER_FILTER_MODE == TRIGGER_FILTER_PCNT
+    int count = 0;
+    pcnt_unit_get_count(s_pcnt_unit[input], &count);
+    pcnt_unit_clear_count(s_pcnt_unit[input]);   /* re-arms the watch point */
+    if (count > 1) {
+        trigger_count_filtered(input, (uint32_t)(count - 1));
+    }
+#endif
+    int level = gpio_get_level(gpio);
+    if (level == 0) {
+        edge_ring_push(input, s_pending_edge_us[input], esp_timer_get_time());
+        if (s_trigger_task) {
+            xTaskNotify(s_trigger_task, TRIGGER_BIT_EDGE, eSetBits);
+        }
+    } else {
+        trigger_count_filtered(input, 1);
+    }
+#if TRIGGER_FILTER_MODE == TRIGGER_FILTER_SOFT
+#if POWER_SAVE_ENABLE
+    trigger_wait_level(gpio, level == 0);   /* a change before the enable still fires */
+#endif
+    gpio_intr_enable(gpio);
+#endif
+}
+#endif
+
+#if TRIGGER_FILTER_MODE == TRIGGER_FILTER_PCNT
+/* Count falling edges on one input in hardware, behind the PCNT glitch filter. */
+static void trigger_pcnt_init(int input)
+{
+    pcnt_unit_config_t unit_config = {
+        .low_limit  = -1,
+        .high_limit = 0x7fff,
+    };
+    ESP_ERROR_CHECK(pcnt_new_unit(&unit_config, &s_pcnt_unit[input]));
+
+    pcnt_glitch_filter_config_t filter_config = {
+        .max_glitch_ns = TRIGGER_GLITCH_NS,
+    };
+    ESP_ERROR_CHECK(pcnt_unit_set_glitch_filter(s_pcnt_unit[input], &filter_config));
+
+    pcnt_chan_config_t chan_config = {
+        .edge_gpio_num  = trigger_inputs[input].gpio,
+        .level_gpio_num = -1,
+    };
+    pcnt_channel_handle_t chan = NULL;
+    ESP_ERROR_CHECK(pcnt_new_channel(s_pcnt_unit[input], &chan_config, &chan));
+    ESP_ERROR_CHECK(pcnt_channel_set_edge_action(chan, PCNT_CHANNEL_EDGE_ACTION_HOLD,
+                                                 PCNT_CHANNEL_EDGE_ACTION_INCREASE));
+
+    ESP_ERROR_CHECK(pcnt_unit_add_watch_point(s_pcnt_unit[input], 1));
+    pcnt_event_callbacks_t cbs = {
+        .on_reach = trigger_pcnt_on_reach,
+    };
+    ESP_ERROR_CHECK(pcnt_unit_register_event_callbacks(s_pcnt_unit[input], &cbs,
+                                                       (void *)(intptr_t)input));
+    ESP_ERROR_CHECK(pcnt_unit_enable(s_pcnt_unit[input]));
+    ESP_ERROR_CHECK(pcnt_unit_clear_count(s_pcnt_unit[input]));
+    ESP_ERROR_CHECK(pcnt_unit_start(s_pcnt_unit[input]));
+}
+#endif
+
+/*
+ * Allocate the input interrupt(s). Interrupts are taken by the core that
+ * allocates them, so this runs in the trigger task: the ISR and the task it
+ * wakes share TRIGGER_TASK_CORE, away from the network stack.
+ */
+static void trigger_arm(void)
+{
+#if TRIGGER_FILTER_MODE == TRIGGER_FILTER_PCNT
+    for (int i = 0; i < TRIGGER_NUM_INPUTS; i++) {
+        trigger_pcnt_init(i);
+    }
+#else
+    ESP_ERROR_CHECK(gpio_isr_register(trigger_isr, NULL, TRIGGER_ISR_FLAGS, NULL));
+#endif
+}
+
+static void trigger_latency_observe(uint32_t us)
+{
+    taskENTER_CRITICAL(&s_latency_lock);
+    s_latency.count++;
+    s_latency.sum_us += us;
+    if (us < s_latency.min_us) {
+        s_latency.min_us = us;
+    }
+    if (us > s_latency.max_us) {
+        s_latency.max_us = us;
+    }
+    taskEXIT_CRITICAL(&s_latency_lock);
+}
+
+/* Drain the edge ring: latch, run the callback, then pass each edge on to the consumer. */
+static void trigger_task(void *arg)
+{
+    (void)arg;
+    trigger_arm();
+    for (;;) {
+        uint32_t bits = 0;
+        xTaskNotifyWait(0, UINT32_MAX, &bits, portMAX_DELAY);
+
+        bool pushed = false;
+        trigger_edge_t e;
+        while (edge_ring_pop(&e)) {
+            trigger_latency_observe((uint32_t)esp_timer_get_time() - e.queued_us);
+            bool latched = trigger_apply_edge(&e);
+            if (latched && s_on_latch) {
+                s_on_latch(&e);
+            }
+            pushed |= event_ring_push(&e, latched);
+        }
+        if (pushed && s_consumer) {
+            xTaskNotify(s_consumer, s_notify_bits, eSetBits);
+        }
+    }
+}
+
+void trigger_init(trigger_latch_fn_t on_latch, TaskHandle_t consumer, uint32_t notify_bits)
+{
+    s_on_latch = on_latch;
+    s_consumer = consumer;
+    s_notify_bits = notify_bits;
+
+    uint64_t pin_mask = 0;
+    memset(s_pin_to_input, 0xff, sizeof(s_pin_to_input));
+    for (int i = 0; i < TRIGGER_NUM_INPUTS; i++) {
+        gpio_num_t gpio = trigger_inputs[i].gpio;
+        if (gpio < 0 || gpio >= (int)sizeof(s_pin_to_input)) {
+            ESP_LOGE(TAG, "input '%s': invalid GPIO %d", trigger_inputs[i].name, gpio);
+            ESP_ERROR_CHECK(ESP_ERR_INVALID_ARG);
+        }
+        s_pin_to_input[gpio] = (uint8_t)i;
+        pin_mask |= 1ULL << gpio;
+    }
+
+    /* Trigger inputs: falling edge latches triggered state. */
+    gpio_config_t trigger_io = {
+        .pin_bit_mask = pin_mask,
+        .mode         = GPIO_MODE_INPUT,
+        .pull_up_en   = GPIO_PULLUP_DISABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+#if TRIGGER_FILTER_MODE == TRIGGER_FILTER_PCNT
+        .intr_type    = GPIO_INTR_DISABLE,   /* edges are taken by PCNT */
+#else
+        .intr_type    = GPIO_INTR_NEGEDGE,
+#endif
+    };
+    ESP_ERROR_CHECK(gpio_config(&trigger_io));
+#if POWER_SAVE_ENABLE
+    /* Sets the pin to a level interrupt as well; esp_sleep_enable_gpio_wakeup() is in power.c. */
+    for (int i = 0; i < TRIGGER_NUM_INPUTS; i++) {
+        gpio_num_t gpio = trigger_inputs[i].gpio;
+        bool low = gpio_get_level(gpio) == 0;
+        s_wait_high[gpio] = low;
+        ESP_ERROR_CHECK(gpio_wakeup_enable(gpio, low ? GPIO_INTR_HIGH_LEVEL : GPIO_INTR_LOW_LEVEL));
+    }
+#endif
+
+#if TRIGGER_FILTER_MODE != TRIGGER_FILTER_NONE
+    for (int i = 0; i < TRIGGER_NUM_INPUTS; i++) {
+        esp_timer_create_args_t debounce_args = {
+            .callback = trigger_debounce_cb,
+            .arg      = (void *)(intptr_t)i,
+            .name     = "debounce",
+        };
+        ESP_ERROR_CHECK(esp_timer_create(&debounce_args, &s_debounce_timer[i]));
+    }
+#endif
+
+    xTaskCreatePinnedToCore(trigger_task, "trigger", 3072, NULL, TRIGGER_TASK_PRIO,
+                            &s_trigger_task, TRIGGER_TASK_CORE);
+
+    for (int i = 0; i < TRIGGER_NUM_INPUTS; i++) {
+#if TRIGGER_FILTER_MODE == TRIGGER_FILTER_PCNT
+        ESP_LOGI(TAG, "input %d '%s' GPIO %d via PCNT (glitch filter %d ns, min pulse %d ms)",
+                 i, trigger_inputs[i].name, trigger_inputs[i].gpio, TRIGGER_GLITCH_NS, TRIGGER_MIN_PULSE_MS);
+#elif TRIGGER_FILTER_MODE == TRIGGER_FILTER_SOFT
+        ESP_LOGI(TAG, "input %d '%s' GPIO %d (min pulse %d ms)",
+                 i, trigger_inputs[i].name, trigger_inputs[i].gpio, TRIGGER_MIN_PULSE_MS);
+#else
+        ESP_LOGI(TAG, "input %d '%s' GPIO %d (unfiltered)",
+                 i, trigger_inputs[i].name, trigger_inputs[i].gpio);
+#endif
+    }
+}
+
+trigger_state_t trigger_snapshot(void)
+{
+    taskENTER_CRITICAL(&s_state_lock);
+    trigger_state_t snap = s_state;
+    taskEXIT_CRITICAL(&s_state_lock);
+    return snap;
+}
+
+bool trigger_apply_edge(const trigger_edge_t *e)
+{
+    bool latched = false;
+    uint32_t bit = 1u << e->input;
+    trigger_input_state_t *in = &s_state.in[e->input];
+    taskENTER_CRITICAL(&s_state_lock);
+    s_state.rev++;
+    in->edges++;
+    if (!(s_state.latched & bit) && e->time_us >= in->reset_us) {
+        s_state.gen++;
+        s_state.latched |= bit;
+        in->seq = e->seq;
+        in->time_us = e->time_us;
+        latched = true;
+    }
+    taskEXIT_CRITICAL(&s_state_lock);
+    return latched;
+}
+
+void trigger_reset(uint32_t mask)
+{
+    int64_t now = esp_timer_get_time();
+    taskENTER_CRITICAL(&s_state_lock);
+    if (s_state.latched & mask) {
+        s_state.gen++;
+        s_state.rev++;
+    }
+    s_state.latched &= ~mask;
+    for (int i = 0; i < TRIGGER_NUM_INPUTS; i++) {
+        if (mask & (1u << i)) {
+            s_state.in[i].seq = 0;
+            s_state.in[i].time_us = 0;
+            s_state.in[i].reset_us = now;
+        }
+    }
+    taskEXIT_CRITICAL(&s_state_lock);
+}
+
+void trigger_restore(uint32_t latched)
+{
+    taskENTER_CRITICAL(&s_state_lock);
+    s_state.latched = latched & TRIGGER_ALL_INPUTS;
+    s_state.rev++;
+    taskEXIT_CRITICAL(&s_state_lock);
+}
+
+uint32_t trigger_levels(void)
+{
+    uint64_t in = ((uint64_t)GPIO.in1.val << 32) | GPIO.in;
+    uint32_t levels = 0;
+    for (int i = 0; i < TRIGGER_NUM_INPUTS; i++) {
+        if (in & (1ULL << trigger_inputs[i].gpio)) {
+            levels |= 1u << i;
+        }
+    }
+    return levels;
+}
+
+void trigger_get_latency(trigger_latency_t *out)
+{
+    taskENTER_CRITICAL(&s_latency_lock);
+    *out = s_latency;
+    taskEXIT_CRITICAL(&s_latency_lock);
+}
+
+uint32_t trigger_dropped(void)
+{
+    return atomic_load_explicit(&s_edge_dropped, memory_order_relaxed);
+}
+
+int trigger_find_input(const char *name)
+{
+    for (int i = 0; i < TRIGGER_NUM_INPUTS; i++) {
+        if (strcmp(trigger_inputs[i].name, name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
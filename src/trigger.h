@@ -0,0 +1,103 @@
+/**
+ * Trigger inputs: edge capture, filtering and the latched state table.
+ *
+ * One shared GPIO ISR (or the PCNT/debounce path, see TRIGGER_FILTER_MODE)
+ * timestamps edges into a lock-free single-producer/single-consumer ring.
+ * The trigger task (TRIGGER_TASK_PRIO, pinned to TRIGGER_TASK_CORE, which
+ * also takes the interrupt) drains it, applies each edge to the state table
+ * and runs the latch callback, then hands the edge on to one consumer task
+ * through a second ring, trigger_event_pop(). The consumer does the slow
+ * fan-out; everyone else reads trigger_snapshot().
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "driver/gpio.h"
+#include "doormon_config.h"
+
+typedef struct {
+    gpio_num_t  gpio;
+    const char *name;
+} trigger_input_t;
+
+enum { TRIGGER_NUM_INPUTS = sizeof((trigger_input_t[]){ TRIGGER_INPUTS }) / sizeof(trigger_input_t) };
+_Static_assert(TRIGGER_NUM_INPUTS >= 1 && TRIGGER_NUM_INPUTS <= 32, "1..32 trigger inputs");
+
+#define TRIGGER_ALL_INPUTS  ((uint32_t)(((uint64_t)1 << TRIGGER_NUM_INPUTS) - 1))
+
+extern const trigger_input_t trigger_inputs[TRIGGER_NUM_INPUTS];
+
+/* One captured edge. */
+typedef struct {
+    uint32_t seq;       /* edge sequence number since boot, shared by all inputs; gaps mean ring overflow */
+    uint8_t  input;     /* index into trigger_inputs */
+    uint32_t queued_us; /* low 32 bits of esp_timer_get_time() when it entered the ring */
+    int64_t  time_us;   /* esp_timer_get_time() at the edge */
+} trigger_edge_t;
+
+/* One edge as applied by the trigger task. */
+typedef struct {
+    trigger_edge_t edge;
+    bool           latched;   /* it latched its input */
+} trigger_event_t;
+
+/* Edge ring to trigger task (queued_us to picked up), since boot. */
+typedef struct {
+    uint32_t count;
+    uint32_t min_us;
+    uint32_t max_us;
+    uint64_t sum_us;
+} trigger_latency_t;
+
+/* Trigger task, as soon as e has latched its input. Keep it short. */
+typedef void (*trigger_latch_fn_t)(const trigger_edge_t *e);
+
+typedef struct {
+    uint32_t seq;       /* edge that latched this input (0 = none / restored from NVS) */
+    uint32_t edges;     /* edges seen since boot, including ones after the latch */
+    uint32_t filtered;  /* edges rejected by the input filter since boot */
+    int64_t  time_us;   /* timestamp of the latching edge */
+    int64_t  reset_us;  /* last reset; older edges still queued must not re-latch */
+} trigger_input_state_t;
+
+typedef struct {
+    uint32_t              gen;       /* bumped on every latch/clear; clients compare to detect change */
+    uint32_t              rev;       /* bumped on any change to this struct (superset of gen) */
+    uint32_t              latched;   /* bit i set = input i triggered */
+    trigger_input_state_t in[TRIGGER_NUM_INPUTS];
+} trigger_state_t;
+
+/*
+ * Configure inputs and filters and start the trigger task, which arms the
+ * interrupt on its own core. consumer is notified with notify_bits once per
+ * batch of applied edges.
+ */
+void trigger_init(trigger_latch_fn_t on_latch, TaskHandle_t consumer, uint32_t notify_bits);
+
+/* Consumer side of the applied-edge ring; false when empty. */
+bool trigger_event_pop(trigger_event_t *out);
+
+/* Apply one edge to the state table; true if it latched its input. Trigger task only. */
+bool trigger_apply_edge(const trigger_edge_t *e);
+
+void trigger_get_latency(trigger_latency_t *out);
+
+/* Clear the inputs in mask. */
+void trigger_reset(uint32_t mask);
+
+/* Set latched bits restored from NVS (before trigger_init). */
+void trigger_restore(uint32_t latched);
+
+trigger_state_t trigger_snapshot(void);
+
+/* Live input levels, bit i = input i reads high. Reads the GPIO input registers once. */
+uint32_t trigger_levels(void);
+
+/* Edges lost because the edge ring, or the applied-edge ring to the consumer, was full. */
+uint32_t trigger_dropped(void);
+
+/* Index of the input with this name, or -1. */
+int trigger_find_input(const char *name);
@@ -0,0 +1,295 @@
+/**
+ * WiFi station – see wifi.h.
+ *
+ * Retries run from a one-shot esp_timer so the event loop never blocks. The
+ * BSSID/channel of the last successful association is cached in NVS and used
+ * to pin the next connect; after WIFI_PIN_MAX_FAILS misses the pin is dropped
+ * and the driver falls back to a full scan for the SSID.
+ *
+ * WIFI_IP_DHCP_REBOOT is plain DHCP started in INIT-REBOOT: lwIP
+ * (CONFIG_LWIP_DHCP_RESTORE_LAST_IP) keeps the last address in NVS and asks for
+ * it with one REQUEST/ACK instead of DISCOVER/OFFER/REQUEST/ACK. Nothing is
+ * applied before the ACK, so the saving is one round trip, not the whole
+ * exchange; a NAK falls back to DISCOVER and renewals run as usual.
+ * WIFI_IP_STATIC applies a build-time address and never starts DHCP.
+ *
+ * POWER_SAVE_ENABLE keeps the radio in modem sleep between beacons: every
+ * DTIM (WIFI_PS_MIN_MODEM), or every POWER_LISTEN_INTERVAL beacons (MAX).
+ */
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "esp_system.h"
+#include "esp_wifi.h"
+#include "esp_event.h"
+#include "esp_log.h"
+#include "esp_mac.h"
+#include "esp_timer.h"
+#include "esp_netif.h"
+#include "nvs.h"
+
+#include "doormon_config.h"
+#include "wifi.h"
+
+/* The lwIP option decides which exchange DHCP starts with; the mode has to agree. */
+#if WIFI_IP_MODE == WIFI_IP_DHCP_REBOOT && !CONFIG_LWIP_DHCP_RESTORE_LAST_IP
+#error "WIFI_IP_DHCP_REBOOT needs CONFIG_LWIP_DHCP_RESTORE_LAST_IP=y (sdkconfig.defaults)"
+#elif WIFI_IP_MODE == WIFI_IP_DHCP && CONFIG_LWIP_DHCP_RESTORE_LAST_IP
+#error "WIFI_IP_DHCP needs CONFIG_LWIP_DHCP_RESTORE_LAST_IP off, or lwIP starts in INIT-REBOOT anyway"
+#endif
+
+static const char *TAG = "wifi";
+
+static EventGroupHandle_t s_wifi_event_group;
+#define WIFI_CONNECTED_BIT BIT0
+
+static wifi_got_ip_cb_t s_on_got_ip;
+static esp_timer_handle_t s_boot_timer;   /* reboots if the first connect never completes */
+
+/* Last AP we associated with, as stored under NVS_KEY_WIFI_AP. */
+typedef struct {
+    char    ssid[33];    /* cache is ignored if WIFI_SSID changed */
+    uint8_t bssid[6];
+    uint8_t channel;
+} wifi_ap_cache_t;
+
+static wifi_ap_cache_t s_ap;
+static bool s_ap_valid;
+static bool s_pinned;             /* current driver config has bssid_set */
+
+static esp_netif_t *s_netif;
+
+static esp_timer_handle_t s_retry_timer;
+static uint32_t s_fails;          /* consecutive failed attempts; 0 while associated */
+static int64_t s_lost_us;         /* when the IP was lost, 0 = never had one */
+static atomic_uint s_disconnects;
+static atomic_uint s_reconnects;
+
+/* Open the namespace read-write and store one blob; logs on failure. */
+static void wifi_blob_save(const char *key, const void *data, size_t len)
+{
+    nvs_handle_t h;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &h);
+    if (err == ESP_OK) {
+        err = nvs_set_blob(h, key, data, len);
+        if (err == ESP_OK) {
+            err = nvs_commit(h);
+        }
+        nvs_close(h);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "%s save failed: %s", key, esp_err_to_name(err));
+    }
+}
+
+static void wifi_ap_load(void)
+{
+    nvs_handle_t h;
+    if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &h) != ESP_OK) {
+        return;
+    }
+    size_t len = sizeof(s_ap);
+    if (nvs_get_blob(h, NVS_KEY_WIFI_AP, &s_ap, &len) == ESP_OK && len == sizeof(s_ap)
+        && strncmp(s_ap.ssid, WIFI_SSID, sizeof(s_ap.ssid)) == 0 && s_ap.channel) {
+        s_ap_valid = true;
+        ESP_LOGI(TAG, "cached AP " MACSTR " ch %u", MAC2STR(s_ap.bssid), s_ap.channel);
+    }
+    nvs_close(h);
+}
+
+/* Runs in the event loop task; only writes when the AP actually changed. */
+static void wifi_ap_save(const uint8_t bssid[6], uint8_t channel)
+{
+    if (s_ap_valid && s_ap.channel == channel && memcmp(s_ap.bssid, bssid, 6) == 0) {
+        return;
+    }
+    memset(&s_ap, 0, sizeof(s_ap));
+    strncpy(s_ap.ssid, WIFI_SSID, sizeof(s_ap.ssid) - 1);
+    memcpy(s_ap.bssid, bssid, 6);
+    s_ap.channel = channel;
+    s_ap_valid = true;
+    wifi_blob_save(NVS_KEY_WIFI_AP, &s_ap, sizeof(s_ap));
+}
+
+/* Point the driver at the cached AP (pin) or let it scan for the SSID. Only while not associated. */
+static void wifi_apply_config(bool pin)
+{
+    wifi_config_t wifi_config = {
+        .sta = {
+            .threshold.authmode = WIFI_AUTH_WPA2_PSK,
+        },
+    };
+    strncpy((char *)wifi_config.sta.ssid, WIFI_SSID, sizeof(wifi_config.sta.ssid) - 1);
+    strncpy((char *)wifi_config.sta.password, WIFI_PASSWORD, sizeof(wifi_config.sta.password) - 1);
+    if (pin) {
+        wifi_config.sta.bssid_set = true;
+        memcpy(wifi_config.sta.bssid, s_ap.bssid, 6);
+        wifi_config.sta.channel = s_ap.channel;
+    }
+#if POWER_SAVE_ENABLE && POWER_LISTEN_INTERVAL > 0
+    wifi_config.sta.listen_interval = POWER_LISTEN_INTERVAL;
+#endif
+    ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &wifi_config));
+    s_pinned = pin;
+}
+
+#if WIFI_IP_MODE == WIFI_IP_STATIC
+static void wifi_set_dns(esp_ip4_addr_t addr)
+{
+    esp_netif_dns_info_t dns = { 0 };
+    dns.ip.type = ESP_IPADDR_TYPE_V4;
+    dns.ip.u_addr.ip4 = addr;
+    if (addr.addr) {
+        esp_netif_set_dns_info(s_netif, ESP_NETIF_DNS_MAIN, &dns);
+    }
+}
+#endif
+
+/* On association: give the netif its fixed address (static mode). */
+static void wifi_ip_fast_path(void)
+{
+#if WIFI_IP_MODE == WIFI_IP_STATIC
+    esp_netif_ip_info_t ip = {
+        .ip.addr      = esp_ip4addr_aton(WIFI_STATIC_IP),
+        .netmask.addr = esp_ip4addr_aton(WIFI_STATIC_NETMASK),
+        .gw.addr      = esp_ip4addr_aton(WIFI_STATIC_GW),
+    };
+    ESP_ERROR_CHECK(esp_netif_set_ip_info(s_netif, &ip));
+    wifi_set_dns((esp_ip4_addr_t){ .addr = esp_ip4addr_aton(WIFI_STATIC_DNS) });
+#endif
+}
+
+static void wifi_retry_cb(void *arg)
+{
+    esp_err_t err = esp_wifi_connect();
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "esp_wifi_connect: %s", esp_err_to_name(err));
+    }
+}
+
+static void wifi_boot_timeout_cb(void *arg)
+{
+    ESP_LOGE(TAG, "no connection after %d s, rebooting", (int)(WIFI_CONNECT_TIMEOUT_MS / 1000));
+    esp_restart();
+}
+
+static void wifi_event_handler(void *arg, esp_event_base_t event_base,
+                               int32_t event_id, void *event_data)
+{
+    if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_START) {
+        esp_wifi_connect();
+    } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_CONNECTED) {
+        wifi_event_sta_connected_t *event = (wifi_event_sta_connected_t *)event_data;
+        s_fails = 0;
+        ESP_LOGI(TAG, "associated, ch %u at %lld ms", event->channel,
+                 (long long)(esp_timer_get_time() / 1000));
+        wifi_ap_save(event->bssid, event->channel);
+        wifi_ip_fast_path();
+    } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED) {
+        wifi_event_sta_disconnected_t *event = (wifi_event_sta_disconnected_t *)event_data;
+        if (xEventGroupGetBits(s_wifi_event_group) & WIFI_CONNECTED_BIT) {
+            s_lost_us = esp_timer_get_time();
+        }
+        xEventGroupClearBits(s_wifi_event_group, WIFI_CONNECTED_BIT);
+        s_fails++;
+        atomic_fetch_add_explicit(&s_disconnects, 1, memory_order_relaxed);
+
+        bool pin = s_ap_valid && s_fails <= WIFI_PIN_MAX_FAILS;
+        if (pin != s_pinned) {
+            if (!pin) {
+                ESP_LOGW(TAG, "cached AP unreachable, scanning for SSID");
+            }
+            wifi_apply_config(pin);
+        }
+
+        uint32_t shift = s_fails - 1 < 16 ? s_fails - 1 : 16;
+        uint32_t delay_ms = WIFI_BACKOFF_MIN_MS << shift;
+        if (delay_ms > WIFI_BACKOFF_MAX_MS) {
+            delay_ms = WIFI_BACKOFF_MAX_MS;
+        }
+        ESP_LOGW(TAG, "disconnected (reason %d), retry %u in %u ms",
+                 event->reason, (unsigned)s_fails, (unsigned)delay_ms);
+        esp_timer_stop(s_retry_timer);
+        esp_timer_start_once(s_retry_timer, (uint64_t)delay_ms * 1000);
+    } else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
+        ip_event_got_ip_t *event = (ip_event_got_ip_t *)event_data;
+        if (s_lost_us) {
+            atomic_fetch_add_explicit(&s_reconnects, 1, memory_order_relaxed);
+            ESP_LOGI(TAG, "got ip: " IPSTR " (offline %lld ms)", IP2STR(&event->ip_info.ip),
+                     (long long)((esp_timer_get_time() - s_lost_us) / 1000));
+        } else {
+            ESP_LOGI(TAG, "got ip: " IPSTR, IP2STR(&event->ip_info.ip));
+            esp_timer_stop(s_boot_timer);
+        }
+        xEventGroupSetBits(s_wifi_event_group, WIFI_CONNECTED_BIT);
+        if (s_on_got_ip) {
+            s_on_got_ip();
+        }
+    }
+}
+
+void wifi_init_sta(wifi_got_ip_cb_t on_got_ip)
+{
+    s_wifi_event_group = xEventGroupCreate();
+    s_on_got_ip = on_got_ip;
+
+    esp_timer_create_args_t retry_args = {
+        .callback = wifi_retry_cb,
+        .name     = "wifi_retry",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&retry_args, &s_retry_timer));
+    esp_timer_create_args_t boot_args = {
+        .callback = wifi_boot_timeout_cb,
+        .name     = "wifi_boot",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&boot_args, &s_boot_timer));
+
+    ESP_ERROR_CHECK(esp_netif_init());
+    ESP_ERROR_CHECK(esp_event_loop_create_default());
+    s_netif = esp_netif_create_default_wifi_sta();
+#if WIFI_IP_MODE == WIFI_IP_STATIC
+    ESP_ERROR_CHECK(esp_netif_dhcpc_stop(s_netif));
+#endif
+
+    wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
+    ESP_ERROR_CHECK(esp_wifi_init(&cfg));
+
+    esp_event_handler_instance_t instance_any_id;
+    esp_event_handler_instance_t instance_got_ip;
+    ESP_ERROR_CHECK(esp_event_handler_instance_register(WIFI_EVENT,
+                                                        ESP_EVENT_ANY_ID,
+                                                        &wifi_event_handler,
+                                                        NULL,
+                                                        &instance_any_id));
+    ESP_ERROR_CHECK(esp_event_handler_instance_register(IP_EVENT,
+                                                        IP_EVENT_STA_GOT_IP,
+                                                        &wifi_event_handler,
+                                                        NULL,
+                                                        &instance_got_ip));
+
+    wifi_ap_load();
+    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
+    wifi_apply_config(s_ap_valid);
+    ESP_ERROR_CHECK(esp_wifi_start());
+#if POWER_SAVE_ENABLE
+    ESP_ERROR_CHECK(esp_wifi_set_ps(POWER_LISTEN_INTERVAL > 0 ? WIFI_PS_MAX_MODEM : WIFI_PS_MIN_MODEM));
+#endif
+
+    ESP_ERROR_CHECK(esp_timer_start_once(s_boot_timer, (uint64_t)WIFI_CONNECT_TIMEOUT_MS * 1000));
+
+    ESP_LOGI(TAG, "wifi_init_sta done, connecting to SSID:%s (up to %d s)...",
+             WIFI_SSID, (int)(WIFI_CONNECT_TIMEOUT_MS / 1000));
+}
+
+void wifi_get_stats(wifi_stats_t *out)
+{
+    wifi_ap_record_t ap;
+    out->connected = (xEventGroupGetBits(s_wifi_event_group) & WIFI_CONNECTED_BIT) != 0;
+    out->rssi = (out->connected && esp_wifi_sta_get_ap_info(&ap) == ESP_OK) ? ap.rssi : 0;
+    out->disconnects = atomic_load_explicit(&s_disconnects, memory_order_relaxed);
+    out->reconnects = atomic_load_explicit(&s_reconnects, memory_order_relaxed);
+}
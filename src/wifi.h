@@ -0,0 +1,30 @@
+/**
+ * WiFi station: association, in-place reconnect with backoff, and a cached
+ * BSSID/channel in NVS so both reconnects and cold boots skip the full scan.
+ *
+ * After the first connection, losing the AP never reboots: the driver is
+ * re-pointed at the last good AP and retried with exponential backoff, while
+ * httpd, mDNS and the trigger ISR keep running.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Called from the event loop task on every IP_EVENT_STA_GOT_IP (first connect and each reconnect). */
+typedef void (*wifi_got_ip_cb_t)(void);
+
+/*
+ * Start the station and return at once; on_got_ip reports each connection.
+ * Reboots if there is no first IP within WIFI_CONNECT_TIMEOUT_MS. Needs NVS.
+ */
+void wifi_init_sta(wifi_got_ip_cb_t on_got_ip);
+
+typedef struct {
+    bool     connected;
+    int8_t   rssi;           /* dBm of the current AP; 0 when not connected */
+    uint32_t disconnects;    /* WIFI_EVENT_STA_DISCONNECTED since boot, failed attempts included */
+    uint32_t reconnects;     /* IPs regained after losing one */
+} wifi_stats_t;
+
+void wifi_get_stats(wifi_stats_t *out);
@@ -0,0 +1,240 @@
+/**
+ * Host micro-benchmarks of the firmware hot paths, plus an event-storm replay.
+ *
+ *   doormon_host_bench [-n iterations] [-q] [trace]
+ *
+ * Micro-benchmarks report wall-clock ns per call on this machine: useful for
+ * comparing changes, not as ESP32 numbers. The storm drives the door input
+ * with a pulse train on the simulated clock – a seeded random one, or a trace
+ * file of "<ms> <level>" lines – and checks the state table stayed coherent.
+ * -q uses small counts so the run fits in a CI test.
+ */
+
+#include <string.h>
+#include <time.h>
+#include "sim.h"
+
+#include "main.c"
+
+#define DOOR_GPIO  trigger_inputs[0].gpio
+
+static double wall_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void report(const char *name, unsigned n, double t0)
+{
+    printf("%-28s %10u  %9.1f ns/op\n", name, n, (wall_ns() - t0) / n);
+}
+
+static void bench_format_json(unsigned n)
+{
+    static char buf[STATE_JSON_MAX];
+    trigger_state_t st = trigger_snapshot();
+    double t0 = wall_ns();
+    for (unsigned i = 0; i < n; i++) {
+        st.gen = i;
+        state_format_json(buf, sizeof(buf), &st, 1);
+    }
+    report("state_format_json", n, t0);
+}
+
+/* Re-render every call: the cost paid once per state change. */
+static void bench_render_miss(unsigned n)
+{
+    double t0 = wall_ns();
+    for (unsigned i = 0; i < n; i++) {
+        s_render.valid = false;
+        state_render();
+    }
+    report("state_render (miss)", n, t0);
+}
+
+/* The common case: state unchanged since the last render. */
+static void bench_render_hit(unsigned n)
+{
+    state_render();
+    double t0 = wall_ns();
+    for (unsigned i = 0; i < n; i++) {
+        state_render();
+    }
+    report("state_render (hit)", n, t0);
+}
+
+static void bench_status(unsigned n, const char *inm, const char *name)
+{
+    sim_http_resp_t r;
+    double t0 = wall_ns();
+    for (unsigned i = 0; i < n; i++) {
+        sim_http(HTTP_GET, "/status", inm, &r);
+    }
+    report(name, n, t0);
+}
+
+static void bench_apply_edge(unsigned n)
+{
+    trigger_edge_t e = { .input = 0 };
+    double t0 = wall_ns();
+    for (unsigned i = 0; i < n; i++) {
+        e.seq = i;
+        e.time_us = i;
+        trigger_apply_edge(&e);
+    }
+    report("trigger_apply_edge", n, t0);
+    trigger_reset(TRIGGER_ALL_INPUTS);
+}
+
+static void bench_metrics_observe(unsigned n)
+{
+    static metrics_hist_t h;
+    double t0 = wall_ns();
+    for (unsigned i = 0; i < n; i++) {
+        metrics_observe(&h, i & 0xfffff);
+    }
+    report("metrics_observe", n, t0);
+}
+
+/* xorshift32: the same storm on every run and every machine. */
+static uint32_t s_rng = 0x2545f491;
+
+static uint32_t rnd(uint32_t lo, uint32_t hi)
+{
+    s_rng ^= s_rng << 13;
+    s_rng ^= s_rng >> 17;
+    s_rng ^= s_rng << 5;
+    return lo + s_rng % (hi - lo + 1);
+}
+
+typedef struct {
+    unsigned levels;         /* level changes applied */
+    unsigned resets;
+} storm_stats_t;
+
+static int64_t s_storm_t0;
+
+/* Set the door level at ms into the storm; every so often a client clears the latch. */
+static void storm_step(storm_stats_t *ss, int64_t at_ms, int level)
+{
+    int64_t now = esp_timer_get_time();
+    int64_t at_us = s_storm_t0 + at_ms * 1000;
+    if (at_us > now) {
+        sim_advance_us(at_us - now);
+    }
+    sim_gpio_set_level(DOOR_GPIO, level);
+    ss->levels++;
+    if (ss->levels % 64 == 0) {
+        sim_http_resp_t r;
+        sim_http(HTTP_POST, "/reset", NULL, &r);
+        ss->resets++;
+    }
+}
+
+static bool storm_from_file(storm_stats_t *ss, const char *path)
+{
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        return false;
+    }
+    long long ms;
+    int level;
+    while (fscanf(f, "%lld %d", &ms, &level) == 2) {
+        storm_step(ss, ms, level);
+    }
+    fclose(f);
+    return true;
+}
+
+/* Bouncy presses, glitches shorter than the filter, and long holds, back to back. */
+static void storm_random(storm_stats_t *ss, unsigned pulses)
+{
+    int64_t ms = 0;
+    for (unsigned i = 0; i < pulses; i++) {
+        storm_step(ss, ms, 0);
+        ms += rnd(1, 3 * TRIGGER_MIN_PULSE_MS);
+        storm_step(ss, ms, 1);
+        ms += rnd(1, 50);
+    }
+}
+
+static int bench_storm(unsigned pulses, const char *trace)
+{
+    storm_stats_t ss = { 0 };
+    trigger_input_state_t before = trigger_snapshot().in[0];
+    unsigned commits_before = sim_nvs_commits();
+    s_storm_t0 = esp_timer_get_time();
+    double t0 = wall_ns();
+    if (trace) {
+        if (!storm_from_file(&ss, trace)) {
+            return 1;
+        }
+    } else {
+        storm_random(&ss, pulses);
+    }
+    sim_gpio_set_level(DOOR_GPIO, 1);
+    sim_advance_ms(NVS_COALESCE_MS * 2);
+    double wall = wall_ns() - t0;
+
+    trigger_state_t st = trigger_snapshot();
+    unsigned edges = st.in[0].edges - before.edges;
+    unsigned filtered = st.in[0].filtered - before.filtered;
+    double virt_s = (esp_timer_get_time() - s_storm_t0) / 1e6;
+    printf("storm: %u level changes, %u resets over %.1f s simulated in %.1f ms wall\n",
+           ss.levels, ss.resets, virt_s, wall / 1e6);
+    printf("storm: %u edges accepted, %u filtered, %u dropped, gen %u, %u NVS commits\n",
+           edges, filtered, (unsigned)trigger_dropped(), (unsigned)st.gen,
+           sim_nvs_commits() - commits_before);
+
+    /* Every falling edge is accepted or filtered unless the ring overflowed. */
+    unsigned falling = (ss.levels + 1) / 2;
+    if (edges + filtered + trigger_dropped() > falling) {
+        fprintf(stderr, "storm: more edges than falling transitions (%u)\n", falling);
+        return 1;
+    }
+    uint32_t nvs = 0;
+    if (sim_nvs_get_u32(NVS_NAMESPACE, NVS_KEY_LATCH, &nvs) && nvs != st.latched) {
+        fprintf(stderr, "storm: NVS holds 0x%x, state is 0x%x\n", (unsigned)nvs, (unsigned)st.latched);
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    unsigned n = 200000;
+    bool quick = false;
+    const char *trace = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            n = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-q") == 0) {
+            quick = true;
+        } else {
+            trace = argv[i];
+        }
+    }
+    if (quick) {
+        n = 2000;
+    }
+
+    sim_init();
+    app_main();
+    sim_settle();
+    sim_wifi_got_ip();
+
+    bench_format_json(n);
+    bench_render_miss(n);
+    bench_render_hit(n);
+    bench_status(n, NULL, "GET /status (200)");
+    state_render();
+    char etag[sizeof(s_render.etag)];
+    memcpy(etag, s_render.etag, sizeof(etag));
+    bench_status(n, etag, "GET /status (304)");
+    bench_apply_edge(n);
+    bench_metrics_observe(n);
+
+    return bench_storm(quick ? 500 : 20000, trace);
+}
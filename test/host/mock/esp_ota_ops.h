@@ -0,0 +1,3 @@
+/* Host build: see idf_mock.h. */
+#pragma once
+#include "idf_mock.h"
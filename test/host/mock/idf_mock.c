@@ -0,0 +1,1620 @@
+/**
+ * Host simulator – see sim.h.
+ *
+ * One mutex (s_sim) is held by whichever context is running: the driver
+ * thread, or a task thread between two blocking xTaskNotifyWait() calls.
+ * A task gives it up only by blocking, and the driver only in sim_settle(),
+ * so there is never real concurrency and no critical section is needed.
+ */
+
+#include <pthread.h>
+#include <stdarg.h>
+#include <string.h>
+#include <unistd.h>
+#include "sim.h"
+#include "wifi.h"
+
+/* ---- scheduler ---------------------------------------------------------- */
+
+#define SIM_MAX_TASKS  8
+
+struct sim_task {
+    pthread_t      thread;
+    const char    *name;
+    uint32_t       stack;
+    TaskFunction_t fn;
+    void          *arg;
+    uint32_t       notify_value;
+    bool           notify_pending;
+    bool           blocked;
+    int64_t        wake_us;        /* INT64_MAX = no timeout */
+};
+
+static pthread_mutex_t s_sim = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  s_cond = PTHREAD_COND_INITIALIZER;   /* any task state change */
+static struct sim_task s_tasks[SIM_MAX_TASKS];
+static int             s_num_tasks;
+static int64_t         s_now_us;
+
+void sim_init(void)
+{
+    pthread_mutex_lock(&s_sim);
+}
+
+static void *task_main(void *p)
+{
+    struct sim_task *t = p;
+    pthread_mutex_lock(&s_sim);
+    t->fn(t->arg);
+    /* A FreeRTOS task must not return; park it for good if it does. */
+    t->blocked = true;
+    t->wake_us = INT64_MAX;
+    pthread_cond_broadcast(&s_cond);
+    for (;;) {
+        pthread_cond_wait(&s_cond, &s_sim);
+    }
+    return NULL;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack, void *arg,
+                       UBaseType_t prio, TaskHandle_t *out)
+{
+    (void)prio;
+    if (s_num_tasks == SIM_MAX_TASKS) {
+        return pdFALSE;
+    }
+    struct sim_task *t = &s_tasks[s_num_tasks++];
+    t->name = name;
+    t->stack = stack;
+    t->fn = fn;
+    t->arg = arg;
+    t->wake_us = INT64_MAX;
+    if (out) {
+        *out = t;
+    }
+    pthread_create(&t->thread, NULL, task_main, t);
+    return pdPASS;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack, void *arg,
+                                   UBaseType_t prio, TaskHandle_t *out, BaseType_t core)
+{
+    (void)core;
+    return xTaskCreate(fn, name, stack, arg, prio, out);
+}
+
+static struct sim_task *current_task(void)
+{
+    pthread_t self = pthread_self();
+    for (int i = 0; i < s_num_tasks; i++) {
+        if (pthread_equal(s_tasks[i].thread, self)) {
+            return &s_tasks[i];
+        }
+    }
+    return NULL;
+}
+
+BaseType_t xTaskNotify(TaskHandle_t t, uint32_t value, eNotifyAction action)
+{
+    switch (action) {
+    case eSetBits:
+        t->notify_value |= value;
+        break;
+    case eIncrement:
+        t->notify_value++;
+        break;
+    case eSetValueWithOverwrite:
+    case eSetValueWithoutOverwrite:
+        t->notify_value = value;
+        break;
+    default:
+        break;
+    }
+    t->notify_pending = true;
+    if (t->blocked) {
+        t->blocked = false;
+        pthread_cond_broadcast(&s_cond);
+    }
+    return pdPASS;
+}
+
+BaseType_t xTaskNotifyFromISR(TaskHandle_t t, uint32_t value, eNotifyAction action, BaseType_t *woken)
+{
+    if (woken) {
+        *woken = pdTRUE;
+    }
+    return xTaskNotify(t, value, action);
+}
+
+BaseType_t xTaskNotifyWait(uint32_t clear_on_entry, uint32_t clear_on_exit, uint32_t *value, TickType_t ticks)
+{
+    struct sim_task *t = current_task();
+    if (!t->notify_pending) {
+        t->notify_value &= ~clear_on_entry;
+        if (ticks == 0) {
+            return pdFALSE;
+        }
+        /* Ticks count from the current tick boundary, as in FreeRTOS. */
+        t->wake_us = ticks == portMAX_DELAY ? INT64_MAX
+                                            : (s_now_us / 1000 + (int64_t)ticks) * 1000;
+        t->blocked = true;
+        pthread_cond_broadcast(&s_cond);
+        while (t->blocked) {
+            pthread_cond_wait(&s_cond, &s_sim);
+        }
+        t->wake_us = INT64_MAX;
+    }
+    if (value) {
+        *value = t->notify_value;
+    }
+    if (!t->notify_pending) {
+        return pdFALSE;
+    }
+    t->notify_pending = false;
+    t->notify_value &= ~clear_on_exit;
+    return pdTRUE;
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    struct sim_task *t = current_task();
+    int64_t wake = (s_now_us / 1000 + (int64_t)ticks) * 1000;
+    while (s_now_us < wake) {
+        t->wake_us = wake;
+        t->blocked = true;
+        pthread_cond_broadcast(&s_cond);
+        while (t->blocked) {
+            pthread_cond_wait(&s_cond, &s_sim);
+        }
+    }
+    t->wake_us = INT64_MAX;
+}
+
+/* Only a task deleting itself; it stays parked, and its slot is not reused. */
+void vTaskDelete(TaskHandle_t task)
+{
+    struct sim_task *t = current_task();
+    if (task && task != t) {
+        abort();
+    }
+    t->blocked = true;
+    t->wake_us = INT64_MAX;
+    pthread_cond_broadcast(&s_cond);
+    for (;;) {
+        pthread_cond_wait(&s_cond, &s_sim);
+    }
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    return (TickType_t)(s_now_us / 1000);
+}
+
+TaskHandle_t xTaskGetHandle(const char *name)
+{
+    for (int i = 0; i < s_num_tasks; i++) {
+        if (strcmp(s_tasks[i].name, name) == 0) {
+            return &s_tasks[i];
+        }
+    }
+    return NULL;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t t)
+{
+    return t->stack / 2;
+}
+
+/* Uncontended by construction; see the file comment. */
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    static int dummy;
+    return &dummy;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks)
+{
+    (void)sem;
+    (void)ticks;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem)
+{
+    (void)sem;
+    return pdTRUE;
+}
+
+/* ---- esp_timer ---------------------------------------------------------- */
+
+struct esp_timer {
+    const char       *name;
+    esp_timer_cb_t    cb;
+    void             *arg;
+    bool              active;
+    int64_t           expiry_us;
+    uint64_t          period_us;   /* 0 = one-shot */
+    struct esp_timer *next;
+};
+
+static struct esp_timer *s_timers;
+
+int64_t esp_timer_get_time(void)
+{
+    return s_now_us;
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out)
+{
+    struct esp_timer *t = calloc(1, sizeof(*t));
+    if (!t) {
+        return ESP_ERR_NO_MEM;
+    }
+    t->name = args->name;
+    t->cb = args->callback;
+    t->arg = args->arg;
+    t->next = s_timers;
+    s_timers = t;
+    *out = t;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t t, uint64_t timeout_us)
+{
+    if (t->active) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    t->active = true;
+    t->expiry_us = s_now_us + (int64_t)timeout_us;
+    t->period_us = 0;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t t, uint64_t period_us)
+{
+    if (t->active) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    t->active = true;
+    t->expiry_us = s_now_us + (int64_t)period_us;
+    t->period_us = period_us;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t t)
+{
+    if (!t->active) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    t->active = false;
+    return ESP_OK;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t t)
+{
+    return t->active;
+}
+
+bool sim_timer_armed(const char *name)
+{
+    for (struct esp_timer *t = s_timers; t; t = t->next) {
+        if (t->active && t->name && strcmp(t->name, name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* ---- httpd work queue --------------------------------------------------- */
+
+#define SIM_WORK_QUEUE_LEN  16
+
+static struct {
+    httpd_work_fn_t fn;
+    void           *arg;
+} s_work[SIM_WORK_QUEUE_LEN];
+static unsigned s_work_head;
+static unsigned s_work_count;
+
+esp_err_t httpd_queue_work(httpd_handle_t hd, httpd_work_fn_t fn, void *arg)
+{
+    (void)hd;
+    if (s_work_count == SIM_WORK_QUEUE_LEN) {
+        return ESP_FAIL;
+    }
+    unsigned tail = (s_work_head + s_work_count) % SIM_WORK_QUEUE_LEN;
+    s_work[tail].fn = fn;
+    s_work[tail].arg = arg;
+    s_work_count++;
+    return ESP_OK;
+}
+
+static bool tasks_idle(void)
+{
+    for (int i = 0; i < s_num_tasks; i++) {
+        if (!s_tasks[i].blocked) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void sim_settle(void)
+{
+    for (;;) {
+        while (!tasks_idle()) {
+            pthread_cond_wait(&s_cond, &s_sim);
+        }
+        if (!s_work_count) {
+            return;
+        }
+        httpd_work_fn_t fn = s_work[s_work_head].fn;
+        void *arg = s_work[s_work_head].arg;
+        s_work_head = (s_work_head + 1) % SIM_WORK_QUEUE_LEN;
+        s_work_count--;
+        fn(arg);
+    }
+}
+
+/* Earliest timer expiry or task timeout; *due is the timer, or NULL for a task. */
+static int64_t next_deadline(struct esp_timer **due)
+{
+    int64_t next = INT64_MAX;
+    *due = NULL;
+    for (struct esp_timer *t = s_timers; t; t = t->next) {
+        if (t->active && t->expiry_us < next) {
+            next = t->expiry_us;
+            *due = t;
+        }
+    }
+    for (int i = 0; i < s_num_tasks; i++) {
+        if (s_tasks[i].blocked && s_tasks[i].wake_us < next) {
+            next = s_tasks[i].wake_us;
+            *due = NULL;
+        }
+    }
+    return next;
+}
+
+void sim_advance_us(int64_t us)
+{
+    int64_t target = s_now_us + us;
+    sim_settle();
+    for (;;) {
+        struct esp_timer *due;
+        int64_t next = next_deadline(&due);
+        if (next > target) {
+            break;
+        }
+        if (next > s_now_us) {
+            s_now_us = next;
+        }
+        if (due) {
+            if (due->period_us) {
+                due->expiry_us += (int64_t)due->period_us;
+            } else {
+                due->active = false;
+            }
+            due->cb(due->arg);
+        } else {
+            for (int i = 0; i < s_num_tasks; i++) {
+                if (s_tasks[i].blocked && s_tasks[i].wake_us <= s_now_us) {
+                    s_tasks[i].blocked = false;
+                }
+            }
+            pthread_cond_broadcast(&s_cond);
+        }
+        sim_settle();
+    }
+    s_now_us = target;
+}
+
+/* ---- GPIO --------------------------------------------------------------- */
+
+#define SIM_NUM_GPIO  40
+
+volatile gpio_dev_t GPIO = { .in = 0xffffffffu, .in1 = { 0xff } };   /* inputs idle high */
+
+static gpio_int_type_t s_intr_type[SIM_NUM_GPIO];
+static bool            s_intr_enabled[SIM_NUM_GPIO];
+static int             s_out_level[SIM_NUM_GPIO];
+static void          (*s_isr)(void *);
+static void           *s_isr_arg;
+
+esp_err_t gpio_config(const gpio_config_t *cfg)
+{
+    for (int pin = 0; pin < SIM_NUM_GPIO; pin++) {
+        if (cfg->pin_bit_mask & (1ULL << pin)) {
+            s_intr_type[pin] = cfg->intr_type;
+            s_intr_enabled[pin] = cfg->intr_type != GPIO_INTR_DISABLE;
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_level(gpio_num_t gpio, uint32_t level)
+{
+    if (gpio < 0 || gpio >= SIM_NUM_GPIO) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_out_level[gpio] = level ? 1 : 0;
+    return ESP_OK;
+}
+
+int gpio_get_level(gpio_num_t gpio)
+{
+    if (gpio < 32) {
+        return (GPIO.in >> gpio) & 1;
+    }
+    return (GPIO.in1.val >> (gpio - 32)) & 1;
+}
+
+static void gpio_level_check(gpio_num_t gpio);
+
+esp_err_t gpio_intr_enable(gpio_num_t gpio)
+{
+    s_intr_enabled[gpio] = true;
+    gpio_level_check(gpio);
+    return ESP_OK;
+}
+
+esp_err_t gpio_intr_disable(gpio_num_t gpio)
+{
+    s_intr_enabled[gpio] = false;
+    return ESP_OK;
+}
+
+esp_err_t gpio_isr_register(void (*fn)(void *), void *arg, int intr_alloc_flags, void *handle)
+{
+    (void)intr_alloc_flags;
+    (void)handle;
+    s_isr = fn;
+    s_isr_arg = arg;
+    return ESP_OK;
+}
+
+/* gpio_wakeup_enable() also switches the pin to that level interrupt, as on the device. */
+esp_err_t gpio_wakeup_enable(gpio_num_t gpio, gpio_int_type_t intr_type)
+{
+    if (intr_type != GPIO_INTR_LOW_LEVEL && intr_type != GPIO_INTR_HIGH_LEVEL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_intr_type[gpio] = intr_type;
+    return ESP_OK;
+}
+
+/* Register write only: a level that now matches fires once the ISR (or the enable) is done. */
+void gpio_ll_set_intr_type(volatile gpio_dev_t *hw, uint32_t gpio_num, gpio_int_type_t intr_type)
+{
+    (void)hw;
+    s_intr_type[gpio_num] = intr_type;
+}
+
+static void gpio_raise(gpio_num_t gpio)
+{
+    if (gpio < 32) {
+        GPIO.status |= 1u << gpio;
+    } else {
+        GPIO.status1.val |= 1u << (gpio - 32);
+    }
+    s_isr(s_isr_arg);
+    /* The ISR acknowledges through the write-1-to-clear registers. */
+    GPIO.status &= ~GPIO.status_w1tc;
+    GPIO.status1.val &= ~GPIO.status1_w1tc.val;
+    GPIO.status_w1tc = 0;
+    GPIO.status1_w1tc.val = 0;
+}
+
+/*
+ * A level interrupt keeps firing while the pin sits at that level, so the ISR
+ * must mask the pin or flip the type. A few rounds are allowed for a stale
+ * status bit; more than that is an interrupt storm and ends the test.
+ */
+static void gpio_level_check(gpio_num_t gpio)
+{
+    for (int round = 0; round < 4; round++) {
+        gpio_int_type_t type = s_intr_type[gpio];
+        if (!s_isr || !s_intr_enabled[gpio] ||
+            (type != GPIO_INTR_LOW_LEVEL && type != GPIO_INTR_HIGH_LEVEL) ||
+            gpio_get_level(gpio) != (type == GPIO_INTR_HIGH_LEVEL)) {
+            return;
+        }
+        gpio_raise(gpio);
+    }
+    fprintf(stderr, "GPIO%d: level interrupt storm\n", gpio);
+    abort();
+}
+
+void sim_gpio_set_level(gpio_num_t gpio, int level)
+{
+    int old = gpio_get_level(gpio);
+    level = level ? 1 : 0;
+    if (gpio < 32) {
+        GPIO.in = (GPIO.in & ~(1u << gpio)) | ((uint32_t)level << gpio);
+    } else {
+        GPIO.in1.val = (GPIO.in1.val & ~(1u << (gpio - 32))) | ((uint32_t)level << (gpio - 32));
+    }
+    if (old == level || !s_intr_enabled[gpio]) {
+        return;
+    }
+    gpio_int_type_t type = s_intr_type[gpio];
+    if (type == GPIO_INTR_LOW_LEVEL || type == GPIO_INTR_HIGH_LEVEL) {
+        gpio_level_check(gpio);
+        return;
+    }
+    bool fire = type == GPIO_INTR_ANYEDGE ||
+                (type == GPIO_INTR_NEGEDGE && !level) ||
+                (type == GPIO_INTR_POSEDGE && level);
+    if (fire && s_isr) {
+        gpio_raise(gpio);
+    }
+}
+
+int sim_gpio_output(gpio_num_t gpio)
+{
+    return s_out_level[gpio];
+}
+
+gpio_int_type_t sim_gpio_intr_type(gpio_num_t gpio)
+{
+    return s_intr_type[gpio];
+}
+
+/* ---- power management --------------------------------------------------- */
+
+static bool                               s_pm_light_sleep;
+static esp_pm_sleep_cbs_register_config_t s_pm_cbs;
+
+esp_err_t esp_pm_configure(const void *config)
+{
+    s_pm_light_sleep = ((const esp_pm_config_t *)config)->light_sleep_enable;
+    return ESP_OK;
+}
+
+esp_err_t esp_pm_light_sleep_register_cbs(esp_pm_sleep_cbs_register_config_t *cbs_conf)
+{
+    s_pm_cbs = *cbs_conf;
+    return ESP_OK;
+}
+
+esp_err_t esp_sleep_enable_gpio_wakeup(void)
+{
+    return ESP_OK;
+}
+
+int64_t sim_light_sleep_us(int64_t us)
+{
+    sim_settle();
+    struct esp_timer *due;
+    int64_t next = next_deadline(&due);
+    if (!s_pm_light_sleep || next <= s_now_us) {
+        return 0;
+    }
+    if (next - s_now_us < us) {
+        us = next - s_now_us;
+    }
+    if (s_pm_cbs.enter_cb) {
+        s_pm_cbs.enter_cb(us, s_pm_cbs.enter_cb_user_arg);
+    }
+    s_now_us += us;
+    if (s_pm_cbs.exit_cb) {
+        s_pm_cbs.exit_cb(us, s_pm_cbs.exit_cb_user_arg);
+    }
+    sim_advance_us(0);
+    return us;
+}
+
+/* ---- NVS ---------------------------------------------------------------- */
+
+#define SIM_NVS_ENTRIES  16
+#define SIM_NVS_HANDLES  8
+
+typedef enum { NVS_TYPE_U8, NVS_TYPE_U32, NVS_TYPE_BLOB } sim_nvs_type_t;
+
+static struct {
+    bool           used;
+    char           ns[16];
+    char           key[16];
+    sim_nvs_type_t type;
+    size_t         len;
+    uint8_t        data[64];
+} s_nvs[SIM_NVS_ENTRIES];
+
+static struct {
+    bool            open;
+    char            ns[16];
+    nvs_open_mode_t mode;
+} s_nvs_handles[SIM_NVS_HANDLES];
+
+static unsigned s_nvs_commits;
+static unsigned s_nvs_fail_commits;
+
+static int nvs_find(const char *ns, const char *key)
+{
+    for (int i = 0; i < SIM_NVS_ENTRIES; i++) {
+        if (s_nvs[i].used && strcmp(s_nvs[i].ns, ns) == 0 && (!key || strcmp(s_nvs[i].key, key) == 0)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static esp_err_t nvs_put(const char *ns, const char *key, sim_nvs_type_t type, const void *data, size_t len)
+{
+    if (strlen(key) >= sizeof(s_nvs[0].key) || len > sizeof(s_nvs[0].data)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    int i = nvs_find(ns, key);
+    for (int j = 0; i < 0 && j < SIM_NVS_ENTRIES; j++) {
+        if (!s_nvs[j].used) {
+            i = j;
+        }
+    }
+    if (i < 0) {
+        return ESP_ERR_NVS_NO_FREE_PAGES;
+    }
+    s_nvs[i].used = true;
+    snprintf(s_nvs[i].ns, sizeof(s_nvs[i].ns), "%s", ns);
+    snprintf(s_nvs[i].key, sizeof(s_nvs[i].key), "%s", key);
+    s_nvs[i].type = type;
+    s_nvs[i].len = len;
+    memcpy(s_nvs[i].data, data, len);
+    return ESP_OK;
+}
+
+static esp_err_t nvs_take(const char *ns, const char *key, sim_nvs_type_t type, void *out, size_t *len)
+{
+    int i = nvs_find(ns, key);
+    if (i < 0 || s_nvs[i].type != type) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    if (*len < s_nvs[i].len) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memcpy(out, s_nvs[i].data, s_nvs[i].len);
+    *len = s_nvs[i].len;
+    return ESP_OK;
+}
+
+#define NVS_HANDLE(h, writable) do {                                                    \
+        if ((h) >= SIM_NVS_HANDLES || !s_nvs_handles[h].open) {                         \
+            return ESP_ERR_INVALID_ARG;                                                 \
+        }                                                                               \
+        if ((writable) && s_nvs_handles[h].mode != NVS_READWRITE) {                     \
+            return ESP_ERR_INVALID_STATE;                                               \
+        }                                                                               \
+    } while (0)
+
+esp_err_t nvs_flash_init(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t nvs_flash_erase(void)
+{
+    memset(s_nvs, 0, sizeof(s_nvs));
+    return ESP_OK;
+}
+
+esp_err_t nvs_open(const char *ns, nvs_open_mode_t mode, nvs_handle_t *out)
+{
+    /* Like the real thing, a namespace exists once something was written to it. */
+    if (mode == NVS_READONLY && nvs_find(ns, NULL) < 0) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    for (nvs_handle_t h = 0; h < SIM_NVS_HANDLES; h++) {
+        if (!s_nvs_handles[h].open) {
+            s_nvs_handles[h].open = true;
+            s_nvs_handles[h].mode = mode;
+            snprintf(s_nvs_handles[h].ns, sizeof(s_nvs_handles[h].ns), "%s", ns);
+            *out = h;
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NO_MEM;
+}
+
+void nvs_close(nvs_handle_t h)
+{
+    if (h < SIM_NVS_HANDLES) {
+        s_nvs_handles[h].open = false;
+    }
+}
+
+esp_err_t nvs_get_u8(nvs_handle_t h, const char *key, uint8_t *out)
+{
+    NVS_HANDLE(h, false);
+    size_t len = sizeof(*out);
+    return nvs_take(s_nvs_handles[h].ns, key, NVS_TYPE_U8, out, &len);
+}
+
+esp_err_t nvs_set_u8(nvs_handle_t h, const char *key, uint8_t value)
+{
+    NVS_HANDLE(h, true);
+    return nvs_put(s_nvs_handles[h].ns, key, NVS_TYPE_U8, &value, sizeof(value));
+}
+
+esp_err_t nvs_get_u32(nvs_handle_t h, const char *key, uint32_t *out)
+{
+    NVS_HANDLE(h, false);
+    size_t len = sizeof(*out);
+    return nvs_take(s_nvs_handles[h].ns, key, NVS_TYPE_U32, out, &len);
+}
+
+esp_err_t nvs_set_u32(nvs_handle_t h, const char *key, uint32_t value)
+{
+    NVS_HANDLE(h, true);
+    return nvs_put(s_nvs_handles[h].ns, key, NVS_TYPE_U32, &value, sizeof(value));
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t h, const char *key, void *out, size_t *len)
+{
+    NVS_HANDLE(h, false);
+    return nvs_take(s_nvs_handles[h].ns, key, NVS_TYPE_BLOB, out, len);
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t h, const char *key, const void *data, size_t len)
+{
+    NVS_HANDLE(h, true);
+    return nvs_put(s_nvs_handles[h].ns, key, NVS_TYPE_BLOB, data, len);
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t h, const char *key)
+{
+    NVS_HANDLE(h, true);
+    int i = nvs_find(s_nvs_handles[h].ns, key);
+    if (i < 0) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    s_nvs[i].used = false;
+    return ESP_OK;
+}
+
+esp_err_t nvs_commit(nvs_handle_t h)
+{
+    NVS_HANDLE(h, true);
+    s_nvs_commits++;
+    if (s_nvs_fail_commits) {
+        s_nvs_fail_commits--;
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+void sim_nvs_set_u8(const char *ns, const char *key, uint8_t value)
+{
+    nvs_put(ns, key, NVS_TYPE_U8, &value, sizeof(value));
+}
+
+void sim_nvs_set_u32(const char *ns, const char *key, uint32_t value)
+{
+    nvs_put(ns, key, NVS_TYPE_U32, &value, sizeof(value));
+}
+
+bool sim_nvs_get_u32(const char *ns, const char *key, uint32_t *out)
+{
+    size_t len = sizeof(*out);
+    return nvs_take(ns, key, NVS_TYPE_U32, out, &len) == ESP_OK;
+}
+
+unsigned sim_nvs_commits(void)
+{
+    return s_nvs_commits;
+}
+
+void sim_nvs_fail_commits(unsigned n)
+{
+    s_nvs_fail_commits = n;
+}
+
+/* ---- flash partition ---------------------------------------------------- */
+
+/* Smaller than partitions.csv so tests wrap the log quickly. */
+#define SIM_FLASH_SECTOR  4096
+#define SIM_FLASH_SIZE    (4 * SIM_FLASH_SECTOR)
+
+static uint8_t s_flash[SIM_FLASH_SIZE];
+static bool    s_flash_formatted;
+static unsigned s_flash_writes;
+static unsigned s_flash_erases;
+static const esp_partition_t s_evlog_part = {
+    .type = ESP_PARTITION_TYPE_DATA, .subtype = 0x40, .address = 0x110000,
+    .size = SIM_FLASH_SIZE, .erase_size = SIM_FLASH_SECTOR, .label = "evlog",
+};
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                const char *label)
+{
+    (void)subtype;
+    if (type != ESP_PARTITION_TYPE_DATA || !label || strcmp(label, s_evlog_part.label) != 0) {
+        return NULL;
+    }
+    if (!s_flash_formatted) {
+        memset(s_flash, 0xff, sizeof(s_flash));   /* a blank chip */
+        s_flash_formatted = true;
+    }
+    return &s_evlog_part;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *part, size_t src_offset, void *dst, size_t size)
+{
+    if (part != &s_evlog_part || src_offset + size > SIM_FLASH_SIZE) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memcpy(dst, s_flash + src_offset, size);
+    return ESP_OK;
+}
+
+/* Programming only clears bits, and rewriting programmed bits is a firmware bug. */
+esp_err_t esp_partition_write(const esp_partition_t *part, size_t dst_offset, const void *src, size_t size)
+{
+    if (part != &s_evlog_part || dst_offset + size > SIM_FLASH_SIZE) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    const uint8_t *p = src;
+    for (size_t i = 0; i < size; i++) {
+        if (p[i] & ~s_flash[dst_offset + i]) {
+            fprintf(stderr, "sim: flash write over programmed bits at 0x%zx\n", dst_offset + i);
+            abort();
+        }
+        s_flash[dst_offset + i] &= p[i];
+    }
+    s_flash_writes++;
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *part, size_t offset, size_t size)
+{
+    if (part != &s_evlog_part || offset % SIM_FLASH_SECTOR || size % SIM_FLASH_SECTOR ||
+        offset + size > SIM_FLASH_SIZE) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(s_flash + offset, 0xff, size);
+    s_flash_erases += size / SIM_FLASH_SECTOR;
+    return ESP_OK;
+}
+
+unsigned sim_flash_writes(void)
+{
+    return s_flash_writes;
+}
+
+unsigned sim_flash_erases(void)
+{
+    return s_flash_erases;
+}
+
+void sim_flash_corrupt(size_t offset, uint8_t mask)
+{
+    s_flash[offset] &= ~mask;
+}
+
+/* ---- OTA ---------------------------------------------------------------- */
+
+#define SIM_OTA_IMAGE_MAX  (8 * 1024)   /* bytes of an update kept for esp_ota_get_partition_description() */
+
+static const esp_partition_t s_ota_parts[2] = {
+    { .type = ESP_PARTITION_TYPE_APP, .subtype = 0x10, .address = 0x10000,  .size = 0x180000, .label = "ota_0" },
+    { .type = ESP_PARTITION_TYPE_APP, .subtype = 0x11, .address = 0x190000, .size = 0x180000, .label = "ota_1" },
+};
+static const esp_app_desc_t s_app_desc = { .magic_word = 0xabcd5432, .version = "sim", .project_name = "doormon" };
+static bool    s_ota_pending;
+static bool    s_ota_confirmed;
+static bool    s_ota_open;
+static bool    s_ota_boot_set;
+static size_t  s_ota_written;
+static uint8_t s_ota_image[SIM_OTA_IMAGE_MAX];
+
+const esp_app_desc_t *esp_app_get_description(void)
+{
+    return &s_app_desc;
+}
+
+const esp_partition_t *esp_ota_get_running_partition(void)
+{
+    return &s_ota_parts[0];
+}
+
+const esp_partition_t *esp_ota_get_next_update_partition(const esp_partition_t *start)
+{
+    (void)start;
+    return &s_ota_parts[1];
+}
+
+esp_err_t esp_ota_get_state_partition(const esp_partition_t *part, esp_ota_img_states_t *state)
+{
+    if (part != &s_ota_parts[0]) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    *state = s_ota_pending ? ESP_OTA_IMG_PENDING_VERIFY : ESP_OTA_IMG_VALID;
+    return ESP_OK;
+}
+
+esp_err_t esp_ota_get_partition_description(const esp_partition_t *part, esp_app_desc_t *desc)
+{
+    if (part != &s_ota_parts[1] || s_ota_written < 32 + sizeof(*desc)) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    memcpy(desc, s_ota_image + 32, sizeof(*desc));
+    return desc->magic_word == s_app_desc.magic_word ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t esp_ota_begin(const esp_partition_t *part, size_t image_size, esp_ota_handle_t *out)
+{
+    (void)image_size;
+    if (part != &s_ota_parts[1] || s_ota_open) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_ota_open = true;
+    s_ota_written = 0;
+    *out = 1;
+    return ESP_OK;
+}
+
+esp_err_t esp_ota_write(esp_ota_handle_t handle, const void *data, size_t size)
+{
+    if (handle != 1 || !s_ota_open) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_ota_written == 0 && size && ((const uint8_t *)data)[0] != 0xe9) {
+        return ESP_ERR_OTA_VALIDATE_FAILED;
+    }
+    if (s_ota_written < sizeof(s_ota_image)) {
+        size_t n = sizeof(s_ota_image) - s_ota_written < size ? sizeof(s_ota_image) - s_ota_written : size;
+        memcpy(s_ota_image + s_ota_written, data, n);
+    }
+    s_ota_written += size;
+    return ESP_OK;
+}
+
+esp_err_t esp_ota_end(esp_ota_handle_t handle)
+{
+    if (handle != 1 || !s_ota_open) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_ota_open = false;
+    return ESP_OK;
+}
+
+esp_err_t esp_ota_abort(esp_ota_handle_t handle)
+{
+    (void)handle;
+    s_ota_open = false;
+    return ESP_OK;
+}
+
+esp_err_t esp_ota_set_boot_partition(const esp_partition_t *part)
+{
+    s_ota_boot_set = part == &s_ota_parts[1];
+    return s_ota_boot_set ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t esp_ota_mark_app_valid_cancel_rollback(void)
+{
+    s_ota_pending = false;
+    s_ota_confirmed = true;
+    return ESP_OK;
+}
+
+void sim_ota_set_pending_verify(void)
+{
+    s_ota_pending = true;
+}
+
+size_t sim_ota_written(void)
+{
+    return s_ota_written;
+}
+
+bool sim_ota_boot_set(void)
+{
+    return s_ota_boot_set;
+}
+
+bool sim_ota_confirmed(void)
+{
+    return s_ota_confirmed;
+}
+
+/* ---- httpd -------------------------------------------------------------- */
+
+#define SIM_MAX_HANDLERS  12
+#define SIM_MAX_SOCKS     32
+#define SIM_FIRST_FD      100   /* well clear of any real descriptor */
+
+static httpd_config_t s_httpd_config;
+static httpd_uri_t    s_handlers[SIM_MAX_HANDLERS];
+static int            s_num_handlers;
+static int            s_next_fd = SIM_FIRST_FD;
+
+static struct {
+    size_t sent;
+    bool   broken;
+    char   last[1024];
+} s_socks[SIM_MAX_SOCKS];
+
+esp_err_t httpd_start(httpd_handle_t *out, const httpd_config_t *cfg)
+{
+    s_httpd_config = *cfg;
+    *out = &s_httpd_config;
+    return ESP_OK;
+}
+
+esp_err_t httpd_register_uri_handler(httpd_handle_t hd, const httpd_uri_t *uri)
+{
+    (void)hd;
+    if (s_num_handlers == SIM_MAX_HANDLERS) {
+        return ESP_ERR_NO_MEM;
+    }
+    s_handlers[s_num_handlers++] = *uri;
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_type(httpd_req_t *req, const char *type)
+{
+    snprintf(req->resp->type, sizeof(req->resp->type), "%s", type);
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_status(httpd_req_t *req, const char *status)
+{
+    req->resp->status = atoi(status);
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_hdr(httpd_req_t *req, const char *field, const char *value)
+{
+    if (strcmp(field, "ETag") == 0) {
+        snprintf(req->resp->etag, sizeof(req->resp->etag), "%s", value);
+    }
+    return ESP_OK;
+}
+
+static void resp_append(sim_http_resp_t *resp, const char *buf, size_t len)
+{
+    size_t room = sizeof(resp->body) - 1 - resp->body_len;
+    if (len > room) {
+        len = room;
+    }
+    memcpy(resp->body + resp->body_len, buf, len);
+    resp->body_len += len;
+    resp->body[resp->body_len] = '\0';
+}
+
+esp_err_t httpd_resp_send(httpd_req_t *req, const char *buf, ssize_t len)
+{
+    if (buf) {
+        resp_append(req->resp, buf, len < 0 ? strlen(buf) : (size_t)len);
+    }
+    req->resp->done = true;
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_sendstr(httpd_req_t *req, const char *str)
+{
+    return httpd_resp_send(req, str, -1);
+}
+
+esp_err_t httpd_resp_send_chunk(httpd_req_t *req, const char *buf, ssize_t len)
+{
+    if (!buf) {
+        req->resp->done = true;
+        return ESP_OK;
+    }
+    resp_append(req->resp, buf, len < 0 ? strlen(buf) : (size_t)len);
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_send_err(httpd_req_t *req, httpd_err_code_t code, const char *msg)
+{
+    req->resp->status = code;
+    return httpd_resp_sendstr(req, msg);
+}
+
+int httpd_send(httpd_req_t *req, const char *buf, size_t len)
+{
+    (void)buf;
+    return s_socks[req->fd - SIM_FIRST_FD].broken ? -1 : (int)len;
+}
+
+int httpd_req_to_sockfd(httpd_req_t *req)
+{
+    return req->fd;
+}
+
+int httpd_socket_send(httpd_handle_t hd, int sockfd, const char *buf, size_t len, int flags)
+{
+    (void)hd;
+    (void)flags;
+    int i = sockfd - SIM_FIRST_FD;
+    if (i < 0 || i >= SIM_MAX_SOCKS || s_socks[i].broken) {
+        return -1;
+    }
+    s_socks[i].sent += len;
+    size_t n = len < sizeof(s_socks[i].last) - 1 ? len : sizeof(s_socks[i].last) - 1;
+    memcpy(s_socks[i].last, buf, n);
+    s_socks[i].last[n] = '\0';
+    return (int)len;
+}
+
+esp_err_t httpd_sess_trigger_close(httpd_handle_t hd, int sockfd)
+{
+    (void)hd;
+    (void)sockfd;
+    return ESP_OK;
+}
+
+esp_err_t httpd_req_get_url_query_str(httpd_req_t *req, char *buf, size_t len)
+{
+    const char *q = strchr(req->uri, '?');
+    if (!q) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    q++;
+    if (strlen(q) >= len) {
+        snprintf(buf, len, "%s", q);
+        return ESP_ERR_HTTPD_RESULT_TRUNC;
+    }
+    strcpy(buf, q);
+    return ESP_OK;
+}
+
+esp_err_t httpd_query_key_value(const char *query, const char *key, char *val, size_t len)
+{
+    size_t klen = strlen(key);
+    const char *p = query;
+    while (p && *p) {
+        const char *end = strchr(p, '&');
+        size_t plen = end ? (size_t)(end - p) : strlen(p);
+        if (plen > klen && strncmp(p, key, klen) == 0 && p[klen] == '=') {
+            size_t vlen = plen - klen - 1;
+            if (vlen >= len) {
+                return ESP_ERR_HTTPD_RESULT_TRUNC;
+            }
+            memcpy(val, p + klen + 1, vlen);
+            val[vlen] = '\0';
+            return ESP_OK;
+        }
+        p = end ? end + 1 : NULL;
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t httpd_req_get_hdr_value_str(httpd_req_t *req, const char *field, char *val, size_t len)
+{
+    const char *v = strcmp(field, "If-None-Match") == 0 ? req->if_none_match
+                  : strcmp(field, "Authorization") == 0 ? req->authorization : NULL;
+    if (!v) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    snprintf(val, len, "%s", v);
+    return strlen(v) < len ? ESP_OK : ESP_ERR_HTTPD_RESULT_TRUNC;
+}
+
+int httpd_req_recv(httpd_req_t *req, char *buf, size_t len)
+{
+    size_t left = req->content_len - req->body_off;
+    size_t n = len < left ? len : left;
+    if (n == 0) {
+        return HTTPD_SOCK_ERR_FAIL;
+    }
+    memcpy(buf, req->body + req->body_off, n);
+    req->body_off += n;
+    return (int)n;
+}
+
+esp_err_t httpd_req_async_handler_begin(httpd_req_t *req, httpd_req_t **out)
+{
+    httpd_req_t *copy = malloc(sizeof(*copy));
+    if (!copy) {
+        return ESP_ERR_NO_MEM;
+    }
+    *copy = *req;
+    copy->if_none_match = NULL;   /* the client's buffer is not kept; the body is, until sim_http() returns */
+    copy->authorization = NULL;
+    *out = copy;
+    return ESP_OK;
+}
+
+esp_err_t httpd_req_async_handler_complete(httpd_req_t *req)
+{
+    free(req);
+    return ESP_OK;
+}
+
+static struct {
+    const char    *authorization;
+    const uint8_t *body;
+    size_t         len;
+} s_next_req;
+
+void sim_http_set_request(const char *authorization, const void *body, size_t len)
+{
+    s_next_req.authorization = authorization;
+    s_next_req.body = body;
+    s_next_req.len = len;
+}
+
+esp_err_t sim_http(httpd_method_t method, const char *uri, const char *if_none_match,
+                   sim_http_resp_t *resp)
+{
+    memset(resp, 0, sizeof(*resp));
+    resp->status = 200;
+    resp->fd = s_next_fd;
+    if (s_next_fd < SIM_FIRST_FD + SIM_MAX_SOCKS - 1) {
+        s_next_fd++;
+    }
+
+    size_t path_len = strcspn(uri, "?");
+    const httpd_uri_t *h = NULL;
+    for (int i = 0; i < s_num_handlers; i++) {
+        if (s_handlers[i].method == method && strlen(s_handlers[i].uri) == path_len &&
+            strncmp(s_handlers[i].uri, uri, path_len) == 0) {
+            h = &s_handlers[i];
+        }
+    }
+    if (!h) {
+        memset(&s_next_req, 0, sizeof(s_next_req));
+        resp->status = 404;
+        resp->done = true;
+        return ESP_FAIL;
+    }
+
+    httpd_req_t req = {
+        .handle = &s_httpd_config,
+        .method = method,
+        .user_ctx = h->user_ctx,
+        .resp = resp,
+        .fd = resp->fd,
+        .if_none_match = if_none_match,
+        .authorization = s_next_req.authorization,
+        .body = s_next_req.body,
+        .content_len = s_next_req.len,
+    };
+    memset(&s_next_req, 0, sizeof(s_next_req));
+    snprintf(req.uri, sizeof(req.uri), "%s", uri);
+    esp_err_t err = h->handler(&req);
+    sim_settle();
+    return err;
+}
+
+size_t sim_sock_sent(int fd)
+{
+    return s_socks[fd - SIM_FIRST_FD].sent;
+}
+
+const char *sim_sock_last(int fd)
+{
+    return s_socks[fd - SIM_FIRST_FD].last;
+}
+
+void sim_sock_break(int fd)
+{
+    s_socks[fd - SIM_FIRST_FD].broken = true;
+}
+
+/* ---- UDP sockets -------------------------------------------------------- */
+
+#define SIM_MAX_UDP       4
+#define SIM_UDP_FIRST_FD  200   /* above the httpd session descriptors */
+
+static struct {
+    bool               used;
+    uint16_t           port;        /* host order, 0 = not bound */
+    struct sim_task   *waiter;      /* task blocked in recvfrom() */
+    bool               pending;     /* one inbound datagram waiting */
+    struct sockaddr_in from;
+    size_t             in_len;
+    uint8_t            in[1500];
+    unsigned           sent;
+    sim_udp_pkt_t      last;
+} s_udp[SIM_MAX_UDP];
+
+static int udp_index(int fd)
+{
+    int i = fd - SIM_UDP_FIRST_FD;
+    return i >= 0 && i < SIM_MAX_UDP && s_udp[i].used ? i : -1;
+}
+
+static int udp_by_port(uint16_t port)
+{
+    for (int i = 0; i < SIM_MAX_UDP; i++) {
+        if (s_udp[i].used && s_udp[i].port == port) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int sim_socket(int domain, int type, int protocol)
+{
+    if (type != SOCK_DGRAM) {
+        return socket(domain, type, protocol);
+    }
+    for (int i = 0; i < SIM_MAX_UDP; i++) {
+        if (!s_udp[i].used) {
+            memset(&s_udp[i], 0, sizeof(s_udp[i]));
+            s_udp[i].used = true;
+            return SIM_UDP_FIRST_FD + i;
+        }
+    }
+    return -1;
+}
+
+int sim_bind(int fd, const struct sockaddr *addr, socklen_t len)
+{
+    int i = udp_index(fd);
+    if (i < 0) {
+        return bind(fd, addr, len);
+    }
+    uint16_t port = ntohs(((const struct sockaddr_in *)addr)->sin_port);
+    if (udp_by_port(port) >= 0) {
+        return -1;
+    }
+    s_udp[i].port = port;
+    return 0;
+}
+
+/* Blocks the calling task until sim_udp_deliver() hands it a datagram. */
+ssize_t sim_recvfrom(int fd, void *buf, size_t len, int flags, struct sockaddr *from, socklen_t *from_len)
+{
+    int i = udp_index(fd);
+    if (i < 0) {
+        return recvfrom(fd, buf, len, flags, from, from_len);
+    }
+    struct sim_task *t = current_task();
+    while (!s_udp[i].pending) {
+        s_udp[i].waiter = t;
+        t->wake_us = INT64_MAX;
+        t->blocked = true;
+        pthread_cond_broadcast(&s_cond);
+        while (t->blocked) {
+            pthread_cond_wait(&s_cond, &s_sim);
+        }
+    }
+    s_udp[i].waiter = NULL;
+    s_udp[i].pending = false;
+    size_t n = s_udp[i].in_len < len ? s_udp[i].in_len : len;
+    memcpy(buf, s_udp[i].in, n);
+    if (from && from_len) {
+        socklen_t fl = *from_len < sizeof(s_udp[i].from) ? *from_len : sizeof(s_udp[i].from);
+        memcpy(from, &s_udp[i].from, fl);
+        *from_len = sizeof(s_udp[i].from);
+    }
+    return (ssize_t)n;
+}
+
+ssize_t sim_sendto(int fd, const void *buf, size_t len, int flags, const struct sockaddr *to, socklen_t to_len)
+{
+    int i = udp_index(fd);
+    if (i < 0) {
+        return sendto(fd, buf, len, flags, to, to_len);
+    }
+    if (len > sizeof(s_udp[i].last.data)) {
+        return -1;
+    }
+    s_udp[i].sent++;
+    memcpy(&s_udp[i].last.to, to, sizeof(s_udp[i].last.to));
+    memcpy(s_udp[i].last.data, buf, len);
+    s_udp[i].last.len = len;
+    return (ssize_t)len;
+}
+
+int sim_close(int fd)
+{
+    int i = udp_index(fd);
+    if (i < 0) {
+        return close(fd);
+    }
+    s_udp[i].used = false;
+    return 0;
+}
+
+bool sim_udp_deliver(uint16_t port, const struct sockaddr_in *from, const void *data, size_t len)
+{
+    int i = udp_by_port(port);
+    if (i < 0 || len > sizeof(s_udp[i].in)) {
+        return false;
+    }
+    s_udp[i].from = *from;
+    memcpy(s_udp[i].in, data, len);
+    s_udp[i].in_len = len;
+    s_udp[i].pending = true;
+    if (s_udp[i].waiter) {
+        s_udp[i].waiter->blocked = false;
+        pthread_cond_broadcast(&s_cond);
+    }
+    sim_settle();
+    return true;
+}
+
+unsigned sim_udp_sent(uint16_t port)
+{
+    int i = udp_by_port(port);
+    return i < 0 ? 0 : s_udp[i].sent;
+}
+
+const sim_udp_pkt_t *sim_udp_last(uint16_t port)
+{
+    int i = udp_by_port(port);
+    return i < 0 || !s_udp[i].sent ? NULL : &s_udp[i].last;
+}
+
+/* ---- WiFi (src/wifi.c is not built) ------------------------------------- */
+
+static wifi_got_ip_cb_t s_on_got_ip;
+
+void wifi_init_sta(wifi_got_ip_cb_t on_got_ip)
+{
+    s_on_got_ip = on_got_ip;
+}
+
+void wifi_get_stats(wifi_stats_t *out)
+{
+    *out = (wifi_stats_t){ .connected = s_on_got_ip != NULL, .rssi = -55 };
+}
+
+void sim_wifi_got_ip(void)
+{
+    if (s_on_got_ip) {
+        s_on_got_ip();
+    }
+    sim_settle();
+}
+
+/* ---- everything else ---------------------------------------------------- */
+
+esp_err_t mdns_init(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t mdns_hostname_set(const char *hostname)
+{
+    (void)hostname;
+    return ESP_OK;
+}
+
+esp_err_t mdns_instance_name_set(const char *name)
+{
+    (void)name;
+    return ESP_OK;
+}
+
+/* TXT record of the (single) advertised service; async updates apply at once. */
+#define SIM_MDNS_TXT_MAX  8
+static struct {
+    char key[16];
+    char value[32];
+} s_mdns_txt[SIM_MDNS_TXT_MAX];
+static int s_mdns_txt_len;
+
+static esp_err_t mdns_txt_store(const char *key, const char *value)
+{
+    int i = 0;
+    while (i < s_mdns_txt_len && strcmp(s_mdns_txt[i].key, key) != 0) {
+        i++;
+    }
+    if (i == SIM_MDNS_TXT_MAX) {
+        return ESP_ERR_NO_MEM;
+    }
+    if (i == s_mdns_txt_len) {
+        snprintf(s_mdns_txt[i].key, sizeof(s_mdns_txt[i].key), "%s", key);
+        s_mdns_txt_len++;
+    }
+    snprintf(s_mdns_txt[i].value, sizeof(s_mdns_txt[i].value), "%s", value);
+    return ESP_OK;
+}
+
+const char *sim_mdns_txt(const char *key)
+{
+    for (int i = 0; i < s_mdns_txt_len; i++) {
+        if (strcmp(s_mdns_txt[i].key, key) == 0) {
+            return s_mdns_txt[i].value;
+        }
+    }
+    return NULL;
+}
+
+esp_err_t mdns_service_add(const char *instance, const char *service, const char *proto,
+                           uint16_t port, mdns_txt_item_t *txt, size_t num_items)
+{
+    (void)instance;
+    (void)service;
+    (void)proto;
+    (void)port;
+    s_mdns_txt_len = 0;
+    for (size_t i = 0; i < num_items; i++) {
+        mdns_txt_store(txt[i].key, txt[i].value);
+    }
+    return ESP_OK;
+}
+
+esp_err_t mdns_service_txt_item_set_async(const char *service, const char *proto, const char *key, const char *value)
+{
+    (void)service;
+    (void)proto;
+    return mdns_txt_store(key, value);
+}
+
+/* Pools disabled: every block comes from the heap. */
+esp_err_t mdns_mem_pool_get_stats(mdns_mem_pool_t pool, mdns_mem_pool_stats_t *stats)
+{
+    if ((unsigned)pool >= MDNS_MEM_POOL_MAX || !stats) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(stats, 0, sizeof(*stats));
+    stats->block_size = 64;
+    return ESP_OK;
+}
+
+esp_err_t mdns_tx_get_stats(mdns_tx_stats_t *stats)
+{
+    if (!stats) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(stats, 0, sizeof(*stats));
+    return ESP_OK;
+}
+
+uint32_t esp_get_free_heap_size(void)
+{
+    return 200000;
+}
+
+uint32_t esp_get_minimum_free_heap_size(void)
+{
+    return 180000;
+}
+
+uint32_t esp_random(void)
+{
+    static uint32_t x = 0x2545f491;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return x;
+}
+
+void esp_restart(void)
+{
+    fprintf(stderr, "esp_restart() at %lld us\n", (long long)s_now_us);
+    abort();
+}
+
+const char *esp_err_to_name(esp_err_t code)
+{
+    switch (code) {
+    case ESP_OK:                return "ESP_OK";
+    case ESP_FAIL:              return "ESP_FAIL";
+    case ESP_ERR_NO_MEM:        return "ESP_ERR_NO_MEM";
+    case ESP_ERR_INVALID_ARG:   return "ESP_ERR_INVALID_ARG";
+    case ESP_ERR_INVALID_STATE: return "ESP_ERR_INVALID_STATE";
+    case ESP_ERR_NVS_NOT_FOUND: return "ESP_ERR_NVS_NOT_FOUND";
+    default:                    return "ESP_ERR_UNKNOWN";
+    }
+}
+
+void sim_error_check_failed(esp_err_t rc, const char *file, int line, const char *expr)
+{
+    fprintf(stderr, "ESP_ERROR_CHECK failed: %s (0x%x) at %s:%d: %s\n",
+            esp_err_to_name(rc), (unsigned)rc, file, line, expr);
+    abort();
+}
+
+void sim_log(char level, const char *tag, const char *fmt, ...)
+{
+    static int enabled = -1;
+    if (enabled < 0) {
+        enabled = getenv("DOORMON_SIM_LOG") != NULL;
+    }
+    if (!enabled) {
+        return;
+    }
+    va_list ap;
+    va_start(ap, fmt);
+    printf("%c (%lld) %s: ", level, (long long)(s_now_us / 1000), tag);
+    vprintf(fmt, ap);
+    printf("\n");
+    va_end(ap);
+}
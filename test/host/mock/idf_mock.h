@@ -0,0 +1,399 @@
+/**
+ * Host stand-ins for the ESP-IDF / FreeRTOS APIs the firmware sources use.
+ *
+ * Only what src/ actually calls is declared, with the same names and shapes;
+ * behaviour lives in idf_mock.c and is driven through sim.h. Every IDF header
+ * the firmware includes (freertos/task.h, esp_timer.h, ...) is a one-line
+ * forwarder to this file.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+
+/* esp_err.h */
+typedef int esp_err_t;
+#define ESP_OK                          0
+#define ESP_FAIL                        -1
+#define ESP_ERR_NO_MEM                  0x101
+#define ESP_ERR_INVALID_ARG             0x102
+#define ESP_ERR_INVALID_STATE           0x103
+#define ESP_ERR_INVALID_SIZE            0x104
+#define ESP_ERR_NOT_FOUND               0x105
+#define ESP_ERR_TIMEOUT                 0x107
+#define ESP_ERR_NVS_NOT_FOUND           0x1102
+#define ESP_ERR_NVS_NO_FREE_PAGES       0x110d
+#define ESP_ERR_NVS_NEW_VERSION_FOUND   0x1110
+#define ESP_ERR_OTA_VALIDATE_FAILED     0x1503
+#define ESP_ERR_HTTPD_RESULT_TRUNC      0xb009
+
+const char *esp_err_to_name(esp_err_t code);
+void sim_error_check_failed(esp_err_t rc, const char *file, int line, const char *expr);
+
+#define ESP_ERROR_CHECK(x) do {                                             \
+        esp_err_t err_rc_ = (x);                                            \
+        if (err_rc_ != ESP_OK) {                                            \
+            sim_error_check_failed(err_rc_, __FILE__, __LINE__, #x);        \
+        }                                                                   \
+    } while (0)
+
+/* esp_attr.h / esp_bit_defs.h */
+#define IRAM_ATTR
+#define BIT0    0x00000001
+#define BIT1    0x00000002
+#define BIT2    0x00000004
+#define BIT3    0x00000008
+
+/* esp_log.h: off unless DOORMON_SIM_LOG is set; debug/verbose never. */
+void sim_log(char level, const char *tag, const char *fmt, ...) __attribute__((format(printf, 3, 4)));
+#define ESP_LOGE(tag, fmt, ...) sim_log('E', tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGW(tag, fmt, ...) sim_log('W', tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGI(tag, fmt, ...) sim_log('I', tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGD(tag, fmt, ...) do { (void)(tag); if (0) { printf(fmt, ##__VA_ARGS__); } } while (0)
+#define ESP_LOGV(tag, fmt, ...) ESP_LOGD(tag, fmt, ##__VA_ARGS__)
+
+/*
+ * FreeRTOS. Tasks are threads, but only one of them (or the test driver,
+ * standing in for ISRs, esp_timer and httpd) runs at a time, so critical
+ * sections are no-ops.
+ */
+typedef int      BaseType_t;
+typedef unsigned UBaseType_t;
+typedef uint32_t TickType_t;
+typedef struct sim_task *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+typedef void *SemaphoreHandle_t;
+
+#define pdFALSE             0
+#define pdTRUE              1
+#define pdPASS              pdTRUE
+#define portMAX_DELAY       ((TickType_t)0xffffffffu)
+#define portTICK_PERIOD_MS  1
+#define pdMS_TO_TICKS(ms)   ((TickType_t)(ms))
+#define portYIELD_FROM_ISR(woken) ((void)(woken))
+
+typedef struct { int unused; } portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED    { 0 }
+#define taskENTER_CRITICAL(mux)         ((void)(mux))
+#define taskEXIT_CRITICAL(mux)          ((void)(mux))
+#define taskENTER_CRITICAL_ISR(mux)     ((void)(mux))
+#define taskEXIT_CRITICAL_ISR(mux)      ((void)(mux))
+
+typedef enum { eNoAction, eSetBits, eIncrement, eSetValueWithOverwrite, eSetValueWithoutOverwrite } eNotifyAction;
+
+#define tskNO_AFFINITY  0x7fffffff
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack, void *arg,
+                       UBaseType_t prio, TaskHandle_t *out);
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack, void *arg,
+                                   UBaseType_t prio, TaskHandle_t *out, BaseType_t core);
+BaseType_t xTaskNotify(TaskHandle_t task, uint32_t value, eNotifyAction action);
+BaseType_t xTaskNotifyFromISR(TaskHandle_t task, uint32_t value, eNotifyAction action, BaseType_t *woken);
+BaseType_t xTaskNotifyWait(uint32_t clear_on_entry, uint32_t clear_on_exit, uint32_t *value, TickType_t ticks);
+void vTaskDelay(TickType_t ticks);
+void vTaskDelete(TaskHandle_t task);
+TickType_t xTaskGetTickCount(void);
+TaskHandle_t xTaskGetHandle(const char *name);
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task);
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void);
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem);
+
+/* esp_system.h */
+void esp_restart(void) __attribute__((noreturn));
+uint32_t esp_get_free_heap_size(void);
+uint32_t esp_get_minimum_free_heap_size(void);
+/* esp_random.h: a fixed sequence */
+uint32_t esp_random(void);
+
+/* esp_timer.h, on the simulated clock */
+typedef struct esp_timer *esp_timer_handle_t;
+typedef void (*esp_timer_cb_t)(void *arg);
+typedef enum { ESP_TIMER_TASK, ESP_TIMER_ISR } esp_timer_dispatch_t;
+typedef struct {
+    esp_timer_cb_t       callback;
+    void                *arg;
+    esp_timer_dispatch_t dispatch_method;
+    const char          *name;
+    bool                 skip_unhandled_events;
+} esp_timer_create_args_t;
+
+int64_t esp_timer_get_time(void);
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out);
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us);
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period_us);
+esp_err_t esp_timer_stop(esp_timer_handle_t timer);
+bool esp_timer_is_active(esp_timer_handle_t timer);
+
+/* driver/gpio.h */
+typedef int gpio_num_t;
+#define GPIO_NUM_NC   -1
+#define GPIO_NUM_0    0
+#define GPIO_NUM_2    2
+#define GPIO_NUM_4    4
+#define GPIO_NUM_5    5
+#define GPIO_NUM_12   12
+#define GPIO_NUM_13   13
+#define GPIO_NUM_14   14
+#define GPIO_NUM_15   15
+#define GPIO_NUM_16   16
+#define GPIO_NUM_17   17
+#define GPIO_NUM_18   18
+#define GPIO_NUM_19   19
+#define GPIO_NUM_21   21
+#define GPIO_NUM_22   22
+#define GPIO_NUM_23   23
+#define GPIO_NUM_25   25
+#define GPIO_NUM_26   26
+#define GPIO_NUM_27   27
+#define GPIO_NUM_32   32
+#define GPIO_NUM_33   33
+#define GPIO_NUM_34   34
+#define GPIO_NUM_35   35
+#define GPIO_NUM_36   36
+#define GPIO_NUM_39   39
+
+typedef enum { GPIO_MODE_DISABLE, GPIO_MODE_INPUT, GPIO_MODE_OUTPUT } gpio_mode_t;
+typedef enum { GPIO_PULLUP_DISABLE, GPIO_PULLUP_ENABLE } gpio_pullup_t;
+typedef enum { GPIO_PULLDOWN_DISABLE, GPIO_PULLDOWN_ENABLE } gpio_pulldown_t;
+typedef enum {
+    GPIO_INTR_DISABLE, GPIO_INTR_POSEDGE, GPIO_INTR_NEGEDGE, GPIO_INTR_ANYEDGE,
+    GPIO_INTR_LOW_LEVEL, GPIO_INTR_HIGH_LEVEL,
+} gpio_int_type_t;
+typedef struct {
+    uint64_t        pin_bit_mask;
+    gpio_mode_t     mode;
+    gpio_pullup_t   pull_up_en;
+    gpio_pulldown_t pull_down_en;
+    gpio_int_type_t intr_type;
+} gpio_config_t;
+
+esp_err_t gpio_config(const gpio_config_t *cfg);
+esp_err_t gpio_set_level(gpio_num_t gpio, uint32_t level);
+int gpio_get_level(gpio_num_t gpio);
+esp_err_t gpio_intr_enable(gpio_num_t gpio);
+esp_err_t gpio_intr_disable(gpio_num_t gpio);
+esp_err_t gpio_wakeup_enable(gpio_num_t gpio, gpio_int_type_t intr_type);
+/* esp_intr_alloc.h, included by driver/gpio.h */
+#define ESP_INTR_FLAG_LEVEL1  (1 << 1)
+#define ESP_INTR_FLAG_LEVEL2  (1 << 2)
+#define ESP_INTR_FLAG_LEVEL3  (1 << 3)
+#define ESP_INTR_FLAG_IRAM    (1 << 10)
+
+esp_err_t gpio_isr_register(void (*fn)(void *), void *arg, int intr_alloc_flags, void *handle);
+
+/* soc/gpio_struct.h: just the registers trigger.c touches. */
+typedef union { uint32_t val; } gpio_reg32_t;
+typedef struct {
+    uint32_t     in;
+    gpio_reg32_t in1;
+    uint32_t     status;
+    uint32_t     status_w1tc;
+    gpio_reg32_t status1;
+    gpio_reg32_t status1_w1tc;
+} gpio_dev_t;
+extern volatile gpio_dev_t GPIO;
+/* hal/gpio_ll.h */
+void gpio_ll_set_intr_type(volatile gpio_dev_t *hw, uint32_t gpio_num, gpio_int_type_t intr_type);
+
+/* esp_pm.h / esp_sleep.h. The light-sleep hooks run in sim_light_sleep_us(). */
+typedef struct {
+    int  max_freq_mhz;
+    int  min_freq_mhz;
+    bool light_sleep_enable;
+} esp_pm_config_t;
+typedef esp_err_t (*esp_pm_light_sleep_cb_t)(int64_t sleep_time_us, void *arg);
+typedef struct {
+    esp_pm_light_sleep_cb_t enter_cb;
+    esp_pm_light_sleep_cb_t exit_cb;
+    void    *enter_cb_user_arg;
+    void    *exit_cb_user_arg;
+    uint32_t enter_cb_prior;
+    uint32_t exit_cb_prior;
+} esp_pm_sleep_cbs_register_config_t;
+
+esp_err_t esp_pm_configure(const void *config);
+esp_err_t esp_pm_light_sleep_register_cbs(esp_pm_sleep_cbs_register_config_t *cbs_conf);
+esp_err_t esp_sleep_enable_gpio_wakeup(void);
+
+/* nvs.h / nvs_flash.h, in RAM */
+typedef uint32_t nvs_handle_t;
+typedef enum { NVS_READONLY, NVS_READWRITE } nvs_open_mode_t;
+
+esp_err_t nvs_flash_init(void);
+esp_err_t nvs_flash_erase(void);
+esp_err_t nvs_open(const char *ns, nvs_open_mode_t mode, nvs_handle_t *out);
+void nvs_close(nvs_handle_t h);
+esp_err_t nvs_get_u8(nvs_handle_t h, const char *key, uint8_t *out);
+esp_err_t nvs_set_u8(nvs_handle_t h, const char *key, uint8_t value);
+esp_err_t nvs_get_u32(nvs_handle_t h, const char *key, uint32_t *out);
+esp_err_t nvs_set_u32(nvs_handle_t h, const char *key, uint32_t value);
+esp_err_t nvs_get_blob(nvs_handle_t h, const char *key, void *out, size_t *len);
+esp_err_t nvs_set_blob(nvs_handle_t h, const char *key, const void *data, size_t len);
+esp_err_t nvs_erase_key(nvs_handle_t h, const char *key);
+esp_err_t nvs_commit(nvs_handle_t h);
+
+/* esp_partition.h: one "evlog" data partition in RAM, with NOR flash semantics. */
+typedef enum { ESP_PARTITION_TYPE_APP = 0x00, ESP_PARTITION_TYPE_DATA = 0x01 } esp_partition_type_t;
+typedef enum { ESP_PARTITION_SUBTYPE_ANY = 0xff } esp_partition_subtype_t;
+typedef struct {
+    esp_partition_type_t type;
+    int                  subtype;
+    uint32_t             address;
+    uint32_t             size;
+    uint32_t             erase_size;
+    char                 label[17];
+} esp_partition_t;
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                const char *label);
+esp_err_t esp_partition_read(const esp_partition_t *part, size_t src_offset, void *dst, size_t size);
+esp_err_t esp_partition_write(const esp_partition_t *part, size_t dst_offset, const void *src, size_t size);
+esp_err_t esp_partition_erase_range(const esp_partition_t *part, size_t offset, size_t size);
+
+/*
+ * esp_ota_ops.h / esp_app_desc.h. The simulator runs from "ota_0" and updates
+ * "ota_1" in RAM. As on the device, the first image byte must be the 0xE9
+ * magic and the app description is read from offset 32 of the written image.
+ */
+typedef uint32_t esp_ota_handle_t;
+#define OTA_WITH_SEQUENTIAL_WRITES  0xfffffffe
+typedef struct {
+    uint32_t magic_word;
+    uint32_t secure_version;
+    uint32_t reserv1[2];
+    char     version[32];
+    char     project_name[32];
+    char     time[16];
+    char     date[16];
+    char     idf_ver[32];
+    uint8_t  app_elf_sha256[32];
+} esp_app_desc_t;
+typedef enum {
+    ESP_OTA_IMG_NEW, ESP_OTA_IMG_PENDING_VERIFY, ESP_OTA_IMG_VALID, ESP_OTA_IMG_INVALID,
+    ESP_OTA_IMG_ABORTED, ESP_OTA_IMG_UNDEFINED = -1,
+} esp_ota_img_states_t;
+
+const esp_app_desc_t *esp_app_get_description(void);
+const esp_partition_t *esp_ota_get_running_partition(void);
+const esp_partition_t *esp_ota_get_next_update_partition(const esp_partition_t *start);
+esp_err_t esp_ota_get_state_partition(const esp_partition_t *part, esp_ota_img_states_t *state);
+esp_err_t esp_ota_get_partition_description(const esp_partition_t *part, esp_app_desc_t *desc);
+esp_err_t esp_ota_begin(const esp_partition_t *part, size_t image_size, esp_ota_handle_t *out);
+esp_err_t esp_ota_write(esp_ota_handle_t handle, const void *data, size_t size);
+esp_err_t esp_ota_end(esp_ota_handle_t handle);
+esp_err_t esp_ota_abort(esp_ota_handle_t handle);
+esp_err_t esp_ota_set_boot_partition(const esp_partition_t *part);
+esp_err_t esp_ota_mark_app_valid_cancel_rollback(void);
+
+/* esp_http_server.h. Requests come from sim_http(); responses land in a sim_http_resp_t. */
+typedef void *httpd_handle_t;
+#define HTTPD_SOCK_ERR_FAIL     -1
+#define HTTPD_SOCK_ERR_TIMEOUT  -3
+typedef enum { HTTP_DELETE, HTTP_GET, HTTP_HEAD, HTTP_POST, HTTP_PUT } httpd_method_t;
+typedef enum {
+    HTTPD_400_BAD_REQUEST = 400, HTTPD_404_NOT_FOUND = 404, HTTPD_408_REQ_TIMEOUT = 408,
+    HTTPD_500_INTERNAL_SERVER_ERROR = 500,
+} httpd_err_code_t;
+
+struct sim_http_resp;
+typedef struct httpd_req {
+    httpd_handle_t handle;
+    int            method;
+    char           uri[513];
+    size_t         content_len;
+    void          *aux;
+    void          *user_ctx;
+    void          *sess_ctx;
+    /* simulator */
+    struct sim_http_resp *resp;
+    int            fd;
+    const char    *if_none_match;
+    const char    *authorization;
+    const uint8_t *body;          /* content_len bytes, consumed by httpd_req_recv() */
+    size_t         body_off;
+} httpd_req_t;
+
+typedef esp_err_t (*httpd_handler_t)(httpd_req_t *req);
+typedef struct {
+    const char    *uri;
+    httpd_method_t method;
+    httpd_handler_t handler;
+    void          *user_ctx;
+} httpd_uri_t;
+
+typedef esp_err_t (*httpd_open_func_t)(httpd_handle_t hd, int sockfd);
+typedef void (*httpd_close_func_t)(httpd_handle_t hd, int sockfd);
+typedef void (*httpd_work_fn_t)(void *arg);
+typedef struct {
+    unsigned           task_priority;
+    size_t             stack_size;
+    BaseType_t         core_id;
+    uint16_t           server_port;
+    uint16_t           max_open_sockets;
+    uint16_t           max_uri_handlers;
+    uint16_t           backlog_conn;
+    bool               lru_purge_enable;
+    uint16_t           recv_wait_timeout;
+    uint16_t           send_wait_timeout;
+    bool               keep_alive_enable;
+    int                keep_alive_idle;
+    int                keep_alive_interval;
+    int                keep_alive_count;
+    httpd_open_func_t  open_fn;
+    httpd_close_func_t close_fn;
+} httpd_config_t;
+#define HTTPD_DEFAULT_CONFIG() { .task_priority = 5, .stack_size = 4096, .core_id = tskNO_AFFINITY, \
+                                 .server_port = 80, .max_open_sockets = 7, .max_uri_handlers = 8, .backlog_conn = 5, \
+                                 .recv_wait_timeout = 5, .send_wait_timeout = 5 }
+
+esp_err_t httpd_start(httpd_handle_t *out, const httpd_config_t *cfg);
+esp_err_t httpd_register_uri_handler(httpd_handle_t hd, const httpd_uri_t *uri);
+esp_err_t httpd_queue_work(httpd_handle_t hd, httpd_work_fn_t fn, void *arg);
+esp_err_t httpd_resp_set_type(httpd_req_t *req, const char *type);
+esp_err_t httpd_resp_set_status(httpd_req_t *req, const char *status);
+esp_err_t httpd_resp_set_hdr(httpd_req_t *req, const char *field, const char *value);
+esp_err_t httpd_resp_send(httpd_req_t *req, const char *buf, ssize_t len);
+esp_err_t httpd_resp_sendstr(httpd_req_t *req, const char *str);
+esp_err_t httpd_resp_send_chunk(httpd_req_t *req, const char *buf, ssize_t len);
+esp_err_t httpd_resp_send_err(httpd_req_t *req, httpd_err_code_t code, const char *msg);
+int httpd_send(httpd_req_t *req, const char *buf, size_t len);
+int httpd_req_to_sockfd(httpd_req_t *req);
+int httpd_socket_send(httpd_handle_t hd, int sockfd, const char *buf, size_t len, int flags);
+esp_err_t httpd_sess_trigger_close(httpd_handle_t hd, int sockfd);
+esp_err_t httpd_req_get_url_query_str(httpd_req_t *req, char *buf, size_t len);
+esp_err_t httpd_query_key_value(const char *query, const char *key, char *val, size_t len);
+esp_err_t httpd_req_get_hdr_value_str(httpd_req_t *req, const char *field, char *val, size_t len);
+int httpd_req_recv(httpd_req_t *req, char *buf, size_t len);
+esp_err_t httpd_req_async_handler_begin(httpd_req_t *req, httpd_req_t **out);
+esp_err_t httpd_req_async_handler_complete(httpd_req_t *req);
+
+/* lwip/sockets.h: UDP sockets live in the simulator; other types go to the host. */
+int sim_socket(int domain, int type, int protocol);
+int sim_bind(int fd, const struct sockaddr *addr, socklen_t len);
+ssize_t sim_recvfrom(int fd, void *buf, size_t len, int flags, struct sockaddr *from, socklen_t *from_len);
+ssize_t sim_sendto(int fd, const void *buf, size_t len, int flags, const struct sockaddr *to, socklen_t to_len);
+int sim_close(int fd);
+
+/* mdns.h */
+typedef struct { const char *key; const char *value; } mdns_txt_item_t;
+esp_err_t mdns_init(void);
+esp_err_t mdns_hostname_set(const char *hostname);
+esp_err_t mdns_instance_name_set(const char *name);
+esp_err_t mdns_service_add(const char *instance, const char *service, const char *proto,
+                           uint16_t port, mdns_txt_item_t *txt, size_t num_items);
+esp_err_t mdns_service_txt_item_set_async(const char *service, const char *proto, const char *key, const char *value);
+typedef enum { MDNS_MEM_POOL_TX_PACKET, MDNS_MEM_POOL_ANSWER, MDNS_MEM_POOL_QUESTION, MDNS_MEM_POOL_MAX } mdns_mem_pool_t;
+typedef struct {
+    size_t block_size, capacity, in_use, high_water;
+    uint32_t heap_allocs;
+} mdns_mem_pool_stats_t;
+esp_err_t mdns_mem_pool_get_stats(mdns_mem_pool_t pool, mdns_mem_pool_stats_t *stats);
+typedef struct { uint32_t sent, dropped, deferred; } mdns_tx_stats_t;
+esp_err_t mdns_tx_get_stats(mdns_tx_stats_t *stats);
@@ -0,0 +1,18 @@
+/*
+ * Host build: lwIP's BSD socket API is the host's, except that UDP sockets
+ * are simulated (idf_mock.c) so no host port is bound and a task blocked in
+ * recvfrom() waits like any other task.
+ */
+#pragma once
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "idf_mock.h"
+
+#define socket(domain, type, proto)   sim_socket(domain, type, proto)
+#define bind(fd, addr, len)           sim_bind(fd, addr, len)
+#define recvfrom(fd, buf, len, flags, from, from_len) sim_recvfrom(fd, buf, len, flags, from, from_len)
+#define sendto(fd, buf, len, flags, to, to_len)       sim_sendto(fd, buf, len, flags, to, to_len)
+#define close(fd)                     sim_close(fd)
@@ -0,0 +1,3 @@
+/* Host build: the sdkconfig.defaults values the firmware reads. */
+#pragma once
+#define CONFIG_LWIP_MAX_SOCKETS 32
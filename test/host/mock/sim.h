@@ -0,0 +1,109 @@
+/**
+ * Control side of the host simulator (idf_mock.c).
+ *
+ * Time is virtual: it only moves in sim_advance_us(), which fires esp_timer
+ * callbacks and wakes timed-out tasks in order. The caller of the sim_*
+ * functions plays every non-task context – GPIO ISR, esp_timer task, httpd
+ * task, WiFi event loop – and firmware tasks run only while it waits in
+ * sim_settle(), so a test is fully deterministic.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <netinet/in.h>
+#include "idf_mock.h"
+
+/* Take the simulator lock on the calling thread. Call once, before app_main(). */
+void sim_init(void);
+
+/* Let every runnable task and queued httpd work item run until all are idle. */
+void sim_settle(void);
+
+/* Move virtual time forward, firing timers and task timeouts on the way; ends settled. */
+void sim_advance_us(int64_t us);
+#define sim_advance_ms(ms) sim_advance_us((int64_t)(ms) * 1000)
+
+/* Drive an input pin; a matching edge raises the registered GPIO ISR. Does not settle. */
+void sim_gpio_set_level(gpio_num_t gpio, int level);
+/* Last level written to an output pin. */
+int sim_gpio_output(gpio_num_t gpio);
+/* Interrupt type the pin is set to (trigger.c flips level interrupts in POWER_SAVE_ENABLE builds). */
+gpio_int_type_t sim_gpio_intr_type(gpio_num_t gpio);
+
+/*
+ * The idle task light-sleeping, once esp_pm_configure() allowed it: the sleep
+ * hooks run around up to us of virtual time, cut short by the next timer or
+ * task timeout as tickless idle would. Returns the time slept; ends settled.
+ */
+int64_t sim_light_sleep_us(int64_t us);
+
+/* Pre-seed or inspect the RAM NVS. get returns false if the key is absent. */
+void sim_nvs_set_u8(const char *ns, const char *key, uint8_t value);
+void sim_nvs_set_u32(const char *ns, const char *key, uint32_t value);
+bool sim_nvs_get_u32(const char *ns, const char *key, uint32_t *out);
+/* nvs_commit() calls so far, and how many of the next ones should fail. */
+unsigned sim_nvs_commits(void);
+void sim_nvs_fail_commits(unsigned n);
+
+/* The RAM "evlog" partition: write and sector-erase calls so far; clear bits at offset (a torn write). */
+unsigned sim_flash_writes(void);
+unsigned sim_flash_erases(void);
+void sim_flash_corrupt(size_t offset, uint8_t mask);
+
+/* Whether an esp_timer created with this name is running. */
+bool sim_timer_armed(const char *name);
+
+/* OTA: boot the running image as pending verification (before app_main()). */
+void sim_ota_set_pending_verify(void);
+/* Bytes written by the last update, whether it became the boot image, and whether the running image was confirmed. */
+size_t sim_ota_written(void);
+bool sim_ota_boot_set(void);
+bool sim_ota_confirmed(void);
+
+/* Report an IP to the callback given to wifi_init_sta(), then settle. */
+void sim_wifi_got_ip(void);
+
+/* One HTTP exchange, as seen by the client. */
+typedef struct sim_http_resp {
+    bool   done;            /* response complete (a parked long-poll is not) */
+    int    status;
+    char   type[48];
+    char   etag[24];
+    char   body[16384];
+    size_t body_len;
+    int    fd;              /* socket the request arrived on */
+} sim_http_resp_t;
+
+/* Authorization header and body for the next sim_http() only; body must outlive that call. */
+void sim_http_set_request(const char *authorization, const void *body, size_t len);
+
+/*
+ * Run the registered handler for uri ("/status?since=3") in the httpd
+ * context, then settle. if_none_match may be NULL. Returns the handler's result.
+ */
+esp_err_t sim_http(httpd_method_t method, const char *uri, const char *if_none_match,
+                   sim_http_resp_t *resp);
+
+/* Current value of a TXT item of the advertised mDNS service, or NULL. */
+const char *sim_mdns_txt(const char *key);
+
+/* httpd_socket_send() traffic per socket: bytes and the last message (text/event-stream pushes). */
+size_t sim_sock_sent(int fd);
+const char *sim_sock_last(int fd);
+/* Make later sends on fd fail, as if the peer went away. */
+void sim_sock_break(int fd);
+
+/* One UDP datagram, as sent by the firmware. */
+typedef struct {
+    struct sockaddr_in to;
+    size_t             len;
+    uint8_t            data[1500];
+} sim_udp_pkt_t;
+
+/* Hand a datagram from `from` to the socket bound to port, then settle. False if nothing is bound there. */
+bool sim_udp_deliver(uint16_t port, const struct sockaddr_in *from, const void *data, size_t len);
+/* Datagrams sent so far from the socket bound to port, and the last of them (NULL if none). */
+unsigned sim_udp_sent(uint16_t port);
+const sim_udp_pkt_t *sim_udp_last(uint16_t port);
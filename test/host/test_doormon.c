@@ -0,0 +1,1000 @@
+/**
+ * Host tests for the firmware logic: trigger latching and filtering, NVS
+ * persistence, the flash event log, and the /status, /reset and /events
+ * handlers. Cases for the optional modules are compiled in when the module
+ * is (CMakeLists.txt builds this file once more per module, switched on).
+ *
+ * main.c is included whole so its statics are reachable. Each case boots the
+ * firmware from scratch in its own process: `doormon_host_test <case>` runs
+ * one, no argument runs them all.
+ */
+
+#include <string.h>
+#include <sys/wait.h>
+#include "sim.h"
+
+#include "main.c"
+
+#define DOOR_GPIO  trigger_inputs[0].gpio
+
+static int s_failures;
+
+#define CHECK(cond) do {                                                        \
+        if (!(cond)) {                                                          \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            s_failures++;                                                       \
+        }                                                                       \
+    } while (0)
+
+/* app_main() with the network up, as after the first DHCP lease. */
+static void boot(void)
+{
+    sim_init();
+    app_main();
+    sim_settle();
+    sim_wifi_got_ip();
+}
+
+/* Hold the door input low for ms, then release it and let the filter finish. */
+static void press(int ms)
+{
+    sim_gpio_set_level(DOOR_GPIO, 0);
+    sim_advance_ms(ms);
+    sim_gpio_set_level(DOOR_GPIO, 1);
+    sim_advance_ms(TRIGGER_MIN_PULSE_MS + 1);
+}
+
+static void get_status(sim_http_resp_t *resp)
+{
+    sim_http(HTTP_GET, "/status", NULL, resp);
+}
+
+static void test_boot_idle(void)
+{
+    boot();
+    sim_http_resp_t r;
+    get_status(&r);
+    CHECK(r.done && r.status == 200);
+    CHECK(strcmp(r.type, "application/json") == 0);
+    CHECK(strstr(r.body, "\"triggered\":false,\"latched\":0,\"gen\":0") != NULL);
+    CHECK(strstr(r.body, "\"level\":1") != NULL);
+    CHECK(sim_gpio_output(LED_GPIO) == 0);
+    sim_advance_ms(NVS_COALESCE_MS * 2);
+    CHECK(sim_nvs_commits() == 0);
+}
+
+static void test_trigger_latches(void)
+{
+    boot();
+    press(TRIGGER_MIN_PULSE_MS * 3);
+    trigger_state_t st = trigger_snapshot();
+    CHECK(st.latched == 1 && st.gen == 1);
+    CHECK(st.in[0].seq == 1 && st.in[0].edges == 1 && st.in[0].filtered == 0);
+    CHECK(sim_gpio_output(LED_GPIO) == 1);
+
+    /* A second press while latched counts the edge but changes nothing else. */
+    press(TRIGGER_MIN_PULSE_MS * 3);
+    st = trigger_snapshot();
+    CHECK(st.latched == 1 && st.gen == 1 && st.in[0].seq == 1 && st.in[0].edges == 2);
+}
+
+static void test_short_pulse_filtered(void)
+{
+    boot();
+    press(TRIGGER_MIN_PULSE_MS / 2);
+    trigger_state_t st = trigger_snapshot();
+    CHECK(st.latched == 0 && st.gen == 0);
+    CHECK(st.in[0].filtered == 1 && st.in[0].edges == 0);
+    CHECK(sim_gpio_output(LED_GPIO) == 0);
+}
+
+static void test_bounce_is_one_edge(void)
+{
+    boot();
+    int64_t t0 = esp_timer_get_time();
+    /* Contact bounce: 1 ms chatter, then held low. */
+    for (int i = 0; i < 4; i++) {
+        sim_gpio_set_level(DOOR_GPIO, 0);
+        sim_advance_ms(1);
+        sim_gpio_set_level(DOOR_GPIO, 1);
+        sim_advance_ms(1);
+    }
+    press(TRIGGER_MIN_PULSE_MS * 2);
+    trigger_state_t st = trigger_snapshot();
+    CHECK(st.latched == 1 && st.in[0].edges == 1);
+    /* Latched at the first bounce: that edge's timestamp is kept. */
+    CHECK(st.in[0].time_us == t0);
+}
+
+static void test_reset(void)
+{
+    boot();
+    press(TRIGGER_MIN_PULSE_MS * 3);
+    sim_http_resp_t r;
+    sim_http(HTTP_POST, "/reset", NULL, &r);
+    CHECK(r.done && r.status == 200 && strcmp(r.body, "{\"reset\":true}") == 0);
+    trigger_state_t st = trigger_snapshot();
+    CHECK(st.latched == 0 && st.gen == 2 && st.in[0].seq == 0);
+    CHECK(sim_gpio_output(LED_GPIO) == 0);
+
+    sim_http(HTTP_GET, "/reset?input=door", NULL, &r);
+    CHECK(r.status == 200);
+    sim_http(HTTP_POST, "/reset?input=nope", NULL, &r);
+    CHECK(r.done && r.status == 400);
+}
+
+static void test_nvs_coalesces(void)
+{
+    boot();
+    /* Latch and clear inside one window: ends where it began, nothing written. */
+    press(TRIGGER_MIN_PULSE_MS * 3);
+    sim_http_resp_t r;
+    sim_http(HTTP_POST, "/reset", NULL, &r);
+    sim_advance_ms(NVS_COALESCE_MS * 2);
+    CHECK(sim_nvs_commits() == 0);
+
+    press(TRIGGER_MIN_PULSE_MS * 3);
+    sim_advance_ms(NVS_COALESCE_MS / 2);
+    CHECK(sim_nvs_commits() == 0);
+    sim_advance_ms(NVS_COALESCE_MS);
+    uint32_t v = 0;
+    CHECK(sim_nvs_commits() == 1);
+    CHECK(sim_nvs_get_u32(NVS_NAMESPACE, NVS_KEY_LATCH, &v) && v == 1);
+}
+
+static void test_nvs_restore(void)
+{
+    sim_nvs_set_u32(NVS_NAMESPACE, NVS_KEY_LATCH, 1);
+    boot();
+    trigger_state_t st = trigger_snapshot();
+    CHECK(st.latched == 1);
+    CHECK(sim_gpio_output(LED_GPIO) == 1);
+    sim_http_resp_t r;
+    get_status(&r);
+    CHECK(strstr(r.body, "\"triggered\":true") != NULL);
+}
+
+static void test_nvs_legacy_migration(void)
+{
+    sim_nvs_set_u8(NVS_NAMESPACE, NVS_KEY_TRIG, 1);
+    boot();
+    CHECK(trigger_snapshot().latched == 1);
+    /* Nothing is known to be in NVS_KEY_LATCH yet, so the first save writes it. */
+    sim_http_resp_t r;
+    sim_http(HTTP_POST, "/reset", NULL, &r);
+    press(TRIGGER_MIN_PULSE_MS * 3);
+    sim_advance_ms(NVS_COALESCE_MS * 2);
+    uint32_t v = 0;
+    CHECK(sim_nvs_get_u32(NVS_NAMESPACE, NVS_KEY_LATCH, &v) && v == 1);
+}
+
+static void test_nvs_retry(void)
+{
+    boot();
+    sim_nvs_fail_commits(1);
+    press(TRIGGER_MIN_PULSE_MS * 3);
+    sim_advance_ms(NVS_COALESCE_MS * 2);
+    CHECK(sim_nvs_commits() == 1);
+    CHECK(atomic_load(&metrics_nvs_errors) == 1);
+    sim_advance_ms(NVS_RETRY_MS);
+    uint32_t v = 0;
+    CHECK(sim_nvs_commits() == 2);
+    CHECK(sim_nvs_get_u32(NVS_NAMESPACE, NVS_KEY_LATCH, &v) && v == 1);
+}
+
+static void test_status_etag(void)
+{
+    boot();
+    sim_http_resp_t r;
+    get_status(&r);
+    char etag[24];
+    snprintf(etag, sizeof(etag), "%s", r.etag);
+    CHECK(etag[0] == '"');
+
+    sim_http(HTTP_GET, "/status", etag, &r);
+    CHECK(r.done && r.status == 304 && r.body_len == 0);
+
+    press(TRIGGER_MIN_PULSE_MS * 3);
+    sim_http(HTTP_GET, "/status", etag, &r);
+    CHECK(r.status == 200 && strcmp(r.etag, etag) != 0);
+}
+
+static void test_longpoll_wakes(void)
+{
+    boot();
+    sim_http_resp_t r;
+    sim_http(HTTP_GET, "/status?since=0&wait=10", NULL, &r);
+    CHECK(!r.done);
+    sim_advance_ms(1000);
+    CHECK(!r.done);
+    press(TRIGGER_MIN_PULSE_MS * 3);
+    CHECK(r.done && r.status == 200);
+    CHECK(strstr(r.body, "\"gen\":1") != NULL);
+
+    /* Stale generation answers at once. */
+    sim_http(HTTP_GET, "/status?since=0&wait=10", NULL, &r);
+    CHECK(r.done && strstr(r.body, "\"gen\":1") != NULL);
+}
+
+static void test_longpoll_times_out(void)
+{
+    boot();
+    sim_http_resp_t r;
+    sim_http(HTTP_GET, "/status?since=0&wait=2", NULL, &r);
+    CHECK(!r.done);
+    sim_advance_ms(1999);
+    CHECK(!r.done);
+    sim_advance_ms(2);
+    CHECK(r.done && strstr(r.body, "\"gen\":0") != NULL);
+}
+
+static void test_events_stream(void)
+{
+    boot();
+    sim_http_resp_t r;
+    sim_http(HTTP_GET, "/events", NULL, &r);
+    CHECK(strncmp(sim_sock_last(r.fd), "event: state\ndata: {", 20) == 0);
+    size_t sent = sim_sock_sent(r.fd);
+
+    press(TRIGGER_MIN_PULSE_MS * 3);
+    CHECK(sim_sock_sent(r.fd) > sent);
+    CHECK(strstr(sim_sock_last(r.fd), "\"gen\":1") != NULL);
+
+    sim_advance_ms(SSE_KEEPALIVE_MS);
+    CHECK(strcmp(sim_sock_last(r.fd), ": keepalive\n\n") == 0);
+
+    /* A vanished subscriber frees its slot on the next push. */
+    sim_sock_break(r.fd);
+    sim_http(HTTP_POST, "/reset", NULL, &r);
+    int used = 0;
+    for (int i = 0; i < SSE_MAX_CLIENTS; i++) {
+        used += s_sse_fds[i] >= 0;
+    }
+    CHECK(used == 0);
+}
+
+static void test_mdns_txt(void)
+{
+    boot();
+    CHECK(strcmp(sim_mdns_txt("triggered"), "0") == 0);
+    CHECK(strcmp(sim_mdns_txt("seq"), "0") == 0);
+    press(TRIGGER_MIN_PULSE_MS * 3);
+    CHECK(strcmp(sim_mdns_txt("triggered"), "1") == 0);
+    CHECK(strcmp(sim_mdns_txt("seq"), "1") == 0);
+    sim_http_resp_t r;
+    sim_http(HTTP_POST, "/reset", NULL, &r);
+    CHECK(strcmp(sim_mdns_txt("triggered"), "0") == 0);
+    CHECK(strcmp(sim_mdns_txt("seq"), "2") == 0);
+}
+
+/* Pull one unsigned JSON field out of a body; UINT32_MAX if absent. */
+static uint32_t json_u32(const char *body, const char *key)
+{
+    char pat[32];
+    snprintf(pat, sizeof(pat), "\"%s\":", key);
+    const char *p = strstr(body, pat);
+    return p ? (uint32_t)strtoul(p + strlen(pat), NULL, 10) : UINT32_MAX;
+}
+
+static void test_evlog_history(void)
+{
+    boot();
+    press(TRIGGER_MIN_PULSE_MS * 3);
+    press(TRIGGER_MIN_PULSE_MS * 3);
+    sim_http_resp_t r;
+    sim_http(HTTP_POST, "/reset?input=door", NULL, &r);
+    /* Four records wait in RAM for a full page, then go out together after EVLOG_FLUSH_MS. */
+    CHECK(sim_flash_writes() == 0);
+    sim_http(HTTP_GET, "/events/history", NULL, &r);
+    CHECK(r.done && r.status == 200 && strcmp(r.type, "application/json") == 0);
+    CHECK(strstr(r.body, "{\"seq\":1,\"boot\":0,\"uptime_ms\":0,\"event\":\"boot\",\"latched\":0}") != NULL);
+    CHECK(strstr(r.body, "{\"seq\":2,\"boot\":0,") != NULL && strstr(r.body, "\"event\":\"trigger\",\"input\":\"door\",\"edge\":1}") != NULL);
+    CHECK(strstr(r.body, "\"event\":\"edge\",\"input\":\"door\",\"edge\":2}") != NULL);
+    CHECK(strstr(r.body, "\"event\":\"reset\",\"input\":\"door\",\"cleared\":1}") != NULL);
+    CHECK(json_u32(r.body, "next") == 5 && strstr(r.body, "\"more\":false}") != NULL);
+    sim_advance_ms(EVLOG_FLUSH_MS);
+    CHECK(sim_flash_writes() == 1 && sim_flash_erases() == 1);
+
+    /* Paging: two at a time, from a cursor. */
+    sim_http(HTTP_GET, "/events/history?limit=2", NULL, &r);
+    CHECK(json_u32(r.body, "first") == 1 && json_u32(r.body, "head") == 5);
+    CHECK(strstr(r.body, "\"seq\":1,") && strstr(r.body, "\"seq\":2,") && !strstr(r.body, "\"seq\":3,"));
+    CHECK(json_u32(r.body, "next") == 3 && strstr(r.body, "\"more\":true}") != NULL);
+    sim_http(HTTP_GET, "/events/history?cursor=3&limit=2", NULL, &r);
+    CHECK(strstr(r.body, "\"seq\":3,") && strstr(r.body, "\"seq\":4,"));
+    CHECK(json_u32(r.body, "next") == 5 && strstr(r.body, "\"more\":false}") != NULL);
+    sim_http(HTTP_GET, "/events/history?cursor=5", NULL, &r);
+    CHECK(strstr(r.body, "\"records\":[],\"next\":5,\"more\":false}") != NULL);
+}
+
+/* Records left over from a full page wait their own EVLOG_FLUSH_MS, not go out straight after it. */
+static void test_evlog_partial_page(void)
+{
+    boot();   /* seq 1 starts the clock */
+    sim_advance_ms(EVLOG_FLUSH_MS - 100);
+    int64_t t = esp_timer_get_time();
+    for (int i = 0; i < 16; i++) {
+        evlog_append(EVLOG_EDGE, 0, i, t);
+    }
+    evlog_service();
+    CHECK(sim_flash_writes() == 1);   /* seq 1-16; seq 17 waits */
+    sim_advance_ms(200);
+    CHECK(sim_flash_writes() == 1);
+    sim_advance_ms(EVLOG_FLUSH_MS);
+    CHECK(sim_flash_writes() == 2);
+    evlog_info_t info;
+    evlog_get_info(&info);
+    CHECK(info.lost == 0 && info.head == 18);
+}
+
+/* A reboot rescans the flash: the sequence continues, the boot number moves on, a torn record is skipped. */
+static void test_evlog_recovery(void)
+{
+    boot();
+    for (int i = 0; i < 20; i++) {
+        press(TRIGGER_MIN_PULSE_MS * 3);
+    }
+    sim_advance_ms(EVLOG_FLUSH_MS);
+    CHECK(sim_flash_writes() == 2);   /* a full page at once, the remaining five after the timeout */
+    sim_flash_corrupt(20 * EVLOG_REC_LEN + 4, 0x01);   /* seq 21 lost its last write */
+
+    evlog_init();
+    evlog_append(EVLOG_BOOT, EVLOG_INPUT_NONE, trigger_snapshot().latched, esp_timer_get_time());
+    evlog_info_t info;
+    evlog_get_info(&info);
+    CHECK(info.boot == 1 && info.first == 1 && info.head == 22);
+    sim_advance_ms(EVLOG_FLUSH_MS);
+
+    sim_http_resp_t r;
+    sim_http(HTTP_GET, "/events/history?cursor=19", NULL, &r);
+    CHECK(strstr(r.body, "{\"seq\":20,\"boot\":0,") != NULL);
+    CHECK(strstr(r.body, "{\"seq\":21,\"boot\":0,") == NULL);
+    CHECK(strstr(r.body, "{\"seq\":21,\"boot\":1,") != NULL);
+    CHECK(strstr(r.body, "\"event\":\"boot\",\"latched\":1}") != NULL);
+    CHECK(json_u32(r.body, "next") == 22);
+}
+
+/* Past the end of the partition the head erases the oldest sector, one sector per trip. */
+static void test_evlog_wraps(void)
+{
+    boot();
+    int64_t t = esp_timer_get_time();
+    for (int i = 0; i < 1100; i++) {
+        evlog_append(EVLOG_EDGE, 0, i, t);
+        evlog_service();
+    }
+    sim_advance_ms(EVLOG_FLUSH_MS);
+    evlog_info_t info;
+    evlog_get_info(&info);
+    CHECK(info.lost == 0 && info.head == 1102);
+    CHECK(info.erases == 5 && sim_flash_erases() == 5);   /* four sectors of 256, then the first again */
+    CHECK(info.first == 257);
+    CHECK(info.writes == (1101 + 15) / 16);
+
+    sim_http_resp_t r;
+    sim_http(HTTP_GET, "/events/history?cursor=1&limit=3", NULL, &r);
+    CHECK(json_u32(r.body, "first") == 257 && strstr(r.body, "{\"seq\":257,") != NULL);
+    CHECK(json_u32(r.body, "next") == 260);
+    sim_http(HTTP_GET, "/events/history?cursor=1100&limit=500", NULL, &r);
+    CHECK(strstr(r.body, "{\"seq\":1101,") != NULL && json_u32(r.body, "next") == 1102);
+
+    evlog_init();
+    evlog_get_info(&info);
+    CHECK(info.first == 257 && info.head == 1102 && info.boot == 1);
+}
+
+static void test_metrics(void)
+{
+    boot();
+    press(TRIGGER_MIN_PULSE_MS * 3);
+    sim_http_resp_t r;
+    get_status(&r);
+    sim_http(HTTP_GET, "/metrics", NULL, &r);
+    CHECK(r.done && r.status == 200);
+    CHECK(strstr(r.body, "doormon_trigger_latch_seconds_count 1\n") != NULL);
+    CHECK(strstr(r.body, "doormon_http_request_duration_seconds_count{path=\"/status\"} 1\n") != NULL);
+    CHECK(strstr(r.body, "doormon_task_stack_free_min_bytes{task=\"event\"}") != NULL);
+    CHECK(strstr(r.body, "doormon_mdns_pool_high_water{pool=\"packet\"} 0\n") != NULL);
+    CHECK(strstr(r.body, "doormon_mdns_tx_deferred_total 0\n") != NULL);
+    CHECK(strstr(r.body, "doormon_evlog_records 2\n") != NULL);
+    CHECK(strstr(r.body, "doormon_trigger_handled_edges_total 1\n") != NULL);
+    CHECK(strstr(r.body, "doormon_trigger_report_seconds_count 1\n") != NULL);
+    CHECK(strstr(r.body, "doormon_trigger_reports_over_target_total 0\n") != NULL);
+    CHECK(strstr(r.body, "doormon_trigger_handler_latency_seconds{stat=\"max\"} 0.000000\n") != NULL);
+    CHECK(strstr(r.body, "doormon_task_stack_free_min_bytes{task=\"trigger\"}") != NULL);
+}
+
+#if COAP_ENABLE
+/* A CoAP client at 192.168.1.5:40000, talking to the coap task over the simulated UDP socket. */
+
+enum { CT_CON = 0, CT_NON = 1, CT_ACK = 2, CT_RST = 3 };
+#define CC(c, dd)  (((c) << 5) | (dd))
+
+static const uint8_t s_coap_token[2] = { 0xca, 0xfe };
+
+typedef struct {
+    uint8_t  buf[256];
+    size_t   n;
+    unsigned last_opt;
+} coap_msg_t;
+
+/* Header and the fixed two-byte token. */
+static void coap_msg(coap_msg_t *m, int type, int code, uint16_t mid)
+{
+    uint8_t h[4] = { (uint8_t)(0x40 | type << 4 | sizeof(s_coap_token)), (uint8_t)code, (uint8_t)(mid >> 8), (uint8_t)mid };
+    memcpy(m->buf, h, 4);
+    memcpy(m->buf + 4, s_coap_token, sizeof(s_coap_token));
+    m->n = 4 + sizeof(s_coap_token);
+    m->last_opt = 0;
+}
+
+/* Options in ascending order; delta and length below 269. */
+static void coap_opt(coap_msg_t *m, unsigned num, const void *val, size_t len)
+{
+    unsigned delta = num - m->last_opt;
+    uint8_t *h = &m->buf[m->n++];
+    *h = (uint8_t)((delta < 13 ? delta : 13) << 4 | (len < 13 ? len : 13));
+    if (delta >= 13) {
+        m->buf[m->n++] = (uint8_t)(delta - 13);
+    }
+    if (len >= 13) {
+        m->buf[m->n++] = (uint8_t)(len - 13);
+    }
+    memcpy(m->buf + m->n, val, len);
+    m->n += len;
+    m->last_opt = num;
+}
+
+/* A request to path ("/status"); observe < 0 and etag NULL leave those options out. */
+static void coap_req(coap_msg_t *m, int type, int code, uint16_t mid, const char *path, const char *query,
+                     int observe, const uint8_t etag[8])
+{
+    coap_msg(m, type, code, mid);
+    if (etag) {
+        coap_opt(m, 4, etag, 8);
+    }
+    if (observe >= 0) {
+        uint8_t v = (uint8_t)observe;
+        coap_opt(m, 6, &v, observe ? 1 : 0);
+    }
+    while (*path == '/') {
+        path++;
+        size_t len = strcspn(path, "/");
+        coap_opt(m, 11, path, len);
+        path += len;
+    }
+    if (query) {
+        coap_opt(m, 15, query, strlen(query));
+    }
+}
+
+static struct sockaddr_in coap_peer(void)
+{
+    struct sockaddr_in a = { .sin_family = AF_INET, .sin_port = htons(40000) };
+    a.sin_addr.s_addr = htonl(0xc0a80105);
+    return a;
+}
+
+static void coap_send(const void *buf, size_t len)
+{
+    struct sockaddr_in peer = coap_peer();
+    CHECK(sim_udp_deliver(COAP_PORT, &peer, buf, len));
+}
+
+/* The last datagram the server sent, decoded. */
+typedef struct {
+    int      type;
+    int      code;
+    uint16_t mid;
+    bool     token_ok;          /* echoes s_coap_token */
+    uint8_t  etag[8];
+    bool     has_etag;
+    bool     has_observe;
+    uint32_t observe;
+    char     payload[COAP_MAX_PKT + 1];
+    size_t   payload_len;
+    struct sockaddr_in to;
+} coap_resp_t;
+
+static bool coap_last(coap_resp_t *r)
+{
+    memset(r, 0, sizeof(*r));
+    const sim_udp_pkt_t *p = sim_udp_last(COAP_PORT);
+    if (!p || p->len < 4 || (p->data[0] >> 6) != 1) {
+        return false;
+    }
+    const uint8_t *d = p->data;
+    unsigned tkl = d[0] & 0x0f;
+    r->type = (d[0] >> 4) & 3;
+    r->code = d[1];
+    r->mid = (uint16_t)(d[2] << 8 | d[3]);
+    r->token_ok = tkl == sizeof(s_coap_token) && memcmp(d + 4, s_coap_token, tkl) == 0;
+    r->to = p->to;
+    size_t i = 4 + tkl;
+    unsigned num = 0;
+    while (i < p->len && d[i] != 0xff) {
+        unsigned delta = d[i] >> 4, len = d[i] & 0x0f;
+        i++;
+        if (delta == 13) {
+            delta = 13 + d[i++];
+        }
+        if (len == 13) {
+            len = 13 + d[i++];
+        }
+        num += delta;
+        if (num == 4 && len == 8) {
+            memcpy(r->etag, d + i, 8);
+            r->has_etag = true;
+        } else if (num == 6) {
+            r->has_observe = true;
+            for (unsigned b = 0; b < len; b++) {
+                r->observe = r->observe << 8 | d[i + b];
+            }
+        }
+        i += len;
+    }
+    if (i < p->len) {
+        r->payload_len = p->len - i - 1;
+        memcpy(r->payload, d + i + 1, r->payload_len);
+    }
+    return true;
+}
+
+static void test_coap_messages(void)
+{
+    boot();
+    coap_resp_t r;
+
+    /* CoAP ping: an empty CON is answered with RST. */
+    const uint8_t ping[4] = { 0x40, 0x00, 0x00, 0x01 };
+    coap_send(ping, sizeof(ping));
+    CHECK(coap_last(&r) && r.type == CT_RST && r.code == 0 && r.mid == 1);
+
+    /* Token length past the end: a malformed CON is rejected with RST. */
+    const uint8_t torn[4] = { 0x48, CC(0, 1), 0x00, 0x02 };
+    coap_send(torn, sizeof(torn));
+    CHECK(coap_last(&r) && r.type == CT_RST && r.mid == 2);
+
+    coap_msg_t m;
+    coap_req(&m, CT_CON, CC(0, 1), 3, "/nope", NULL, -1, NULL);
+    coap_send(m.buf, m.n);
+    CHECK(coap_last(&r) && r.type == CT_ACK && r.code == CC(4, 4) && r.mid == 3 && r.token_ok);
+    CHECK(ntohs(r.to.sin_port) == 40000);
+
+    /* An unsupported critical (odd) option: Block2, there is no block-wise transfer. */
+    coap_req(&m, CT_CON, CC(0, 1), 4, "/status", NULL, -1, NULL);
+    coap_opt(&m, 23, "\x02", 1);
+    coap_send(m.buf, m.n);
+    CHECK(coap_last(&r) && r.code == CC(4, 2) && r.mid == 4);
+
+    coap_req(&m, CT_CON, CC(0, 1), 5, "/.well-known/core", NULL, -1, NULL);
+    coap_send(m.buf, m.n);
+    CHECK(coap_last(&r) && r.code == CC(2, 5) && strstr(r.payload, "</status>;") != NULL);
+
+    /* NON is answered with NON under the server's own message ID. */
+    coap_req(&m, CT_NON, CC(0, 1), 6, "/status", NULL, -1, NULL);
+    coap_send(m.buf, m.n);
+    CHECK(coap_last(&r) && r.type == CT_NON && r.code == CC(2, 5) && r.mid != 6 && r.token_ok);
+
+    /* ACKs and responses sent to the server get no answer. */
+    unsigned sent = sim_udp_sent(COAP_PORT);
+    const uint8_t ack[4] = { 0x60, 0x00, 0x12, 0x34 };
+    coap_send(ack, sizeof(ack));
+    coap_msg(&m, CT_CON, CC(2, 5), 7);
+    coap_send(m.buf, m.n);
+    CHECK(sim_udp_sent(COAP_PORT) == sent);
+}
+
+static void test_coap_status_etag(void)
+{
+    boot();
+    coap_msg_t m;
+    coap_resp_t r;
+    coap_req(&m, CT_CON, CC(0, 1), 10, "/status", NULL, -1, NULL);
+    coap_send(m.buf, m.n);
+    CHECK(coap_last(&r) && r.type == CT_ACK && r.code == CC(2, 5) && r.mid == 10 && r.token_ok);
+    CHECK(r.has_etag && !r.has_observe);
+    CHECK(strstr(r.payload, "\"triggered\":false,\"latched\":0,\"gen\":0") != NULL);
+    uint8_t etag[8];
+    memcpy(etag, r.etag, sizeof(etag));
+
+    coap_req(&m, CT_CON, CC(0, 1), 11, "/status", NULL, -1, etag);
+    coap_send(m.buf, m.n);
+    CHECK(coap_last(&r) && r.code == CC(2, 3) && r.payload_len == 0);
+    CHECK(r.has_etag && memcmp(r.etag, etag, sizeof(etag)) == 0);
+
+    press(TRIGGER_MIN_PULSE_MS * 3);
+    coap_req(&m, CT_CON, CC(0, 1), 12, "/status", NULL, -1, etag);
+    coap_send(m.buf, m.n);
+    CHECK(coap_last(&r) && r.code == CC(2, 5) && memcmp(r.etag, etag, sizeof(etag)) != 0);
+    CHECK(strstr(r.payload, "\"gen\":1") != NULL);
+}
+
+static void test_coap_reset(void)
+{
+    boot();
+    press(TRIGGER_MIN_PULSE_MS * 3);
+    coap_msg_t m;
+    coap_resp_t r;
+    coap_req(&m, CT_CON, CC(0, 2), 20, "/reset", NULL, -1, NULL);
+    coap_send(m.buf, m.n);
+    CHECK(coap_last(&r) && r.code == CC(2, 4) && strcmp(r.payload, "{\"reset\":true}") == 0);
+    CHECK(trigger_snapshot().latched == 0);
+
+    press(TRIGGER_MIN_PULSE_MS * 3);
+    coap_req(&m, CT_CON, CC(0, 2), 21, "/reset", "input=nope", -1, NULL);
+    coap_send(m.buf, m.n);
+    CHECK(coap_last(&r) && r.code == CC(4, 0));
+    CHECK(trigger_snapshot().latched == 1);
+    coap_req(&m, CT_CON, CC(0, 1), 22, "/reset", NULL, -1, NULL);
+    coap_send(m.buf, m.n);
+    CHECK(coap_last(&r) && r.code == CC(4, 5));
+    coap_req(&m, CT_CON, CC(0, 2), 23, "/reset", "input=door", -1, NULL);
+    coap_send(m.buf, m.n);
+    CHECK(coap_last(&r) && r.code == CC(2, 4));
+    CHECK(trigger_snapshot().latched == 0);
+}
+
+static void test_coap_observe(void)
+{
+    boot();
+    coap_msg_t m;
+    coap_resp_t r;
+    coap_req(&m, CT_CON, CC(0, 1), 30, "/status", NULL, 0, NULL);
+    coap_send(m.buf, m.n);
+    CHECK(coap_last(&r) && r.code == CC(2, 5) && r.has_observe);
+    uint32_t seq = r.observe;
+    unsigned sent = sim_udp_sent(COAP_PORT);
+
+    /* Every state change is pushed as a NON notification with a newer sequence number. */
+    press(TRIGGER_MIN_PULSE_MS * 3);
+    CHECK(sim_udp_sent(COAP_PORT) == sent + 1);
+    CHECK(coap_last(&r) && r.type == CT_NON && r.code == CC(2, 5) && r.token_ok);
+    CHECK(r.has_observe && r.observe > seq && strstr(r.payload, "\"gen\":1") != NULL);
+
+    /* Observe 1 deregisters: the answer carries no Observe and nothing follows. */
+    coap_req(&m, CT_CON, CC(0, 1), 31, "/status", NULL, 1, NULL);
+    coap_send(m.buf, m.n);
+    CHECK(coap_last(&r) && r.code == CC(2, 5) && !r.has_observe);
+    sent = sim_udp_sent(COAP_PORT);
+    sim_http_resp_t h;
+    sim_http(HTTP_POST, "/reset", NULL, &h);
+    CHECK(sim_udp_sent(COAP_PORT) == sent);
+}
+
+static void test_coap_observe_rst(void)
+{
+    boot();
+    coap_msg_t m;
+    coap_resp_t r;
+    coap_req(&m, CT_NON, CC(0, 1), 40, "/status", NULL, 0, NULL);
+    coap_send(m.buf, m.n);
+    press(TRIGGER_MIN_PULSE_MS * 3);
+    CHECK(coap_last(&r) && r.type == CT_NON && r.has_observe);
+
+    /* RST answering that notification's message ID drops the observer. */
+    uint8_t rst[4] = { 0x70, 0x00, (uint8_t)(r.mid >> 8), (uint8_t)r.mid };
+    unsigned sent = sim_udp_sent(COAP_PORT);
+    coap_send(rst, sizeof(rst));
+    CHECK(sim_udp_sent(COAP_PORT) == sent);
+    sim_http_resp_t h;
+    sim_http(HTTP_POST, "/reset", NULL, &h);
+    CHECK(sim_udp_sent(COAP_PORT) == sent);
+}
+
+/* A retransmission gets the first answer again; the request is not run twice. */
+static void test_coap_duplicate(void)
+{
+    boot();
+    press(TRIGGER_MIN_PULSE_MS * 3);
+    coap_msg_t m;
+    coap_req(&m, CT_CON, CC(0, 2), 50, "/reset", NULL, -1, NULL);
+    coap_send(m.buf, m.n);
+    sim_udp_pkt_t first = *sim_udp_last(COAP_PORT);
+    CHECK(trigger_snapshot().latched == 0 && trigger_snapshot().gen == 2);
+
+    press(TRIGGER_MIN_PULSE_MS * 3);
+    unsigned sent = sim_udp_sent(COAP_PORT);
+    coap_send(m.buf, m.n);
+    CHECK(sim_udp_sent(COAP_PORT) == sent + 1);
+    CHECK(sim_udp_last(COAP_PORT)->len == first.len && memcmp(sim_udp_last(COAP_PORT)->data, first.data, first.len) == 0);
+    CHECK(trigger_snapshot().latched == 1 && trigger_snapshot().gen == 3);
+
+    /* Duplicate NON: dropped without an answer. */
+    coap_req(&m, CT_NON, CC(0, 2), 51, "/reset", NULL, -1, NULL);
+    coap_send(m.buf, m.n);
+    CHECK(trigger_snapshot().latched == 0);
+    press(TRIGGER_MIN_PULSE_MS * 3);
+    sent = sim_udp_sent(COAP_PORT);
+    coap_send(m.buf, m.n);
+    CHECK(sim_udp_sent(COAP_PORT) == sent && trigger_snapshot().latched == 1);
+
+    /* Same message ID from another port is another exchange. */
+    struct sockaddr_in other = coap_peer();
+    other.sin_port = htons(40001);
+    coap_req(&m, CT_CON, CC(0, 2), 50, "/reset", NULL, -1, NULL);
+    CHECK(sim_udp_deliver(COAP_PORT, &other, m.buf, m.n));
+    CHECK(trigger_snapshot().latched == 0);
+
+    /* After EXCHANGE_LIFETIME the message ID may be reused. */
+    press(TRIGGER_MIN_PULSE_MS * 3);
+    sim_advance_ms(247 * 1000);
+    coap_send(m.buf, m.n);
+    CHECK(trigger_snapshot().latched == 0);
+}
+
+/* Uri-Host and Uri-Port, as coap-client sends for coap://doormon.local/..., are ignored; Accept is honoured. */
+static void test_coap_options(void)
+{
+    boot();
+    press(TRIGGER_MIN_PULSE_MS * 3);
+    coap_msg_t m;
+    coap_resp_t r;
+    const uint8_t port[2] = { COAP_PORT >> 8, COAP_PORT & 0xff };
+    coap_msg(&m, CT_CON, CC(0, 1), 60);
+    coap_opt(&m, 3, "doormon.local", 13);
+    coap_opt(&m, 7, port, sizeof(port));
+    coap_opt(&m, 11, "status", 6);
+    coap_send(m.buf, m.n);
+    CHECK(coap_last(&r) && r.code == CC(2, 5) && r.mid == 60 && strstr(r.payload, "\"gen\":1") != NULL);
+
+    const uint8_t json = 50, link = 40;
+    coap_req(&m, CT_CON, CC(0, 1), 61, "/status", NULL, -1, NULL);
+    coap_opt(&m, 17, &json, 1);
+    coap_send(m.buf, m.n);
+    CHECK(coap_last(&r) && r.code == CC(2, 5) && r.payload_len > 0);
+
+    /* Accept: text/plain (0, an empty value) is not served. */
+    coap_req(&m, CT_CON, CC(0, 1), 62, "/status", NULL, -1, NULL);
+    coap_opt(&m, 17, "", 0);
+    coap_send(m.buf, m.n);
+    CHECK(coap_last(&r) && r.code == CC(4, 6) && r.payload_len == 0);
+
+    coap_req(&m, CT_CON, CC(0, 1), 63, "/.well-known/core", NULL, -1, NULL);
+    coap_opt(&m, 17, &link, 1);
+    coap_send(m.buf, m.n);
+    CHECK(coap_last(&r) && r.code == CC(2, 5) && strstr(r.payload, "</status>;") != NULL);
+    coap_req(&m, CT_CON, CC(0, 1), 64, "/.well-known/core", NULL, -1, NULL);
+    coap_opt(&m, 17, &json, 1);
+    coap_send(m.buf, m.n);
+    CHECK(coap_last(&r) && r.code == CC(4, 6));
+
+    /* Refused before it is applied. */
+    coap_req(&m, CT_CON, CC(0, 2), 65, "/reset", NULL, -1, NULL);
+    coap_opt(&m, 17, &link, 1);
+    coap_send(m.buf, m.n);
+    CHECK(coap_last(&r) && r.code == CC(4, 6) && trigger_snapshot().latched == 1);
+}
+#endif
+
+#if OTA_ENABLE
+/* A 3-chunk app image: the 0xE9 magic, then the app description at offset 32 naming project. */
+static uint8_t s_image[3 * OTA_CHUNK - 72];
+
+static void ota_image(const char *project)
+{
+    memset(s_image, 0x5a, sizeof(s_image));
+    s_image[0] = 0xe9;
+    esp_app_desc_t desc = { .magic_word = 0xabcd5432, .version = "2.0" };
+    snprintf(desc.project_name, sizeof(desc.project_name), "%s", project);
+    memcpy(s_image + 32, &desc, sizeof(desc));
+}
+
+static void ota_post(const char *auth, const void *body, size_t len, sim_http_resp_t *r)
+{
+    sim_http_set_request(auth, body, len);
+    sim_http(HTTP_POST, "/ota", NULL, r);
+}
+
+static void test_ota_unauthorized(void)
+{
+    boot();
+    ota_image("doormon");
+    sim_http_resp_t r;
+    const char *bad[] = { NULL, "", "Bearer", "Bearer wrong", "Bearer sim-toke", "Bearer sim-token2", "sim-token" };
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        ota_post(bad[i], s_image, sizeof(s_image), &r);
+        CHECK(r.done && r.status == 401 && strstr(r.body, "\"reason\":\"unauthorized\"") != NULL);
+    }
+    CHECK(sim_ota_written() == 0 && !sim_ota_boot_set());
+
+    ota_post("Bearer sim-token", NULL, 0, &r);
+    CHECK(r.done && r.status == 411);
+}
+
+static void test_ota_update(void)
+{
+    boot();
+    ota_image("doormon");
+    sim_http_resp_t r;
+    ota_post("Bearer sim-token", s_image, sizeof(s_image), &r);
+    CHECK(r.done && r.status == 200 && strcmp(r.type, "application/json") == 0);
+    CHECK(strstr(r.body, "\"ota\":\"ok\",\"version\":\"2.0\",\"partition\":\"ota_1\"") != NULL);
+    CHECK(json_u32(r.body, "bytes") == sizeof(s_image));
+    CHECK(sim_ota_written() == sizeof(s_image) && sim_ota_boot_set());
+    /* The restart follows OTA_RESTART_DELAY_MS later (esp_restart() ends the simulation). */
+    CHECK(sim_timer_armed("ota_restart"));
+}
+
+static void test_ota_wrong_project(void)
+{
+    boot();
+    ota_image("someone-else");
+    sim_http_resp_t r;
+    ota_post("Bearer sim-token", s_image, sizeof(s_image), &r);
+    CHECK(r.done && r.status == 400 && strstr(r.body, "\"reason\":\"image from another project\"") != NULL);
+    CHECK(sim_ota_written() == sizeof(s_image) && !sim_ota_boot_set());
+    CHECK(!sim_timer_armed("ota_restart"));
+
+    /* The slot is free again for the right image. */
+    ota_image("doormon");
+    ota_post("Bearer sim-token", s_image, sizeof(s_image), &r);
+    CHECK(r.status == 200 && sim_ota_boot_set());
+}
+
+static void test_ota_not_an_image(void)
+{
+    boot();
+    ota_image("doormon");
+    s_image[0] = 0;
+    sim_http_resp_t r;
+    ota_post("Bearer sim-token", s_image, sizeof(s_image), &r);
+    CHECK(r.done && r.status == 400 && strstr(r.body, "\"reason\":\"not an app image\"") != NULL);
+    CHECK(sim_ota_written() == 0 && !sim_ota_boot_set());
+}
+
+/* A pending image arms the rollback timer at boot; bringing httpd up confirms it and stops the timer. */
+static void test_ota_confirm(void)
+{
+    sim_ota_set_pending_verify();
+    sim_init();
+    app_main();
+    sim_settle();
+    CHECK(sim_timer_armed("ota_confirm") && !sim_ota_confirmed());
+    sim_advance_ms(OTA_CONFIRM_TIMEOUT_S * 1000 / 2);
+    CHECK(sim_timer_armed("ota_confirm"));
+
+    sim_wifi_got_ip();
+    CHECK(sim_ota_confirmed() && !sim_timer_armed("ota_confirm"));
+    /* Past the deadline: the timer would have restarted (and rolled back) here. */
+    sim_advance_ms(OTA_CONFIRM_TIMEOUT_S * 1000);
+    CHECK(trigger_snapshot().gen == 0);
+}
+#endif
+
+#if POWER_SAVE_ENABLE
+/* Two idle light sleeps: /metrics counts them and weighs the time asleep into the modelled current. */
+static void test_power_sleep_metrics(void)
+{
+    boot();
+    sim_advance_ms(1000);   /* awake */
+    uint64_t slept = (uint64_t)sim_light_sleep_us(2000000);
+    slept += (uint64_t)sim_light_sleep_us(2000000);
+    CHECK(slept > 0);
+    sim_http_resp_t r;
+    sim_http(HTTP_GET, "/metrics", NULL, &r);
+    CHECK(r.done && r.status == 200);
+
+    uint64_t up = (uint64_t)esp_timer_get_time();
+    uint64_t ua = (slept * POWER_SLEEP_UA + (up - slept) * POWER_AWAKE_UA) / up;
+    CHECK(ua < POWER_AWAKE_UA);
+    char want[160];
+    snprintf(want, sizeof(want),
+             "doormon_power_light_sleeps_total 2\n"
+             "# TYPE doormon_power_light_sleep_seconds_total counter\n"
+             "doormon_power_light_sleep_seconds_total %llu.%06u\n",
+             (unsigned long long)(slept / 1000000), (unsigned)(slept % 1000000));
+    CHECK(strstr(r.body, want) != NULL);
+    snprintf(want, sizeof(want), "doormon_power_modelled_current_amperes 0.%06u\n", (unsigned)ua);
+    CHECK(strstr(r.body, want) != NULL);
+}
+
+/* The door pin waits low while idle, high while held, and low again once released. */
+static void test_power_level_rearm(void)
+{
+    boot();
+    CHECK(sim_gpio_intr_type(DOOR_GPIO) == GPIO_INTR_LOW_LEVEL);
+
+    /* Held well past the filter: one edge, not one per debounce period. */
+    sim_gpio_set_level(DOOR_GPIO, 0);
+    sim_advance_ms(TRIGGER_MIN_PULSE_MS * 10);
+    trigger_state_t st = trigger_snapshot();
+    CHECK(st.latched == 1 && st.in[0].edges == 1);
+    CHECK(sim_gpio_intr_type(DOOR_GPIO) == GPIO_INTR_HIGH_LEVEL);
+
+    sim_gpio_set_level(DOOR_GPIO, 1);
+    sim_advance_ms(TRIGGER_MIN_PULSE_MS + 1);
+    st = trigger_snapshot();
+    CHECK(st.in[0].edges == 1 && st.in[0].filtered == 0);
+    CHECK(sim_gpio_intr_type(DOOR_GPIO) == GPIO_INTR_LOW_LEVEL);
+
+    /* A short pulse is filtered and leaves the pin waiting for the next press. */
+    press(TRIGGER_MIN_PULSE_MS / 2);
+    st = trigger_snapshot();
+    CHECK(st.in[0].edges == 1 && st.in[0].filtered == 1);
+    CHECK(sim_gpio_intr_type(DOOR_GPIO) == GPIO_INTR_LOW_LEVEL);
+
+    press(TRIGGER_MIN_PULSE_MS * 3);
+    st = trigger_snapshot();
+    CHECK(st.in[0].edges == 2 && st.in[0].filtered == 1);
+    CHECK(sim_gpio_intr_type(DOOR_GPIO) == GPIO_INTR_LOW_LEVEL);
+}
+#endif
+
+static const struct {
+    const char *name;
+    void (*fn)(void);
+} s_cases[] = {
+    { "boot_idle",            test_boot_idle },
+    { "trigger_latches",      test_trigger_latches },
+    { "short_pulse_filtered", test_short_pulse_filtered },
+    { "bounce_is_one_edge",   test_bounce_is_one_edge },
+    { "reset",                test_reset },
+    { "nvs_coalesces",        test_nvs_coalesces },
+    { "nvs_restore",          test_nvs_restore },
+    { "nvs_legacy_migration", test_nvs_legacy_migration },
+    { "nvs_retry",            test_nvs_retry },
+    { "status_etag",          test_status_etag },
+    { "longpoll_wakes",       test_longpoll_wakes },
+    { "longpoll_times_out",   test_longpoll_times_out },
+    { "events_stream",        test_events_stream },
+    { "mdns_txt",             test_mdns_txt },
+    { "evlog_history",        test_evlog_history },
+    { "evlog_partial_page",   test_evlog_partial_page },
+    { "evlog_recovery",       test_evlog_recovery },
+    { "evlog_wraps",          test_evlog_wraps },
+    { "metrics",              test_metrics },
+#if COAP_ENABLE
+    { "coap_messages",        test_coap_messages },
+    { "coap_status_etag",     test_coap_status_etag },
+    { "coap_reset",           test_coap_reset },
+    { "coap_observe",         test_coap_observe },
+    { "coap_observe_rst",     test_coap_observe_rst },
+    { "coap_duplicate",       test_coap_duplicate },
+    { "coap_options",         test_coap_options },
+#endif
+#if OTA_ENABLE
+    { "ota_unauthorized",     test_ota_unauthorized },
+    { "ota_update",           test_ota_update },
+    { "ota_wrong_project",    test_ota_wrong_project },
+    { "ota_not_an_image",     test_ota_not_an_image },
+    { "ota_confirm",          test_ota_confirm },
+#endif
+#if POWER_SAVE_ENABLE
+    { "power_sleep_metrics",  test_power_sleep_metrics },
+    { "power_level_rearm",    test_power_level_rearm },
+#endif
+};
+#define NUM_CASES (int)(sizeof(s_cases) / sizeof(s_cases[0]))
+
+int main(int argc, char **argv)
+{
+    if (argc > 1) {
+        for (int i = 0; i < NUM_CASES; i++) {
+            if (strcmp(argv[1], s_cases[i].name) == 0) {
+                s_cases[i].fn();
+                return s_failures ? 1 : 0;
+            }
+        }
+        fprintf(stderr, "unknown case '%s'\n", argv[1]);
+        return 2;
+    }
+
+    /* The firmware keeps its state in statics: one fresh process per case. */
+    int failed = 0;
+    for (int i = 0; i < NUM_CASES; i++) {
+        fflush(stdout);
+        pid_t pid = fork();
+        if (pid == 0) {
+            s_cases[i].fn();
+            _exit(s_failures ? 1 : 0);
+        }
+        int status = 0;
+        waitpid(pid, &status, 0);
+        bool ok = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+        printf("%-24s %s\n", s_cases[i].name, ok ? "ok" : "FAIL");
+        failed += !ok;
+    }
+    printf("%d/%d passed\n", NUM_CASES - failed, NUM_CASES);
+    return failed ? 1 : 0;
+}